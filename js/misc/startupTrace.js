@@ -0,0 +1,19 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Shell = imports.gi.Shell;
+
+// Imports the UI module @name, recording the time taken in the startup
+// trace. This includes the time taken by the modules it is the first to
+// import; the trace only knows about the imports that go through here.
+function importUI(name) {
+    if (!Shell.startup_trace_is_enabled())
+        return imports.ui[name];
+
+    let span = 'ui.' + name;
+    Shell.startup_trace_begin(span);
+    try {
+        return imports.ui[name];
+    } finally {
+        Shell.startup_trace_end(span);
+    }
+}
@@ -3,6 +3,7 @@
 const Clutter = imports.gi.Clutter;
 const Gio = imports.gi.Gio;
 const GLib = imports.gi.GLib;
+const Lang = imports.lang;
 const Shell = imports.gi.Shell;
 const St = imports.gi.St;
 
@@ -241,6 +242,189 @@ function insertSorted(array, val, cmp) {
     return pos;
 }
 
+// PriorityQueue:
+// @cmp: the sorting function
+// @keyFunc: (optional) a function returning the key an item is filed
+//           under, for findByKey()
+//
+// A binary heap that hands out its items in the order given by @cmp.
+// Items that compare equal come out in the order they were pushed.
+// An item is only queued once; looking it up or removing it doesn't
+// need to go through the whole queue.
+const PriorityQueue = new Lang.Class({
+    Name: 'PriorityQueue',
+
+    _init: function(cmp, keyFunc) {
+        this._cmp = cmp;
+        this._keyFunc = keyFunc || null;
+        this._heap = [];
+        this._entries = new Map();
+        this._keys = new Map();
+        this._serial = 0;
+    },
+
+    get length() {
+        return this._heap.length;
+    },
+
+    // Returns the first item without removing it, or %null if the
+    // queue is empty
+    peek: function() {
+        return this._heap.length > 0 ? this._heap[0].item : null;
+    },
+
+    // Does nothing if @item is already queued
+    push: function(item) {
+        if (this._entries.has(item))
+            return;
+
+        let entry = { item: item,
+                      serial: this._serial++,
+                      index: this._heap.length };
+        this._heap.push(entry);
+        this._entries.set(item, entry);
+        this._addKey(entry);
+        this._siftUp(entry.index);
+    },
+
+    // Removes and returns the first item, or %null if the queue is empty
+    shift: function() {
+        if (this._heap.length == 0)
+            return null;
+
+        let item = this._heap[0].item;
+        this._removeAt(0);
+        return item;
+    },
+
+    contains: function(item) {
+        return this._entries.has(item);
+    },
+
+    // Returns the first item, in no particular order, filed under @key
+    // for which @predicate returns %true, or %null
+    findByKey: function(key, predicate) {
+        let entries = this._keys.get(key);
+        if (!entries)
+            return null;
+
+        for (let i = 0; i < entries.length; i++) {
+            if (predicate(entries[i].item))
+                return entries[i].item;
+        }
+        return null;
+    },
+
+    // Returns %true if @item was in the queue
+    remove: function(item) {
+        let entry = this._entries.get(item);
+        if (!entry)
+            return false;
+
+        this._removeAt(entry.index);
+        return true;
+    },
+
+    // Removes all the items for which @predicate returns %true
+    removeAll: function(predicate) {
+        let heap = this._heap.filter(function(entry) {
+            return !predicate(entry.item);
+        });
+        if (heap.length == this._heap.length)
+            return;
+
+        this._heap = heap;
+        this._entries = new Map();
+        this._keys = new Map();
+        for (let i = 0; i < heap.length; i++) {
+            heap[i].index = i;
+            this._entries.set(heap[i].item, heap[i]);
+            this._addKey(heap[i]);
+        }
+
+        for (let i = (heap.length >> 1) - 1; i >= 0; i--)
+            this._siftDown(i);
+    },
+
+    _addKey: function(entry) {
+        if (!this._keyFunc)
+            return;
+
+        let key = this._keyFunc(entry.item);
+        let entries = this._keys.get(key);
+        if (entries)
+            entries.push(entry);
+        else
+            this._keys.set(key, [entry]);
+    },
+
+    _removeKey: function(entry) {
+        if (!this._keyFunc)
+            return;
+
+        let key = this._keyFunc(entry.item);
+        let entries = this._keys.get(key);
+        entries.splice(entries.indexOf(entry), 1);
+        if (entries.length == 0)
+            this._keys.delete(key);
+    },
+
+    _before: function(entry1, entry2) {
+        let res = this._cmp(entry1.item, entry2.item);
+        return res < 0 || (res == 0 && entry1.serial < entry2.serial);
+    },
+
+    _swap: function(i, j) {
+        let entry = this._heap[i];
+        this._heap[i] = this._heap[j];
+        this._heap[j] = entry;
+        this._heap[i].index = i;
+        this._heap[j].index = j;
+    },
+
+    _siftUp: function(i) {
+        while (i > 0) {
+            let parent = (i - 1) >> 1;
+            if (!this._before(this._heap[i], this._heap[parent]))
+                break;
+            this._swap(i, parent);
+            i = parent;
+        }
+    },
+
+    _siftDown: function(i) {
+        let length = this._heap.length;
+        while (true) {
+            let first = i;
+            let left = 2 * i + 1;
+            let right = left + 1;
+            if (left < length && this._before(this._heap[left], this._heap[first]))
+                first = left;
+            if (right < length && this._before(this._heap[right], this._heap[first]))
+                first = right;
+            if (first == i)
+                break;
+            this._swap(i, first);
+            i = first;
+        }
+    },
+
+    _removeAt: function(i) {
+        let entry = this._heap[i];
+        this._entries.delete(entry.item);
+        this._removeKey(entry);
+
+        let last = this._heap.pop();
+        if (i == this._heap.length)
+            return;
+
+        last.index = i;
+        this._heap[i] = last;
+        this._siftUp(i);
+        this._siftDown(last.index);
+    }
+});
+
 function getBrowserId() {
     let id = FALLBACK_BROWSER_ID;
     let app = Gio.app_info_get_default_for_type('x-scheme-handler/http', true);
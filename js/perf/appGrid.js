@@ -0,0 +1,121 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const System = imports.system;
+
+const AppDisplay = imports.ui.appDisplay;
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures how long it takes to open the folders
+// in the desktop icon grid, the first time (when the folder's icons are
+// created) and subsequent times.
+
+// Open each folder this many times; the first is reported separately
+const N_OPENS = 3;
+
+let METRICS = {
+    folderCount:
+    { description: "Number of folders in the icon grid",
+      units: "folders" },
+    folderOpenTimeFirstP50:
+    { description: "Median time to open a folder, first time",
+      units: "us" },
+    folderOpenTimeFirstMax:
+    { description: "Longest time to open a folder, first time",
+      units: "us" },
+    folderOpenTimeSubsequentP50:
+    { description: "Median time to open a folder, subsequent times",
+      units: "us" },
+    folderOpenTimeSubsequentMax:
+    { description: "Longest time to open a folder, subsequent times",
+      units: "us" },
+    folderCloseTimeP50:
+    { description: "Median time to close a folder",
+      units: "us" }
+};
+
+function _getFolderIcons() {
+    let allView = Main.overview._viewSelector._viewsDisplay.allView;
+    return allView.getAllIcons().filter(function(icon) {
+        return icon instanceof AppDisplay.FolderIcon;
+    });
+}
+
+function run() {
+    Scripting.defineScriptEvent("folderOpenFirstStart", "Starting to open a folder, first time");
+    Scripting.defineScriptEvent("folderOpenStart", "Starting to open a folder, subsequent time");
+    Scripting.defineScriptEvent("folderOpenDone", "Done opening a folder");
+    Scripting.defineScriptEvent("folderCloseStart", "Starting to close a folder");
+    Scripting.defineScriptEvent("folderCloseDone", "Done closing a folder");
+
+    yield Scripting.sleep(1000);
+
+    Main.overview.showApps();
+    yield Scripting.waitLeisure();
+
+    let folders = _getFolderIcons();
+    METRICS.folderCount.value = folders.length;
+
+    for (let i = 0; i < folders.length; i++) {
+        let folder = folders[i];
+
+        for (let k = 0; k < N_OPENS; k++) {
+            Scripting.scriptEvent(k == 0 ? 'folderOpenFirstStart' : 'folderOpenStart');
+            folder.actor.checked = true;
+            folder._activate();
+            yield Scripting.waitLeisure();
+            Scripting.scriptEvent('folderOpenDone');
+
+            Scripting.scriptEvent('folderCloseStart');
+            folder._popup.popdown();
+            yield Scripting.waitLeisure();
+            Scripting.scriptEvent('folderCloseDone');
+        }
+
+        System.gc();
+        yield Scripting.sleep(200);
+    }
+
+    Main.overview.hide();
+    yield Scripting.waitLeisure();
+}
+
+let openStart;
+let openFirst;
+let closeStart;
+let openFirstTimes = [];
+let openSubsequentTimes = [];
+let closeTimes = [];
+
+function script_folderOpenFirstStart(time) {
+    openStart = time;
+    openFirst = true;
+}
+
+function script_folderOpenStart(time) {
+    openStart = time;
+    openFirst = false;
+}
+
+function script_folderOpenDone(time) {
+    if (openFirst)
+        openFirstTimes.push(time - openStart);
+    else
+        openSubsequentTimes.push(time - openStart);
+}
+
+function script_folderCloseStart(time) {
+    closeStart = time;
+}
+
+function script_folderCloseDone(time) {
+    closeTimes.push(time - closeStart);
+}
+
+function finish() {
+    METRICS.folderOpenTimeFirstP50.value = Scripting.percentile(openFirstTimes, 50);
+    METRICS.folderOpenTimeFirstMax.value = Scripting.percentile(openFirstTimes, 100);
+    METRICS.folderOpenTimeSubsequentP50.value = Scripting.percentile(openSubsequentTimes, 50);
+    METRICS.folderOpenTimeSubsequentMax.value = Scripting.percentile(openSubsequentTimes, 100);
+    METRICS.folderCloseTimeP50.value = Scripting.percentile(closeTimes, 50);
+}
@@ -52,7 +52,13 @@ let METRICS = {
       units: "us" },
     applicationsShowTimeSubsequent:
     { description: "Time to switch to applications view, second time",
-      units: "us"}
+      units: "us"},
+    initializeUITime:
+    { description: "Time to construct the UI at startup",
+      units: "us" },
+    firstFrameLatency:
+    { description: "Time from the start of the UI construction to the first frame",
+      units: "us" }
 };
 
 let WINDOW_CONFIGS = [
@@ -134,6 +140,7 @@ let firstOverviewUsedSize;
 let haveSwapComplete = false;
 let applicationsShowStart;
 let applicationsShowCount = 0;
+let initializeUIStart;
 
 function script_overviewShowStart(time) {
     showingOverview = true;
@@ -173,7 +180,18 @@ function malloc_usedSize(time, bytes) {
     mallocUsedSize = bytes;
 }
 
+function main_initializeUIStart(time) {
+    initializeUIStart = time;
+}
+
+function main_initializeUIDone(time) {
+    METRICS.initializeUITime.value = time - initializeUIStart;
+}
+
 function _frameDone(time) {
+    if (initializeUIStart !== undefined && METRICS.firstFrameLatency.value === undefined)
+        METRICS.firstFrameLatency.value = time - initializeUIStart;
+
     if (showingOverview) {
         if (overviewFrames == 0)
             overviewLatency = time - overviewShowStart;
@@ -0,0 +1,168 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Mainloop = imports.mainloop;
+const System = imports.system;
+
+const Main = imports.ui.main;
+const MessageTray = imports.ui.messageTray;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures how well the message tray copes with
+// an application that floods it with notifications: how long it takes
+// to accept them, and how smooth the frames painted meanwhile are.
+
+const N_NOTIFICATIONS = 200;
+
+// Notifications are posted in batches from a timeout, to approximate
+// a misbehaving application sending them as fast as D-Bus allows
+const NOTIFICATIONS_PER_BATCH = 10;
+const BATCH_INTERVAL = 5; // ms
+
+// How long to keep watching frames after the last notification
+const SETTLE_TIME = 2000; // ms
+
+let METRICS = {
+    notificationStormPostTime:
+    { description: "Time to post all notifications to the message tray",
+      units: "us" },
+    notificationStormFrameTimeP50:
+    { description: "Median time between frames during a notification storm",
+      units: "us" },
+    notificationStormFrameTimeP90:
+    { description: "90th percentile time between frames during a notification storm",
+      units: "us" },
+    notificationStormFrameTimeP99:
+    { description: "99th percentile time between frames during a notification storm",
+      units: "us" },
+    notificationStormFrameTimeMax:
+    { description: "Longest time between frames during a notification storm",
+      units: "us" },
+    notificationStormCleanupTime:
+    { description: "Time to destroy the source of a notification storm",
+      units: "us" },
+    notificationStormCoalesced:
+    { description: "Notifications whose banner was replaced by a newer one during a notification storm",
+      units: "notifications" },
+    notificationStormDropped:
+    { description: "Notifications discarded without being shown during a notification storm",
+      units: "notifications" }
+};
+
+function _postNotifications(source) {
+    let cb;
+    let posted = 0;
+
+    Mainloop.timeout_add(BATCH_INTERVAL, function() {
+        for (let i = 0; i < NOTIFICATIONS_PER_BATCH && posted < N_NOTIFICATIONS; i++, posted++) {
+            let notification = new MessageTray.Notification(source,
+                                                            "Notification " + posted,
+                                                            "This is the body of test notification " + posted);
+            source.notify(notification);
+        }
+
+        if (posted < N_NOTIFICATIONS)
+            return true;
+
+        if (cb)
+            cb();
+        return false;
+    });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+function run() {
+    Scripting.defineScriptEvent("stormStart", "Starting to post notifications");
+    Scripting.defineScriptEvent("stormPosted", "Finished posting notifications");
+    Scripting.defineScriptEvent("stormEnd", "Finished watching frames after posting notifications");
+    Scripting.defineScriptEvent("cleanupStart", "Starting to destroy the notification source");
+    Scripting.defineScriptEvent("cleanupDone", "Finished destroying the notification source");
+
+    yield Scripting.sleep(1000);
+
+    let source = new MessageTray.Source("Notification storm", 'dialog-information');
+    Main.messageTray.add(source);
+    yield Scripting.waitLeisure();
+
+    Scripting.scriptEvent('stormStart');
+    yield _postNotifications(source);
+    Scripting.scriptEvent('stormPosted');
+
+    yield Scripting.sleep(SETTLE_TIME);
+    Scripting.scriptEvent('stormEnd');
+    Scripting.collectStatistics();
+
+    Scripting.scriptEvent('cleanupStart');
+    source.destroy();
+    yield Scripting.waitLeisure();
+    Scripting.scriptEvent('cleanupDone');
+
+    System.gc();
+    yield Scripting.sleep(1000);
+}
+
+let stormStart;
+let inStorm = false;
+let lastFrame = -1;
+let frameTimes = [];
+let cleanupStart;
+let haveSwapComplete = false;
+
+function script_stormStart(time) {
+    stormStart = time;
+    inStorm = true;
+    lastFrame = -1;
+}
+
+function script_stormPosted(time) {
+    METRICS.notificationStormPostTime.value = time - stormStart;
+}
+
+function script_stormEnd(time) {
+    inStorm = false;
+}
+
+function notifications_coalesced(time, count) {
+    METRICS.notificationStormCoalesced.value = count;
+}
+
+function notifications_dropped(time, count) {
+    METRICS.notificationStormDropped.value = count;
+}
+
+function script_cleanupStart(time) {
+    cleanupStart = time;
+}
+
+function script_cleanupDone(time) {
+    METRICS.notificationStormCleanupTime.value = time - cleanupStart;
+}
+
+function _frameDone(time) {
+    if (!inStorm)
+        return;
+
+    if (lastFrame >= 0)
+        frameTimes.push(time - lastFrame);
+    lastFrame = time;
+}
+
+function finish() {
+    METRICS.notificationStormFrameTimeP50.value = Scripting.percentile(frameTimes, 50);
+    METRICS.notificationStormFrameTimeP90.value = Scripting.percentile(frameTimes, 90);
+    METRICS.notificationStormFrameTimeP99.value = Scripting.percentile(frameTimes, 99);
+    METRICS.notificationStormFrameTimeMax.value = Scripting.percentile(frameTimes, 100);
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -0,0 +1,183 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Mainloop = imports.mainloop;
+const System = imports.system;
+
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures how long the user waits for search
+// results to update after each keystroke in the overview search entry,
+// with a large number of installed applications.
+
+const N_DESKTOP_FILES = 500;
+
+// Give up waiting for a single search after this long; a remote provider
+// that never replies shouldn't hang the whole run.
+const SEARCH_DONE_TIMEOUT = 5000; // ms
+
+const SEARCH_QUERIES = ['chess', 'music writer', 'perf 42', 'calc'];
+
+let METRICS = {
+    appsInstalledTime:
+    { description: "Time for the app system to load the test .desktop files",
+      units: "us" },
+    searchFirstKeystrokeLatency:
+    { description: "Time from the first keystroke to the first frame showing results",
+      units: "us" },
+    searchKeystrokeLatencyP50:
+    { description: "Median time from a keystroke to the first frame showing its results",
+      units: "us" },
+    searchKeystrokeLatencyP90:
+    { description: "90th percentile time from a keystroke to the first frame showing its results",
+      units: "us" },
+    searchKeystrokeLatencyP99:
+    { description: "99th percentile time from a keystroke to the first frame showing its results",
+      units: "us" },
+    searchKeystrokeLatencyMax:
+    { description: "Maximum time from a keystroke to the first frame showing its results",
+      units: "us" }
+};
+
+function _waitSearchDone(searchResults) {
+    let cb;
+    let finished = false;
+    let timeoutId = 0;
+    let progressId = 0;
+
+    let done = function() {
+        if (finished)
+            return;
+
+        finished = true;
+
+        searchResults.disconnect(progressId);
+        progressId = 0;
+        if (timeoutId != 0)
+            Mainloop.source_remove(timeoutId);
+        timeoutId = 0;
+
+        Scripting.scriptEvent('searchResultsDone');
+        if (cb)
+            cb();
+    };
+
+    progressId = searchResults.connect('search-progress-updated', function() {
+        if (!searchResults.searchInProgress)
+            done();
+    });
+    timeoutId = Mainloop.timeout_add(SEARCH_DONE_TIMEOUT, function() {
+        timeoutId = 0;
+        done();
+        return false;
+    });
+
+    // Results may arrive before the script yields to us
+    return function(callback) {
+        if (finished)
+            callback();
+        else
+            cb = callback;
+    };
+}
+
+function run() {
+    Scripting.defineScriptEvent("appsInstallStart", "Starting to create test .desktop files");
+    Scripting.defineScriptEvent("appsInstallDone", "App system finished loading test .desktop files");
+    Scripting.defineScriptEvent("searchKeystroke", "Typed a character into the search entry");
+    Scripting.defineScriptEvent("searchResultsDone", "Search results updated for the typed text");
+
+    yield Scripting.sleep(1000);
+
+    Scripting.scriptEvent('appsInstallStart');
+    yield Scripting.createTestDesktopFiles(N_DESKTOP_FILES);
+    Scripting.scriptEvent('appsInstallDone');
+    yield Scripting.waitLeisure();
+
+    Main.overview.showApps();
+    yield Scripting.waitLeisure();
+
+    let viewsDisplay = Main.overview._viewSelector._viewsDisplay;
+    let entry = viewsDisplay.entry;
+    let searchResults = viewsDisplay._searchResults;
+
+    for (let i = 0; i < SEARCH_QUERIES.length; i++) {
+        let query = SEARCH_QUERIES[i];
+
+        for (let k = 1; k <= query.length; k++) {
+            let waitDone = _waitSearchDone(searchResults);
+
+            Scripting.scriptEvent('searchKeystroke');
+            entry.set_text(query.substr(0, k));
+
+            yield waitDone;
+            yield Scripting.waitLeisure();
+        }
+
+        entry.resetSearch();
+        yield Scripting.waitLeisure();
+
+        System.gc();
+        yield Scripting.sleep(500);
+    }
+
+    Main.overview.hide();
+    yield Scripting.waitLeisure();
+
+    yield Scripting.destroyTestDesktopFiles();
+}
+
+let appsInstallStart;
+let keystrokeStart = -1;
+let resultsDone = false;
+let keystrokeLatencies = [];
+let haveSwapComplete = false;
+
+function script_appsInstallStart(time) {
+    appsInstallStart = time;
+}
+
+function script_appsInstallDone(time) {
+    METRICS.appsInstalledTime.value = time - appsInstallStart;
+}
+
+function script_searchKeystroke(time) {
+    keystrokeStart = time;
+    resultsDone = false;
+}
+
+function script_searchResultsDone(time) {
+    // The results are only visible to the user once the next frame
+    // has been painted, so we wait for that before counting
+    resultsDone = true;
+}
+
+function _frameDone(time) {
+    if (keystrokeStart < 0 || !resultsDone)
+        return;
+
+    keystrokeLatencies.push(time - keystrokeStart);
+    keystrokeStart = -1;
+    resultsDone = false;
+}
+
+function finish() {
+    METRICS.searchFirstKeystrokeLatency.value = keystrokeLatencies.length > 0 ? keystrokeLatencies[0] : 0;
+    METRICS.searchKeystrokeLatencyP50.value = Scripting.percentile(keystrokeLatencies, 50);
+    METRICS.searchKeystrokeLatencyP90.value = Scripting.percentile(keystrokeLatencies, 90);
+    METRICS.searchKeystrokeLatencyP99.value = Scripting.percentile(keystrokeLatencies, 99);
+    METRICS.searchKeystrokeLatencyMax.value = Scripting.percentile(keystrokeLatencies, 100);
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js; without swap complete events we
+    // approximate the time the frame was shown with the end of painting
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
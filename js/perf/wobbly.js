@@ -0,0 +1,190 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Mainloop = imports.mainloop;
+const System = imports.system;
+
+const Scripting = imports.ui.scripting;
+const WindowManager = imports.ui.windowManager;
+
+// This performance script measures the cost of the wobbly effect with
+// several windows wobbling at once, as happens after dragging a window
+// around: the time between frames while they are dragged and settle,
+// and how long they take to settle.
+
+// Numbers of windows wobbling simultaneously to measure
+const WINDOW_COUNTS = [1, 8];
+
+// Simulated drag; each step moves the grabbed point of every window
+const DRAG_STEPS = 60;
+const DRAG_STEP_INTERVAL = 16; // ms
+const DRAG_STEP_DISTANCE = 8; // px
+
+// Give up waiting for the windows to stop wobbling after this long
+const SETTLE_TIMEOUT = 10000; // ms
+
+let METRICS = {};
+
+WINDOW_COUNTS.forEach(function(count) {
+    METRICS['wobbly' + count + 'FrameTimeP50'] =
+        { description: "Median time between frames with " + count + " windows wobbling",
+          units: "us" };
+    METRICS['wobbly' + count + 'FrameTimeP90'] =
+        { description: "90th percentile time between frames with " + count + " windows wobbling",
+          units: "us" };
+    METRICS['wobbly' + count + 'FrameTimeMax'] =
+        { description: "Longest time between frames with " + count + " windows wobbling",
+          units: "us" };
+    METRICS['wobbly' + count + 'SettleTime'] =
+        { description: "Time for " + count + " windows to stop wobbling after being released",
+          units: "us" };
+});
+
+function _getTestWindowActors() {
+    return global.get_window_actors().filter(function(actor) {
+        return actor.get_meta_window().get_wm_class() == 'Gnome-shell-perf-helper';
+    });
+}
+
+function _drag(effects) {
+    let cb;
+    let step = 0;
+
+    Mainloop.timeout_add(DRAG_STEP_INTERVAL, function() {
+        // Go back and forth so the windows stay on screen
+        let direction = (Math.floor(step / 10) % 2) == 0 ? 1 : -1;
+        let delta = direction * DRAG_STEP_DISTANCE;
+
+        effects.forEach(function(effect) {
+            effect.move_by(delta, delta);
+        });
+
+        if (++step < DRAG_STEPS)
+            return true;
+
+        if (cb)
+            cb();
+        return false;
+    });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+function _waitSettled(effects) {
+    let cb;
+    let waited = 0;
+
+    Mainloop.timeout_add(DRAG_STEP_INTERVAL, function() {
+        waited += DRAG_STEP_INTERVAL;
+
+        let settled = effects.every(function(effect) {
+            return effect.settled;
+        });
+        if (!settled && waited < SETTLE_TIMEOUT)
+            return true;
+
+        if (cb)
+            cb();
+        return false;
+    });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+function run() {
+    Scripting.defineScriptEvent("wobbleStart", "Starting to drag the wobbling windows");
+    Scripting.defineScriptEvent("wobbleReleased", "Released the wobbling windows");
+    Scripting.defineScriptEvent("wobbleDone", "Windows stopped wobbling");
+
+    yield Scripting.sleep(1000);
+
+    yield Scripting.destroyTestWindows();
+    yield Scripting.sleep(1000);
+
+    for (let i = 0; i < WINDOW_COUNTS.length; i++) {
+        let count = WINDOW_COUNTS[i];
+
+        for (let k = 0; k < count; k++)
+            yield Scripting.createTestWindow(320, 240, false, false);
+        yield Scripting.waitTestWindows();
+        yield Scripting.sleep(1000);
+        yield Scripting.waitLeisure();
+
+        let effects = _getTestWindowActors().map(function(actor) {
+            let effect = new WindowManager.EOSShellWobbly();
+            actor.add_effect_with_name('endless-wobbly', effect);
+
+            let [x, y] = actor.get_position();
+            effect.grab(x + actor.width / 2, y + actor.height / 2);
+            return effect;
+        });
+
+        Scripting.scriptEvent('wobbleStart');
+        yield _drag(effects);
+
+        Scripting.scriptEvent('wobbleReleased');
+        effects.forEach(function(effect) {
+            effect.ungrab();
+        });
+
+        yield _waitSettled(effects);
+        Scripting.scriptEvent('wobbleDone');
+
+        yield Scripting.destroyTestWindows();
+        System.gc();
+        yield Scripting.sleep(1000);
+        yield Scripting.waitLeisure();
+    }
+}
+
+let round = 0;
+let inWobble = false;
+let lastFrame = -1;
+let frameTimes = [];
+let releaseTime;
+let haveSwapComplete = false;
+
+function script_wobbleStart(time) {
+    inWobble = true;
+    lastFrame = -1;
+    frameTimes = [];
+}
+
+function script_wobbleReleased(time) {
+    releaseTime = time;
+}
+
+function script_wobbleDone(time) {
+    let prefix = 'wobbly' + WINDOW_COUNTS[round];
+
+    METRICS[prefix + 'FrameTimeP50'].value = Scripting.percentile(frameTimes, 50);
+    METRICS[prefix + 'FrameTimeP90'].value = Scripting.percentile(frameTimes, 90);
+    METRICS[prefix + 'FrameTimeMax'].value = Scripting.percentile(frameTimes, 100);
+    METRICS[prefix + 'SettleTime'].value = time - releaseTime;
+
+    inWobble = false;
+    round++;
+}
+
+function _frameDone(time) {
+    if (!inWobble)
+        return;
+
+    if (lastFrame >= 0)
+        frameTimes.push(time - lastFrame);
+    lastFrame = time;
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -0,0 +1,147 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Meta = imports.gi.Meta;
+const System = imports.system;
+
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures workspace switching with windows on
+// both sides of the switch, and how long the shell (window tracking,
+// the app icon bar, workspace bookkeeping) takes to settle after a
+// burst of new windows.
+
+const N_BURST_WINDOWS = 20;
+const N_SWITCH_WINDOWS = 4;
+const N_SWITCHES = 10;
+
+let METRICS = {
+    windowBurstSettleTime:
+    { description: "Time from starting to map a burst of windows until the shell is idle",
+      units: "us" },
+    workspaceSwitchTimeP50:
+    { description: "Median time for a workspace switch to finish",
+      units: "us" },
+    workspaceSwitchTimeMax:
+    { description: "Longest time for a workspace switch to finish",
+      units: "us" },
+    workspaceSwitchFrameTimeP50:
+    { description: "Median time between frames while switching workspaces",
+      units: "us" },
+    workspaceSwitchFrameTimeP90:
+    { description: "90th percentile time between frames while switching workspaces",
+      units: "us" },
+    workspaceSwitchFrameTimeMax:
+    { description: "Longest time between frames while switching workspaces",
+      units: "us" }
+};
+
+function _getTestWindows() {
+    return global.get_window_actors().map(function(actor) {
+        return actor.get_meta_window();
+    }).filter(function(window) {
+        return window.get_wm_class() == 'Gnome-shell-perf-helper';
+    });
+}
+
+function run() {
+    Scripting.defineScriptEvent("windowBurstStart", "Starting to create a burst of windows");
+    Scripting.defineScriptEvent("windowBurstDone", "Shell idle after a burst of windows");
+    Scripting.defineScriptEvent("workspaceSwitchStart", "Starting to switch workspaces");
+    Scripting.defineScriptEvent("workspaceSwitchDone", "Done switching workspaces");
+
+    yield Scripting.sleep(1000);
+
+    yield Scripting.destroyTestWindows();
+    yield Scripting.sleep(1000);
+
+    Scripting.scriptEvent('windowBurstStart');
+    for (let i = 0; i < N_BURST_WINDOWS; i++)
+        yield Scripting.createTestWindow(640, 480, false, false);
+    yield Scripting.waitTestWindows();
+    yield Scripting.waitLeisure();
+    Scripting.scriptEvent('windowBurstDone');
+
+    yield Scripting.destroyTestWindows();
+    System.gc();
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    for (let i = 0; i < N_SWITCH_WINDOWS; i++)
+        yield Scripting.createTestWindow(640, 480, false, false);
+    yield Scripting.waitTestWindows();
+    yield Scripting.waitLeisure();
+
+    // Dynamic workspaces always leave an empty workspace at the end,
+    // so moving half the windows there gives us two populated ones
+    let windows = _getTestWindows();
+    for (let i = 0; i < windows.length / 2; i++)
+        windows[i].change_workspace_by_index(1, false);
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    for (let i = 0; i < N_SWITCHES; i++) {
+        let direction = (i % 2) == 0 ? Meta.MotionDirection.DOWN : Meta.MotionDirection.UP;
+
+        Scripting.scriptEvent('workspaceSwitchStart');
+        Main.wm.actionMoveWorkspace(direction);
+        yield Scripting.waitLeisure();
+        Scripting.scriptEvent('workspaceSwitchDone');
+    }
+
+    yield Scripting.destroyTestWindows();
+    yield Scripting.sleep(1000);
+}
+
+let windowBurstStart;
+let switchStart = -1;
+let lastFrame = -1;
+let switchTimes = [];
+let frameTimes = [];
+let haveSwapComplete = false;
+
+function script_windowBurstStart(time) {
+    windowBurstStart = time;
+}
+
+function script_windowBurstDone(time) {
+    METRICS.windowBurstSettleTime.value = time - windowBurstStart;
+}
+
+function script_workspaceSwitchStart(time) {
+    switchStart = time;
+    lastFrame = -1;
+}
+
+function script_workspaceSwitchDone(time) {
+    switchTimes.push(time - switchStart);
+    switchStart = -1;
+}
+
+function _frameDone(time) {
+    if (switchStart < 0)
+        return;
+
+    if (lastFrame >= 0)
+        frameTimes.push(time - lastFrame);
+    lastFrame = time;
+}
+
+function finish() {
+    METRICS.workspaceSwitchTimeP50.value = Scripting.percentile(switchTimes, 50);
+    METRICS.workspaceSwitchTimeMax.value = Scripting.percentile(switchTimes, 100);
+    METRICS.workspaceSwitchFrameTimeP50.value = Scripting.percentile(frameTimes, 50);
+    METRICS.workspaceSwitchFrameTimeP90.value = Scripting.percentile(frameTimes, 90);
+    METRICS.workspaceSwitchFrameTimeMax.value = Scripting.percentile(frameTimes, 100);
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -91,6 +91,14 @@ const AppSearchProvider = new Lang.Class({
     },
 
     getInitialResultSet: function(terms, callback, cancellable) {
+        // Which apps are on the desktop decides what is shown, and how
+        if (!IconGridLayout.layout.loaded) {
+            IconGridLayout.layout.whenLoaded(Lang.bind(this, function() {
+                this.getInitialResultSet(terms, callback, cancellable);
+            }));
+            return;
+        }
+
         let query = terms.join(' ');
         let groups = Gio.DesktopAppInfo.search(query);
         let usage = Shell.AppUsage.get_default();
@@ -160,9 +168,11 @@ const EndlessApplicationView = new Lang.Class({
     Name: 'EndlessApplicationView',
     Abstract: true,
 
-    _init: function() {
-        this._grid = new IconGrid.IconGrid({ xAlign: St.Align.MIDDLE,
-                                             columnLimit: MAX_COLUMNS });
+    _init: function(gridParams) {
+        gridParams = Params.parse(gridParams, { xAlign: St.Align.MIDDLE,
+                                                columnLimit: MAX_COLUMNS },
+                                  true);
+        this._grid = new IconGrid.IconGrid(gridParams);
 
         // Standard hack for ClutterBinLayout
         this._grid.actor.x_expand = true;
@@ -239,6 +249,11 @@ const EndlessApplicationView = new Lang.Class({
         return this._allIcons;
     },
 
+    // The ids of the icons in the view, in order
+    _getShownIds: function() {
+        return this._allIcons.map(function(icon) { return icon.getId(); });
+    },
+
     getLayoutIds: function() {
         let viewId = this.getViewId();
         return IconGridLayout.layout.getIcons(viewId).slice();
@@ -253,7 +268,7 @@ const EndlessApplicationView = new Lang.Class({
     },
 
     _findIconChanges: function() {
-        let oldItemLayout = this._allIcons.map(function(icon) { return icon.getId(); });
+        let oldItemLayout = this._getShownIds();
         let newItemLayout = this.getLayoutIds();
         newItemLayout = this._trimInvisible(newItemLayout);
 
@@ -276,7 +291,7 @@ const EndlessApplicationView = new Lang.Class({
     },
 
     _findAddedIcons: function() {
-        let oldItemLayout = this._allIcons.map(function(icon) { return icon.getId(); });
+        let oldItemLayout = this._getShownIds();
         if (oldItemLayout.length === 0) return [];
 
         let newItemLayout = this.getLayoutIds();
@@ -321,10 +336,16 @@ const EndlessApplicationView = new Lang.Class({
 
         // Create a map from app ids to icon objects
         let iconTable = {};
-        for (let idx in this._allIcons) {
-            iconTable[this._allIcons[idx].getId()] = this._allIcons[idx];
+        let allIcons = this.getAllIcons();
+        for (let idx in allIcons) {
+            iconTable[allIcons[idx].getId()] = allIcons[idx];
         }
 
+        let shownIds = {};
+        this._getShownIds().forEach(function(itemId) {
+            shownIds[itemId] = true;
+        });
+
         let layoutIds = this.getLayoutIds();
 
         // Iterate through all visible icons
@@ -341,11 +362,16 @@ const EndlessApplicationView = new Lang.Class({
                 continue;
             }
 
+            if (!shownIds[itemId]) {
+                // This icon is new
+                return true;
+            }
+
             let currentIcon = iconTable[itemId];
 
             if (!currentIcon) {
-                // This icon is new
-                return true;
+                // The icon isn't in view, so it wasn't created
+                continue;
             }
 
             if (currentIcon.customName &&
@@ -442,18 +468,101 @@ const FolderView = new Lang.Class({
     Extends: EndlessApplicationView,
 
     _init: function(folderIcon, parentView) {
-        this.parent();
+        // Folders can hold hundreds of apps, so only the icons in view
+        // are created, and reused for other apps as the view scrolls
+        this.parent({ virtualized: true,
+                      createItem: Lang.bind(this, this._createGridItem),
+                      updateItem: Lang.bind(this, this._updateGridItem) });
         this._folderIcon = folderIcon;
         this._parentView = parentView;
         this.actor = this._grid.actor;
 
+        this._itemIds = [];
+        this._addedIds = [];
+
+        this._grid.setAdjustment(parentView.actor.vscroll.adjustment);
+
+        // Keep the icon being dragged from showing another app
+        this._dragBeginId = Main.overview.connect('item-drag-begin', Lang.bind(this, function() {
+            this._grid.freezeItems();
+        }));
+        this._dragEndId = Main.overview.connect('item-drag-end', Lang.bind(this, function() {
+            this._grid.thawItems();
+        }));
+
         this.addIcons();
     },
 
+    _onDestroy: function() {
+        this.parent();
+
+        Main.overview.disconnect(this._dragBeginId);
+        Main.overview.disconnect(this._dragEndId);
+    },
+
     _createItemIcon: function(item) {
         return new AppIcon(item, null, { parentView: this });
     },
 
+    _createGridItem: function(index) {
+        let itemId = this._itemIds[index];
+        let icon = this._createItemIcon(this._createItemForId(itemId));
+
+        if (this._addedIds.indexOf(itemId) != -1) {
+            icon.scheduleScaleIn();
+        }
+
+        icon.actor.connect('key-focus-in',
+                           Lang.bind(this, this._ensureIconVisible));
+        return icon.actor;
+    },
+
+    _updateGridItem: function(actor, index) {
+        let icon = actor._delegate;
+        if (!icon) {
+            return false;
+        }
+
+        let itemId = this._itemIds[index];
+        icon.setApp(this._createItemForId(itemId));
+
+        if (this._addedIds.indexOf(itemId) != -1) {
+            icon.scheduleScaleIn();
+        }
+
+        return true;
+    },
+
+    getAllIcons: function() {
+        return this._grid.getItems().map(function(actor) {
+            return actor._delegate;
+        });
+    },
+
+    _getShownIds: function() {
+        return this._itemIds;
+    },
+
+    getIconForIndex: function(index) {
+        let actor = this._grid.getItemAtIndex(index);
+        return actor ? actor._delegate : null;
+    },
+
+    addIcons: function() {
+        // Don't do anything if we don't have more up-to-date information, since
+        // re-adding icons unnecessarily can cause UX problems
+        if (!this.iconsNeedRedraw()) {
+            return;
+        }
+
+        this._addedIds = this._findAddedIcons();
+        this._itemIds = this.getLayoutIds().filter(Lang.bind(this, function(itemId) {
+            return this._createItemForId(itemId) != null;
+        }));
+
+        this._grid.setItemCount(this._itemIds.length);
+    },
+
     getViewId: function() {
         return this._folderIcon.getId();
     },
@@ -1859,10 +1968,10 @@ const AppIcon = new Lang.Class({
                                                           this._onStateChanged));
         this._onStateChanged();
 
-        if (app.get_id() === 'com.endlessm.Coding.Chatbox.desktop') {
-            Main.notificationDaemon.gtk.connect('new-gtk-notification-source',
-                                                Lang.bind(this, this._onNewGtkNotificationSource));
-        }
+        this._notificationSource = null;
+        this._notificationSourceDestroyId = 0;
+        this._notificationSourceAddedId = 0;
+        this._watchNotificationSources();
     },
 
     _onDestroy: function() {
@@ -1872,6 +1981,66 @@ const AppIcon = new Lang.Class({
             this.app.disconnect(this._stateChangedId);
         }
         this._stateChangedId = 0;
+
+        if (this._notificationSourceAddedId > 0) {
+            Main.notificationDaemon.gtk.disconnect(this._notificationSourceAddedId);
+        }
+        this._notificationSourceAddedId = 0;
+
+        this._clearNotificationSource();
+    },
+
+    _clearNotificationSource: function() {
+        if (this._notificationSourceDestroyId > 0) {
+            this._notificationSource.disconnect(this._notificationSourceDestroyId);
+        }
+        this._notificationSourceDestroyId = 0;
+        this._notificationSource = null;
+    },
+
+    _watchNotificationSources: function() {
+        if (this._notificationSourceAddedId > 0) {
+            return;
+        }
+
+        if (this.app.get_id() === 'com.endlessm.Coding.Chatbox.desktop') {
+            this._notificationSourceAddedId =
+                Main.notificationDaemon.gtk.connect('new-gtk-notification-source',
+                                                    Lang.bind(this, this._onNewGtkNotificationSource));
+        }
+    },
+
+    // Shows another app with this icon, for views that reuse the icons
+    // that went out of view
+    setApp: function(app) {
+        this.app.disconnect(this._stateChangedId);
+        this._unscheduleScaleIn();
+
+        // The notifications of the last app aren't ours to show anymore
+        this._clearNotificationSource();
+        this.icon.extraIcons.forEach(function(icon) {
+            icon.destroy();
+        });
+        this.icon.extraIcons = [];
+        if (this._notificationSourceAddedId > 0) {
+            Main.notificationDaemon.gtk.disconnect(this._notificationSourceAddedId);
+        }
+        this._notificationSourceAddedId = 0;
+
+        this.app = app;
+        this._name = this.app.get_name();
+        this.customName = false;
+
+        this._stateChangedId = this.app.connect('notify::state',
+                                                Lang.bind(this,
+                                                          this._onStateChanged));
+        this._onStateChanged();
+        this._watchNotificationSources();
+
+        if (this.icon.label) {
+            this.icon.label.text = this._name;
+        }
+        this.icon.reloadIcon();
     },
 
     _createIcon: function(iconSize) {
@@ -1890,8 +2059,10 @@ const AppIcon = new Lang.Class({
         if (source.app != this.app)
             return;
 
+        this._clearNotificationSource();
         this._notificationSource = source;
-        this._notificationSource.connect('destroy', Lang.bind(this, function() {
+        this._notificationSourceDestroyId = this._notificationSource.connect('destroy', Lang.bind(this, function() {
+            this._notificationSourceDestroyId = 0;
             this._notificationSource = null;
             this.icon.reloadIcon();
         }));
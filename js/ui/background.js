@@ -100,6 +100,7 @@ const GLib = imports.gi.GLib;
 const GnomeDesktop = imports.gi.GnomeDesktop;
 const Lang = imports.lang;
 const Meta = imports.gi.Meta;
+const Shell = imports.gi.Shell;
 const Signals = imports.signals;
 
 const Config = imports.misc.config;
@@ -146,6 +147,50 @@ const BackgroundCache = new Lang.Class({
         this._pendingFileLoads = [];
         this._fileMonitors = {};
         this._backgroundSources = {};
+
+        let perfLog = Shell.PerfLog.get_default();
+        perfLog.define_statistic('background.cacheSources',
+                                 "Number of background sources in the background cache", 'i');
+        perfLog.define_statistic('background.cacheImages',
+                                 "Number of loaded background images in use", 'i');
+        perfLog.define_statistic('background.cacheImageSize',
+                                 "Estimated size of the loaded background images, in bytes", 'x');
+        perfLog.add_statistics_callback(Lang.bind(this, this._updateStatistics));
+    },
+
+    _updateStatistics: function(perfLog) {
+        let usage = this.getMemoryUsage();
+        perfLog.update_statistic_i('background.cacheSources', usage.sources);
+        perfLog.update_statistic_i('background.cacheImages', usage.images);
+        perfLog.update_statistic_x('background.cacheImageSize', usage.imageBytes);
+    },
+
+    getMemoryUsage: function() {
+        let usage = { sources: Object.keys(this._backgroundSources).length,
+                      images: 0,
+                      imageBytes: 0 };
+
+        // Only count the images that live backgrounds are holding on
+        // to; several backgrounds can share the same image
+        let seen = [];
+        for (let schema in this._backgroundSources) {
+            let images = this._backgroundSources[schema].getImages();
+            for (let i = 0; i < images.length; i++) {
+                let image = images[i];
+                if (seen.indexOf(image) >= 0)
+                    continue;
+                seen.push(image);
+
+                if (!image.is_loaded() || !image.get_success())
+                    continue;
+
+                let texture = image.get_texture();
+                usage.images++;
+                usage.imageBytes += texture.get_width() * texture.get_height() * 4;
+            }
+        }
+
+        return usage;
     },
 
     monitorFile: function(file) {
@@ -160,7 +205,8 @@ const BackgroundCache = new Lang.Class({
                                            this.emit('file-changed', file);
                                        }));
 
-        this._fileMonitors[key] = { monitor: monitor,
+        this._fileMonitors[key] = { file: file,
+                                    monitor: monitor,
                                     signalId: signalId };
     },
 
@@ -301,6 +347,7 @@ const Background = new Lang.Class({
         this._monitorIndex = params.monitorIndex;
         this._layoutManager = params.layoutManager;
         this._fileWatches = {};
+        this._images = [];
         this._cancellable = new Gio.Cancellable();
         this.isLoaded = false;
 
@@ -321,12 +368,17 @@ const Background = new Lang.Class({
             this._cache.disconnect(this._fileWatches[keys[i]]);
         }
         this._fileWatches = null;
+        this._images = [];
 
         if (this._settingsChangedSignalId != 0)
             this._settings.disconnect(this._settingsChangedSignalId);
         this._settingsChangedSignalId = 0;
     },
 
+    getImages: function() {
+        return this._images;
+    },
+
     updateResolution: function() {
         if (this._animation) {
             this._removeAnimationTimeout();
@@ -409,6 +461,7 @@ const Background = new Lang.Class({
         let cache = Meta.BackgroundImageCache.get_default();
         let numPendingImages = files.length;
         let images = [];
+        this._images = images;
         for (let i = 0; i < files.length; i++) {
             this._watchFile(files[i]);
             let image = cache.load(files[i]);
@@ -479,6 +532,7 @@ const Background = new Lang.Class({
 
         let cache = Meta.BackgroundImageCache.get_default();
         let image = cache.load(file);
+        this._images = [image];
         if (image.is_loaded())
             this._setLoaded();
         else {
@@ -626,6 +680,13 @@ const BackgroundSource = new Lang.Class({
         return this._backgrounds[monitorIndex];
     },
 
+    getImages: function() {
+        let images = [];
+        for (let monitorIndex in this._backgrounds)
+            images = images.concat(this._backgrounds[monitorIndex].getImages());
+        return images;
+    },
+
     destroy: function() {
         global.screen.disconnect(this._monitorsChangedId);
 
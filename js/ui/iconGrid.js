@@ -3,6 +3,7 @@
 const Clutter = imports.gi.Clutter;
 const Gdk = imports.gi.Gdk;
 const GObject = imports.gi.GObject;
+const Meta = imports.gi.Meta;
 const Pango = imports.gi.Pango;
 const Shell = imports.gi.Shell;
 const St = imports.gi.St;
@@ -31,6 +32,17 @@ const NUDGE_FACTOR = 0.2;
 const SHUFFLE_ANIMATION_TIME = 0.250;
 const SHUFFLE_ANIMATION_OPACITY = 255;
 
+// Rows of items created above and below the visible area of a
+// virtualized grid, so that scrolling doesn't show missing icons
+const VIRTUALIZED_MARGIN_ROWS = 2;
+// Actors of items that went out of view a virtualized grid keeps
+// around to show other items
+const MAX_RECYCLED_ITEMS = 16;
+
+// Whether the first paint of a populated grid was recorded in the
+// startup trace
+let _firstPaintTraced = false;
+
 const CursorLocation = {
     DEFAULT: 0,
     ON_ICON: 1,
@@ -477,12 +489,34 @@ const IconGrid = new Lang.Class({
         params = Params.parse(params, { rowLimit: null,
                                         columnLimit: null,
                                         fillParent: false,
-                                        xAlign: St.Align.MIDDLE });
+                                        xAlign: St.Align.MIDDLE,
+                                        virtualized: false,
+                                        createItem: null,
+                                        updateItem: null });
         this._rowLimit = params.rowLimit;
         this._colLimit = params.columnLimit;
         this._xAlign = params.xAlign;
         this._fillParent = params.fillParent;
 
+        // A virtualized grid lays out a number of items of the same size,
+        // and only has actors for the ones in or near the visible area of
+        // the stage. They are created with createItem(index), and the
+        // actors of items that went out of view are handed back to
+        // updateItem(actor, index) to show other ones; they are destroyed
+        // instead when it returns false.
+        this._virtualized = params.virtualized;
+        this._createItem = params.createItem;
+        this._updateItem = params.updateItem;
+        this._nItems = 0;
+        this._items = {};
+        this._recycledItems = [];
+        this._visibleRange = [0, 0];
+        this._itemsChanged = false;
+        this._itemsFrozen = false;
+        this._updateItemsId = 0;
+        this._adjustment = null;
+        this._adjustmentChangedId = 0;
+
         // Pulled from CSS, but hardcode some defaults here
         this._spacing = 0;
         this._hItemSize = this._vItemSize = ICON_SIZE;
@@ -492,6 +526,7 @@ const IconGrid = new Lang.Class({
         this.actor.connect('get-preferred-width', Lang.bind(this, this._getPreferredWidth));
         this.actor.connect('get-preferred-height', Lang.bind(this, this._getPreferredHeight));
         this.actor.connect('allocate', Lang.bind(this, this._allocate));
+        this.actor.connect('destroy', Lang.bind(this, this._onDestroy));
 
         this.saturation = new Shell.GridDesaturateEffect({ factor: 0,
                                                            enabled: false });
@@ -502,6 +537,52 @@ const IconGrid = new Lang.Class({
         Main.layoutManager.connect('monitors-changed', Lang.bind(this, this._updateLowResolutionMode));
 
         this._updateLowResolutionMode();
+
+        this._firstPaintId = 0;
+        if (!_firstPaintTraced && Shell.startup_trace_is_enabled())
+            this._firstPaintId = this.actor.connect_after('paint', Lang.bind(this, this._onFirstPaint));
+    },
+
+    _onFirstPaint: function() {
+        if (this.actor.get_n_children() == 0)
+            return;
+
+        this.actor.disconnect(this._firstPaintId);
+        this._firstPaintId = 0;
+
+        if (_firstPaintTraced)
+            return;
+
+        _firstPaintTraced = true;
+        Shell.startup_trace_mark('firstIconGridPaint');
+    },
+
+    _onDestroy: function() {
+        if (this._updateItemsId != 0) {
+            Meta.later_remove(this._updateItemsId);
+            this._updateItemsId = 0;
+        }
+
+        this.setAdjustment(null);
+    },
+
+    _getItemCount: function() {
+        if (this._virtualized)
+            return this._nItems;
+
+        return this.actor.get_n_children();
+    },
+
+    // The actors of the items, by index; in a virtualized grid, the
+    // items that have no actors are left unset
+    _getItemActors: function() {
+        if (!this._virtualized)
+            return this.actor.get_children();
+
+        let actors = [];
+        for (let index in this._items)
+            actors[index] = this._items[index];
+        return actors;
     },
 
     _getPreferredWidth: function (grid, forHeight, alloc) {
@@ -510,10 +591,10 @@ const IconGrid = new Lang.Class({
             // later we'll allocate as many children as fit the parent
             return;
 
-        let children = this.actor.get_children();
+        let nItems = this._getItemCount();
         let nColumns = this._colLimit ? Math.min(this._colLimit,
-                                                 children.length)
-                                      : children.length;
+                                                 nItems)
+                                      : nItems;
         let totalSpacing = Math.max(0, nColumns - 1) * this._spacing;
         // Kind of a lie, but not really an issue right now.  If
         // we wanted to support some sort of hidden/overflow that would
@@ -528,17 +609,17 @@ const IconGrid = new Lang.Class({
             // later we'll allocate as many children as fit the parent
             return;
 
-        let children = this.actor.get_children();
+        let nItems = this._getItemCount();
         let nColumns;
         if (forWidth < 0) {
-            nColumns = children.length;
+            nColumns = nItems;
         } else {
             [nColumns, ] = this._computeLayout(forWidth);
         }
 
         let nRows;
         if (nColumns > 0)
-            nRows = Math.ceil(children.length / nColumns);
+            nRows = Math.ceil(nItems / nColumns);
         else
             nRows = 0;
         if (this._rowLimit)
@@ -560,7 +641,6 @@ const IconGrid = new Lang.Class({
             box = this.actor.get_theme_node().get_content_box(parentBox);
         }
 
-        let children = this.actor.get_children();
         let availWidth = box.x2 - box.x1;
         let availHeight = box.y2 - box.y1;
 
@@ -582,18 +662,191 @@ const IconGrid = new Lang.Class({
         this._leftPadding = leftPadding;
         this._allocatedColumns = nColumns;
 
-        for (let i = 0; i < children.length; i++) {
-            let rowIndex = Math.floor(i / this._allocatedColumns);
-            let childBox = this._childAllocation(children[i], box, i);
+        if (this._virtualized) {
+            this._allocatedBox = box;
 
-            if (this._rowLimit && rowIndex >= this._rowLimit ||
-                this._fillParent && childBox.y2 > availHeight) {
-                this.actor.set_skip_paint(children[i], true);
-            } else {
-                children[i].allocate(childBox, flags);
-                this.actor.set_skip_paint(children[i], false);
+            for (let index in this._items)
+                this._allocateItem(this._items[index], box, parseInt(index),
+                                   availHeight, flags);
+
+            // The items in view depend on where we were allocated
+            this._queueUpdateItems();
+        } else {
+            let children = this.actor.get_children();
+            for (let i = 0; i < children.length; i++)
+                this._allocateItem(children[i], box, i, availHeight, flags);
+        }
+    },
+
+    _allocateItem: function(child, box, index, availHeight, flags) {
+        let rowIndex = Math.floor(index / this._allocatedColumns);
+        let childBox = this._childAllocation(child, box, index);
+
+        if (this._rowLimit && rowIndex >= this._rowLimit ||
+            this._fillParent && childBox.y2 > availHeight) {
+            this.actor.set_skip_paint(child, true);
+        } else {
+            child.allocate(childBox, flags);
+            this.actor.set_skip_paint(child, false);
+        }
+    },
+
+    // Returns the range of the items of a virtualized grid that are in or
+    // near the visible area of the stage
+    _getVisibleRange: function() {
+        let rowHeight = this._vItemSize + this._spacing;
+        let nColumns, gridY;
+
+        if (this._allocatedBox) {
+            nColumns = this._allocatedColumns;
+
+            // The transformed position includes the scrolling of any
+            // view the grid is in
+            [, gridY] = this.actor.get_transformed_position();
+            gridY += this._allocatedBox.y1;
+        } else {
+            // Until we are allocated, fill the stage from the top
+            [nColumns, ] = this._computeLayout(global.stage.width);
+            gridY = 0;
+        }
+
+        let firstRow = Math.floor(-gridY / rowHeight) - VIRTUALIZED_MARGIN_ROWS;
+        let lastRow = Math.ceil((global.stage.height - gridY) / rowHeight) +
+                      VIRTUALIZED_MARGIN_ROWS;
+        if (this._rowLimit)
+            lastRow = Math.min(lastRow, this._rowLimit);
+
+        let first = Math.min(Math.max(0, firstRow * nColumns), this._nItems);
+        let last = Math.min(Math.max(0, lastRow * nColumns), this._nItems);
+
+        return [first, last];
+    },
+
+    _queueUpdateItems: function() {
+        if (this._updateItemsId != 0)
+            return;
+
+        this._updateItemsId = Meta.later_add(Meta.LaterType.BEFORE_REDRAW, Lang.bind(this, function() {
+            this._updateItemsId = 0;
+            this._updateItems();
+            return false;
+        }));
+    },
+
+    // Stops the animations of an actor that went out of view, and undoes
+    // what they left on it, so that the next item it shows doesn't start
+    // out moved, scaled or faded like the last one
+    _resetRecycledItem: function(actor) {
+        Tweener.removeTweens(actor);
+
+        actor.translation_x = 0;
+        actor.translation_y = 0;
+        actor.scale_x = 1;
+        actor.scale_y = 1;
+        actor.opacity = 255;
+    },
+
+    _takeRecycledItem: function(index) {
+        while (this._recycledItems.length > 0) {
+            let actor = this._recycledItems.pop();
+            this._resetRecycledItem(actor);
+            if (this._updateItem && this._updateItem(actor, index))
+                return actor;
+
+            actor.destroy();
+        }
+
+        return null;
+    },
+
+    _updateItems: function() {
+        let [first, last] = this._getVisibleRange();
+
+        if (!this._itemsChanged &&
+            first == this._visibleRange[0] && last == this._visibleRange[1])
+            return;
+
+        let items = {};
+        for (let key in this._items) {
+            let index = parseInt(key);
+            let actor = this._items[key];
+
+            if (!this._itemsChanged &&
+                (this._itemsFrozen || (index >= first && index < last)))
+                items[index] = actor;
+            else
+                this._recycledItems.push(actor);
+        }
+
+        for (let index = first; index < last; index++) {
+            if (items[index])
+                continue;
+
+            let actor = this._takeRecycledItem(index);
+            if (!actor) {
+                actor = this._createItem(index);
+                this.actor.add_actor(actor);
             }
+
+            actor.show();
+            items[index] = actor;
+        }
+
+        while (this._recycledItems.length > MAX_RECYCLED_ITEMS)
+            this._recycledItems.pop().destroy();
+        this._recycledItems.forEach(function(actor) {
+            actor.hide();
+        });
+
+        this._items = items;
+        this._visibleRange = [first, last];
+        this._itemsChanged = false;
+    },
+
+    // For virtualized grids: sets the number of items, and has the actors
+    // of the ones in view created, or updated with updateItem(), again
+    setItemCount: function(nItems) {
+        this._nItems = nItems;
+        this._itemsChanged = true;
+
+        this._queueUpdateItems();
+        this.actor.queue_relayout();
+    },
+
+    // For virtualized grids in a scrolled view: shows the items that come
+    // into view when @adjustment, the one the view scrolls with, changes
+    setAdjustment: function(adjustment) {
+        if (this._adjustmentChangedId != 0) {
+            this._adjustment.disconnect(this._adjustmentChangedId);
+            this._adjustmentChangedId = 0;
         }
+
+        this._adjustment = adjustment;
+
+        if (this._adjustment)
+            this._adjustmentChangedId = this._adjustment.connect('notify::value',
+                                                                 Lang.bind(this, this._queueUpdateItems));
+    },
+
+    // While frozen, a virtualized grid keeps the actors of the items that
+    // go out of view, instead of showing other items with them, for
+    // instance while one of them is being dragged
+    freezeItems: function() {
+        this._itemsFrozen = true;
+    },
+
+    thawItems: function() {
+        this._itemsFrozen = false;
+        this._visibleRange = [0, 0];
+        this._queueUpdateItems();
+    },
+
+    // Returns the actors of the items, in order; a virtualized grid only
+    // has the ones in or near view
+    getItems: function() {
+        return this._getItemActors().filter(function(actor) {
+            return actor;
+        });
     },
 
     _childAllocation: function(child, box, index) {
@@ -657,15 +910,28 @@ const IconGrid = new Lang.Class({
         this.actor.queue_relayout();
     },
 
+    _clearItems: function() {
+        this._nItems = 0;
+        this._items = {};
+        this._recycledItems = [];
+        this._visibleRange = [0, 0];
+        this._itemsChanged = false;
+    },
+
     removeAll: function() {
+        this._clearItems();
         this.actor.remove_all_children();
     },
 
     destroyAll: function() {
+        this._clearItems();
         this.actor.destroy_all_children();
     },
 
     addItem: function(actor, index) {
+        if (this._virtualized)
+            throw new Error('Items of a virtualized grid are added with setItemCount()');
+
         if (index !== undefined)
             this.actor.insert_child_at_index(actor, index);
         else
@@ -673,10 +939,16 @@ const IconGrid = new Lang.Class({
     },
 
     removeItem: function(actor) {
+        if (this._virtualized)
+            throw new Error('Items of a virtualized grid are removed with setItemCount()');
+
         this.actor.remove_actor(actor);
     },
 
     getItemAtIndex: function(index) {
+        if (this._virtualized)
+            return this._items[index] || null;
+
         return this.actor.get_child_at_index(index);
     },
 
@@ -707,7 +979,8 @@ const IconGrid = new Lang.Class({
     },
 
     animateShuffling: function(changedItems, removedItems, originalItemData, callback) {
-        let children = this.actor.get_children();
+        let children = this._getItemActors();
+        let nItems = this._getItemCount();
         let node = this.actor.get_theme_node();
         let contentBox = node.get_content_box(this.actor.allocation);
 
@@ -718,7 +991,11 @@ const IconGrid = new Lang.Class({
             let sourceActor = children[sourceIndex];
             let actorOffset;
 
-            if (targetIndex >= children.length) {
+            // Items a virtualized grid has no actors for don't move
+            if (!sourceActor)
+                continue;
+
+            if (targetIndex >= nItems || !children[targetIndex]) {
                 // calculate the position of the new slot
                 let oldBox = sourceActor.allocation;
                 let newBox = this._childAllocation(sourceActor, contentBox, targetIndex);
@@ -733,7 +1010,8 @@ const IconGrid = new Lang.Class({
         // Make the original icon look like it fell into its place
         let [originalIndex, dndDropPosition] = originalItemData;
         let originalIcon = children[originalIndex];
-        if (originalIndex in movementMatrix) {
+        if (originalIndex in movementMatrix &&
+            children[changedItems[originalIndex]]) {
             let oldIcon = children[originalIndex];
             let newIcon = children[changedItems[originalIndex]];
 
@@ -750,13 +1028,15 @@ const IconGrid = new Lang.Class({
         }
 
         // Move icons that need animating
-        for (let sourceIndex in changedItems) {
+        for (let sourceIndex in movementMatrix) {
             this._moveIcon(children[sourceIndex], movementMatrix[sourceIndex]);
         }
 
         // Hide any removed icons (only temporary)
         for (let removedIndex in removedItems) {
-            children[removedItems[removedIndex]].opacity = 0;
+            let removedActor = children[removedItems[removedIndex]];
+            if (removedActor)
+                removedActor.opacity = 0;
         }
 
         // Make sure that everything gets redrawn after the animation
@@ -814,6 +1094,16 @@ const IconGrid = new Lang.Class({
     },
 
     indexOf: function(item) {
+        if (this._virtualized) {
+            for (let index in this._items) {
+                if (item == this._items[index]) {
+                    return parseInt(index);
+                }
+            }
+
+            return -1;
+        }
+
         let children = this.actor.get_children();
         for (let i = 0; i < children.length; i++) {
             if (item == children[i]) {
@@ -825,6 +1115,9 @@ const IconGrid = new Lang.Class({
     },
 
     visibleItemsCount: function() {
+        if (this._virtualized)
+            return this._nItems;
+
         return this.actor.get_n_children() - this.actor.get_n_skip_paint();
     },
 
@@ -863,8 +1156,8 @@ const IconGrid = new Lang.Class({
             return [-1, CursorLocation.DEFAULT];
         }
 
-        let children = this.actor.get_children();
-        let childIdx = Math.min((row * this._allocatedColumns) + column, children.length);
+        let nItems = this._getItemCount();
+        let childIdx = Math.min((row * this._allocatedColumns) + column, nItems);
 
         // If we're above the grid vertically,
         // we are in an invalid drop location
@@ -874,16 +1167,19 @@ const IconGrid = new Lang.Class({
 
         // If we're past the last visible element in the grid,
         // we might be allowed to drop there.
-        if (childIdx >= children.length) {
+        if (childIdx >= nItems) {
             if (canDropPastEnd) {
-                return [children.length, CursorLocation.EMPTY_AREA];
+                return [nItems, CursorLocation.EMPTY_AREA];
             } else {
                 return [-1, CursorLocation.DEFAULT];
             }
         }
 
-        let child = children[childIdx];
-        let [childMinWidth, childMinHeight, childNaturalWidth, childNaturalHeight] = child.get_preferred_size();
+        // A virtualized grid may have no actor for the item yet
+        let child = this.getItemAtIndex(childIdx);
+        let childNaturalWidth = 0;
+        if (child)
+            [, , childNaturalWidth, ] = child.get_preferred_size();
 
         // This is the width of the cell that contains the icon
         // (excluding spacing between cells)
@@ -939,7 +1235,7 @@ const IconGrid = new Lang.Class({
             }
         } else if (sx >= iconRightX) {
             // We are to the right of the icon target
-            if (childIdx >= children.length - (canDropPastEnd ? 0 : 1)) {
+            if (childIdx >= nItems - (canDropPastEnd ? 0 : 1)) {
                 // We are beyond the last valid icon
                 // (to the right of the app store / trash can, if present)
                 dropIdx = -1;
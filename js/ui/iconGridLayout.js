@@ -4,7 +4,6 @@ const Lang = imports.lang;
 const Signals = imports.signals;
 const Gio = imports.gi.Gio;
 const GLib = imports.gi.GLib;
-const Json = imports.gi.Json;
 
 const Config = imports.misc.config;
 const EosMetrics = imports.gi.EosMetrics;
@@ -20,16 +19,7 @@ const APP_DIR_NAME = 'applications';
 const FOLDER_DIR_NAME = 'desktop-directories';
 
 const DEFAULT_CONFIGS_DIR = Config.DATADIR + '/eos-shell-content/icon-grid-defaults';
-const DEFAULT_CONFIG_NAME_BASE = 'icon-grid';
-
-const OVERRIDE_CONFIGS_DIR = Config.LOCALSTATEDIR + '/lib/eos-image-defaults/icon-grid';
-const OVERRIDE_CONFIG_NAME_BASE = 'icon-grid';
-
-const PREPEND_CONFIGS_DIR = Config.LOCALSTATEDIR + '/lib/eos-image-defaults/icon-grid';
-const PREPEND_CONFIG_NAME_BASE = 'icon-grid-prepend';
-
-const APPEND_CONFIGS_DIR = Config.LOCALSTATEDIR + '/lib/eos-image-defaults/icon-grid';
-const APPEND_CONFIG_NAME_BASE = 'icon-grid-append';
+const IMAGE_DEFAULT_CONFIGS_DIR = Config.LOCALSTATEDIR + '/lib/eos-image-defaults/icon-grid';
 
 /* Occurs when an application is uninstalled, meaning removed from the desktop's
  * app grid. Applications can be uninstalled in the app store or via dragging
@@ -41,179 +31,62 @@ const IconGridLayout = new Lang.Class({
     Name: 'IconGridLayout',
 
     _init: function(params) {
-        this._updateIconTree();
+        this._model = Shell.IconGridModel.new(global.settings, SCHEMA_KEY,
+                                              DEFAULT_CONFIGS_DIR,
+                                              IMAGE_DEFAULT_CONFIGS_DIR);
+        this._icons = {};
 
         this._removeUndone = false;
 
-        global.settings.connect('changed::' + SCHEMA_KEY, Lang.bind(this, function() {
-            this._updateIconTree();
+        this._model.connect('folder-changed', Lang.bind(this, function(model, folderId) {
+            delete this._icons[folderId];
+        }));
+        this._model.connect('changed', Lang.bind(this, function() {
             this.emit('changed');
         }));
     },
 
-    _getIconTreeFromVariant: function(allIcons) {
-        let iconTree = {};
-        let appSys = Shell.AppSystem.get_default();
-
-        for (let i = 0; i < allIcons.n_children(); i++) {
-            let context = allIcons.get_child_value(i);
-            let [folder, ] = context.get_child_value(0).get_string();
-            let children = context.get_child_value(1).get_strv();
-            iconTree[folder] = children.map(function(appId) {
-                // Some older versions of eos-app-store incorrectly added eos-app-*.desktop
-                // files to the icon grid layout, instead of the proper unprefixed .desktop
-                // files, which should never leak out of the Shell. Take these out of the
-                // icon layout.
-                if (appId.startsWith('eos-app-'))
-                    return appId.slice('eos-app-'.length);
-
-                // Some apps have their name superceded, for instance gedit -> org.gnome.gedit.
-                // We want the new name, not the old one.
-                let app = appSys.lookup_alias(appId);
-                if (app)
-                    return app.get_id();
-
-                return appId;
-            });
-        }
-
-        return iconTree;
+    get loaded() {
+        return this._model.loaded;
     },
 
-    _updateIconTree: function() {
-        let allIcons = global.settings.get_value(SCHEMA_KEY);
-        let nIcons = allIcons.n_children();
-        let iconTree = this._getIconTreeFromVariant(allIcons);
-
-        if (nIcons > 0 && !iconTree[DESKTOP_GRID_ID]) {
-            // Missing toplevel desktop ID indicates we are reading a
-            // corrupted setting. Reset grid to defaults, and let the logic
-            // below run after the GSettings notification
-            log('Corrupted icon-grid-layout detected, resetting to defaults');
-            global.settings.reset(SCHEMA_KEY);
+    // Calls @callback once the layout has been read; until then, the
+    // layout is empty and hasIcon() is false for every icon
+    whenLoaded: function(callback) {
+        if (this._model.loaded) {
+            callback();
             return;
         }
 
-        if (nIcons == 0) {
-            // Entirely empty indicates that we need to read in the defaults
-            allIcons = this._getDefaultIcons();
-            iconTree = this._getIconTreeFromVariant(allIcons);
-        }
-
-        this._iconTree = iconTree;
-    },
-
-    _loadConfigJsonString: function(dir, base) {
-        let jsonString = null;
-        let defaultFiles = GLib.get_language_names()
-            .filter(function(name) {
-                return name.indexOf('.') == -1;
-            })
-            .map(function(name) {
-                let path = GLib.build_filenamev([dir, base + '-' + name + '.json']);
-                return Gio.File.new_for_path(path);
-            })
-            .some(function(defaultsFile) {
-                try {
-                    let [success, data] = defaultsFile.load_contents(null, null,
-                                                                     null);
-                    jsonString = data.toString();
-                    return true;
-                } catch (e) {
-                    // Ignore errors, as we always have a fallback
-                }
-                return false;
-            });
-        return jsonString;
-    },
-
-    _mergeJsonStrings: function(base, override, prepend, append) {
-        let baseNode = {};
-        let prependNode = null;
-        let appendNode = null;
-        // If any image default override matches the user's locale,
-        // give that priority over the default from the base OS
-        if (override) {
-            baseNode = JSON.parse(override);
-        } else if (base) {
-            baseNode = JSON.parse(base);
-        }
-        if (prepend) {
-            prependNode = JSON.parse(prepend);
-        }
-        if (append) {
-            appendNode = JSON.parse(append);
-        }
-        for (let key in baseNode) {
-            if (prependNode && prependNode[key]) {
-                baseNode[key] = prependNode[key].concat(baseNode[key]);
-            }
-            if (appendNode && appendNode[key]) {
-                baseNode[key] = baseNode[key].concat(appendNode[key]);
-            }
-        }
-        return JSON.stringify(baseNode);
-    },
-
-    _getDefaultIcons: function() {
-        let mergedJson = this._mergeJsonStrings(
-            this._loadConfigJsonString(DEFAULT_CONFIGS_DIR, DEFAULT_CONFIG_NAME_BASE),
-            this._loadConfigJsonString(OVERRIDE_CONFIGS_DIR, OVERRIDE_CONFIG_NAME_BASE),
-            this._loadConfigJsonString(PREPEND_CONFIGS_DIR, PREPEND_CONFIG_NAME_BASE),
-            this._loadConfigJsonString(APPEND_CONFIGS_DIR ,APPEND_CONFIG_NAME_BASE)
-        );
-        let iconTree = Json.gvariant_deserialize_data(mergedJson, -1, 'a{sas}');
-
-        if (iconTree === null || iconTree.n_children() == 0) {
-            log('No icon grid defaults found!');
-            // At the minimum, put in something that avoids exceptions later
-            let fallback = {};
-            fallback[DESKTOP_GRID_ID] = [];
-            iconTree = GLib.Variant.new('a{sas}', fallback);
-        }
-
-        return iconTree;
+        let id = this._model.connect('notify::loaded', Lang.bind(this, function() {
+            this._model.disconnect(id);
+            callback();
+        }));
     },
 
     hasIcon: function(id) {
-        for (let folderId in this._iconTree) {
-            let folder = this._iconTree[folderId];
-            if (folder.indexOf(id) != -1) {
-                return true;
-            }
-        }
-
-        return false;
+        return this._model.has_icon(id);
     },
 
     _getIconLocation: function(id) {
-        for (let folderId in this._iconTree) {
-            let folder = this._iconTree[folderId];
-            let nIcons = folder.length;
-
-            let itemIdx = folder.indexOf(id);
-            let nextId;
-
-            if (itemIdx < nIcons) {
-                nextId = folder[itemIdx + 1];
-            } else {
-                // append to the folder
-                nextId = null;
-            }
-
-            if (itemIdx != -1) {
-                return [folderId, nextId];
-            }
+        let folderId = this._model.get_icon_folder(id);
+        if (!folderId) {
+            return null;
         }
-        return null;
+
+        let icons = this.getIcons(folderId);
+        let nextId = icons[this._model.get_icon_position(id) + 1];
+
+        // append to the folder if we are the last icon
+        return [folderId, nextId || null];
     },
 
     getIcons: function(folder) {
-        if (this._iconTree && this._iconTree[folder]) {
-            return this._iconTree[folder];
-        } else {
-            return [];
+        // The model hands out copies, so keep them until the folder changes
+        if (!this._icons[folder]) {
+            this._icons[folder] = this._model.get_icons(folder);
         }
+        return this._icons[folder];
     },
 
     iconIsFolder: function(id) {
@@ -297,64 +170,11 @@ const IconGridLayout = new Lang.Class({
     },
 
     listApplications: function() {
-        let allApplications = [];
-
-        for (let folderId in this._iconTree) {
-            let folder = this._iconTree[folderId];
-            for (let iconIdx in folder) {
-                let icon = folder[iconIdx];
-                if (!this.iconIsFolder(icon)) {
-                    allApplications.push(icon);
-                }
-            }
-        }
-
-        return allApplications;
+        return this._model.list_applications();
     },
 
     repositionIcon: function(id, insertId, newFolderId) {
-        let icons;
-        let existing = false;
-        let isFolder = this.iconIsFolder(id);
-
-        for (let i in this._iconTree) {
-            icons = this._iconTree[i];
-            let oldPos = icons.indexOf(id);
-            if (oldPos != -1) {
-                icons.splice(oldPos, 1);
-                existing = true;
-                break;
-            }
-        }
-
-        if (newFolderId != null) {
-            // We're adding or repositioning an icon
-            icons = this._iconTree[newFolderId];
-            if (!icons) {
-                // Invalid destination folder
-                return;
-            }
-            this._insertIcon(icons, id, insertId);
-
-            if (isFolder && !existing) {
-                // We're adding a folder, need to initialize an
-                // array for its contents
-                this._iconTree[id] = [];
-            }
-        } else {
-            // We're removing an entry
-            if (isFolder && existing) {
-                // We're removing a folder, need to delete the array
-                // for its contents as well
-                delete this._iconTree[id];
-            }
-        }
-
-        // Recreate GVariant from iconTree
-        let newLayout = GLib.Variant.new('a{sas}', this._iconTree);
-
-        // Store gsetting
-        global.settings.set_value(SCHEMA_KEY, newLayout);
+        this._model.reposition_icon(id, insertId, newFolderId);
     },
 
     resetDesktop: function() {
@@ -426,26 +246,6 @@ const IconGridLayout = new Lang.Class({
 
     _removeDirectoryFiles: function(enumerator, result) {
         this._removeFiles(enumerator, result, DIRECTORY_EXT);
-    },
-
-    // We use the insert Id instead of the index here since gsettings
-    // includes the full application list that the desktop may have.
-    // Relying on the position leads to faulty behaviour if some
-    // apps are not present on the system
-    _insertIcon: function(icons, id, insertId) {
-        let insertIdx = -1;
-
-        if (insertId != null) {
-            insertIdx = icons.indexOf(insertId);
-        }
-
-        // We were dropped to the left of the trashcan,
-        // or we were asked to append
-        if (insertIdx == -1) {
-            insertIdx = icons.length;
-        }
-
-        icons.splice(insertIdx, 0, id);
     }
 });
 Signals.addSignalMethods(IconGridLayout.prototype);
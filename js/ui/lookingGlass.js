@@ -14,6 +14,7 @@ const Lang = imports.lang;
 const Mainloop = imports.mainloop;
 const System = imports.system;
 
+const Background = imports.ui.background;
 const History = imports.misc.history;
 const ExtensionSystem = imports.ui.extensionSystem;
 const ExtensionUtils = imports.misc.extensionUtils;
@@ -362,6 +363,67 @@ const WindowList = new Lang.Class({
 });
 Signals.addSignalMethods(WindowList.prototype);
 
+const MemoryUsage = new Lang.Class({
+    Name: 'MemoryUsage',
+
+    _init: function(lookingGlass) {
+        this.actor = new St.BoxLayout({ name: 'Memory', vertical: true, style: 'spacing: 8px' });
+        this._lookingGlass = lookingGlass;
+
+        let refresh = new St.Button({ label: 'Refresh', style_class: 'lg-obj-inspector-button' });
+        refresh.connect('clicked', Lang.bind(this, this._update));
+        this.actor.add(refresh, { x_align: St.Align.START, x_fill: false });
+
+        this._statsBox = new St.BoxLayout({ vertical: true });
+        this.actor.add(this._statsBox);
+
+        this._countsBox = new St.BoxLayout({ vertical: true, style: 'padding-left: 6px;' });
+        this.actor.add(this._countsBox);
+
+        Main.initializeDeferredWork(this.actor, Lang.bind(this, this._update));
+    },
+
+    _addStat: function(name, count, bytes) {
+        let text = name + ': ' + count;
+        if (bytes !== undefined)
+            text += ' (' + GLib.format_size(bytes) + ')';
+        this._statsBox.add(new St.Label({ text: text }));
+    },
+
+    _update: function() {
+        this._statsBox.destroy_all_children();
+        this._countsBox.destroy_all_children();
+
+        let [nEntries, entriesSize] = St.TextureCache.get_default().get_memory_usage();
+        this._addStat('Texture cache entries', nEntries, entriesSize);
+
+        let [nNodes, nodesSize] = St.ThemeContext.get_for_stage(global.stage).get_memory_usage();
+        this._addStat('Theme nodes', nNodes, nodesSize);
+
+        let [nPrerendered, prerenderedSize, nShadows, shadowsSize] =
+            St.ThemeNode.get_texture_memory_usage();
+        this._addStat('Prerendered backgrounds', nPrerendered, prerenderedSize);
+        this._addStat('Shadow textures', nShadows, shadowsSize);
+
+        let backgrounds = Background.getBackgroundCache().getMemoryUsage();
+        this._addStat('Background sources', backgrounds.sources);
+        this._addStat('Background images', backgrounds.images, backgrounds.imageBytes);
+
+        // Only filled in when running with GOBJECT_DEBUG=instance-count
+        let counts = Shell.util_get_instance_counts().deep_unpack();
+        let types = Object.keys(counts);
+        if (types.length == 0) {
+            this._countsBox.add(new St.Label({ text: 'Set GOBJECT_DEBUG=instance-count to see instance counts' }));
+            return;
+        }
+
+        types.sort(function(a, b) { return counts[b] - counts[a]; });
+        this._countsBox.add(new St.Label({ text: 'Live instances:' }));
+        for (let i = 0; i < types.length; i++)
+            this._countsBox.add(new St.Label({ text: types[i] + ': ' + counts[types[i]] }));
+    }
+});
+
 const ObjInspector = new Lang.Class({
     Name: 'ObjInspector',
 
@@ -876,6 +938,9 @@ const LookingGlass = new Lang.Class({
         this._extensions = new Extensions(this);
         notebook.appendPage('Extensions', this._extensions.actor);
 
+        this._memoryUsage = new MemoryUsage(this);
+        notebook.appendPage('Memory', this._memoryUsage.actor);
+
         this._entry.clutter_text.connect('activate', Lang.bind(this, function (o, e) {
             // Hide any completions we are currently showing
             this._hideCompletions();
@@ -645,7 +645,7 @@ const ZoomRegion = new Lang.Class({
 
         this._magView = null;
         this._background = null;
-        this._uiGroupClone = null;
+        this._magnifierView = null;
         this._mouseSourceActor = mouseSourceActor;
         this._mouseActor  = null;
         this._crossHairs = null;
@@ -974,8 +974,8 @@ const ZoomRegion = new Lang.Class({
      */
     setInvertLightness: function(flag) {
         this._invertLightness = flag;
-        if (this._magShaderEffects)
-            this._magShaderEffects.setInvertLightness(this._invertLightness);
+        if (this._magnifierView)
+            this._magnifierView.invert_lightness = this._invertLightness;
     },
 
     /**
@@ -996,8 +996,8 @@ const ZoomRegion = new Lang.Class({
      */
     setColorSaturation: function(saturation) {
         this._colorSaturation = saturation;
-        if (this._magShaderEffects)
-            this._magShaderEffects.setColorSaturation(this._colorSaturation);
+        if (this._magnifierView)
+            this._magnifierView.color_saturation = this._colorSaturation;
     },
 
     /**
@@ -1020,8 +1020,10 @@ const ZoomRegion = new Lang.Class({
         this._brightness.r = brightness.r;
         this._brightness.g = brightness.g;
         this._brightness.b = brightness.b;
-        if (this._magShaderEffects)
-            this._magShaderEffects.setBrightness(this._brightness);
+        if (this._magnifierView)
+            this._magnifierView.set_brightness(this._brightness.r,
+                                               this._brightness.g,
+                                               this._brightness.b);
     },
 
     /**
@@ -1050,8 +1052,10 @@ const ZoomRegion = new Lang.Class({
         this._contrast.r = contrast.r;
         this._contrast.g = contrast.g;
         this._contrast.b = contrast.b;
-        if (this._magShaderEffects)
-            this._magShaderEffects.setContrast(this._contrast);
+        if (this._magnifierView)
+            this._magnifierView.set_contrast(this._contrast.r,
+                                             this._contrast.g,
+                                             this._contrast.b);
     },
 
     /**
@@ -1087,10 +1091,11 @@ const ZoomRegion = new Lang.Class({
         this._background = (new Background.SystemBackground()).actor;
         mainGroup.add_actor(this._background);
 
-        // Clone the group that contains all of UI on the screen.  This is the
-        // chrome, the windows, etc.
-        this._uiGroupClone = new Clutter.Clone({ source: Main.uiGroup });
-        mainGroup.add_actor(this._uiGroupClone);
+        // Magnify the group that contains all of UI on the screen.  This is
+        // the chrome, the windows, etc.  Only the part of it that is visible
+        // in the view is painted, with the color adjustments below.
+        this._magnifierView = new Shell.MagnifierView({ source: Main.uiGroup });
+        mainGroup.add_actor(this._magnifierView);
 
         // Add either the given mouseSourceActor to the ZoomRegion, or a clone of
         // it.
@@ -1106,11 +1111,14 @@ const ZoomRegion = new Lang.Class({
             this._crossHairsActor = null;
 
         // Contrast and brightness effects.
-        this._magShaderEffects = new MagShaderEffects(this._uiGroupClone);
-        this._magShaderEffects.setColorSaturation(this._colorSaturation);
-        this._magShaderEffects.setInvertLightness(this._invertLightness);
-        this._magShaderEffects.setBrightness(this._brightness);
-        this._magShaderEffects.setContrast(this._contrast);
+        this._magnifierView.color_saturation = this._colorSaturation;
+        this._magnifierView.invert_lightness = this._invertLightness;
+        this._magnifierView.set_brightness(this._brightness.r,
+                                           this._brightness.g,
+                                           this._brightness.b);
+        this._magnifierView.set_contrast(this._contrast.r,
+                                         this._contrast.g,
+                                         this._contrast.b);
     },
 
     _destroyActors: function() {
@@ -1119,12 +1127,10 @@ const ZoomRegion = new Lang.Class({
         if (this._crossHairs)
             this._crossHairs.removeFromParent(this._crossHairsActor);
 
-        this._magShaderEffects.destroyEffects();
-        this._magShaderEffects = null;
         this._magView.destroy();
         this._magView = null;
         this._background = null;
-        this._uiGroupClone = null;
+        this._magnifierView = null;
         this._mouseActor = null;
         this._crossHairsActor = null;
     },
@@ -1320,11 +1326,15 @@ const ZoomRegion = new Lang.Class({
         if (!this.isActive())
             return;
 
-        this._uiGroupClone.set_scale(this._xMagFactor, this._yMagFactor);
         this._mouseActor.set_scale(this._xMagFactor, this._yMagFactor);
 
+        // The part of the screen that ends up in the view port
         let [x, y] = this._screenToViewPort(0, 0);
-        this._uiGroupClone.set_position(Math.round(x), Math.round(y));
+        this._magnifierView.set_size(this._viewPortWidth, this._viewPortHeight);
+        this._magnifierView.set_region(-Math.round(x) / this._xMagFactor,
+                                       -Math.round(y) / this._yMagFactor,
+                                       this._viewPortWidth / this._xMagFactor,
+                                       this._viewPortHeight / this._yMagFactor);
 
         this._updateMousePosition();
     },
@@ -1626,144 +1636,3 @@ const Crosshairs = new Lang.Class({
         this._vertBottomHair.set_position((groupWidth - thickness) / 2, bottom);
     }
 });
-
-const MagShaderEffects = new Lang.Class({
-    Name: 'MagShaderEffects',
-
-    _init: function(uiGroupClone) {
-        this._inverse = new Shell.InvertLightnessEffect();
-        this._brightnessContrast = new Clutter.BrightnessContrastEffect();
-        this._colorDesaturation = new Clutter.DesaturateEffect();
-        this._inverse.set_enabled(false);
-        this._brightnessContrast.set_enabled(false);
-
-        this._magView = uiGroupClone;
-        this._magView.add_effect(this._inverse);
-        this._magView.add_effect(this._brightnessContrast);
-        this._magView.add_effect(this._colorDesaturation);
-    },
-
-    /**
-     * destroyEffects:
-     * Remove contrast and brightness effects from the magnified view, and
-     * lose the reference to the actor they were applied to.  Don't use this
-     * object after calling this.
-     */
-    destroyEffects: function() {
-        this._magView.clear_effects();
-        this._colorDesaturation = null;
-        this._brightnessContrast = null;
-        this._inverse = null;
-        this._magView = null;
-    },
-
-    /**
-     * setInvertLightness:
-     * Enable/disable invert lightness effect.
-     * @invertFlag:     Enabled flag.
-     */
-    setInvertLightness: function(invertFlag) {
-        this._inverse.set_enabled(invertFlag);
-    },
-
-    /**
-     * getInvertLightness:
-     * Report whether the inversion effect is enabled.
-     * @return:     Boolean.
-     */
-    getInvertLightness: function() {
-        return this._inverse.get_enabled();
-    },
-
-    setColorSaturation: function(factor) {
-        this._colorDesaturation.set_factor(1.0 - factor);
-    },
-
-    getColorSaturation: function() {
-        return 1.0 - this._colorDesaturation.get_factor();
-    },
-
-    /**
-     * setBrightness:
-     * Set the brightness of the magnified view.
-     * @brightness: Object containing the brightness for the red, green,
-     *              and blue channels.  Values of 0.0 represent "standard"
-     *              brightness (no change), whereas values less or greater than
-     *              0.0 indicate decreased or incresaed brightness,
-     *              respectively.
-     */
-    setBrightness: function(brightness) {
-        let bRed = brightness.r;
-        let bGreen = brightness.g;
-        let bBlue = brightness.b;
-        this._brightnessContrast.set_brightness_full(bRed, bGreen, bBlue);
-
-        // Enable the effect if the brightness OR contrast change are such that
-        // it modifies the brightness and/or contrast.
-        let [cRed, cGreen, cBlue] = this._brightnessContrast.get_contrast();
-        this._brightnessContrast.set_enabled(
-            (bRed != NO_CHANGE || bGreen != NO_CHANGE || bBlue != NO_CHANGE ||
-             cRed != NO_CHANGE || cGreen != NO_CHANGE || cBlue != NO_CHANGE)
-        );
-    },
-
-    /**
-     * getBrightness:
-     * Retrieve current brightness of the magnified view.
-     * @return: Object containing the brightness for the red, green,
-     *          and blue channels.  Values of 0.0 represent "standard" 
-     *          brightness (no change), whereas values less or greater than
-     *          0.0 indicate decreased or incresaed brightness, respectively.
-     */
-    getBrightness: function() {
-        let result = {};
-        let [bRed, bGreen, bBlue] = this._brightnessContrast.get_brightness();
-        result.r = bRed;
-        result.g = bGreen;
-        result.b = bBlue;
-
-        return result;
-    },
-
-    /**
-     * Set the contrast of the magnified view.
-     * @contrast:   Object containing the contrast for the red, green,
-     *              and blue channels.  Values of 0.0 represent "standard"
-     *              contrast (no change), whereas values less or greater than
-     *              0.0 indicate decreased or incresaed contrast, respectively.
-     */
-    setContrast: function(contrast) {
-        let cRed = contrast.r;
-        let cGreen = contrast.g;
-        let cBlue = contrast.b;
-
-        this._brightnessContrast.set_contrast_full(cRed, cGreen, cBlue);
-
-        // Enable the effect if the contrast OR brightness change are such that
-        // it modifies the brightness and/or contrast.
-        // should be able to use Clutter.color_equal(), but that complains of
-        // a null first argument.
-        let [bRed, bGreen, bBlue] = this._brightnessContrast.get_brightness();
-        this._brightnessContrast.set_enabled(
-             cRed != NO_CHANGE || cGreen != NO_CHANGE || cBlue != NO_CHANGE ||
-             bRed != NO_CHANGE || bGreen != NO_CHANGE || bBlue != NO_CHANGE
-        );
-    },
-
-    /**
-     * Retrieve current contrast of the magnified view.
-     * @return: Object containing the contrast for the red, green,
-     *          and blue channels.  Values of 0.0 represent "standard"
-     *          contrast (no change), whereas values less or greater than
-     *          0.0 indicate decreased or incresaed contrast, respectively.
-     */
-    getContrast: function() {
-        let resutl = {};
-        let [cRed, cGreen, cBlue] = this._brightnessContrast.get_contrast();
-        result.r = cRed;
-        result.g = cGreen;
-        result.b = cBlue;
-
-        return result;
-    }
-});
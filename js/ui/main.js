@@ -10,39 +10,45 @@ const Meta = imports.gi.Meta;
 const Shell = imports.gi.Shell;
 const St = imports.gi.St;
 
-const AppActivation = imports.ui.appActivation;
-const Components = imports.ui.components;
-const CtrlAltTab = imports.ui.ctrlAltTab;
-const EndSessionDialog = imports.ui.endSessionDialog;
-const Environment = imports.ui.environment;
-const ExtensionSystem = imports.ui.extensionSystem;
-const ExtensionDownloader = imports.ui.extensionDownloader;
-const Keyboard = imports.ui.keyboard;
-const MessageTray = imports.ui.messageTray;
-const ModalDialog = imports.ui.modalDialog;
-const OsdWindow = imports.ui.osdWindow;
-const OsdMonitorLabeler = imports.ui.osdMonitorLabeler;
-const Overview = imports.ui.overview;
-const Panel = imports.ui.panel;
+// Before the UI modules, so their imports can be traced
+const StartupTrace = imports.misc.startupTrace;
+
+const AppActivation = StartupTrace.importUI('appActivation');
+const Components = StartupTrace.importUI('components');
+const CtrlAltTab = StartupTrace.importUI('ctrlAltTab');
+const EndSessionDialog = StartupTrace.importUI('endSessionDialog');
+const Environment = StartupTrace.importUI('environment');
+const ExtensionSystem = StartupTrace.importUI('extensionSystem');
+const ExtensionDownloader = StartupTrace.importUI('extensionDownloader');
+const Keyboard = StartupTrace.importUI('keyboard');
+const MessageTray = StartupTrace.importUI('messageTray');
+const ModalDialog = StartupTrace.importUI('modalDialog');
+const OsdWindow = StartupTrace.importUI('osdWindow');
+const OsdMonitorLabeler = StartupTrace.importUI('osdMonitorLabeler');
+const Overview = StartupTrace.importUI('overview');
+const Panel = StartupTrace.importUI('panel');
 const Params = imports.misc.params;
-const RunDialog = imports.ui.runDialog;
-const Layout = imports.ui.layout;
+const RunDialog = StartupTrace.importUI('runDialog');
+const Layout = StartupTrace.importUI('layout');
 const LoginManager = imports.misc.loginManager;
-const LookingGlass = imports.ui.lookingGlass;
-const NotificationDaemon = imports.ui.notificationDaemon;
-const WindowAttentionHandler = imports.ui.windowAttentionHandler;
-const ScreenShield = imports.ui.screenShield;
-const Scripting = imports.ui.scripting;
-const SessionMode = imports.ui.sessionMode;
-const ShellDBus = imports.ui.shellDBus;
-const ShellMountOperation = imports.ui.shellMountOperation;
-const WindowManager = imports.ui.windowManager;
-const WorkspaceMonitor = imports.ui.workspaceMonitor;
-const Magnifier = imports.ui.magnifier;
-const XdndHandler = imports.ui.xdndHandler;
+const LookingGlass = StartupTrace.importUI('lookingGlass');
+const NotificationDaemon = StartupTrace.importUI('notificationDaemon');
+const WindowAttentionHandler = StartupTrace.importUI('windowAttentionHandler');
+const ScreenShield = StartupTrace.importUI('screenShield');
+const Scripting = StartupTrace.importUI('scripting');
+const SessionMode = StartupTrace.importUI('sessionMode');
+const ShellDBus = StartupTrace.importUI('shellDBus');
+const ShellMountOperation = StartupTrace.importUI('shellMountOperation');
+const WindowManager = StartupTrace.importUI('windowManager');
+const WorkspaceMonitor = StartupTrace.importUI('workspaceMonitor');
+const Magnifier = StartupTrace.importUI('magnifier');
+const XdndHandler = StartupTrace.importUI('xdndHandler');
 const Util = imports.misc.util;
 
 const OVERRIDES_SCHEMA = 'org.gnome.shell.overrides';
+const A11Y_APPLICATIONS_SCHEMA = 'org.gnome.desktop.a11y.applications';
+const SHOW_MAGNIFIER_KEY = 'screen-magnifier-enabled';
+const SHOW_KEYBOARD_KEY = 'screen-keyboard-enabled';
 const LOW_RESOLUTION_WIDTH = 800;
 const LOW_RESOLUTION_HEIGHT = 600;
 
@@ -60,8 +66,6 @@ let screenShield = null;
 let notificationDaemon = null;
 let windowAttentionHandler = null;
 let ctrlAltTabManager = null;
-let osdWindow = null;
-let osdMonitorLabeler = null;
 let sessionMode = null;
 let shellDBusService = null;
 let shellMountOpDBusService = null;
@@ -71,9 +75,7 @@ let modalCount = 0;
 let keybindingMode = Shell.KeyBindingMode.NONE;
 let modalActorFocusStack = [];
 let uiGroup = null;
-let magnifier = null;
 let xdndHandler = null;
-let keyboard = null;
 let layoutManager = null;
 let workspaceMonitor = null;
 let desktopAppClient = null;
@@ -82,6 +84,67 @@ let _startDate;
 let _defaultCssStylesheet = null;
 let _cssStylesheet = null;
 let _overridesSettings = null;
+let _a11yApplicationsSettings = null;
+
+// keyboard, magnifier, osdMonitorLabeler and osdWindow are not needed
+// to show the first frame. They are defined as properties of this
+// module by _defineLazyService(), and created the first time they are
+// used, or once the shell is idle after startup, whichever comes
+// first. The keyboard and the magnifier are also created as soon as
+// they are enabled.
+const _moduleScope = this;
+let _lazyServices = [];
+
+function _defineLazyService(name, constructor) {
+    let service = { name: name,
+                    constructor: constructor,
+                    instance: null };
+    _lazyServices.push(service);
+
+    Object.defineProperty(_moduleScope, name, {
+        get: function() {
+            return _ensureLazyService(service);
+        },
+        enumerable: true
+    });
+
+    return service;
+}
+
+// Defines a lazy service that is created right away while @key of the
+// accessibility applications settings is enabled
+function _defineLazyA11yService(name, key, constructor) {
+    let service = _defineLazyService(name, constructor);
+
+    let ensureIfEnabled = function() {
+        if (_a11yApplicationsSettings.get_boolean(key))
+            _ensureLazyService(service);
+    };
+    _a11yApplicationsSettings.connect('changed::' + key, ensureIfEnabled);
+
+    return ensureIfEnabled;
+}
+
+function _ensureLazyService(service) {
+    if (!service.instance) {
+        service.instance = service.constructor();
+        Shell.PerfLog.get_default().event_s('main.lazyServiceCreated', service.name);
+    }
+    return service.instance;
+}
+
+function _writeStartupTrace() {
+    try {
+        Shell.startup_trace_write_report();
+    } catch(e) {
+        log('Failed to write the startup trace: ' + e.message);
+    }
+}
+
+function _createLazyServices() {
+    _lazyServices.forEach(_ensureLazyService);
+    Shell.PerfLog.get_default().event('main.lazyServicesReady');
+}
 
 function _sessionUpdated() {
     _loadDefaultStylesheet();
@@ -103,6 +166,8 @@ function _sessionUpdated() {
 }
 
 function start() {
+    Shell.startup_trace_mark('mainStart');
+
     // These are here so we don't break compatibility.
     global.logError = window.log;
     global.log = window.log;
@@ -127,7 +192,24 @@ function _sessionsLoaded() {
     _sessionUpdated();
 }
 
+function _defineStartupEvents() {
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('main.initializeUIStart',
+                         "Start of the construction of the UI", '');
+    perfLog.define_event('main.initializeUIDone',
+                         "The UI was constructed", '');
+    perfLog.define_event('main.startupComplete',
+                         "The startup animation finished", '');
+    perfLog.define_event('main.lazyServiceCreated',
+                         "A service not needed at startup was created", 's');
+    perfLog.define_event('main.lazyServicesReady',
+                         "All the services not needed at startup were created", '');
+}
+
 function _initializeUI() {
+    _defineStartupEvents();
+    Shell.PerfLog.get_default().event('main.initializeUIStart');
+
     // Ensure ShellWindowTracker and ShellAppUsage are initialized; this will
     // also initialize ShellAppSystem first.  ShellAppSystem
     // needs to load all the .desktop files, and ShellWindowTracker
@@ -136,15 +218,19 @@ function _initializeUI() {
     // and recalculate application associations, so to avoid
     // races for now we initialize it here.  It's better to
     // be predictable anyways.
+    Shell.startup_trace_begin('appSystem');
     let tracker = Shell.WindowTracker.get_default();
     Shell.AppUsage.get_default();
+    Shell.startup_trace_end('appSystem');
 
     tracker.connect('startup-sequence-changed', _queueCheckWorkspaces);
 
+    Shell.startup_trace_begin('theme');
     let resource = Gio.Resource.load(global.datadir + '/gnome-shell-theme.gresource');
     resource._register();
 
     _loadDefaultStylesheet();
+    Shell.startup_trace_end('theme');
 
     // Setup the stage hierarchy early
     layoutManager = new Layout.LayoutManager();
@@ -160,19 +246,32 @@ function _initializeUI() {
     // working until it's updated.
     uiGroup = layoutManager.uiGroup;
 
+    _a11yApplicationsSettings = new Gio.Settings({ schema: A11Y_APPLICATIONS_SCHEMA });
+
     xdndHandler = new XdndHandler.XdndHandler();
     ctrlAltTabManager = new CtrlAltTab.CtrlAltTabManager();
-    osdWindow = new OsdWindow.OsdWindow();
-    osdMonitorLabeler = new OsdMonitorLabeler.OsdMonitorLabeler();
+    _defineLazyService('osdWindow', function() {
+        return new OsdWindow.OsdWindow();
+    });
+    _defineLazyService('osdMonitorLabeler', function() {
+        return new OsdMonitorLabeler.OsdMonitorLabeler();
+    });
+    let ensureMagnifier = _defineLazyA11yService('magnifier', SHOW_MAGNIFIER_KEY, function() {
+        return new Magnifier.Magnifier();
+    });
+    let ensureKeyboard = _defineLazyA11yService('keyboard', SHOW_KEYBOARD_KEY, function() {
+        return new Keyboard.Keyboard();
+    });
+
     overview = new Overview.Overview();
     wm = new WindowManager.WindowManager();
-    magnifier = new Magnifier.Magnifier();
+    ensureMagnifier();
     if (LoginManager.canLock())
         screenShield = new ScreenShield.ScreenShield();
 
     messageTray = new MessageTray.MessageTray();
     panel = new Panel.Panel();
-    keyboard = new Keyboard.Keyboard();
+    ensureKeyboard();
     notificationDaemon = new NotificationDaemon.NotificationDaemon();
     windowAttentionHandler = new WindowAttentionHandler.WindowAttentionHandler();
     componentManager = new Components.ComponentManager();
@@ -240,13 +339,20 @@ function _initializeUI() {
     });
 
     layoutManager.connect('startup-complete', function() {
+        Shell.PerfLog.get_default().event('main.startupComplete');
+
         if (keybindingMode == Shell.KeyBindingMode.NONE) {
             keybindingMode = Shell.KeyBindingMode.NORMAL;
         }
         if (screenShield) {
             screenShield.lockIfWasLocked();
         }
+
+        global.run_at_leisure(_createLazyServices);
+        global.run_at_leisure(_writeStartupTrace);
     });
+
+    Shell.PerfLog.get_default().event('main.initializeUIDone');
 }
 
 function _updateLowResolution() {
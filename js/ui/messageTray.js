@@ -1368,11 +1368,15 @@ const Source = new Lang.Class({
     },
 
     pushNotification: function(notification) {
-        if (this.notifications.indexOf(notification) < 0) {
-            this.notifications.push(notification);
-            this.emit('notification-added', notification);
+        if (this.notifications.indexOf(notification) >= 0) {
+            // An update of a notification we already have
+            this.countUpdated();
+            return;
         }
 
+        this.notifications.push(notification);
+        this.emit('notification-added', notification);
+
         notification.connect('destroy', Lang.bind(this,
             function () {
                 let index = this.notifications.indexOf(notification);
@@ -1715,8 +1719,21 @@ const MessageTray = new Lang.Class({
         this._notificationWidget.add_actor(this._notificationBin);
         this._notificationWidget.hide();
         this._notificationFocusGrabber = new FocusGrabber(this._notificationWidget);
-        this._notificationQueue = [];
+        this._notificationQueue = new Util.PriorityQueue(function(notification1, notification2) {
+            return (notification2.urgency - notification1.urgency);
+        }, function(notification) {
+            return notification.source;
+        });
+        this._notificationsCoalesced = 0;
+        this._notificationsDropped = 0;
         this._notification = null;
+
+        let perfLog = Shell.PerfLog.get_default();
+        perfLog.define_statistic('notifications.coalesced',
+                                 "Number of banners replaced by a newer notification from the same source", 'i');
+        perfLog.define_statistic('notifications.dropped',
+                                 "Number of notifications discarded before they could be shown", 'i');
+        perfLog.add_statistics_callback(Lang.bind(this, this._updateStatistics));
         this._notificationClickedId = 0;
 
         this.actor.connect('button-release-event', Lang.bind(this, function(actor, event) {
@@ -2042,8 +2059,8 @@ const MessageTray = new Lang.Class({
         obj.mutedChangedId = source.connect('muted-changed', Lang.bind(this,
             function () {
                 if (source.isMuted)
-                    this._notificationQueue = this._notificationQueue.filter(function(notification) {
-                        return source != notification.source;
+                    this._notificationQueue.removeAll(function(notification) {
+                        return source == notification.source;
                     });
             }));
 
@@ -2131,10 +2148,8 @@ const MessageTray = new Lang.Class({
             return;
         }
 
-        let index = this._notificationQueue.indexOf(notification);
         notification.destroy();
-        if (index != -1)
-            this._notificationQueue.splice(index, 1);
+        this._notificationQueue.remove(notification);
     },
 
     openTray: function() {
@@ -2196,17 +2211,52 @@ const MessageTray = new Lang.Class({
             // If a new notification is updated while it is being hidden,
             // we stop hiding it and show it again.
             this._updateShowingNotification();
-        } else if (this._notificationQueue.indexOf(notification) < 0) {
+        } else if (!this._notificationQueue.contains(notification)) {
             notification.connect('destroy',
                                  Lang.bind(this, this._onNotificationDestroy));
+            this._coalesceQueuedNotification(notification);
             this._notificationQueue.push(notification);
-            this._notificationQueue.sort(function(notification1, notification2) {
-                return (notification2.urgency - notification1.urgency);
-            });
         }
         this._updateState();
     },
 
+    // A source that sends notifications faster than we can show them
+    // only gets a banner for the most recent one; the ones it replaces
+    // are still in the source's notification stack, unless they were
+    // transient, in which case they are gone for good.
+    _coalesceQueuedNotification: function(notification) {
+        let queued = this._notificationQueue.findByKey(notification.source, function(n) {
+            return n.urgency != Urgency.CRITICAL &&
+                   n.urgency <= notification.urgency;
+        });
+        if (!queued)
+            return;
+
+        this._notificationQueue.remove(queued);
+        if (queued.isTransient) {
+            queued.destroy(NotificationDestroyedReason.EXPIRED);
+            this.notificationDropped();
+        } else {
+            this.notificationCoalesced();
+        }
+    },
+
+    // These are also called by whoever merges or discards notifications
+    // before they make it to the tray, so that all of them are accounted
+    // for in the perf log
+    notificationCoalesced: function() {
+        this._notificationsCoalesced++;
+    },
+
+    notificationDropped: function() {
+        this._notificationsDropped++;
+    },
+
+    _updateStatistics: function(perfLog) {
+        perfLog.update_statistic_i('notifications.coalesced', this._notificationsCoalesced);
+        perfLog.update_statistic_i('notifications.dropped', this._notificationsDropped);
+    },
+
     _onSummaryItemClicked: function(summaryItem, button) {
         if (summaryItem.source.handleSummaryClick(button)) {
             if (summaryItem.source.keepTrayOnSummaryClick)
@@ -2349,12 +2399,12 @@ const MessageTray = new Lang.Class({
     _updateState: function() {
         // Notifications
         let notificationQueue = this._notificationQueue;
-        let notificationUrgent = notificationQueue.length > 0 && notificationQueue[0].urgency == Urgency.CRITICAL;
-        let notificationForFeedback = notificationQueue.length > 0 && notificationQueue[0].forFeedback;
+        let nextNotification = notificationQueue.peek();
+        let notificationUrgent = nextNotification != null && nextNotification.urgency == Urgency.CRITICAL;
+        let notificationForFeedback = nextNotification != null && nextNotification.forFeedback;
         let notificationForFeedbackHidden = notificationForFeedback && (Main.layoutManager.bottomMonitor && Main.layoutManager.bottomMonitor.inFullscreen);
         let notificationsLimited = this._busy || (Main.layoutManager.bottomMonitor && Main.layoutManager.bottomMonitor.inFullscreen);
         let notificationsPending = notificationQueue.length > 0 && (!notificationsLimited || notificationUrgent || notificationForFeedback) && Main.sessionMode.hasNotifications;
-        let nextNotification = notificationQueue.length > 0 ? notificationQueue[0] : null;
         let notificationPinned = this._pointerInTray && !this._notificationRemoved;
         let notificationExpanded = this._notification && this._notification.expanded;
         let notificationExpired = this._notificationTimeoutId == 0 &&
@@ -2781,16 +2831,13 @@ const MessageTray = new Lang.Class({
 
         let hasRightClickMenu = this._summaryBoxPointerItem.rightClickMenu != null;
         if (this._clickedSummaryItemMouseButton == 1 || !hasRightClickMenu) {
-            let newQueue = [];
-            for (let i = 0; i < this._notificationQueue.length; i++) {
-                let notification = this._notificationQueue[i];
-                let sameSource = this._summaryBoxPointerItem.source == notification.source;
+            let source = this._summaryBoxPointerItem.source;
+            this._notificationQueue.removeAll(function(notification) {
+                let sameSource = source == notification.source;
                 if (sameSource)
                     notification.acknowledged = true;
-                else
-                    newQueue.push(notification);
-            }
-            this._notificationQueue = newQueue;
+                return sameSource;
+            });
 
             this._summaryBoxPointer.bin.child = this._summaryBoxPointerItem.notificationStackWidget;
 
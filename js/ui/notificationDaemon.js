@@ -3,7 +3,6 @@
 const Clutter = imports.gi.Clutter;
 const GLib = imports.gi.GLib;
 const Gdk = imports.gi.Gdk;
-const GdkPixbuf = imports.gi.GdkPixbuf;
 const Gio = imports.gi.Gio;
 const Gtk = imports.gi.Gtk;
 const Lang = imports.lang;
@@ -82,6 +81,14 @@ const Urgency = {
     CRITICAL: 2
 };
 
+// Notifications are built from an idle, this many at a time, so that
+// an application flooding us with them can't keep us from painting
+const MAX_NOTIFICATIONS_PER_BATCH = 5;
+
+// Past this many notifications waiting to be built for one source,
+// the oldest ones are expired without ever being shown
+const MAX_PENDING_NOTIFICATIONS = 20;
+
 const rewriteRules = {
     'XChat': [
         { pattern:     /^XChat: Private message from: (\S*) \(.*\)$/,
@@ -118,6 +125,11 @@ const FdoNotificationDaemon = new Lang.Class({
         this._sources = [];
         this._senderToPid = {};
         this._notifications = {};
+        // Notifications waiting to be built, by id, in the order they
+        // came in, and by source, to keep each source under its limit
+        this._pendingNotifications = new Map();
+        this._pendingBySource = new Map();
+        this._pendingNotificationsId = 0;
         this._busProxy = new Bus();
 
         this._nextNotificationId = 1;
@@ -134,15 +146,11 @@ const FdoNotificationDaemon = new Lang.Class({
         this._trayManager.manage_screen(global.screen, Main.messageTray.actor);
     },
 
-    _imageForNotificationData: function(hints) {
-        if (hints['image-data']) {
-            let [width, height, rowStride, hasAlpha,
-                 bitsPerSample, nChannels, data] = hints['image-data'];
-            return Shell.util_create_pixbuf_from_data(data, GdkPixbuf.Colorspace.RGB, hasAlpha,
-                                                      bitsPerSample, width, height, rowStride);
-        } else if (hints['image-path']) {
-            return new Gio.FileIcon({ file: Gio.File.new_for_path(hints['image-path']) });
-        }
+    _imageForNotificationData: function(ndata) {
+        if (ndata.image)
+            return ndata.image;
+        else if (ndata.hints['image-path'])
+            return new Gio.FileIcon({ file: Gio.File.new_for_path(ndata.hints['image-path']) });
         return null;
     },
 
@@ -241,6 +249,19 @@ const FdoNotificationDaemon = new Lang.Class({
         let [appName, replacesId, icon, summary, body, actions, hints, timeout] = params;
         let id;
 
+        // Be compatible with the various hints for image data and image path
+        // 'image-data' and 'image-path' are the latest name of these hints, introduced in 1.2;
+        // 'image_data' is from version 1.1 of the spec, and early versions used
+        // 'icon_data', which should only be used if 'image-path' is not available.
+        // The image data stays packed in its variant, so that the pixels are
+        // never copied into JS; it is decoded in a thread instead.
+        let imageData = hints['image-data'] || hints['image_data'];
+        if (!imageData && !hints['image-path'] && !hints['image_path'])
+            imageData = hints['icon_data'];
+        delete hints['image-data'];
+        delete hints['image_data'];
+        delete hints['icon_data'];
+
         for (let hint in hints) {
             // unpack the variants
             hints[hint] = hints[hint].deep_unpack();
@@ -277,26 +298,17 @@ const FdoNotificationDaemon = new Lang.Class({
             }
         }
 
-        // Be compatible with the various hints for image data and image path
-        // 'image-data' and 'image-path' are the latest name of these hints, introduced in 1.2
-
         if (!hints['image-path'] && hints['image_path'])
             hints['image-path'] = hints['image_path']; // version 1.1 of the spec
 
-        if (!hints['image-data']) {
-            if (hints['image_data'])
-                hints['image-data'] = hints['image_data']; // version 1.1 of the spec
-            else if (hints['icon_data'] && !hints['image-path'])
-                // early versions of the spec; 'icon_data' should only be used if 'image-path' is not available
-                hints['image-data'] = hints['icon_data'];
-        }
-
         let ndata = { appName: appName,
                       icon: icon,
                       summary: summary,
                       body: body,
                       actions: actions,
                       hints: hints,
+                      imageData: imageData,
+                      image: null,
                       timeout: timeout };
         if (replacesId != 0 && this._notifications[replacesId]) {
             ndata.id = id = replacesId;
@@ -313,7 +325,7 @@ const FdoNotificationDaemon = new Lang.Class({
         let source = this._getSource(appName, pid, ndata, sender, null);
 
         if (source) {
-            this._notifyForSource(source, ndata);
+            this._notifyForSourceWhenReady(source, ndata);
             return invocation.return_value(GLib.Variant.new('(u)', [id]));
         }
 
@@ -352,7 +364,7 @@ const FdoNotificationDaemon = new Lang.Class({
                     delete this._senderToPid[sender];
                 }));
             }
-            this._notifyForSource(source, ndata);
+            this._notifyForSourceWhenReady(source, ndata);
         }));
 
         return invocation.return_value(GLib.Variant.new('(u)', [id]));
@@ -371,6 +383,158 @@ const FdoNotificationDaemon = new Lang.Class({
         return button;
     },
 
+    _notifyForSourceWhenReady: function(source, ndata) {
+        // Take our place in the queue right away, so that notifications
+        // without an image can't overtake this one while it loads
+        let pending = this._queueNotifyForSource(source, ndata);
+        if (!ndata.imageData)
+            return;
+
+        let imageData = ndata.imageData;
+        ndata.imageData = null;
+        pending.loading = ndata;
+
+        let size = MessageTray.Notification.prototype.IMAGE_SIZE;
+
+        let cache = St.TextureCache.get_default();
+        cache.load_image_data_async(imageData, size,
+                                    Lang.bind(this, function(cache, result) {
+            try {
+                ndata.image = cache.load_image_data_finish(result);
+            } catch(e) {
+                logError(e, 'Failed to load notification image data');
+            }
+
+            // An update may have taken over the queue entry meanwhile
+            if (pending.loading != ndata)
+                return;
+
+            pending.loading = null;
+            this._schedulePendingFlush();
+        }));
+    },
+
+    _schedulePendingFlush: function() {
+        if (this._pendingNotificationsId == 0)
+            this._pendingNotificationsId = Mainloop.idle_add(Lang.bind(this, this._flushPendingNotifications));
+    },
+
+    _queueNotifyForSource: function(source, ndata) {
+        // An update of a notification that hasn't been built yet
+        // simply takes its place
+        let entry = this._pendingNotifications.get(ndata.id);
+        if (entry) {
+            if (entry.source != source) {
+                this._removePendingForSource(entry);
+                entry.source = source;
+                this._addPendingForSource(entry);
+            }
+            entry.ndata = ndata;
+            entry.loading = null;
+            Main.messageTray.notificationCoalesced();
+            this._schedulePendingFlush();
+            return entry;
+        }
+
+        entry = { source: source, ndata: ndata, loading: null };
+        this._pendingNotifications.set(ndata.id, entry);
+        this._addPendingForSource(entry);
+
+        let pendingForSource = this._pendingBySource.get(source);
+        if (pendingForSource.size > MAX_PENDING_NOTIFICATIONS) {
+            // Maps keep their insertion order, so this is the oldest
+            for (let oldest of pendingForSource.values()) {
+                this._expirePendingNotification(oldest);
+                break;
+            }
+        }
+
+        this._schedulePendingFlush();
+        return entry;
+    },
+
+    _addPendingForSource: function(entry) {
+        let pendingForSource = this._pendingBySource.get(entry.source);
+        if (!pendingForSource) {
+            pendingForSource = new Map();
+            this._pendingBySource.set(entry.source, pendingForSource);
+        }
+        pendingForSource.set(entry.ndata.id, entry);
+    },
+
+    _removePendingForSource: function(entry) {
+        let pendingForSource = this._pendingBySource.get(entry.source);
+        pendingForSource.delete(entry.ndata.id);
+        if (pendingForSource.size == 0)
+            this._pendingBySource.delete(entry.source);
+    },
+
+    _removePending: function(entry) {
+        this._pendingNotifications.delete(entry.ndata.id);
+        this._removePendingForSource(entry);
+        entry.loading = null;
+    },
+
+    _expirePendingNotification: function(pending) {
+        this._removePending(pending);
+
+        let ndata = pending.ndata;
+        if (this._notifications[ndata.id] != ndata)
+            return;
+
+        if (ndata.notification) {
+            // The destroy handler lets the app know
+            ndata.notification.destroy(MessageTray.NotificationDestroyedReason.EXPIRED);
+        } else {
+            delete this._notifications[ndata.id];
+            this._emitNotificationClosed(ndata.id, NotificationClosedReason.EXPIRED);
+        }
+
+        Main.messageTray.notificationDropped();
+    },
+
+    _flushPendingNotifications: function() {
+        // Notifications go out in the order they came in, so stop at
+        // the first one whose image is still loading; it reschedules
+        // the flush once it's done
+        let batch = [];
+        for (let entry of this._pendingNotifications.values()) {
+            if (batch.length == MAX_NOTIFICATIONS_PER_BATCH || entry.loading)
+                break;
+            batch.push(entry);
+        }
+
+        for (let i = 0; i < batch.length; i++) {
+            let source = batch[i].source;
+            let ndata = batch[i].ndata;
+
+            this._removePending(batch[i]);
+
+            // The app may have closed or replaced the notification meanwhile
+            if (this._notifications[ndata.id] != ndata)
+                continue;
+
+            // The source may have gone away while the notification was
+            // queued; the app still has to hear that it was closed
+            if (source.isDestroyed) {
+                delete this._notifications[ndata.id];
+                this._emitNotificationClosed(ndata.id, NotificationClosedReason.UNDEFINED);
+                continue;
+            }
+
+            this._notifyForSource(source, ndata);
+        }
+
+        for (let entry of this._pendingNotifications.values()) {
+            if (!entry.loading)
+                return true;
+            break;
+        }
+
+        this._pendingNotificationsId = 0;
+        return false;
+    },
+
     _notifyForSource: function(source, ndata) {
         let [id, icon, summary, body, actions, hints, notification] =
             [ndata.id, ndata.icon, ndata.summary, ndata.body,
@@ -402,7 +566,7 @@ const FdoNotificationDaemon = new Lang.Class({
         notification.isMusic = (ndata.hints['category'] == 'x-gnome.music');
 
         let gicon = this._iconForNotificationData(icon, hints);
-        let gimage = this._imageForNotificationData(hints);
+        let gimage = this._imageForNotificationData(ndata);
 
         let image = null;
 
@@ -478,11 +642,21 @@ const FdoNotificationDaemon = new Lang.Class({
 
     CloseNotification: function(id) {
         let ndata = this._notifications[id];
-        if (ndata) {
-            if (ndata.notification)
-                ndata.notification.destroy(MessageTray.NotificationDestroyedReason.SOURCE_CLOSED);
-            delete this._notifications[id];
+        if (!ndata)
+            return;
+
+        let pending = this._pendingNotifications.get(id);
+        if (pending)
+            this._removePending(pending);
+
+        if (ndata.notification) {
+            // The destroy handler lets the app know
+            ndata.notification.destroy(MessageTray.NotificationDestroyedReason.SOURCE_CLOSED);
+        } else {
+            // It was never built, so nobody else will
+            this._emitNotificationClosed(id, NotificationClosedReason.APP_CLOSED);
         }
+        delete this._notifications[id];
     },
 
     GetCapabilities: function() {
@@ -562,6 +736,7 @@ const FdoNotificationDaemonSource = new Lang.Class({
         this.parent(title);
 
         this.initialTitle = title;
+        this.isDestroyed = false;
 
         if (this.app)
             this.title = this.app.get_name();
@@ -699,6 +874,7 @@ const FdoNotificationDaemonSource = new Lang.Class({
             this._nameWatcherId = 0;
         }
 
+        this.isDestroyed = true;
         this.parent();
     },
 
@@ -65,6 +65,14 @@ var SearchProviderProxyInfo = Gio.DBusInterfaceInfo.new_for_xml(SearchProviderIf
 var SearchProvider2ProxyInfo = Gio.DBusInterfaceInfo.new_for_xml(SearchProvider2Iface);
 
 function loadRemoteSearchProviders(callback) {
+    // Providers of apps on the desktop are sorted first
+    if (!IconGridLayout.layout.loaded) {
+        IconGridLayout.layout.whenLoaded(function() {
+            loadRemoteSearchProviders(callback);
+        });
+        return;
+    }
+
     let objectPaths = {};
     let loadedProviders = [];
 
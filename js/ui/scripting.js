@@ -79,6 +79,11 @@ const PerfHelperIface = '<node> \
 </method> \
 <method name="WaitWindows" /> \
 <method name="DestroyWindows" /> \
+<method name="CreateDesktopFiles"> \
+    <arg type="i" direction="in" /> \
+    <arg type="as" direction="out" /> \
+</method> \
+<method name="DestroyDesktopFiles" /> \
 </interface> \
 </node>';
 
@@ -166,6 +171,98 @@ function destroyTestWindows() {
     };
 }
 
+/**
+ * createTestDesktopFiles:
+ * @count: number of .desktop files to create
+ *
+ * Creates @count application .desktop files using gnome-shell-perf-helper
+ * in a data directory that the shell was started with, and pauses until
+ * the app system has loaded all of them.
+ */
+function createTestDesktopFiles(count) {
+    let cb;
+    let perfHelper = _getPerfHelper();
+    let appSystem = Shell.AppSystem.get_default();
+    let desktopIds = null;
+    let installedChangedId = 0;
+
+    function checkInstalled() {
+        if (desktopIds == null)
+            return;
+
+        let missing = desktopIds.some(function(id) {
+            return appSystem.lookup_app(id) == null;
+        });
+        if (missing)
+            return;
+
+        appSystem.disconnect(installedChangedId);
+        desktopIds = null;
+        if (cb)
+            cb();
+    }
+
+    // Connect before the files are written, so that we can't miss the
+    // app system picking them up
+    installedChangedId = appSystem.connect('installed-changed', checkInstalled);
+
+    perfHelper.CreateDesktopFilesRemote(count,
+                                        function(result, excp) {
+                                            if (excp) {
+                                                log("Failed to create test .desktop files: " + excp);
+                                                desktopIds = [];
+                                            } else {
+                                                [desktopIds] = result;
+                                            }
+                                            checkInstalled();
+                                        });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+/**
+ * destroyTestDesktopFiles:
+ *
+ * Removes all .desktop files previously created with
+ * createTestDesktopFiles().
+ */
+function destroyTestDesktopFiles() {
+    let cb;
+    let perfHelper = _getPerfHelper();
+
+    perfHelper.DestroyDesktopFilesRemote(function(result, excp) {
+                                             if (cb)
+                                                 cb();
+                                         });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+/**
+ * percentile:
+ * @values: array of numbers
+ * @p: the percentile to compute, between 0 and 100
+ *
+ * Convenience function for computing metrics from a series of
+ * samples, using linear interpolation between the closest ranks.
+ * Returns 0 for an empty series.
+ */
+function percentile(values, p) {
+    if (values.length == 0)
+        return 0;
+
+    let sorted = values.slice().sort(function(a, b) { return a - b; });
+    let rank = (p / 100) * (sorted.length - 1);
+    let lower = Math.floor(rank);
+    let upper = Math.ceil(rank);
+
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
 /**
  * defineScriptEvent
  * @name: The event will be called script.<name>
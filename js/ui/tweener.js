@@ -24,11 +24,67 @@ const Tweener = imports.tweener.tweener;
 // calls any of these is almost certainly wrong anyway, because they
 // affect the entire application.)
 
+// Tweens of a Clutter.Actor that only animate the properties below,
+// with one of the standard transitions and no per-frame callbacks,
+// are run as implicit Clutter transitions instead, so that the values
+// are computed natively rather than from JavaScript on every frame.
+const NATIVE_PROPERTIES = {
+    opacity: true,
+    x: true,
+    y: true,
+    width: true,
+    height: true,
+    scale_x: true,
+    scale_y: true,
+    translation_x: true,
+    translation_y: true,
+    translation_z: true,
+    rotation_angle_x: true,
+    rotation_angle_y: true,
+    rotation_angle_z: true
+};
+
+// Tweening parameters that the native path knows how to honor; any
+// other parameter (onUpdate, rounded, transitionParams, ...) makes the
+// tween run in JavaScript
+const NATIVE_PARAMETERS = {
+    time: true,
+    delay: true,
+    transition: true,
+    onStart: true,
+    onStartScope: true,
+    onStartParams: true,
+    onComplete: true,
+    onCompleteScope: true,
+    onCompleteParams: true
+};
+
+// The default transition of imports.tweener.tweener
+const DEFAULT_TRANSITION = 'easeOutExpo';
+
+let _jsTweens = 0;
+let _nativeTweens = 0;
+
 // Called from Main.start
 function init() {
     Tweener.setFrameTicker(new ClutterFrameTicker());
+
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_statistic('tweener.jsTweens',
+                             "Number of tweens computed in JavaScript since the statistics were last collected", 'i');
+    perfLog.define_statistic('tweener.nativeTweens',
+                             "Number of tweens run as Clutter transitions since the statistics were last collected", 'i');
+    perfLog.add_statistics_callback(_updateStatistics);
 }
 
+function _updateStatistics(perfLog) {
+    perfLog.update_statistic_i('tweener.jsTweens', _jsTweens);
+    perfLog.update_statistic_i('tweener.nativeTweens', _nativeTweens);
+
+    // Each collection reports only what happened since the last one
+    _jsTweens = 0;
+    _nativeTweens = 0;
+}
 
 function addCaller(target, tweeningParameters) {
     _wrapTweening(target, tweeningParameters);
@@ -37,7 +93,249 @@ function addCaller(target, tweeningParameters) {
 
 function addTween(target, tweeningParameters) {
     _wrapTweening(target, tweeningParameters);
+
+    if (_addNativeTween(target, tweeningParameters)) {
+        _nativeTweens++;
+        return;
+    }
+
+    // Whatever this tween animates, it replaces a native tween of
+    // the same properties, as it would replace a JavaScript one
+    _removeNativeTweens(target, _getTweenedProperties(tweeningParameters));
     Tweener.addTween(target, tweeningParameters);
+    _jsTweens++;
+}
+
+function _getTweenedProperties(params) {
+    let properties = [];
+    for (let name in params) {
+        if (!(name in NATIVE_PARAMETERS))
+            properties.push(name);
+    }
+    return properties;
+}
+
+function _getAnimationMode(transition) {
+    if (transition === undefined)
+        transition = DEFAULT_TRANSITION;
+
+    if (typeof(transition) != 'string')
+        return null;
+
+    if (transition == 'linear' || transition == 'easeNone')
+        return Clutter.AnimationMode.LINEAR;
+
+    let match = transition.match(/^ease(InOut|In|Out)(Quad|Cubic|Quart|Quint|Sine|Expo|Circ|Elastic|Back|Bounce)$/);
+    if (!match)
+        return null;
+
+    let direction = { In: 'IN', Out: 'OUT', InOut: 'IN_OUT' }[match[1]];
+    return Clutter.AnimationMode['EASE_' + direction + '_' + match[2].toUpperCase()];
+}
+
+function _getDuration(seconds) {
+    return Math.round((seconds || 0) * 1000 * St.get_slow_down_factor());
+}
+
+function _canTweenNatively(target, params) {
+    if (!(target instanceof Clutter.Actor))
+        return false;
+
+    // Clutter sets the properties of an unmapped actor right away,
+    // without a transition
+    if (!target.mapped)
+        return false;
+
+    // A transition with no duration would set the values right away,
+    // ignoring the delay
+    if (_getDuration(params.time) <= 0)
+        return false;
+
+    if (_getAnimationMode(params.transition) == null)
+        return false;
+
+    for (let name in params) {
+        if (name in NATIVE_PARAMETERS)
+            continue;
+        if (!(name in NATIVE_PROPERTIES) || typeof(params[name]) != 'number')
+            return false;
+    }
+
+    return true;
+}
+
+function _addNativeTween(target, params) {
+    if (!_canTweenNatively(target, params))
+        return false;
+
+    let properties = _getTweenedProperties(params);
+    if (properties.length == 0)
+        return false;
+
+    // Like Tweener, a new tween overwrites any other tween of the same
+    // properties; Clutter would otherwise retarget an existing
+    // transition of a property rather than create a new one
+    Tweener.removeTweens.apply(null, [target].concat(properties));
+    _removeNativeTweens(target, properties);
+    for (let i = 0; i < properties.length; i++)
+        target.remove_transition(properties[i].replace(/_/g, '-'));
+
+    let initialValues = {};
+    for (let i = 0; i < properties.length; i++)
+        initialValues[properties[i]] = target[properties[i]];
+
+    target.save_easing_state();
+    target.set_easing_duration(_getDuration(params.time));
+    target.set_easing_delay(_getDuration(params.delay));
+    target.set_easing_mode(_getAnimationMode(params.transition));
+    for (let i = 0; i < properties.length; i++)
+        target[properties[i]] = params[properties[i]];
+    target.restore_easing_state();
+
+    // Clutter may still have skipped the transition of some property
+    // and set it right away; then undo the whole tween and let Tweener
+    // run it from the initial values
+    let complete = properties.every(function(property) {
+        return target.get_transition(property.replace(/_/g, '-')) != null;
+    });
+
+    if (!complete) {
+        target.save_easing_state();
+        target.set_easing_duration(0);
+        for (let i = 0; i < properties.length; i++) {
+            target.remove_transition(properties[i].replace(/_/g, '-'));
+            target[properties[i]] = initialValues[properties[i]];
+        }
+        target.restore_easing_state();
+        return false;
+    }
+
+    let tween = { params: params,
+                  transitions: {},
+                  remaining: 0,
+                  started: false };
+
+    for (let i = 0; i < properties.length; i++) {
+        let name = properties[i].replace(/_/g, '-');
+        let transition = target.get_transition(name);
+        let entry = { transition: transition };
+        entry.startedId = transition.connect('started', function() {
+            _nativeTweenStarted(target, tween);
+        });
+        entry.stoppedId = transition.connect('stopped', function(transition, isFinished) {
+            _nativeTransitionStopped(target, tween, name, isFinished);
+        });
+        tween.transitions[name] = entry;
+        tween.remaining++;
+    }
+
+    let state = _getTweenState(target);
+    if (!state.nativeTweens)
+        state.nativeTweens = [];
+    state.nativeTweens.push(tween);
+
+    // Like the frame ticker does while there are JavaScript tweens
+    global.begin_work();
+
+    return true;
+}
+
+function _callHandler(target, params, name) {
+    if (!params[name])
+        return;
+
+    let scope = params[name + 'Scope'] ? params[name + 'Scope'] : target;
+    params[name].apply(scope, params[name + 'Params'] || []);
+}
+
+function _nativeTweenStarted(target, tween) {
+    if (tween.started)
+        return;
+
+    tween.started = true;
+    _callHandler(target, tween.params, 'onStart');
+}
+
+function _releaseNativeTransition(tween, name) {
+    let entry = tween.transitions[name];
+
+    entry.transition.disconnect(entry.startedId);
+    entry.transition.disconnect(entry.stoppedId);
+    delete tween.transitions[name];
+    tween.remaining--;
+}
+
+function _forgetNativeTween(target, tween) {
+    let state = _getTweenState(target);
+    let index = state.nativeTweens ? state.nativeTweens.indexOf(tween) : -1;
+
+    if (index >= 0) {
+        state.nativeTweens.splice(index, 1);
+        global.end_work();
+    }
+}
+
+function _nativeTransitionStopped(target, tween, name, isFinished) {
+    _releaseNativeTransition(tween, name);
+    if (tween.remaining > 0)
+        return;
+
+    _forgetNativeTween(target, tween);
+
+    // The onComplete handler was wrapped by _wrapTweening(), so that it
+    // also cleans up the tween state
+    if (isFinished)
+        _callHandler(target, tween.params, 'onComplete');
+    else if (!isTweening(target))
+        _resetTweenState(target);
+}
+
+// Calls @func with each native tween of @target that animates one of
+// @properties (all of them, if @properties is empty) and the matching
+// transition names
+function _forEachNativeTween(target, properties, func) {
+    let state = target.__ShellTweenerState;
+    if (!state || !state.nativeTweens)
+        return;
+
+    let names = properties.map(function(property) {
+        return property.replace(/_/g, '-');
+    });
+
+    let tweens = state.nativeTweens.slice();
+    for (let i = 0; i < tweens.length; i++) {
+        let matched = [];
+        for (let name in tweens[i].transitions) {
+            if (names.length == 0 || names.indexOf(name) >= 0)
+                matched.push(name);
+        }
+
+        if (matched.length > 0)
+            func(tweens[i], matched);
+    }
+}
+
+function _removeNativeTweens(target, properties) {
+    let removed = false;
+
+    _forEachNativeTween(target, properties, function(tween, names) {
+        for (let i = 0; i < names.length; i++) {
+            _releaseNativeTransition(tween, names[i]);
+            target.remove_transition(names[i]);
+        }
+
+        if (tween.remaining == 0)
+            _forgetNativeTween(target, tween);
+
+        removed = true;
+    });
+
+    return removed;
+}
+
+function _getNativeTweenCount(target) {
+    let state = target.__ShellTweenerState;
+    return state && state.nativeTweens ? state.nativeTweens.length : 0;
 }
 
 function _wrapTweening(target, tweeningParameters) {
@@ -73,6 +371,8 @@ function _resetTweenState(target) {
     if (state) {
         if (state.destroyedId)
             state.actor.disconnect(state.destroyedId);
+        if (state.nativeTweens)
+            state.nativeTweens.forEach(function() { global.end_work(); });
     }
 
     target.__ShellTweenerState = {};
@@ -94,6 +394,8 @@ function _addHandler(target, params, name, handler) {
 }
 
 function _actorDestroyed(target) {
+    // Clutter drops the transitions of a destroyed actor, so the
+    // native tweens only need to be forgotten
     _resetTweenState(target);
     Tweener.removeTweens(target);
 }
@@ -104,31 +406,59 @@ function _tweenCompleted(target) {
 }
 
 function getTweenCount(scope) {
-    return Tweener.getTweenCount(scope);
+    return Tweener.getTweenCount(scope) + _getNativeTweenCount(scope);
 }
 
 // imports.tweener.tweener doesn't provide this method (which exists
 // in the ActionScript version) but it's easy to implement.
 function isTweening(scope) {
-    return Tweener.getTweenCount(scope) != 0;
+    return getTweenCount(scope) != 0;
 }
 
 function removeTweens(scope) {
-    if (Tweener.removeTweens.apply(null, arguments)) {
+    let properties = Array.prototype.slice.call(arguments, 1);
+    let removedNative = _removeNativeTweens(scope, properties);
+
+    if (Tweener.removeTweens.apply(null, arguments) || removedNative) {
         // If we just removed the last active tween, clean up
-        if (Tweener.getTweenCount(scope) == 0)
+        if (getTweenCount(scope) == 0)
             _tweenCompleted(scope);
         return true;
     } else
         return false;
 }
 
-function pauseTweens() {
-    return Tweener.pauseTweens.apply(null, arguments);
+function pauseTweens(scope) {
+    let properties = Array.prototype.slice.call(arguments, 1);
+    let paused = false;
+
+    _forEachNativeTween(scope, properties, function(tween, names) {
+        for (let i = 0; i < names.length; i++)
+            tween.transitions[names[i]].transition.pause();
+        paused = true;
+    });
+
+    return Tweener.pauseTweens.apply(null, arguments) || paused;
 }
 
-function resumeTweens() {
-    return Tweener.resumeTweens.apply(null, arguments);
+function resumeTweens(scope) {
+    let properties = Array.prototype.slice.call(arguments, 1);
+    let resumed = false;
+
+    _forEachNativeTween(scope, properties, function(tween, names) {
+        for (let i = 0; i < names.length; i++) {
+            let transition = tween.transitions[names[i]].transition;
+
+            // Starting the transition again would wait out its delay
+            // again, even though it was paused after the delay
+            if (tween.started)
+                transition.set_delay(0);
+            transition.start();
+        }
+        resumed = true;
+    });
+
+    return Tweener.resumeTweens.apply(null, arguments) || resumed;
 }
 
 
@@ -24,25 +24,11 @@ const WINDOW_DND_SIZE = 256;
 
 const SCROLL_SCALE_AMOUNT = 100 / 5;
 
-const WINDOW_CLONE_MAXIMUM_SCALE = 0.7;
-
 const LIGHTBOX_FADE_TIME = 0.1;
 const CLOSE_BUTTON_FADE_TIME = 0.1;
 
 const DRAGGING_WINDOW_OPACITY = 100;
 
-// When calculating a layout, we calculate the scale of windows and the percent
-// of the available area the new layout uses. If the values for the new layout,
-// when weighted with the values as below, are worse than the previous layout's,
-// we stop looking for a new layout and use the previous layout.
-// Otherwise, we keep looking for a new layout.
-const LAYOUT_SCALE_WEIGHT = 1;
-const LAYOUT_SPACE_WEIGHT = 0.1;
-
-function _interpolate(start, end, step) {
-    return start + (end - start) * step;
-}
-
 const WindowClone = new Lang.Class({
     Name: 'WindowClone',
 
@@ -53,9 +39,9 @@ const WindowClone = new Lang.Class({
         this._workspace = workspace;
 
         let [borderX, borderY] = this._getInvisibleBorderPadding();
-        this._windowClone = new Clutter.Clone({ source: realWindow.get_texture(),
-                                                x: -borderX,
-                                                y: -borderY });
+        this._windowClone = new Shell.WindowThumbnail({ source: realWindow.get_texture(),
+                                                        x: -borderX,
+                                                        y: -borderY });
         // We expect this.actor to be used for all interaction rather than
         // this._windowClone; as the former is reactive and the latter
         // is not, this just works for most cases. However, for DND all
@@ -583,311 +569,6 @@ const WindowPositionFlags = {
     ANIMATE: 1 << 1
 };
 
-// Window Thumbnail Layout Algorithm
-// =================================
-//
-// General overview
-// ----------------
-//
-// The window thumbnail layout algorithm calculates some optimal layout
-// by computing layouts with some number of rows, calculating how good
-// each layout is, and stopping iterating when it finds one that is worse
-// than the previous layout. A layout consists of which windows are in
-// which rows, row sizes and other general state tracking that would make
-// calculating window positions from this information fairly easy.
-//
-// We don't compute some global order of windows right now for optimal
-// travel when animating into the overview; windows are assumed to be
-// in some stable order.
-//
-// After a layout is computed that's considered the best layout, we
-// compute the layout scale to fit it in the area, and then compute
-// slots (sizes and positions) for each thumbnail.
-//
-// Layout generation
-// -----------------
-//
-// Layout generation is naive and simple: we simply add windows to a row
-// until we've added too many windows to a row, and then make a new row,
-// until we have our required N rows. The potential issue with this strategy
-// is that we may have too many windows at the bottom in some pathological
-// cases, which tends to make the thumbnails have the shape of a pile of
-// sand with a peak, with one window at the top.
-//
-// Scaling factors
-// ---------------
-//
-// Thumbnail position is mostly straightforward -- the main issue is
-// computing an optimal scale for each window that fits the constraints,
-// and doesn't make the thumbnail too small to see. There are two factors
-// involved in thumbnail scale to make sure that these two goals are met:
-// the window scale (calculated by _computeWindowScale) and the layout
-// scale (calculated by computeSizeAndScale).
-//
-// The calculation logic becomes slightly more complicated because row
-// and column spacing are not scaled, they're constant, so we can't
-// simply generate a bunch of window positions and then scale it. In
-// practice, it's not too bad -- we can simply try to fit the layout
-// in the input area minus whatever spacing we have, and then add
-// it back afterwards.
-//
-// The window scale is constant for the window's size regardless of the
-// input area or the layout scale or rows or anything else, and right
-// now just enlarges the window if it's too small. The fact that this
-// factor is stable makes it easy to calculate, so there's no sense
-// in not applying it in most calculations.
-//
-// The layout scale depends on the input area, the rows, etc, but is the
-// same for the entire layout, rather than being per-window. After
-// generating the rows of windows, we basically do some basic math to
-// fit the full, unscaled layout to the input area, as described above.
-//
-// With these two factors combined, the final scale of each thumbnail is
-// simply windowScale * layoutScale... almost.
-//
-// There's one additional constraint: the thumbnail scale must never be
-// larger than WINDOW_CLONE_MAXIMUM_SCALE, which means that the inequality:
-//
-//   windowScale * layoutScale <= WINDOW_CLONE_MAXIMUM_SCALE
-//
-// must always be true. This is for each individual window -- while we
-// could adjust layoutScale to make the largest thumbnail smaller than
-// WINDOW_CLONE_MAXIMUM_SCALE, it would shrink windows which are already
-// under the inequality. To solve this, we simply cheat: we simply keep
-// each window's "cell" area to be the same, but we shrink the thumbnail
-// and center it horizontally, and align it to the bottom vertically.
-
-const LayoutStrategy = new Lang.Class({
-    Name: 'LayoutStrategy',
-    Abstract: true,
-
-    _init: function(monitor, rowSpacing, columnSpacing) {
-        this._monitor = monitor;
-        this._rowSpacing = rowSpacing;
-        this._columnSpacing = columnSpacing;
-    },
-
-    _newRow: function() {
-        // Row properties:
-        //
-        // * x, y are the position of row, relative to area
-        //
-        // * width, height are the scaled versions of fullWidth, fullHeight
-        //
-        // * width also has the spacing in between windows. It's not in
-        //   fullWidth, as the spacing is constant, whereas fullWidth is
-        //   meant to be scaled
-        //
-        // * neither height/fullHeight have any sort of spacing or padding
-        return { x: 0, y: 0,
-                 width: 0, height: 0,
-                 fullWidth: 0, fullHeight: 0,
-                 windows: [] };
-    },
-
-    // Computes and returns an individual scaling factor for @window,
-    // to be applied in addition to the overal layout scale.
-    _computeWindowScale: function(window) {
-        // Since we align windows next to each other, the height of the
-        // thumbnails is much more important to preserve than the width of
-        // them, so two windows with equal height, but maybe differering
-        // widths line up.
-        let ratio = window.actor.height / this._monitor.height;
-
-        // The purpose of this manipulation here is to prevent windows
-        // from getting too small. For something like a calculator window,
-        // we need to bump up the size just a bit to make sure it looks
-        // good. We'll use a multiplier of 1.5 for this.
-
-        // Map from [0, 1] to [1.5, 1]
-        return _interpolate(1.5, 1, ratio);
-    },
-
-    // Compute the size of each row, by assigning to the properties
-    // row.width, row.height, row.fullWidth, row.fullHeight, and
-    // (optionally) for each row in @layout.rows. This method is
-    // intended to be called by subclasses.
-    _computeRowSizes: function(layout) {
-        throw new Error('_computeRowSizes not implemented');
-    },
-
-    // Compute strategy-specific window slots for each window in
-    // @windows, given the @layout. The strategy may also use @layout
-    // as strategy-specific storage.
-    //
-    // This must calculate:
-    //  * maxColumns - The maximum number of columns used by the layout.
-    //  * gridWidth - The total width used by the grid, unscaled, unspaced.
-    //  * gridHeight - The totial height used by the grid, unscaled, unspaced.
-    //  * rows - A list of rows, which should be instantiated by _newRow.
-    computeLayout: function(windows, layout) {
-        throw new Error('computeLayout not implemented');
-    },
-
-    // Given @layout, compute the overall scale and space of the layout.
-    // The scale is the individual, non-fancy scale of each window, and
-    // the space is the percentage of the available area eventually
-    // used by the layout.
-
-    // This method does not return anything, but instead installs
-    // the properties "scale" and "space" on @layout directly.
-    //
-    // Make sure to call this methods before calling computeWindowSlots(),
-    // as it depends on the scale property installed in @layout here.
-    computeScaleAndSpace: function(layout) {
-        let area = layout.area;
-
-        let hspacing = (layout.maxColumns - 1) * this._columnSpacing;
-        let vspacing = (layout.numRows - 1) * this._rowSpacing;
-
-        let spacedWidth = area.width - hspacing;
-        let spacedHeight = area.height - vspacing;
-
-        let horizontalScale = spacedWidth / layout.gridWidth;
-        let verticalScale = spacedHeight / layout.gridHeight;
-
-        // Thumbnails should be less than 70% of the original size
-        let scale = Math.min(horizontalScale, verticalScale, WINDOW_CLONE_MAXIMUM_SCALE);
-
-        let scaledLayoutWidth = layout.gridWidth * scale + hspacing;
-        let scaledLayoutHeight = layout.gridHeight * scale + vspacing;
-        let space = (scaledLayoutWidth * scaledLayoutHeight) / (area.width * area.height);
-
-        layout.scale = scale;
-        layout.space = space;
-    },
-
-    _getDistance: function (row, actor) {
-        let dist_x = actor.x - row.x;
-        let dist_y = actor.y - row.y;
-
-        return Math.sqrt(Math.pow(dist_x, 2) + Math.pow(dist_y, 2));
-    },
-
-    computeWindowSlots: function(layout, area) {
-        this._computeRowSizes(layout);
-
-        let { rows: rows, scale: scale } = layout;
-
-        let slots = [];
-
-        let y = 0;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.x = area.x + (area.width - row.width) / 2;
-            row.y = area.y + y;
-            y += row.height + this._rowSpacing;
-            row.windows.sort(Lang.bind(this, function(a, b) {
-                return this._getDistance(row, a.realWindow) - this._getDistance(row, b.realWindow);
-            }));
-        }
-
-        let height = y - this._rowSpacing;
-        let baseY = (area.height - height) / 2;
-
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.y += baseY;
-            let x = row.x;
-            for (let j = 0; j < row.windows.length; j++) {
-                let window = row.windows[j];
-
-                let s = scale * this._computeWindowScale(window);
-                let cellWidth = window.actor.width * s;
-                let cellHeight = window.actor.height * s;
-
-                s = Math.min(s, WINDOW_CLONE_MAXIMUM_SCALE);
-                let cloneWidth = window.actor.width * s;
-
-                let cloneX = x + (cellWidth - cloneWidth) / 2;
-                let cloneY = row.y + row.height - cellHeight;
-
-                slots.push([cloneX, cloneY, s, window]);
-                x += cellWidth + this._columnSpacing;
-            }
-        }
-        return slots;
-    }
-});
-
-const UnalignedLayoutStrategy = new Lang.Class({
-    Name: 'UnalignedLayoutStrategy',
-    Extends: LayoutStrategy,
-
-    _computeRowSizes: function(layout) {
-        let { rows: rows, scale: scale } = layout;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.width = row.fullWidth * scale + (row.windows.length - 1) * this._columnSpacing;
-            row.height = row.fullHeight * scale;
-        }
-    },
-
-    _keepSameRow: function(row, window, width, idealRowWidth) {
-        if (row.fullWidth + width <= idealRowWidth)
-            return true;
-
-        let oldRatio = row.fullWidth / idealRowWidth;
-        let newRatio = (row.fullWidth + width) / idealRowWidth;
-
-        if (Math.abs(1 - newRatio) < Math.abs(1 - oldRatio))
-            return true;
-
-        return false;
-    },
-
-    computeLayout: function(windows, layout) {
-        let numRows = layout.numRows;
-
-        let rows = [];
-        let totalWidth = 0;
-        for (let i = 0; i < windows.length; i++) {
-            let window = windows[i];
-            let s = this._computeWindowScale(window);
-            totalWidth += window.actor.width * s;
-        }
-
-        let idealRowWidth = totalWidth / numRows;
-        let windowIdx = 0;
-        for (let i = 0; i < numRows; i++) {
-            let col = 0;
-            let row = this._newRow();
-            rows.push(row);
-
-            for (; windowIdx < windows.length; windowIdx++) {
-                let window = windows[windowIdx];
-                let s = this._computeWindowScale(window);
-                let width = window.actor.width * s;
-                let height = window.actor.height * s;
-                row.fullHeight = Math.max(row.fullHeight, height);
-
-                // either new width is < idealWidth or new width is nearer from idealWidth then oldWidth
-                if (this._keepSameRow(row, window, width, idealRowWidth) || (i == numRows - 1)) {
-                    row.windows.push(window);
-                    row.fullWidth += width;
-                } else {
-                    break;
-                }
-            }
-        }
-
-        let gridHeight = 0;
-        let maxRow;
-        for (let i = 0; i < numRows; i++) {
-            let row = rows[i];
-            if (!maxRow || row.fullWidth > maxRow.fullWidth)
-                maxRow = row;
-            gridHeight += row.fullHeight;
-        }
-
-        layout.rows = rows;
-        layout.maxColumns = maxRow.windows.length;
-        layout.gridWidth = maxRow.fullWidth;
-        layout.gridHeight = gridHeight;
-    }
-});
-
-
 /**
  * @metaWorkspace: a #Meta.Workspace, or null
  */
@@ -956,7 +637,7 @@ const Workspace = new Lang.Class({
         this._positionWindowsFlags = 0;
         this._positionWindowsId = 0;
 
-        this._currentLayout = null;
+        this._layout = new Shell.WindowLayout();
     },
 
     setGeometry: function(x, y, width, height) {
@@ -1009,7 +690,7 @@ const Workspace = new Lang.Class({
             clone = null;
 
         this._reservedSlot = clone;
-        this._currentLayout = null;
+        this._layout.invalidate();
         this.positionWindows(WindowPositionFlags.ANIMATE);
     },
 
@@ -1293,7 +974,7 @@ const Workspace = new Lang.Class({
         this._cursorX = x;
         this._cursorY = y;
 
-        this._currentLayout = null;
+        this._layout.invalidate();
         this._repositionWindowsId = Mainloop.timeout_add(750,
             Lang.bind(this, this._delayedWindowRepositioning));
     },
@@ -1351,7 +1032,7 @@ const Workspace = new Lang.Class({
             clone.overlay.relayout(false);
         }
 
-        this._currentLayout = null;
+        this._layout.invalidate();
         this.positionWindows(WindowPositionFlags.ANIMATE);
     },
 
@@ -1389,7 +1070,7 @@ const Workspace = new Lang.Class({
 
     // Animate the full-screen to Overview transition.
     zoomToOverview : function() {
-        this._currentLayout = null;
+        this._layout.invalidate();
 
         // Position and scale the windows.
         if (Main.overview.animationInProgress)
@@ -1579,68 +1260,6 @@ const Workspace = new Lang.Class({
         }
     },
 
-    _isBetterLayout: function(oldLayout, newLayout) {
-        if (oldLayout.scale === undefined)
-            return true;
-
-        let spacePower = (newLayout.space - oldLayout.space) * LAYOUT_SPACE_WEIGHT;
-        let scalePower = (newLayout.scale - oldLayout.scale) * LAYOUT_SCALE_WEIGHT;
-
-        if (newLayout.scale > oldLayout.scale && newLayout.space > oldLayout.space) {
-            // Win win -- better scale and better space
-            return true;
-        } else if (newLayout.scale > oldLayout.scale && newLayout.space <= oldLayout.space) {
-            // Keep new layout only if scale gain outweights aspect space loss
-            return scalePower > spacePower;
-        } else if (newLayout.scale <= oldLayout.scale && newLayout.space > oldLayout.space) {
-            // Keep new layout only if aspect space gain outweights scale loss
-            return spacePower > scalePower;
-        } else {
-            // Lose -- worse scale and space
-            return false;
-        }
-    },
-
-    _computeLayout: function(windows, area, rowSpacing, columnSpacing) {
-        // We look for the largest scale that allows us to fit the
-        // largest row/tallest column on the workspace.
-
-        let lastLayout = {};
-
-        for (let numRows = 1; ; numRows++) {
-            let numColumns = Math.ceil(windows.length / numRows);
-
-            // If adding a new row does not change column count just stop
-            // (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
-            // 3 columns as well => just use 3 rows then)
-            if (numColumns == lastLayout.numColumns)
-                break;
-
-            let strategy = new UnalignedLayoutStrategy(this._monitor, rowSpacing, columnSpacing);
-
-            let layout = { area: area, strategy: strategy, numRows: numRows, numColumns: numColumns };
-            strategy.computeLayout(windows, layout);
-            strategy.computeScaleAndSpace(layout);
-
-            if (!this._isBetterLayout(lastLayout, layout))
-                break;
-
-            lastLayout = layout;
-        }
-
-        return lastLayout;
-    },
-
-    _rectEqual: function(one, two) {
-        if (one == two)
-            return true;
-
-        return (one.x == two.x &&
-                one.y == two.y &&
-                one.width == two.width &&
-                one.height == two.height);
-    },
-
     _computeAllWindowSlots: function(windows) {
         let totalWindows = windows.length;
         let node = this.actor.get_theme_node();
@@ -1655,8 +1274,10 @@ const Workspace = new Lang.Class({
             right: node.get_padding(St.Side.RIGHT),
         };
 
-        if (!totalWindows)
+        if (!totalWindows) {
+            this._layout.set_windows([]);
             return [];
+        }
 
         let closeButtonHeight, captionHeight;
         let leftBorder, rightBorder;
@@ -1685,18 +1306,29 @@ const Workspace = new Lang.Class({
             height: this._height - padding.top - padding.bottom,
         };
 
-        if (!this._currentLayout)
-            this._currentLayout = this._computeLayout(windows, area, rowSpacing, columnSpacing);
-
-        let layout = this._currentLayout;
-        let strategy = layout.strategy;
+        // The layout is cached on the C side, and only the parts
+        // affected by what changed since the last call are recomputed
+        this._layout.set_spacing(rowSpacing, columnSpacing);
+        this._layout.set_area(area.x, area.y, area.width, area.height);
+        this._layout.set_monitor_height(this._monitor.height);
+        this._layout.set_windows(windows.map(function(clone) {
+            return clone.actor;
+        }));
 
-        if (!this._rectEqual(area, layout.area)) {
-            layout.area = area;
-            strategy.computeScaleAndSpace(layout);
+        for (let i = 0; i < windows.length; i++) {
+            let clone = windows[i];
+            this._layout.update_window(clone.actor,
+                                       clone.realWindow.x, clone.realWindow.y,
+                                       clone.actor.width, clone.actor.height);
         }
 
-        return strategy.computeWindowSlots(layout, area);
+        let slots = [];
+        for (let i = 0; i < windows.length; i++) {
+            let clone = windows[i];
+            let [, x, y, scale] = this._layout.get_slot(clone.actor);
+            slots.push([x, y, scale, clone]);
+        }
+        return slots;
     },
 
     _onCloneSelected : function (clone, time) {
@@ -35,8 +35,8 @@ const WindowClone = new Lang.Class({
     Name: 'WindowClone',
 
     _init : function(realWindow) {
-        this.actor = new Clutter.Clone({ source: realWindow.get_texture(),
-                                         reactive: true });
+        this.actor = new Shell.WindowThumbnail({ source: realWindow.get_texture(),
+                                                 reactive: true });
         this.actor._delegate = this;
         this.realWindow = realWindow;
         this.metaWindow = realWindow.meta_window;
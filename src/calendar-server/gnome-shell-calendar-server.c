@@ -74,13 +74,20 @@ static App *_global_app = NULL;
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+typedef struct _CalendarAppointment CalendarAppointment;
+
 typedef struct
 {
   time_t start_time;
   time_t end_time;
+
+  CalendarAppointment *appointment;
+
+  /* Position in the App's occurrence index, or NULL */
+  GSequenceIter *iter;
 } CalendarOccurrence;
 
-typedef struct
+struct _CalendarAppointment
 {
   char   *uid;
   char   *rid;
@@ -93,8 +100,20 @@ typedef struct
   guint   is_all_day : 1;
 
   /* Only used internally */
+  ECalComponent *component;
+  ECalClient    *client;
+  guint          is_recurring : 1;
+  guint          is_expanded : 1;
+
+  /* Occurrences are generated lazily; for recurring appointments this
+   * is the (contiguous) range they have been generated for so far
+   */
+  time_t  expanded_since;
+  time_t  expanded_until;
+
+  /* Sorted by start time */
   GSList *occurrences;
-} CalendarAppointment;
+};
 
 static time_t
 get_time_from_property (icalcomponent         *ical,
@@ -311,23 +330,99 @@ null_safe_strcmp (const char *a,
 }
 
 static inline gboolean
-calendar_appointment_equal (CalendarAppointment *a,
-                            CalendarAppointment *b)
+calendar_occurrence_in_window (CalendarOccurrence *occurrence,
+                               time_t              since,
+                               time_t              until)
+{
+  return (occurrence->start_time >= since &&
+          occurrence->start_time < until) ||
+         (occurrence->start_time <= since &&
+          (occurrence->end_time - 1) > since);
+}
+
+static gint
+calendar_occurrence_compare (gconstpointer a,
+                             gconstpointer b,
+                             gpointer      user_data)
+{
+  const CalendarOccurrence *oa = a;
+  const CalendarOccurrence *ob = b;
+
+  if (oa->start_time != ob->start_time)
+    return oa->start_time < ob->start_time ? -1 : 1;
+  if (oa->end_time != ob->end_time)
+    return oa->end_time < ob->end_time ? -1 : 1;
+  return 0;
+}
+
+static gint
+calendar_occurrence_compare_start (gconstpointer a,
+                                   gconstpointer b,
+                                   gpointer      user_data)
+{
+  const CalendarOccurrence *oa = a;
+  const CalendarOccurrence *ob = b;
+
+  if (oa->start_time != ob->start_time)
+    return oa->start_time < ob->start_time ? -1 : 1;
+  return 0;
+}
+
+static gboolean
+calendar_appointment_occurrences_equal (CalendarAppointment *a,
+                                        CalendarAppointment *b)
 {
   GSList *la, *lb;
+  time_t since = 0;
+  time_t until = 0;
 
-  if (g_slist_length (a->occurrences) != g_slist_length (b->occurrences))
-      return FALSE;
+  if (a->is_recurring != b->is_recurring)
+    return FALSE;
 
-  for (la = a->occurrences, lb = b->occurrences; la && lb; la = la->next, lb = lb->next)
+  /* Recurring appointments can only be compared over the range
+   * both have been expanded for
+   */
+  if (a->is_recurring)
     {
-      CalendarOccurrence *oa = la->data;
-      CalendarOccurrence *ob = lb->data;
+      since = MAX (a->expanded_since, b->expanded_since);
+      until = MIN (a->expanded_until, b->expanded_until);
+    }
 
+  la = a->occurrences;
+  lb = b->occurrences;
+  while (TRUE)
+    {
+      CalendarOccurrence *oa;
+      CalendarOccurrence *ob;
+
+      if (a->is_recurring)
+        {
+          while (la != NULL && !calendar_occurrence_in_window (la->data, since, until))
+            la = la->next;
+          while (lb != NULL && !calendar_occurrence_in_window (lb->data, since, until))
+            lb = lb->next;
+        }
+
+      if (la == NULL || lb == NULL)
+        return la == lb;
+
+      oa = la->data;
+      ob = lb->data;
       if (oa->start_time != ob->start_time ||
           oa->end_time   != ob->end_time)
         return FALSE;
+
+      la = la->next;
+      lb = lb->next;
     }
+}
+
+static inline gboolean
+calendar_appointment_equal (CalendarAppointment *a,
+                            CalendarAppointment *b)
+{
+  if (!calendar_appointment_occurrences_equal (a, b))
+    return FALSE;
 
   return
     null_safe_strcmp (a->uid,          b->uid)          == 0 &&
@@ -346,10 +441,19 @@ calendar_appointment_free (CalendarAppointment *appointment)
   GSList *l;
 
   for (l = appointment->occurrences; l; l = l->next)
-    g_free (l->data);
+    {
+      CalendarOccurrence *occurrence = l->data;
+
+      if (occurrence->iter != NULL)
+        g_sequence_remove (occurrence->iter);
+      g_free (occurrence);
+    }
   g_slist_free (appointment->occurrences);
   appointment->occurrences = NULL;
 
+  g_clear_object (&appointment->component);
+  g_clear_object (&appointment->client);
+
   g_free (appointment->uid);
   appointment->uid = NULL;
 
@@ -368,8 +472,7 @@ calendar_appointment_free (CalendarAppointment *appointment)
   g_free (appointment->color_string);
   appointment->color_string = NULL;
 
-  appointment->start_time = 0;
-  appointment->is_all_day = FALSE;
+  g_free (appointment);
 }
 
 static void
@@ -425,33 +528,132 @@ calendar_appointment_collect_occurrence (ECalComponent  *component,
 }
 
 static void
-calendar_appointment_generate_occurrences (CalendarAppointment *appointment,
-                                           icalcomponent       *ical,
-                                           ECalClient          *cal,
-                                           time_t               start,
-                                           time_t               end,
-                                           icaltimezone        *default_zone)
+calendar_appointment_generate_occurrences (CalendarAppointment  *appointment,
+                                           time_t                start,
+                                           time_t                end,
+                                           icaltimezone         *default_zone,
+                                           GSList              **occurrences)
 {
-  ECalComponent *ecal;
-
-  g_assert (appointment->occurrences == NULL);
-
-  ecal = e_cal_component_new ();
-  e_cal_component_set_icalcomponent (ecal,
-                                     icalcomponent_new_clone (ical));
-
-  e_cal_recur_generate_instances (ecal,
+  e_cal_recur_generate_instances (appointment->component,
                                   start,
                                   end,
                                   calendar_appointment_collect_occurrence,
-                                  &appointment->occurrences,
+                                  occurrences,
                                   (ECalRecurResolveTimezoneFn) resolve_timezone_id,
-                                  cal,
+                                  appointment->client,
                                   default_zone);
+}
+
+/* Makes sure all occurrences of @appointment between @since and @until
+ * have been generated, only expanding its recurrences over the part of
+ * the range that hasn't been expanded yet. Returns the occurrences that
+ * were added; the list should be freed, its contents belong to
+ * @appointment.
+ */
+static GSList *
+calendar_appointment_expand (CalendarAppointment *appointment,
+                             time_t               since,
+                             time_t               until,
+                             icaltimezone        *default_zone)
+{
+  GSList *generated = NULL;
+  GSList *merged = NULL;
+  GSList *added = NULL;
+  GSList *l, *ll;
+
+  if (!appointment->is_recurring)
+    {
+      /* The one occurrence starts at start_time, wherever the window is */
+      if (appointment->is_expanded)
+        return NULL;
+
+      calendar_appointment_generate_occurrences (appointment,
+                                                 appointment->start_time,
+                                                 appointment->start_time + 1,
+                                                 default_zone,
+                                                 &generated);
+    }
+  else if (!appointment->is_expanded)
+    {
+      calendar_appointment_generate_occurrences (appointment, since, until,
+                                                 default_zone, &generated);
+      appointment->expanded_since = since;
+      appointment->expanded_until = until;
+    }
+  else
+    {
+      if (since >= appointment->expanded_since &&
+          until <= appointment->expanded_until)
+        return NULL;
+
+      if (since < appointment->expanded_since)
+        {
+          calendar_appointment_generate_occurrences (appointment,
+                                                     since,
+                                                     appointment->expanded_since,
+                                                     default_zone,
+                                                     &generated);
+          appointment->expanded_since = since;
+        }
+
+      if (until > appointment->expanded_until)
+        {
+          calendar_appointment_generate_occurrences (appointment,
+                                                     appointment->expanded_until,
+                                                     until,
+                                                     default_zone,
+                                                     &generated);
+          appointment->expanded_until = until;
+        }
+    }
 
-  g_object_unref (ecal);
+  appointment->is_expanded = TRUE;
 
-  appointment->occurrences = g_slist_reverse (appointment->occurrences);
+  generated = g_slist_sort_with_data (generated, calendar_occurrence_compare, NULL);
+
+  /* Occurrences overlapping the edges of the range expanded before are
+   * generated again, so drop the ones we already have while merging
+   */
+  l = appointment->occurrences;
+  ll = generated;
+  while (l != NULL || ll != NULL)
+    {
+      gint cmp;
+
+      if (l == NULL)
+        cmp = 1;
+      else if (ll == NULL)
+        cmp = -1;
+      else
+        cmp = calendar_occurrence_compare (l->data, ll->data, NULL);
+
+      if (cmp <= 0)
+        {
+          merged = g_slist_prepend (merged, l->data);
+          l = l->next;
+
+          if (cmp == 0)
+            {
+              g_free (ll->data);
+              ll = ll->next;
+            }
+        }
+      else
+        {
+          CalendarOccurrence *occurrence = ll->data;
+
+          occurrence->appointment = appointment;
+          merged = g_slist_prepend (merged, occurrence);
+          added = g_slist_prepend (added, occurrence);
+          ll = ll->next;
+        }
+    }
+
+  g_slist_free (generated);
+  g_slist_free (appointment->occurrences);
+  appointment->occurrences = g_slist_reverse (merged);
+
+  return added;
 }
 
 static CalendarAppointment *
@@ -467,6 +669,13 @@ calendar_appointment_new (icalcomponent        *ical,
                              ical,
                              cal,
                              default_zone);
+
+  appointment->component = e_cal_component_new ();
+  e_cal_component_set_icalcomponent (appointment->component,
+                                     icalcomponent_new_clone (ical));
+  appointment->client = g_object_ref (cal);
+  appointment->is_recurring = e_cal_component_has_recurrences (appointment->component);
+
   return appointment;
 }
 
@@ -484,8 +693,20 @@ struct _App
   CalendarSources *sources;
   gulong sources_signal_id;
 
-  /* hash from uid to CalendarAppointment objects */
+  /* hash from "source-uid:uid" to CalendarAppointment objects, for
+   * all events between load_since and load_until
+   */
   GHashTable *appointments;
+  time_t load_since;
+  time_t load_until;
+  gboolean have_cache;
+
+  /* The occurrences of the appointments generated so far, sorted by
+   * start time, and the longest of them; an occurrence overlapping a
+   * window starts at most that long before it
+   */
+  GSequence *occurrence_index;
+  time_t max_occurrence_duration;
 
   gchar *timezone_location;
 
@@ -494,8 +715,38 @@ struct _App
   gboolean cache_invalid;
 
   GList *live_views;
+
+  /* State of the load in progress, if any; the clients are opened and
+   * queried in parallel and their results collected in
+   * pending_appointments, which replaces appointments once all of
+   * them have finished
+   */
+  GCancellable *cancellable;
+  GHashTable *pending_appointments;
+  time_t pending_since;
+  time_t pending_until;
+  guint n_pending_loads;
+  gboolean served_stale;
+
+  /* GetEvents calls waiting for a load of a window we have no cache for */
+  GList *pending_invocations;
 };
 
+typedef struct
+{
+  App            *app;
+  ECalClient     *client;
+  GCancellable   *cancellable;
+  gchar          *query;
+} ClientLoad;
+
+typedef struct
+{
+  GDBusMethodInvocation *invocation;
+  time_t                 since;
+  time_t                 until;
+} PendingInvocation;
+
 static void
 app_update_timezone (App *app)
 {
@@ -542,189 +793,614 @@ app_schedule_changed (App *app)
     }
 }
 
+static void
+app_emit_changed (App *app)
+{
+  if (app->changed_timeout_id != 0)
+    g_source_remove (app->changed_timeout_id);
+
+  on_app_schedule_changed_cb (app);
+}
+
 static void
 invalidate_cache (App *app)
 {
   app->cache_invalid = TRUE;
 }
 
+static gchar *
+app_get_appointment_key (ECalClient *cal,
+                         const char *uid)
+{
+  ESource *source = e_client_get_source (E_CLIENT (cal));
+
+  return g_strconcat (e_source_get_uid (source), ":", uid, NULL);
+}
+
+/* Changes reported by the live views go to the table being loaded,
+ * if there is one, so they aren't lost when it replaces the current one
+ */
+static GHashTable *
+app_get_target_appointments (App *app)
+{
+  return app->pending_appointments != NULL ? app->pending_appointments : app->appointments;
+}
+
 static void
-on_objects_added (ECalClientView *view,
-                  GSList         *objects,
-                  gpointer        user_data)
+app_index_occurrences (App    *app,
+                       GSList *occurrences)
 {
-  App *app = user_data;
   GSList *l;
 
-  print_debug ("%s for calendar", G_STRFUNC);
+  for (l = occurrences; l != NULL; l = l->next)
+    {
+      CalendarOccurrence *occurrence = l->data;
+
+      occurrence->iter = g_sequence_insert_sorted (app->occurrence_index,
+                                                   occurrence,
+                                                   calendar_occurrence_compare,
+                                                   NULL);
+      app->max_occurrence_duration = MAX (app->max_occurrence_duration,
+                                          occurrence->end_time - occurrence->start_time);
+    }
+}
 
-  for (l = objects; l != NULL; l = l->next)
+/* Generates the occurrences of all current appointments between @since
+ * and @until that haven't been generated yet, and indexes them
+ */
+static void
+app_expand_window (App    *app,
+                   time_t  since,
+                   time_t  until)
+{
+  GHashTableIter iter;
+  CalendarAppointment *appointment;
+
+  g_hash_table_iter_init (&iter, app->appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &appointment))
     {
-      icalcomponent *ical = l->data;
-      const char *uid;
+      GSList *added;
 
-      uid = icalcomponent_get_uid (ical);
+      added = calendar_appointment_expand (appointment, since, until, app->zone);
+      app_index_occurrences (app, added);
+      g_slist_free (added);
+    }
+}
 
-      if (g_hash_table_lookup (app->appointments, uid) == NULL)
-        {
-          /* new appointment we don't know about => changed signal */
-          invalidate_cache (app);
-          app_schedule_changed (app);
-        }
+static gboolean
+app_add_appointment (App           *app,
+                     GHashTable    *appointments,
+                     icalcomponent *ical,
+                     ECalClient    *cal)
+{
+  CalendarAppointment *appointment;
+  CalendarAppointment *old;
+  GSList *added;
+  gchar *key;
+
+  appointment = calendar_appointment_new (ical, cal, app->zone);
+  if (appointment == NULL)
+    return FALSE;
+
+  key = app_get_appointment_key (cal, appointment->uid);
+  old = g_hash_table_lookup (appointments, key);
+
+  /* Expand it as far as the appointment it replaces, so that they can be
+   * compared and no occurrences go missing from windows served before
+   */
+  if (old != NULL && old->is_recurring && old->is_expanded)
+    added = calendar_appointment_expand (appointment,
+                                         MIN (old->expanded_since, app->since),
+                                         MAX (old->expanded_until, app->until),
+                                         app->zone);
+  else
+    added = calendar_appointment_expand (appointment, app->since, app->until, app->zone);
+
+  if (old != NULL && calendar_appointment_equal (old, appointment))
+    {
+      g_slist_free (added);
+      calendar_appointment_free (appointment);
+      g_free (key);
+      return FALSE;
     }
+
+  g_hash_table_replace (appointments, key, appointment);
+
+  if (appointments == app->appointments)
+    app_index_occurrences (app, added);
+  g_slist_free (added);
+
+  return TRUE;
 }
 
 static void
-on_objects_modified (ECalClientView *view,
-                     GSList         *objects,
-                     gpointer        user_data)
+on_objects_added_or_modified (ECalClientView *view,
+                              GSList         *objects,
+                              gpointer        user_data)
 {
   App *app = user_data;
+  ECalClient *cal;
+  GHashTable *appointments;
+  gboolean changed;
+  GSList *l;
+
   print_debug ("%s for calendar", G_STRFUNC);
-  invalidate_cache (app);
-  app_schedule_changed (app);
+
+  cal = e_cal_client_view_get_client (view);
+  appointments = app_get_target_appointments (app);
+
+  changed = FALSE;
+  for (l = objects; l != NULL; l = l->next)
+    {
+      if (app_add_appointment (app, appointments, l->data, cal))
+        changed = TRUE;
+    }
+
+  if (changed && appointments == app->appointments)
+    app_schedule_changed (app);
 }
 
 static void
 on_objects_removed (ECalClientView *view,
-                    GSList         *uids,
+                    GSList         *ids,
                     gpointer        user_data)
 {
   App *app = user_data;
+  ECalClient *cal;
+  GHashTable *appointments;
+  gboolean changed;
+  GSList *l;
+
   print_debug ("%s for calendar", G_STRFUNC);
-  invalidate_cache (app);
-  app_schedule_changed (app);
+
+  cal = e_cal_client_view_get_client (view);
+  appointments = app_get_target_appointments (app);
+
+  changed = FALSE;
+  for (l = ids; l != NULL; l = l->next)
+    {
+      ECalComponentId *id = l->data;
+      gchar *key;
+
+      /* Detached instances share the uid of their series, so we can't
+       * tell what's left of the series without querying it again
+       */
+      if (id->rid != NULL && *id->rid != '\0')
+        {
+          invalidate_cache (app);
+          changed = TRUE;
+          continue;
+        }
+
+      key = app_get_appointment_key (cal, id->uid);
+      if (g_hash_table_remove (appointments, key))
+        changed = TRUE;
+      g_free (key);
+    }
+
+  if (changed && appointments == app->appointments)
+    app_schedule_changed (app);
 }
 
+static void on_client_view_complete (ECalClientView *view,
+                                     const GError   *error,
+                                     gpointer        user_data);
+
 static void
-app_load_events (App *app)
+app_stop_views (App *app)
 {
-  GList *clients;
-  GList *l;
   GList *ll;
-  gchar *since_iso8601;
-  gchar *until_iso8601;
 
-  /* out with the old */
-  g_hash_table_remove_all (app->appointments);
-  /* nuke existing views */
   for (ll = app->live_views; ll != NULL; ll = ll->next)
     {
       ECalClientView *view = E_CAL_CLIENT_VIEW (ll->data);
-      g_signal_handlers_disconnect_by_func (view, on_objects_added, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_modified, app);
+      g_signal_handlers_disconnect_by_func (view, on_objects_added_or_modified, app);
       g_signal_handlers_disconnect_by_func (view, on_objects_removed, app);
+      /* frees the load of a view that didn't complete yet */
+      g_signal_handlers_disconnect_matched (view, G_SIGNAL_MATCH_FUNC,
+                                            0, 0, NULL,
+                                            on_client_view_complete, NULL);
       e_cal_client_view_stop (view, NULL);
       g_object_unref (view);
     }
   g_list_free (app->live_views);
   app->live_views = NULL;
+}
+
+static gboolean
+appointment_tables_equal (GHashTable *a,
+                          GHashTable *b)
+{
+  GHashTableIter iter;
+  gpointer key;
+  CalendarAppointment *appointment;
+
+  if (g_hash_table_size (a) != g_hash_table_size (b))
+    return FALSE;
+
+  g_hash_table_iter_init (&iter, a);
+  while (g_hash_table_iter_next (&iter, &key, (gpointer) &appointment))
+    {
+      CalendarAppointment *other = g_hash_table_lookup (b, key);
+
+      if (other == NULL || !calendar_appointment_equal (appointment, other))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+app_return_events (App                   *app,
+                   GDBusMethodInvocation *invocation,
+                   time_t                 since,
+                   time_t                 until)
+{
+  GVariantBuilder builder;
+  GSequenceIter *iter;
+  CalendarOccurrence key;
+
+  app_expand_window (app, since, until);
+
+  /* The a{sv} is used as an escape hatch in case we want to provide more
+   * information in the future without breaking ABI
+   */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssbxxa{sv})"));
+
+  key.start_time = since - app->max_occurrence_duration - 1;
+  iter = g_sequence_search (app->occurrence_index,
+                            &key,
+                            calendar_occurrence_compare_start,
+                            NULL);
+  for (; !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter))
+    {
+      CalendarOccurrence *o = g_sequence_get (iter);
+      CalendarAppointment *a = o->appointment;
+      GVariantBuilder extras_builder;
+
+      if (o->start_time >= until)
+        break;
+
+      if (!calendar_occurrence_in_window (o, since, until))
+        continue;
+
+      g_variant_builder_init (&extras_builder, G_VARIANT_TYPE ("a{sv}"));
+      g_variant_builder_add (&builder,
+                             "(sssbxxa{sv})",
+                             a->uid,
+                             a->summary != NULL ? a->summary : "",
+                             a->description != NULL ? a->description : "",
+                             (gboolean) a->is_all_day,
+                             (gint64) o->start_time,
+                             (gint64) o->end_time,
+                             extras_builder);
+    }
+  g_dbus_method_invocation_return_value (invocation,
+                                         g_variant_new ("(a(sssbxxa{sv}))", &builder));
+}
+
+static void
+app_load_finished (App *app)
+{
+  GHashTableIter iter;
+  CalendarAppointment *appointment;
+  gboolean changed;
+  gboolean notify;
+  GList *l;
+
+  changed = !appointment_tables_equal (app->appointments, app->pending_appointments);
+
+  /* This also takes the old occurrences out of the index */
+  g_hash_table_unref (app->appointments);
+  app->appointments = app->pending_appointments;
+  app->pending_appointments = NULL;
+  app->load_since = app->pending_since;
+  app->load_until = app->pending_until;
+  app->have_cache = TRUE;
+
+  app->max_occurrence_duration = 0;
+  g_hash_table_iter_init (&iter, app->appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &appointment))
+    app_index_occurrences (app, appointment->occurrences);
+
+  print_debug ("Finished loading %u appointments%s",
+               g_hash_table_size (app->appointments),
+               changed ? " (changed)" : "");
+
+  /* Callers that were waiting for this load get the new events in the
+   * reply; anyone else has to be told to ask again
+   */
+  notify = changed && (app->served_stale || app->pending_invocations == NULL);
+  app->served_stale = FALSE;
+
+  app->pending_invocations = g_list_reverse (app->pending_invocations);
+  for (l = app->pending_invocations; l != NULL; l = l->next)
+    {
+      PendingInvocation *pending = l->data;
+
+      app_return_events (app, pending->invocation, pending->since, pending->until);
+      g_slice_free (PendingInvocation, pending);
+    }
+  g_list_free (app->pending_invocations);
+  app->pending_invocations = NULL;
+
+  if (notify)
+    app_emit_changed (app);
+}
+
+/* GetEvents calls waiting for a window that the load about to start
+ * doesn't cover can't be answered from it; the caller has moved on to
+ * a different window by then, so just fail them
+ */
+static void
+app_drop_stale_invocations (App *app)
+{
+  GList *l, *next;
+
+  for (l = app->pending_invocations; l != NULL; l = next)
+    {
+      PendingInvocation *pending = l->data;
+
+      next = l->next;
+      if (pending->since >= app->pending_since && pending->until <= app->pending_until)
+        continue;
+
+      print_debug ("Dropping GetEvents call for a superseded window");
+      g_dbus_method_invocation_return_dbus_error (pending->invocation,
+                                                  "org.gnome.Shell.CalendarServer.Error.Failed",
+                                                  "request superseded by one for a different window");
+      g_slice_free (PendingInvocation, pending);
+      app->pending_invocations = g_list_delete_link (app->pending_invocations, l);
+    }
+}
+
+static void
+client_load_free (ClientLoad *load)
+{
+  g_object_unref (load->client);
+  g_object_unref (load->cancellable);
+  g_free (load->query);
+  g_slice_free (ClientLoad, load);
+}
+
+/* Frees @load and returns %FALSE if the load it is part of has been
+ * superseded or the app is shutting down
+ */
+static gboolean
+client_load_check (ClientLoad *load,
+                   GError     *error,
+                   const char *what)
+{
+  if (g_cancellable_is_cancelled (load->cancellable))
+    {
+      g_clear_error (&error);
+      client_load_free (load);
+      return FALSE;
+    }
+
+  if (error != NULL)
+    {
+      ESource *source = e_client_get_source (E_CLIENT (load->client));
+      g_warning ("Error %s calendar %s: %s\n",
+                 what, e_source_get_uid (source), error->message);
+      g_error_free (error);
+    }
+
+  return TRUE;
+}
+
+static void
+client_load_done (ClientLoad *load)
+{
+  App *app = load->app;
+
+  client_load_free (load);
+
+  g_assert (app->n_pending_loads > 0);
+  if (--app->n_pending_loads == 0)
+    app_load_finished (app);
+}
+
+/* The view of each calendar sends the objects it has as soon as it is
+ * started, and emits ::complete once it has sent them all, which is
+ * when the calendar is loaded. Anything that changes later is sent too,
+ * so nothing is missed between loading the events and watching them.
+ */
+static void
+on_client_view_complete (ECalClientView *view,
+                         const GError   *error,
+                         gpointer        user_data)
+{
+  ClientLoad *load = user_data;
+  App *app = load->app;
+  gboolean cancelled;
+
+  cancelled = g_cancellable_is_cancelled (load->cancellable);
+  if (error != NULL && !cancelled)
+    {
+      ESource *source = e_client_get_source (E_CLIENT (load->client));
+      g_warning ("Error loading calendar %s: %s\n",
+                 e_source_get_uid (source), error->message);
+    }
+
+  /* Only the first ::complete finishes the load; this frees @load */
+  g_signal_handlers_disconnect_by_func (view, on_client_view_complete, load);
+
+  if (cancelled)
+    return;
+
+  g_assert (app->n_pending_loads > 0);
+  if (--app->n_pending_loads == 0)
+    app_load_finished (app);
+}
+
+static void
+on_client_view_ready (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  ClientLoad *load = user_data;
+  ECalClientView *view;
+  App *app;
+  GError *error;
+
+  error = NULL;
+  view = NULL;
+  e_cal_client_get_view_finish (load->client, result, &view, &error);
+  if (!client_load_check (load, error, "setting up live-query on"))
+    {
+      if (view != NULL)
+        g_object_unref (view);
+      return;
+    }
+
+  if (view == NULL)
+    {
+      client_load_done (load);
+      return;
+    }
+
+  app = load->app;
+
+  g_signal_connect (view,
+                    "objects-added",
+                    G_CALLBACK (on_objects_added_or_modified),
+                    app);
+  g_signal_connect (view,
+                    "objects-modified",
+                    G_CALLBACK (on_objects_added_or_modified),
+                    app);
+  g_signal_connect (view,
+                    "objects-removed",
+                    G_CALLBACK (on_objects_removed),
+                    app);
+  g_signal_connect_data (view,
+                         "complete",
+                         G_CALLBACK (on_client_view_complete),
+                         load,
+                         (GClosureNotify) client_load_free,
+                         0);
+  app->live_views = g_list_prepend (app->live_views, view);
+
+  e_cal_client_view_start (view, &error);
+  if (error != NULL)
+    {
+      on_client_view_complete (view, error, load);
+      g_error_free (error);
+    }
+}
+
+static void
+on_client_opened (GObject      *source_object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  ClientLoad *load = user_data;
+  GError *error;
+
+  error = NULL;
+  if (!e_client_open_finish (E_CLIENT (load->client), result, &error))
+    {
+      if (client_load_check (load, error, "opening"))
+        client_load_done (load);
+      return;
+    }
+
+  if (!client_load_check (load, NULL, NULL))
+    return;
+
+  e_cal_client_get_view (load->client,
+                         load->query,
+                         load->cancellable,
+                         on_client_view_ready,
+                         load);
+}
+
+/* Starts loading the events around app->since and app->until from all
+ * calendars in parallel, cancelling any load already in progress. The
+ * current appointments keep being served until the load finishes.
+ */
+static void
+app_load_events (App *app)
+{
+  GList *clients;
+  GList *l;
+  gchar *since_iso8601;
+  gchar *until_iso8601;
+  gchar *query;
+  time_t span;
+
+  if (app->cancellable != NULL)
+    {
+      g_cancellable_cancel (app->cancellable);
+      g_object_unref (app->cancellable);
+    }
+  app->cancellable = g_cancellable_new ();
+
+  /* the new load sets up its own views */
+  app_stop_views (app);
+
+  if (app->pending_appointments != NULL)
+    g_hash_table_unref (app->pending_appointments);
+  app->pending_appointments = g_hash_table_new_full (g_str_hash,
+                                                     g_str_equal,
+                                                     g_free,
+                                                     (GDestroyNotify) calendar_appointment_free);
+  app->n_pending_loads = 0;
+  app->cache_invalid = FALSE;
 
   /* timezone could have changed */
   app_update_timezone (app);
 
-  since_iso8601 = isodate_from_time_t (app->since);
-  until_iso8601 = isodate_from_time_t (app->until);
+  /* Also load the windows either side of the requested one, so that
+   * paging through the calendar only has to expand recurrences
+   */
+  span = app->until - app->since;
+  app->pending_since = app->since - span;
+  app->pending_until = app->until + span;
+
+  app_drop_stale_invocations (app);
+
+  since_iso8601 = isodate_from_time_t (app->pending_since);
+  until_iso8601 = isodate_from_time_t (app->pending_until);
 
   print_debug ("Loading events since %s until %s",
                since_iso8601,
                until_iso8601);
 
+  query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
+                           "(make-time \"%s\")",
+                           since_iso8601,
+                           until_iso8601);
+
   clients = calendar_sources_get_appointment_clients (app->sources);
   for (l = clients; l != NULL; l = l->next)
     {
       ECalClient *cal = E_CAL_CLIENT (l->data);
-      GError *error;
-      gchar *query;
-      GSList *objects, *j;
-      ECalClientView *view;
+      ClientLoad *load;
 
       e_cal_client_set_default_timezone (cal, app->zone);
 
-      error = NULL;
-      if (!e_client_open_sync (E_CLIENT (cal), TRUE, NULL, &error))
-        {
-          ESource *source = e_client_get_source (E_CLIENT (cal));
-          g_warning ("Error opening calendar %s: %s\n",
-		     e_source_get_uid (source), error->message);
-          g_error_free (error);
-          continue;
-        }
-
-      query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
-                               "(make-time \"%s\")",
-                               since_iso8601,
-                               until_iso8601);
-      error = NULL;
-      objects = NULL;
-      if (!e_cal_client_get_object_list_sync (cal,
-					      query,
-					      &objects,
-					      NULL, /* cancellable */
-					      &error))
-        {
-          ESource *source = e_client_get_source (E_CLIENT (cal));
-          g_warning ("Error querying calendar %s: %s\n",
-		     e_source_get_uid (source), error->message);
-          g_error_free (error);
-          g_free (query);
-          continue;
-        }
-
-      for (j = objects; j != NULL; j = j->next)
-        {
-          icalcomponent *ical = j->data;
-          CalendarAppointment *appointment;
-
-          appointment = calendar_appointment_new (ical, cal, app->zone);
-          if (appointment == NULL)
-            continue;
-
-          calendar_appointment_generate_occurrences (appointment,
-                                                     ical,
-                                                     cal,
-                                                     app->since,
-                                                     app->until,
-                                                     app->zone);
-          g_hash_table_insert (app->appointments, g_strdup (appointment->uid), appointment);
-        }
-
-      e_cal_client_free_icalcomp_slist (objects);
-
-      error = NULL;
-      if (!e_cal_client_get_view_sync (cal,
-				       query,
-				       &view,
-				       NULL, /* cancellable */
-				       &error))
-        {
-          g_warning ("Error setting up live-query on calendar: %s\n", error->message);
-          g_error_free (error);
-        }
-      else
-        {
-          g_signal_connect (view,
-                            "objects-added",
-                            G_CALLBACK (on_objects_added),
-                            app);
-          g_signal_connect (view,
-                            "objects-modified",
-                            G_CALLBACK (on_objects_modified),
-                            app);
-          g_signal_connect (view,
-                            "objects-removed",
-                            G_CALLBACK (on_objects_removed),
-                            app);
-          e_cal_client_view_start (view, NULL);
-          app->live_views = g_list_prepend (app->live_views, view);
-        }
-
-      g_free (query);
+      load = g_slice_new0 (ClientLoad);
+      load->app = app;
+      load->client = g_object_ref (cal);
+      load->cancellable = g_object_ref (app->cancellable);
+      load->query = g_strdup (query);
+
+      app->n_pending_loads++;
+      e_client_open (E_CLIENT (cal),
+                     TRUE,
+                     load->cancellable,
+                     on_client_opened,
+                     load);
     }
   g_list_free (clients);
+  g_free (query);
   g_free (since_iso8601);
   g_free (until_iso8601);
-  app->cache_invalid = FALSE;
+
+  if (app->n_pending_loads == 0)
+    app_load_finished (app);
 }
 
 static gboolean
@@ -780,6 +1456,7 @@ app_new (GDBusConnection *connection)
                                              g_str_equal,
                                              g_free,
                                              (GDestroyNotify) calendar_appointment_free);
+  app->occurrence_index = g_sequence_new (NULL);
 
   app_update_timezone (app);
 
@@ -789,21 +1466,33 @@ app_new (GDBusConnection *connection)
 static void
 app_free (App *app)
 {
-  GList *ll;
-  for (ll = app->live_views; ll != NULL; ll = ll->next)
+  GList *l;
+
+  if (app->cancellable != NULL)
     {
-      ECalClientView *view = E_CAL_CLIENT_VIEW (ll->data);
-      g_signal_handlers_disconnect_by_func (view, on_objects_added, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_modified, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_removed, app);
-      e_cal_client_view_stop (view, NULL);
-      g_object_unref (view);
+      g_cancellable_cancel (app->cancellable);
+      g_object_unref (app->cancellable);
     }
-  g_list_free (app->live_views);
+
+  for (l = app->pending_invocations; l != NULL; l = l->next)
+    {
+      PendingInvocation *pending = l->data;
+
+      g_dbus_method_invocation_return_dbus_error (pending->invocation,
+                                                  "org.gnome.Shell.CalendarServer.Error.Failed",
+                                                  "calendar server is exiting");
+      g_slice_free (PendingInvocation, pending);
+    }
+  g_list_free (app->pending_invocations);
+
+  app_stop_views (app);
 
   g_free (app->timezone_location);
 
   g_hash_table_unref (app->appointments);
+  if (app->pending_appointments != NULL)
+    g_hash_table_unref (app->pending_appointments);
+  g_sequence_free (app->occurrence_index);
 
   g_object_unref (app->connection);
   g_signal_handler_disconnect (app->sources,
@@ -832,13 +1521,11 @@ handle_method_call (GDBusConnection       *connection,
 
   if (g_strcmp0 (method_name, "GetEvents") == 0)
     {
-      GVariantBuilder builder;
-      GHashTableIter hash_iter;
-      CalendarAppointment *a;
       gint64 since;
       gint64 until;
       gboolean force_reload;
-      gboolean window_changed;
+      gboolean loading;
+      gboolean cached;
 
       g_variant_get (parameters,
                      "(xxb)",
@@ -859,7 +1546,6 @@ handle_method_call (GDBusConnection       *connection,
                    until,
                    force_reload ? "true" : "false");
 
-      window_changed = FALSE;
       if (!(app->until == until && app->since == since))
         {
           GVariantBuilder *builder;
@@ -867,7 +1553,6 @@ handle_method_call (GDBusConnection       *connection,
 
           app->until = until;
           app->since = since;
-          window_changed = TRUE;
 
           builder = g_variant_builder_new (G_VARIANT_TYPE ("a{sv}"));
           invalidated_builder = g_variant_builder_new (G_VARIANT_TYPE ("as"));
@@ -887,48 +1572,41 @@ handle_method_call (GDBusConnection       *connection,
                                          NULL); /* GError** */
         }
 
-      /* reload events if necessary */
-      if (window_changed || force_reload || app->cache_invalid)
+      /* reload events if necessary; a load covering this window that
+       * is already running is as good as a new one
+       */
+      loading = app->pending_appointments != NULL;
+      cached = app->have_cache && since >= app->load_since && until <= app->load_until;
+      if (loading)
+        {
+          if (!cached && !(since >= app->pending_since && until <= app->pending_until))
+            app_load_events (app);
+        }
+      else if (!cached || force_reload || app->cache_invalid)
         {
           app_load_events (app);
         }
+      loading = app->pending_appointments != NULL;
 
-      /* The a{sv} is used as an escape hatch in case we want to provide more
-       * information in the future without breaking ABI
-       */
-      g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssbxxa{sv})"));
-      g_hash_table_iter_init (&hash_iter, app->appointments);
-      while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer) &a))
+      if (cached)
         {
-          GVariantBuilder extras_builder;
-          GSList *l;
+          /* Reply from the cache right away; if it turns out to be out
+           * of date, the load in progress will emit Changed
+           */
+          if (loading)
+            app->served_stale = TRUE;
+          app_return_events (app, invocation, since, until);
+        }
+      else
+        {
+          PendingInvocation *pending;
 
-          for (l = a->occurrences; l; l = l->next)
-            {
-              CalendarOccurrence *o = l->data;
-              time_t start_time = o->start_time;
-              time_t end_time   = o->end_time;
-
-              if ((start_time >= app->since &&
-                   start_time < app->until) ||
-                  (start_time <= app->since &&
-                  (end_time - 1) > app->since))
-                {
-                  g_variant_builder_init (&extras_builder, G_VARIANT_TYPE ("a{sv}"));
-                  g_variant_builder_add (&builder,
-                                         "(sssbxxa{sv})",
-                                         a->uid,
-                                         a->summary != NULL ? a->summary : "",
-                                         a->description != NULL ? a->description : "",
-                                         (gboolean) a->is_all_day,
-                                         (gint64) start_time,
-                                         (gint64) end_time,
-                                         extras_builder);
-                }
-            }
+          pending = g_slice_new (PendingInvocation);
+          pending->invocation = invocation;
+          pending->since = since;
+          pending->until = until;
+          app->pending_invocations = g_list_prepend (app->pending_invocations, pending);
         }
-      g_dbus_method_invocation_return_value (invocation,
-                                             g_variant_new ("(a(sssbxxa{sv}))", &builder));
     }
   else
     {
@@ -38,6 +38,7 @@
 
 #include "shell-global-private.h"
 #include "shell-perf-log.h"
+#include "shell-startup-trace.h"
 #include "shell-wm-private.h"
 
 static void gnome_shell_plugin_start            (MetaPlugin          *plugin);
@@ -208,6 +209,8 @@ gnome_shell_plugin_start (MetaPlugin *plugin)
   GjsContext *gjs_context;
   ClutterBackend *backend;
 
+  shell_startup_trace_mark ("pluginStart");
+
   backend = clutter_get_default_backend ();
   shell_plugin->cogl_context = clutter_backend_get_cogl_context (backend);
 
@@ -224,6 +227,7 @@ gnome_shell_plugin_start (MetaPlugin *plugin)
 
   gjs_context = _shell_global_get_gjs_context (shell_plugin->global);
 
+  shell_startup_trace_begin ("mainJs");
   if (!gjs_context_eval (gjs_context,
                          "imports.ui.environment.init();"
                          "imports.ui.main.start();",
@@ -248,6 +252,7 @@ gnome_shell_plugin_start (MetaPlugin *plugin)
       g_object_unref (gjs_context);
       exit (1);
     }
+  shell_startup_trace_end ("mainJs");
 }
 
 static ShellWM *
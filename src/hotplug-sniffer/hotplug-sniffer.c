@@ -23,6 +23,7 @@
  */
 
 #include "shell-mime-sniffer.h"
+#include "shell-sniff-cache.h"
 #include "hotplug-mimetypes.h"
 
 /* Set the environment variable HOTPLUG_SNIFFER_DEBUG to show debug */
@@ -83,6 +84,10 @@ ensure_autoquit_on (void)
 typedef struct {
   GVariant *parameters;
   GDBusMethodInvocation *invocation;
+
+  GFile *file;
+  gchar *uuid;
+  gchar *signature;
 } InvocationData;
 
 static InvocationData *
@@ -103,10 +108,22 @@ invocation_data_free (InvocationData *data)
 {
   g_variant_unref (data->parameters);
   g_clear_object (&data->invocation);
+  g_clear_object (&data->file);
+  g_free (data->uuid);
+  g_free (data->signature);
 
   g_slice_free (InvocationData, data);
 }
 
+static void
+return_types (InvocationData *data,
+              gchar **types)
+{
+  g_dbus_method_invocation_return_value (data->invocation,
+                                         g_variant_new ("(^as)", types));
+  g_clear_object (&data->invocation);
+}
+
 static void
 sniff_async_ready_cb (GObject *source,
                       GAsyncResult *res,
@@ -121,13 +138,31 @@ sniff_async_ready_cb (GObject *source,
 
   if (error != NULL)
     {
-      g_dbus_method_invocation_return_gerror (data->invocation, error);
+      /* if we already replied from the cache, keep the cached result */
+      if (data->invocation != NULL)
+        g_dbus_method_invocation_return_gerror (data->invocation, error);
       g_error_free (error);
       goto out;
     }
 
-  g_dbus_method_invocation_return_value (data->invocation,
-                                         g_variant_new ("(^as)", types));
+  if (data->invocation != NULL)
+    return_types (data, types);
+
+  if (data->uuid != NULL)
+    {
+      gboolean complete;
+
+      /* types found before the watchdog fired only cover part of the
+       * volume; keep them as a guess, but sniff it again next time */
+      complete = !shell_mime_sniffer_get_timed_out (SHELL_MIME_SNIFFER (source));
+
+      print_debug ("Storing %s sniffed types for volume %s",
+                   complete ? "complete" : "incomplete", data->uuid);
+      shell_sniff_cache_store (data->uuid, data->signature,
+                               (const gchar * const *) types,
+                               complete);
+    }
+
   g_strfreev (types);
 
  out:
@@ -136,28 +171,87 @@ sniff_async_ready_cb (GObject *source,
 }
 
 static void
-handle_sniff_uri (InvocationData *data)
+start_sniff (InvocationData *data)
 {
   ShellMimeSniffer *sniffer;
+
+  sniffer = shell_mime_sniffer_new (data->file);
+  shell_mime_sniffer_sniff_async (sniffer,
+                                  sniff_async_ready_cb,
+                                  data);
+
+  g_object_unref (sniffer);
+}
+
+static void
+query_volume_ready_cb (GObject *source,
+                       GAsyncResult *res,
+                       gpointer user_data)
+{
+  InvocationData *data = user_data;
+  gchar **cached_types;
+  gchar *cached_signature = NULL;
+  GError *error = NULL;
+
+  if (!shell_sniff_cache_query_volume_finish (data->file, res,
+                                              &data->uuid, &data->signature,
+                                              &error))
+    {
+      print_debug ("Not caching the sniffed types: %s", error->message);
+      g_error_free (error);
+
+      start_sniff (data);
+      return;
+    }
+
+  cached_types = shell_sniff_cache_lookup (data->uuid, &cached_signature);
+
+  if (cached_types == NULL)
+    {
+      print_debug ("Volume %s was never sniffed", data->uuid);
+      start_sniff (data);
+      return;
+    }
+
+  /* The types a drive has rarely change, so answer with the ones we
+   * had, even when the volume changed; in that case we sniff it again
+   * behind the scenes to be right next time. */
+  return_types (data, cached_types);
+  g_strfreev (cached_types);
+
+  if (g_strcmp0 (cached_signature, data->signature) == 0)
+    {
+      print_debug ("Volume %s is unchanged, using cached types", data->uuid);
+
+      invocation_data_free (data);
+      ensure_autoquit_on ();
+    }
+  else
+    {
+      print_debug ("Volume %s changed, sniffing it again", data->uuid);
+      start_sniff (data);
+    }
+
+  g_free (cached_signature);
+}
+
+static void
+handle_sniff_uri (InvocationData *data)
+{
   const gchar *uri;
-  GFile *file;
 
   ensure_autoquit_off ();
 
   g_variant_get (data->parameters, 
                  "(&s)", &uri,
                  NULL);
-  file = g_file_new_for_uri (uri);
+  data->file = g_file_new_for_uri (uri);
 
   print_debug ("Initiating sniff for uri %s", uri);
 
-  sniffer = shell_mime_sniffer_new (file);
-  shell_mime_sniffer_sniff_async (sniffer,
-                                  sniff_async_ready_cb,
-                                  data);
-
-  g_object_unref (sniffer);
-  g_object_unref (file);
+  shell_sniff_cache_query_volume_async (data->file, NULL,
+                                        query_volume_ready_cb,
+                                        data);
 }
 
 static void
@@ -32,6 +32,8 @@
 #include "shell-mime-sniffer.h"
 #include "hotplug-mimetypes.h"
 
+#include <math.h>
+
 #include <glib/gi18n.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -45,6 +47,20 @@
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 #define HIGH_SCORE_RATIO 0.10
 
+/* Number of directories that are enumerated at the same time */
+#define MAX_CONCURRENT_DIRECTORIES 4
+/* Number of partially enumerated directories that can be put back in
+ * the queue, keeping their enumerator open, to give other ones a turn */
+#define MAX_SUSPENDED_DIRECTORIES 32
+
+/* The result is decided early once the ratios are known with this
+ * confidence (the z-score of a two-sided 99% interval), but never before
+ * this many items from this many directories were seen, as the files
+ * in a single directory tend to be all of the same kind. */
+#define DECISION_CONFIDENCE_Z 2.576
+#define DECISION_MIN_ITEMS 100
+#define DECISION_MIN_DIRECTORIES 10
+
 G_DEFINE_TYPE (ShellMimeSniffer, shell_mime_sniffer, G_TYPE_OBJECT);
 
 enum {
@@ -62,9 +78,11 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 typedef struct {
   ShellMimeSniffer *self;
 
-  GFile *file;
-  GFileEnumerator *enumerator;
-  GList *deep_count_subdirectories;
+  /* DirectoryLoads waiting for a worker, in breadth-first order */
+  GQueue *pending;
+  guint n_active;
+  guint n_suspended;
+  guint n_directories;
 
   gint audio_count;
   gint image_count;
@@ -74,18 +92,26 @@ typedef struct {
   gint total_items;
 } DeepCountState;
 
+typedef struct {
+  DeepCountState *state;
+
+  GFile *file;
+  /* only set while the directory is being enumerated, or was suspended */
+  GFileEnumerator *enumerator;
+} DirectoryLoad;
+
 struct _ShellMimeSnifferPrivate {
   GFile *file;
 
   GCancellable *cancellable;
   guint watchdog_id;
+  gboolean timed_out;
 
   GSimpleAsyncResult *async_result;
   gchar **sniffed_mime;
 };
 
-static void deep_count_load (DeepCountState *state,
-                             GFile *file);
+static void deep_count_schedule (DeepCountState *state);
 
 static void
 init_mimetypes (void)
@@ -228,71 +254,151 @@ prepare_async_result (DeepCountState *state)
   g_simple_async_result_complete_in_idle (self->priv->async_result);
 }
 
+/* Wilson score interval of the ratio of @count items out of @total */
+static void
+get_ratio_interval (gint     count,
+                    gint     total,
+                    gdouble *lower,
+                    gdouble *upper)
+{
+  gdouble ratio = (gdouble) count / (gdouble) total;
+  gdouble z2 = DECISION_CONFIDENCE_Z * DECISION_CONFIDENCE_Z;
+  gdouble denominator = 1.0 + z2 / total;
+  gdouble center, margin;
+
+  center = (ratio + z2 / (2.0 * total)) / denominator;
+  margin = DECISION_CONFIDENCE_Z *
+    sqrt (ratio * (1.0 - ratio) / total + z2 / (4.0 * total * total)) / denominator;
+
+  *lower = center - margin;
+  *upper = center + margin;
+}
+
+/* Whether looking at more files is unlikely to change the result, that is
+ * whether the leading category is ahead of all the other ones, and every
+ * other category is known to be above or below HIGH_SCORE_RATIO.
+ */
+static gboolean
+deep_count_is_decided (DeepCountState *state)
+{
+  gint counts[] = { state->video_count, state->audio_count,
+                    state->image_count, state->document_count };
+  gdouble lower[G_N_ELEMENTS (counts)];
+  gdouble upper[G_N_ELEMENTS (counts)];
+  guint idx, leader;
+
+  if (state->total_items < DECISION_MIN_ITEMS ||
+      state->n_directories < DECISION_MIN_DIRECTORIES)
+    return FALSE;
+
+  leader = 0;
+  for (idx = 0; idx < G_N_ELEMENTS (counts); idx++)
+    {
+      get_ratio_interval (counts[idx], state->total_items,
+                          &lower[idx], &upper[idx]);
+
+      if (counts[idx] > counts[leader])
+        leader = idx;
+    }
+
+  for (idx = 0; idx < G_N_ELEMENTS (counts); idx++)
+    {
+      if (idx == leader)
+        continue;
+
+      if (lower[leader] <= upper[idx])
+        return FALSE;
+
+      if (lower[idx] < HIGH_SCORE_RATIO && upper[idx] >= HIGH_SCORE_RATIO)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static DirectoryLoad *
+directory_load_new (DeepCountState *state,
+                    GFile *file)
+{
+  DirectoryLoad *load;
+
+  load = g_new0 (DirectoryLoad, 1);
+  load->state = state;
+  load->file = g_object_ref (file);
+
+  return load;
+}
+
+static void
+directory_load_free (DirectoryLoad *load)
+{
+  if (load->enumerator)
+    {
+      if (!g_file_enumerator_is_closed (load->enumerator))
+        g_file_enumerator_close_async (load->enumerator,
+                                       0, NULL, NULL, NULL);
+
+      g_object_unref (load->enumerator);
+    }
+
+  g_object_unref (load->file);
+  g_free (load);
+}
+
 /* adapted from nautilus/libnautilus-private/nautilus-directory-async.c */
 static void
-deep_count_one (DeepCountState *state,
+deep_count_one (DirectoryLoad *load,
 		GFileInfo *info)
 {
+  DeepCountState *state = load->state;
   GFile *subdir;
   const char *content_type;
 
   if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
-      /* record the fact that we have to descend into this directory */
-      subdir = g_file_get_child (state->file, g_file_info_get_name (info));
-      state->deep_count_subdirectories =
-        g_list_append (state->deep_count_subdirectories, subdir);
-    } 
+      /* record the fact that we have to descend into this directory,
+       * after the ones we already know about */
+      subdir = g_file_get_child (load->file, g_file_info_get_name (info));
+      g_queue_push_tail (state->pending, directory_load_new (state, subdir));
+      g_object_unref (subdir);
+    }
   else
     {
       content_type = g_file_info_get_content_type (info);
-      add_content_type_to_cache (state, content_type);
+      if (content_type != NULL)
+        add_content_type_to_cache (state, content_type);
     }
 }
 
 static void
 deep_count_finish (DeepCountState *state)
 {
+  ShellMimeSniffer *self = state->self;
+
   prepare_async_result (state);
 
-  if (state->enumerator)
+  if (self->priv->watchdog_id != 0)
     {
-      if (!g_file_enumerator_is_closed (state->enumerator))
-        g_file_enumerator_close_async (state->enumerator,
-                                       0, NULL, NULL, NULL);
-
-      g_object_unref (state->enumerator);
+      g_source_remove (self->priv->watchdog_id);
+      self->priv->watchdog_id = 0;
     }
 
-  g_cancellable_reset (state->self->priv->cancellable);
-  g_clear_object (&state->file);
+  g_cancellable_reset (self->priv->cancellable);
 
-  g_list_free_full (state->deep_count_subdirectories, g_object_unref);
+  g_queue_free_full (state->pending, (GDestroyNotify) directory_load_free);
 
   g_free (state);
 }
 
 static void
-deep_count_next_dir (DeepCountState *state)
+deep_count_load_done (DirectoryLoad *load)
 {
-  GFile *new_file;
+  DeepCountState *state = load->state;
 
-  g_clear_object (&state->file);
+  directory_load_free (load);
+  state->n_active--;
 
-  if (state->deep_count_subdirectories != NULL)
-    {
-      /* Work on a new directory. */
-      new_file = state->deep_count_subdirectories->data;
-      state->deep_count_subdirectories =
-        g_list_remove (state->deep_count_subdirectories, new_file);
-
-      deep_count_load (state, new_file);
-      g_object_unref (new_file);
-    }
-  else
-    {
-      deep_count_finish (state);
-    }
+  deep_count_schedule (state);
 }
 
 static void
@@ -300,47 +406,67 @@ deep_count_more_files_callback (GObject *source_object,
 				GAsyncResult *res,
 				gpointer user_data)
 {
+  DirectoryLoad *load;
   DeepCountState *state;
+  GCancellable *cancellable;
   GList *files, *l;
   GFileInfo *info;
 
-  state = user_data;
+  load = user_data;
+  state = load->state;
+  cancellable = state->self->priv->cancellable;
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  files = g_file_enumerator_next_files_finish (load->enumerator,
+                                               res, NULL);
+
+  if (g_cancellable_is_cancelled (cancellable))
     {
-      deep_count_finish (state);
+      g_list_free_full (files, g_object_unref);
+      deep_count_load_done (load);
       return;
     }
-	
-  files = g_file_enumerator_next_files_finish (state->enumerator,
-                                               res, NULL);
-  
+
   for (l = files; l != NULL; l = l->next)
     {
       info = l->data;
-      deep_count_one (state, info);
+      deep_count_one (load, info);
       g_object_unref (info);
     }
 
   if (files == NULL)
     {
-      g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-      g_object_unref (state->enumerator);
-      state->enumerator = NULL;
+      deep_count_load_done (load);
+      return;
+    }
+
+  g_list_free (files);
 
-      deep_count_next_dir (state);
+  if (deep_count_is_decided (state))
+    {
+      g_cancellable_cancel (cancellable);
+      deep_count_load_done (load);
+    }
+  else if (!g_queue_is_empty (state->pending) &&
+           state->n_suspended < MAX_SUSPENDED_DIRECTORIES)
+    {
+      /* give the other directories a turn before reading more of this
+       * one, so that a single large directory doesn't use up all the
+       * time we have */
+      g_queue_push_tail (state->pending, load);
+      state->n_suspended++;
+      state->n_active--;
+
+      deep_count_schedule (state);
     }
   else
     {
-      g_file_enumerator_next_files_async (state->enumerator,
+      g_file_enumerator_next_files_async (load->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
-                                          state->self->priv->cancellable,
+                                          cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          load);
     }
-
-  g_list_free (files);
 }
 
 static void
@@ -348,49 +474,83 @@ deep_count_callback (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
-  DeepCountState *state;
+  DirectoryLoad *load;
   GFileEnumerator *enumerator;
 
-  state = user_data;
-
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
-    {
-      deep_count_finish (state);
-      return;
-    }
+  load = user_data;
 
   enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
                                                  res, NULL);
-	
-  if (enumerator == NULL)
+
+  if (enumerator == NULL ||
+      g_cancellable_is_cancelled (load->state->self->priv->cancellable))
     {
-      deep_count_next_dir (state);
+      g_clear_object (&enumerator);
+      deep_count_load_done (load);
+      return;
     }
-  else
+
+  load->state->n_directories++;
+  load->enumerator = enumerator;
+  g_file_enumerator_next_files_async (load->enumerator,
+                                      DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                      G_PRIORITY_LOW,
+                                      load->state->self->priv->cancellable,
+                                      deep_count_more_files_callback,
+                                      load);
+}
+
+static void
+deep_count_load (DirectoryLoad *load)
+{
+  DeepCountState *state = load->state;
+
+  if (load->enumerator != NULL)
     {
-      state->enumerator = enumerator;
-      g_file_enumerator_next_files_async (state->enumerator,
+      /* resume a directory that was suspended to give others a turn */
+      state->n_suspended--;
+      g_file_enumerator_next_files_async (load->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
                                           state->self->priv->cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          load);
+    }
+  else
+    {
+      g_file_enumerate_children_async (load->file,
+                                       LOADER_ATTRS,
+                                       G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
+                                       G_PRIORITY_LOW, /* prio */
+                                       state->self->priv->cancellable,
+                                       deep_count_callback,
+                                       load);
     }
 }
 
+/* Hands pending directories to idle workers, and finishes the count once
+ * there is nothing left to do, or the sniff was cancelled and all the
+ * workers stopped.
+ */
 static void
-deep_count_load (DeepCountState *state,
-                 GFile *file)
+deep_count_schedule (DeepCountState *state)
 {
-  state->file = g_object_ref (file);
-
-  g_file_enumerate_children_async (state->file,
-                                   LOADER_ATTRS,
-                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
-                                   G_PRIORITY_LOW, /* prio */
-                                   state->self->priv->cancellable,
-                                   deep_count_callback,
-                                   state);
+  DirectoryLoad *load;
+
+  if (!g_cancellable_is_cancelled (state->self->priv->cancellable))
+    {
+      while (state->n_active < MAX_CONCURRENT_DIRECTORIES &&
+             !g_queue_is_empty (state->pending))
+        {
+          load = g_queue_pop_head (state->pending);
+          state->n_active++;
+
+          deep_count_load (load);
+        }
+    }
+
+  if (state->n_active == 0)
+    deep_count_finish (state);
 }
 
 static void
@@ -400,8 +560,10 @@ deep_count_start (ShellMimeSniffer *self)
 
   state = g_new0 (DeepCountState, 1);
   state->self = self;
+  state->pending = g_queue_new ();
 
-  deep_count_load (state, self->priv->file);
+  g_queue_push_tail (state->pending, directory_load_new (state, self->priv->file));
+  deep_count_schedule (state);
 }
 
 static void
@@ -445,6 +607,7 @@ watchdog_timeout_reached_cb (gpointer user_data)
   ShellMimeSniffer *self = user_data;
 
   self->priv->watchdog_id = 0;
+  self->priv->timed_out = TRUE;
   g_cancellable_cancel (self->priv->cancellable);
 
   return FALSE;
@@ -606,3 +769,17 @@ shell_mime_sniffer_sniff_finish (ShellMimeSniffer *self,
 
   return g_strdupv (self->priv->sniffed_mime);
 }
+
+/**
+ * shell_mime_sniffer_get_timed_out:
+ * @self: a #ShellMimeSniffer
+ *
+ * Returns: %TRUE if sniffing was stopped by the watchdog, in which case
+ *   the content types are only based on the part of the file tree that
+ *   was crawled in time
+ */
+gboolean
+shell_mime_sniffer_get_timed_out (ShellMimeSniffer *self)
+{
+  return self->priv->timed_out;
+}
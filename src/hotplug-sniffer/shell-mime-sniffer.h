@@ -64,6 +64,8 @@ gchar ** shell_mime_sniffer_sniff_finish (ShellMimeSniffer *self,
                                           GAsyncResult *res,
                                           GError **error);
 
+gboolean shell_mime_sniffer_get_timed_out (ShellMimeSniffer *self);
+
 G_END_DECLS
 
 #endif /* __SHELL_MIME_SNIFFER_H__ */
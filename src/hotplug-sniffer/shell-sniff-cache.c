@@ -0,0 +1,366 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+/* The sniff cache remembers the content types found on a volume, keyed by
+ * the UUID of its filesystem, so that a drive that is plugged in again
+ * doesn't need to be crawled again.
+ *
+ * Along with the content types, it stores a signature of the volume that
+ * is cheap to compute: the modification time of its root directory, the
+ * number of entries in it, and the number of bytes used on the filesystem.
+ * A different signature means the contents of the volume changed since
+ * it was last sniffed.
+ *
+ * Content types that were found by a sniff that didn't get to crawl the
+ * whole volume are stored without a signature: they are still a good
+ * first answer, but never match the volume, so it is sniffed again.
+ */
+
+#include "shell-sniff-cache.h"
+
+#define CACHE_MAX_VOLUMES 64
+
+#define CACHE_KEY_SIGNATURE "Signature"
+#define CACHE_KEY_CONTENT_TYPES "ContentTypes"
+#define CACHE_KEY_LAST_STORED "LastStored"
+
+#define ROOT_ATTRS                            \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED ","          \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+static GKeyFile *cache_key_file = NULL;
+
+typedef struct {
+  gchar *uuid;
+  gchar *signature;
+} VolumeQuery;
+
+static void
+volume_query_free (VolumeQuery *query)
+{
+  g_free (query->uuid);
+  g_free (query->signature);
+
+  g_slice_free (VolumeQuery, query);
+}
+
+static gchar *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "hotplug-sniffer-cache",
+                           NULL);
+}
+
+static GKeyFile *
+get_cache_key_file (void)
+{
+  gchar *path;
+
+  if (cache_key_file != NULL)
+    return cache_key_file;
+
+  cache_key_file = g_key_file_new ();
+
+  path = get_cache_path ();
+  g_key_file_load_from_file (cache_key_file, path, G_KEY_FILE_NONE, NULL);
+  g_free (path);
+
+  return cache_key_file;
+}
+
+static gchar *
+get_volume_uuid (GFile        *root,
+                 GCancellable *cancellable)
+{
+  GMount *mount;
+  GVolume *volume;
+  gchar *uuid = NULL;
+
+  mount = g_file_find_enclosing_mount (root, cancellable, NULL);
+  if (mount == NULL)
+    return NULL;
+
+  /* udisks mounts usually carry no UUID themselves, but their volume
+   * has the one of the filesystem */
+  volume = g_mount_get_volume (mount);
+  if (volume != NULL)
+    {
+      uuid = g_volume_get_uuid (volume);
+      g_object_unref (volume);
+    }
+
+  if (uuid == NULL)
+    uuid = g_mount_get_uuid (mount);
+
+  g_object_unref (mount);
+
+  return uuid;
+}
+
+static gchar *
+get_volume_signature (GFile         *root,
+                      GCancellable  *cancellable,
+                      GError       **error)
+{
+  GFileInfo *info;
+  GFileEnumerator *enumerator;
+  guint64 mtime, used = 0;
+  guint32 mtime_usec;
+  guint n_entries = 0;
+
+  info = g_file_query_info (root, ROOT_ATTRS,
+                            G_FILE_QUERY_INFO_NONE,
+                            cancellable, error);
+  if (info == NULL)
+    return NULL;
+
+  mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  g_object_unref (info);
+
+  info = g_file_query_filesystem_info (root, G_FILE_ATTRIBUTE_FILESYSTEM_USED,
+                                       cancellable, NULL);
+  if (info != NULL)
+    {
+      used = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_USED);
+      g_object_unref (info);
+    }
+
+  enumerator = g_file_enumerate_children (root, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable, error);
+  if (enumerator == NULL)
+    return NULL;
+
+  while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL)
+    {
+      n_entries++;
+      g_object_unref (info);
+    }
+
+  g_object_unref (enumerator);
+
+  return g_strdup_printf ("%" G_GUINT64_FORMAT ".%06u:%u:%" G_GUINT64_FORMAT,
+                          mtime, mtime_usec, n_entries, used);
+}
+
+static void
+query_volume_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  GFile *root = source_object;
+  VolumeQuery *query;
+  GError *error = NULL;
+
+  query = g_slice_new0 (VolumeQuery);
+
+  query->uuid = get_volume_uuid (root, cancellable);
+  if (query->uuid == NULL)
+    {
+      volume_query_free (query);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               "The volume has no UUID");
+      return;
+    }
+
+  query->signature = get_volume_signature (root, cancellable, &error);
+  if (query->signature == NULL)
+    {
+      volume_query_free (query);
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, query, (GDestroyNotify) volume_query_free);
+}
+
+/**
+ * shell_sniff_cache_query_volume_async:
+ * @root: the root directory of the volume
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: function to call when the query is finished
+ * @user_data: data for @callback
+ *
+ * Finds the UUID of the filesystem @root is on, and computes the current
+ * signature of the volume, in a thread.
+ */
+void
+shell_sniff_cache_query_volume_async (GFile               *root,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (root, cancellable, callback, user_data);
+  g_task_run_in_thread (task, query_volume_thread);
+  g_object_unref (task);
+}
+
+/**
+ * shell_sniff_cache_query_volume_finish:
+ * @root: the root directory of the volume
+ * @res: the #GAsyncResult passed to the callback
+ * @uuid: (out): location to store the UUID of the volume
+ * @signature: (out): location to store the signature of the volume
+ * @error: a #GError
+ *
+ * Returns: %TRUE if the volume could be identified
+ */
+gboolean
+shell_sniff_cache_query_volume_finish (GFile         *root,
+                                       GAsyncResult  *res,
+                                       gchar        **uuid,
+                                       gchar        **signature,
+                                       GError       **error)
+{
+  VolumeQuery *query;
+
+  g_return_val_if_fail (g_task_is_valid (res, root), FALSE);
+
+  query = g_task_propagate_pointer (G_TASK (res), error);
+  if (query == NULL)
+    return FALSE;
+
+  *uuid = g_strdup (query->uuid);
+  *signature = g_strdup (query->signature);
+  volume_query_free (query);
+
+  return TRUE;
+}
+
+/**
+ * shell_sniff_cache_lookup:
+ * @uuid: the UUID of a volume
+ * @signature: (out): location to store the signature the volume had
+ *   when it was sniffed, or %NULL if the content types are incomplete
+ *
+ * Returns: (transfer full): the content types found on the volume the
+ *   last time it was sniffed, or %NULL if it was never sniffed
+ */
+gchar **
+shell_sniff_cache_lookup (const gchar  *uuid,
+                          gchar       **signature)
+{
+  GKeyFile *key_file = get_cache_key_file ();
+  gchar **content_types;
+
+  if (!g_key_file_has_group (key_file, uuid))
+    return NULL;
+
+  content_types = g_key_file_get_string_list (key_file, uuid,
+                                              CACHE_KEY_CONTENT_TYPES,
+                                              NULL, NULL);
+  if (content_types == NULL)
+    return NULL;
+
+  *signature = g_key_file_get_string (key_file, uuid,
+                                      CACHE_KEY_SIGNATURE, NULL);
+
+  return content_types;
+}
+
+/* Keeps the cache from growing forever with the drives of every visitor,
+ * by dropping the volumes that were stored the longest time ago.
+ */
+static void
+prune_cache (GKeyFile *key_file)
+{
+  gchar **groups;
+  gsize n_groups, idx;
+
+  groups = g_key_file_get_groups (key_file, &n_groups);
+
+  while (n_groups > CACHE_MAX_VOLUMES)
+    {
+      gsize oldest = 0;
+      gint64 oldest_time = G_MAXINT64;
+
+      for (idx = 0; idx < n_groups; idx++)
+        {
+          gint64 time = g_key_file_get_int64 (key_file, groups[idx],
+                                              CACHE_KEY_LAST_STORED, NULL);
+          if (time < oldest_time)
+            {
+              oldest = idx;
+              oldest_time = time;
+            }
+        }
+
+      g_key_file_remove_group (key_file, groups[oldest], NULL);
+      g_free (groups[oldest]);
+      groups[oldest] = groups[--n_groups];
+      groups[n_groups] = NULL;
+    }
+
+  g_strfreev (groups);
+}
+
+/**
+ * shell_sniff_cache_store:
+ * @uuid: the UUID of a volume
+ * @signature: the signature of the volume when it was sniffed
+ * @content_types: the content types found on the volume
+ * @complete: whether the whole volume was sniffed
+ *
+ * Remembers the result of sniffing a volume, and saves the cache. If
+ * @complete is %FALSE, @signature is not stored, so that the volume is
+ * sniffed again the next time it is looked up.
+ */
+void
+shell_sniff_cache_store (const gchar         *uuid,
+                         const gchar         *signature,
+                         const gchar * const *content_types,
+                         gboolean             complete)
+{
+  GKeyFile *key_file = get_cache_key_file ();
+  GError *error = NULL;
+  gchar *path, *dir;
+
+  if (complete)
+    g_key_file_set_string (key_file, uuid,
+                           CACHE_KEY_SIGNATURE, signature);
+  else
+    g_key_file_remove_key (key_file, uuid,
+                           CACHE_KEY_SIGNATURE, NULL);
+  g_key_file_set_string_list (key_file, uuid,
+                              CACHE_KEY_CONTENT_TYPES,
+                              content_types,
+                              g_strv_length ((gchar **) content_types));
+  g_key_file_set_int64 (key_file, uuid,
+                        CACHE_KEY_LAST_STORED, g_get_real_time ());
+
+  prune_cache (key_file);
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0700);
+
+  if (!g_key_file_save_to_file (key_file, path, &error))
+    {
+      g_warning ("Unable to save the hotplug sniffer cache: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+}
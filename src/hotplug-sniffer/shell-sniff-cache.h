@@ -0,0 +1,46 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#ifndef __SHELL_SNIFF_CACHE_H__
+#define __SHELL_SNIFF_CACHE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void       shell_sniff_cache_query_volume_async  (GFile               *root,
+                                                  GCancellable        *cancellable,
+                                                  GAsyncReadyCallback  callback,
+                                                  gpointer             user_data);
+gboolean   shell_sniff_cache_query_volume_finish (GFile               *root,
+                                                  GAsyncResult        *res,
+                                                  gchar              **uuid,
+                                                  gchar              **signature,
+                                                  GError             **error);
+
+gchar    **shell_sniff_cache_lookup              (const gchar         *uuid,
+                                                  gchar              **signature);
+void       shell_sniff_cache_store               (const gchar         *uuid,
+                                                  const gchar         *signature,
+                                                  const gchar * const *content_types,
+                                                  gboolean             complete);
+
+G_END_DECLS
+
+#endif /* __SHELL_SNIFF_CACHE_H__ */
@@ -0,0 +1,169 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include <glib/gstdio.h>
+
+#include "shell-sniff-cache.h"
+
+static const gchar *video_types[] = { "x-content/video", NULL };
+static const gchar *mixed_types[] = { "x-content/audio", "x-content/pictures", NULL };
+
+static void
+test_lookup_unknown (void)
+{
+  gchar *signature = NULL;
+
+  g_assert (shell_sniff_cache_lookup ("never-stored", &signature) == NULL);
+  g_assert (signature == NULL);
+}
+
+static void
+test_store_lookup (void)
+{
+  gchar **types;
+  gchar *signature = NULL;
+
+  shell_sniff_cache_store ("volume-a", "1.000000:3:42", video_types, TRUE);
+
+  types = shell_sniff_cache_lookup ("volume-a", &signature);
+  g_assert (types != NULL);
+  g_assert_cmpuint (g_strv_length (types), ==, 1);
+  g_assert_cmpstr (types[0], ==, "x-content/video");
+  g_assert_cmpstr (signature, ==, "1.000000:3:42");
+
+  g_strfreev (types);
+  g_free (signature);
+
+  /* a new sniff of the volume replaces the old result */
+  shell_sniff_cache_store ("volume-a", "2.000000:4:42", mixed_types, TRUE);
+
+  types = shell_sniff_cache_lookup ("volume-a", &signature);
+  g_assert_cmpuint (g_strv_length (types), ==, 2);
+  g_assert_cmpstr (types[0], ==, "x-content/audio");
+  g_assert_cmpstr (types[1], ==, "x-content/pictures");
+  g_assert_cmpstr (signature, ==, "2.000000:4:42");
+
+  g_strfreev (types);
+  g_free (signature);
+}
+
+static void
+test_incomplete_invalidates (void)
+{
+  gchar **types;
+  gchar *signature = NULL;
+
+  shell_sniff_cache_store ("volume-b", "1.000000:3:42", video_types, TRUE);
+  shell_sniff_cache_store ("volume-b", "1.000000:3:42", mixed_types, FALSE);
+
+  /* the partial result is still returned, but never matches a volume */
+  types = shell_sniff_cache_lookup ("volume-b", &signature);
+  g_assert (types != NULL);
+  g_assert_cmpstr (types[0], ==, "x-content/audio");
+  g_assert (signature == NULL);
+
+  g_strfreev (types);
+
+  shell_sniff_cache_store ("volume-b", "1.000000:3:42", mixed_types, TRUE);
+
+  types = shell_sniff_cache_lookup ("volume-b", &signature);
+  g_assert_cmpstr (signature, ==, "1.000000:3:42");
+
+  g_strfreev (types);
+  g_free (signature);
+}
+
+static void
+test_saved (void)
+{
+  GKeyFile *key_file;
+  gchar *path;
+
+  shell_sniff_cache_store ("volume-c", "1.000000:3:42", video_types, TRUE);
+
+  path = g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "hotplug-sniffer-cache",
+                           NULL);
+  key_file = g_key_file_new ();
+  g_assert (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL));
+  g_assert (g_key_file_has_group (key_file, "volume-c"));
+
+  g_key_file_free (key_file);
+  g_free (path);
+}
+
+static void
+test_prune (void)
+{
+  gchar **types;
+  gchar *signature;
+  gint i;
+
+  /* the cache keeps 64 volumes */
+  for (i = 0; i < 65; i++)
+    {
+      gchar *uuid = g_strdup_printf ("pruned-%d", i);
+
+      shell_sniff_cache_store (uuid, "1.000000:3:42", video_types, TRUE);
+      g_free (uuid);
+    }
+
+  signature = NULL;
+  g_assert (shell_sniff_cache_lookup ("pruned-0", &signature) == NULL);
+
+  types = shell_sniff_cache_lookup ("pruned-1", &signature);
+  g_assert (types != NULL);
+
+  g_strfreev (types);
+  g_free (signature);
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *cache_dir, *path;
+  int result;
+
+  cache_dir = g_dir_make_tmp ("test-sniff-cache-XXXXXX", NULL);
+  g_assert (cache_dir != NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sniff-cache/lookup-unknown", test_lookup_unknown);
+  g_test_add_func ("/sniff-cache/store-lookup", test_store_lookup);
+  g_test_add_func ("/sniff-cache/incomplete-invalidates", test_incomplete_invalidates);
+  g_test_add_func ("/sniff-cache/saved", test_saved);
+  g_test_add_func ("/sniff-cache/prune", test_prune);
+
+  result = g_test_run ();
+
+  path = g_build_filename (cache_dir, "gnome-shell", "hotplug-sniffer-cache", NULL);
+  g_unlink (path);
+  g_free (path);
+
+  path = g_build_filename (cache_dir, "gnome-shell", NULL);
+  g_rmdir (path);
+  g_free (path);
+
+  g_rmdir (cache_dir);
+  g_free (cache_dir);
+
+  return result;
+}
@@ -25,6 +25,8 @@
 #include "shell-global.h"
 #include "shell-global-private.h"
 #include "shell-perf-log.h"
+#include "shell-startup-trace.h"
+#include "shell-util.h"
 #include "st.h"
 
 extern GType gnome_shell_plugin_get_type (void);
@@ -220,6 +222,105 @@ malloc_statistics_callback (ShellPerfLog *perf_log,
 #endif
 }
 
+static void
+st_memory_statistics_callback (ShellPerfLog *perf_log,
+                               gpointer      data)
+{
+  ShellGlobal *global = shell_global_get ();
+  ClutterStage *stage;
+  guint n_entries;
+  gsize n_bytes;
+  guint n_shadows;
+  gsize shadow_bytes;
+
+  st_texture_cache_get_memory_usage (st_texture_cache_get_default (),
+                                     &n_entries, &n_bytes);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.textureCacheEntries",
+                                     n_entries);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "st.textureCacheSize",
+                                     n_bytes);
+
+  st_theme_node_get_texture_memory_usage (&n_entries, &n_bytes,
+                                          &n_shadows, &shadow_bytes);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.prerenderedTextures",
+                                     n_entries);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "st.prerenderedTextureSize",
+                                     n_bytes);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.shadowTextures",
+                                     n_shadows);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "st.shadowTextureSize",
+                                     shadow_bytes);
+
+  stage = global ? shell_global_get_stage (global) : NULL;
+  if (stage != NULL)
+    {
+      st_theme_context_get_memory_usage (st_theme_context_get_for_stage (stage),
+                                         &n_entries, &n_bytes);
+      shell_perf_log_update_statistic_i (perf_log,
+                                         "st.themeNodes",
+                                         n_entries);
+      shell_perf_log_update_statistic_x (perf_log,
+                                         "st.themeNodeSize",
+                                         n_bytes);
+    }
+}
+
+/* Statistics for GType instance counts are defined the first time we
+ * see a live instance of the type, since we don't know the types up front.
+ * Once defined, a statistic is updated on every collection, going back to
+ * 0 when the type has no live instances left.
+ */
+static void
+instance_count_statistics_callback (ShellPerfLog *perf_log,
+                                    gpointer      data)
+{
+  GHashTable *defined = data;
+  GHashTable *seen;
+  GHashTableIter hash_iter;
+  GVariant *counts;
+  GVariantIter iter;
+  const char *type_name;
+  gpointer key;
+  guint32 count;
+
+  counts = shell_util_get_instance_counts ();
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_variant_iter_init (&iter, counts);
+  while (g_variant_iter_next (&iter, "{&su}", &type_name, &count))
+    {
+      char *name = g_strconcat ("gobject.", type_name, NULL);
+
+      if (!g_hash_table_contains (defined, name))
+        {
+          char *description = g_strdup_printf ("Number of live %s instances", type_name);
+          shell_perf_log_define_statistic (perf_log, name, description, "i");
+          g_hash_table_add (defined, g_strdup (name));
+          g_free (description);
+        }
+
+      shell_perf_log_update_statistic_i (perf_log, name, count);
+      g_hash_table_add (seen, g_hash_table_lookup (defined, name));
+      g_free (name);
+    }
+
+  g_hash_table_iter_init (&hash_iter, defined);
+  while (g_hash_table_iter_next (&hash_iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (seen, key))
+        shell_perf_log_update_statistic_i (perf_log, key, 0);
+    }
+
+  g_hash_table_destroy (seen);
+  g_variant_unref (counts);
+}
+
 static void
 shell_perf_log_init (void)
 {
@@ -245,6 +346,48 @@ shell_perf_log_init (void)
   shell_perf_log_add_statistics_callback (perf_log,
                                           malloc_statistics_callback,
                                           NULL, NULL);
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.textureCacheEntries",
+                                   "Number of textures held by the St texture cache",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.textureCacheSize",
+                                   "Estimated size of the textures held by the St texture cache, in bytes",
+                                   "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.prerenderedTextures",
+                                   "Number of live prerendered theme node backgrounds",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.prerenderedTextureSize",
+                                   "Estimated size of the prerendered theme node backgrounds, in bytes",
+                                   "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.shadowTextures",
+                                   "Number of live blurred shadow textures",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.shadowTextureSize",
+                                   "Estimated size of the blurred shadow textures, in bytes",
+                                   "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.themeNodes",
+                                   "Number of theme nodes interned by the stage's theme context",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.themeNodeSize",
+                                   "Estimated size of the interned theme nodes, in bytes",
+                                   "x");
+
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          st_memory_statistics_callback,
+                                          NULL, NULL);
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          instance_count_statistics_callback,
+                                          g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                                 g_free, NULL),
+                                          (GDestroyNotify) g_hash_table_destroy);
 }
 
 static void
@@ -349,6 +492,8 @@ main (int argc, char **argv)
   GError *error = NULL;
   int ecode;
 
+  shell_startup_trace_init ();
+
   bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
   bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
   textdomain (GETTEXT_PACKAGE);
@@ -372,6 +517,7 @@ main (int argc, char **argv)
   g_setenv ("NO_AT_BRIDGE", "1", TRUE);
   meta_init ();
   g_unsetenv ("NO_AT_BRIDGE");
+  shell_startup_trace_mark ("metaInit");
 
   /* FIXME: Add gjs API to set this stuff and don't depend on the
    * environment.  These propagate to child processes.
@@ -385,12 +531,14 @@ main (int argc, char **argv)
   shell_prefs_init ();
   shell_introspection_init ();
   shell_fonts_init ();
+  shell_startup_trace_mark ("shellInit");
 
   /* Initialize the global object */
   if (session_mode == NULL)
     session_mode = is_gdm_mode ? "gdm" : "user";
 
   _shell_global_init ("session-mode", session_mode, NULL);
+  shell_startup_trace_mark ("globalInit");
 
   ecode = meta_run ();
 
@@ -93,6 +93,9 @@ G_DEFINE_TYPE_WITH_CODE (ShellDesktopDirInfo, shell_desktop_dir_info, G_TYPE_OBJ
 G_LOCK_DEFINE_STATIC (shell_desktop_env);
 static gchar *shell_desktop_env = NULL;
 
+static GHashTable *get_directories_index        (void);
+static void        invalidate_directories_index (const char *filename);
+
 static gpointer
 search_path_init (gpointer data)
 {
@@ -372,57 +375,13 @@ shell_desktop_dir_info_new_from_filename (const char *filename)
 ShellDesktopDirInfo *
 shell_desktop_dir_info_new (const char *desktop_id)
 {
-  ShellDesktopDirInfo *dirinfo;
-  const char * const *dirs;
-  char *basename;
-  int i;
-
-  dirs = get_directories_search_path ();
-
-  basename = g_strdup (desktop_id);
-  
-  for (i = 0; dirs[i] != NULL; i++)
-    {
-      char *filename;
-      char *p;
+  ShellDesktopDirInfo *cached;
 
-      filename = g_build_filename (dirs[i], desktop_id, NULL);
-      dirinfo = shell_desktop_dir_info_new_from_filename (filename);
-      g_free (filename);
-      if (dirinfo != NULL)
-        goto found;
+  cached = g_hash_table_lookup (get_directories_index (), desktop_id);
+  if (cached == NULL)
+    return NULL;
 
-      p = basename;
-      while ((p = strchr (p, '-')) != NULL)
-        {
-          *p = '/';
-
-          filename = g_build_filename (dirs[i], basename, NULL);
-          dirinfo = shell_desktop_dir_info_new_from_filename (filename);
-          g_free (filename);
-          if (dirinfo != NULL)
-            goto found;
-          *p = '-';
-          p++;
-        }
-    }
-
-  g_free (basename);
-  return NULL;
-
- found:
-  g_free (basename);
-  
-  g_free (dirinfo->desktop_id);
-  dirinfo->desktop_id = g_strdup (desktop_id);
-
-  if (shell_desktop_dir_info_get_is_hidden (dirinfo))
-    {
-      g_object_unref (dirinfo);
-      dirinfo = NULL;
-    }
-  
-  return dirinfo;
+  return SHELL_DESKTOP_DIR_INFO (shell_dir_info_dup (SHELL_DIR_INFO (cached)));
 }
 
 static ShellDirInfo *
@@ -704,6 +663,8 @@ shell_desktop_dir_info_delete (ShellDirInfo *dirinfo)
     { 
       if (g_remove (info->filename) == 0)
         {
+          invalidate_directories_index (info->filename);
+
           g_free (info->filename);
           info->filename = NULL;
           g_free (info->desktop_id);
@@ -762,17 +723,143 @@ shell_desktop_dir_info_iface_init (ShellDirInfoIface *iface)
   iface->get_display_name = shell_desktop_dir_info_get_display_name;
 }
 
+/* The index of desktop directories maps each desktop id to the entry that
+ * takes precedence for it, or to %NULL when that entry is hidden. It is
+ * built the first time it's needed, and rebuilt when one of the scanned
+ * directories changes; the entries are then only parsed again for the
+ * files whose modification time changed.
+ *
+ * The entries in the index are never handed out directly, only copies.
+ */
+typedef struct {
+  gint64 mtime;
+  ShellDesktopDirInfo *info;
+} ParsedFile;
+
+static GHashTable *index_entries = NULL;
+static GHashTable *index_parsed_files = NULL;
+static GHashTable *index_monitors = NULL;
+static gboolean index_valid = FALSE;
+
+static void
+parsed_file_free (ParsedFile *parsed)
+{
+  g_clear_object (&parsed->info);
+  g_slice_free (ParsedFile, parsed);
+}
+
+static void
+index_entry_free (gpointer data)
+{
+  if (data != NULL)
+    g_object_unref (data);
+}
+
+/* Also forgets the parsed contents of @filename, if given, for changes we
+ * make ourselves, which may happen within the resolution of the mtime */
+static void
+invalidate_directories_index (const char *filename)
+{
+  index_valid = FALSE;
+
+  if (filename != NULL && index_parsed_files != NULL)
+    g_hash_table_remove (index_parsed_files, filename);
+}
+
+static void
+on_directory_changed (GFileMonitor      *monitor,
+                      GFile             *file,
+                      GFile             *other_file,
+                      GFileMonitorEvent  event_type,
+                      gpointer           user_data)
+{
+  invalidate_directories_index (NULL);
+}
+
+static void
+watch_directory (GHashTable *monitors,
+                 const char *dirname)
+{
+  GFileMonitor *monitor;
+  GFile *file;
+
+  if (g_hash_table_contains (monitors, dirname))
+    return;
+
+  monitor = index_monitors ? g_hash_table_lookup (index_monitors, dirname) : NULL;
+  if (monitor != NULL)
+    {
+      g_object_ref (monitor);
+    }
+  else
+    {
+      file = g_file_new_for_path (dirname);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+      g_object_unref (file);
+
+      if (monitor == NULL)
+        return;
+
+      g_signal_connect (monitor, "changed",
+                        G_CALLBACK (on_directory_changed), NULL);
+    }
+
+  g_hash_table_insert (monitors, g_strdup (dirname), monitor);
+}
+
+static ShellDesktopDirInfo *
+get_parsed_file (GHashTable *parsed_files,
+                 const char *filename,
+                 const char *desktop_id)
+{
+  ParsedFile *previous = NULL;
+  ParsedFile *parsed;
+  GStatBuf buf;
+
+  if (g_stat (filename, &buf) != 0)
+    return NULL;
+
+  if (index_parsed_files != NULL)
+    previous = g_hash_table_lookup (index_parsed_files, filename);
+
+  parsed = g_slice_new0 (ParsedFile);
+  parsed->mtime = buf.st_mtime;
+
+  if (previous != NULL && previous->mtime == parsed->mtime)
+    {
+      if (previous->info != NULL)
+        parsed->info = g_object_ref (previous->info);
+    }
+  else
+    {
+      parsed->info = shell_desktop_dir_info_new_from_filename (filename);
+
+      if (parsed->info != NULL)
+        {
+          g_free (parsed->info->desktop_id);
+          parsed->info->desktop_id = g_strdup (desktop_id);
+        }
+    }
+
+  g_hash_table_insert (parsed_files, g_strdup (filename), parsed);
+
+  return parsed->info;
+}
+
 static void
-get_entries_from_dir (GHashTable *entries, 
-                      const char *dirname, 
+get_entries_from_dir (GHashTable *entries,
+                      GHashTable *parsed_files,
+                      GHashTable *monitors,
+                      const char *dirname,
                       const char *prefix)
 {
   GDir *dir;
   const char *basename;
   char *filename, *subprefix, *desktop_id;
-  gboolean hidden;
   ShellDesktopDirInfo *dirinfo;
-  
+
+  watch_directory (monitors, dirname);
+
   dir = g_dir_open (dirname, 0, NULL);
   if (dir)
     {
@@ -786,36 +873,27 @@ get_entries_from_dir (GHashTable *entries,
               /* Use _extended so we catch NULLs too (hidden) */
               if (!g_hash_table_lookup_extended (entries, desktop_id, NULL, NULL))
                 {
-                  dirinfo = shell_desktop_dir_info_new_from_filename (filename);
-                  hidden = FALSE;
+                  dirinfo = get_parsed_file (parsed_files, filename, desktop_id);
 
                   if (dirinfo && shell_desktop_dir_info_get_is_hidden (dirinfo))
-                    {
-                      g_object_unref (dirinfo);
-                      dirinfo = NULL;
-                      hidden = TRUE;
-                    }
-                                      
-                  if (dirinfo || hidden)
-                    {
-                      g_hash_table_insert (entries, g_strdup (desktop_id), dirinfo);
-
-                      if (dirinfo)
-                        {
-                          /* Reuse instead of strdup here */
-                          dirinfo->desktop_id = desktop_id;
-                          desktop_id = NULL;
-                        }
-                    }
+                    g_hash_table_insert (entries, desktop_id, NULL);
+                  else if (dirinfo)
+                    g_hash_table_insert (entries, desktop_id, g_object_ref (dirinfo));
+                  else
+                    g_free (desktop_id);
+                }
+              else
+                {
+                  g_free (desktop_id);
                 }
-              g_free (desktop_id);
             }
           else
             {
               if (g_file_test (filename, G_FILE_TEST_IS_DIR))
                 {
                   subprefix = g_strconcat (prefix, basename, "-", NULL);
-                  get_entries_from_dir (entries, filename, subprefix);
+                  get_entries_from_dir (entries, parsed_files, monitors,
+                                        filename, subprefix);
                   g_free (subprefix);
                 }
             }
@@ -825,6 +903,47 @@ get_entries_from_dir (GHashTable *entries,
     }
 }
 
+static GHashTable *
+get_directories_index (void)
+{
+  const char * const *dirs;
+  GHashTable *parsed_files, *monitors;
+  int i;
+
+  if (index_valid)
+    return index_entries;
+
+  dirs = get_directories_search_path ();
+
+  if (index_entries != NULL)
+    g_hash_table_destroy (index_entries);
+
+  index_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, index_entry_free);
+  parsed_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) parsed_file_free);
+  monitors = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                    g_free, (GDestroyNotify) g_object_unref);
+
+  /* Set this first, so that changes that happen while we are scanning
+   * invalidate the new index */
+  index_valid = TRUE;
+
+  for (i = 0; dirs[i] != NULL; i++)
+    get_entries_from_dir (index_entries, parsed_files, monitors, dirs[i], "");
+
+  /* Whatever is left from the previous index belongs to files and
+   * directories that went away */
+  if (index_parsed_files != NULL)
+    g_hash_table_destroy (index_parsed_files);
+  if (index_monitors != NULL)
+    g_hash_table_destroy (index_monitors);
+
+  index_parsed_files = parsed_files;
+  index_monitors = monitors;
+
+  return index_entries;
+}
 
 /**
  * shell_dir_info_get_all:
@@ -844,33 +963,18 @@ get_entries_from_dir (GHashTable *entries,
 GList *
 shell_dir_info_get_all (void)
 {
-  const char * const *dirs;
-  GHashTable *entries;
   GHashTableIter iter;
   gpointer value;
-  int i;
   GList *infos;
 
-  dirs = get_directories_search_path ();
-
-  entries = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                   g_free, NULL);
-
-  
-  for (i = 0; dirs[i] != NULL; i++)
-    get_entries_from_dir (entries, dirs[i], "");
-
-
   infos = NULL;
-  g_hash_table_iter_init (&iter, entries);
+  g_hash_table_iter_init (&iter, get_directories_index ());
   while (g_hash_table_iter_next (&iter, NULL, &value))
     {
       if (value)
-        infos = g_list_prepend (infos, value);
+        infos = g_list_prepend (infos, shell_dir_info_dup (value));
     }
 
-  g_hash_table_destroy (entries);
-
   return g_list_reverse (infos);
 }
 
@@ -956,6 +1060,14 @@ shell_desktop_dir_info_create_custom_with_name (ShellDesktopDirInfo *info,
   if (info->keyfile == NULL)
     return TRUE;
 
+  /* the keyfile is shared with the entry in the index of directories,
+   * and with all the other copies of it, so change a copy of our own */
+  buf = g_key_file_to_data (info->keyfile, &len, NULL);
+  g_key_file_unref (info->keyfile);
+  info->keyfile = g_key_file_new ();
+  g_key_file_load_from_data (info->keyfile, buf, len, G_KEY_FILE_NONE, NULL);
+  g_free (buf);
+
   /* remove all translated 'Name' keys */
   keys = g_key_file_get_keys (info->keyfile,
                               G_KEY_FILE_DESKTOP_GROUP,
@@ -1018,6 +1130,7 @@ shell_desktop_dir_info_create_custom_with_name (ShellDesktopDirInfo *info,
                                 NULL);
 
   g_file_set_contents (user_path, buf, len, &internal_error);
+  invalidate_directories_index (user_path);
   if (internal_error != NULL)
     {
       g_propagate_error (error, internal_error);
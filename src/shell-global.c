@@ -35,6 +35,7 @@
 #include "shell-enum-types.h"
 #include "shell-global-private.h"
 #include "shell-perf-log.h"
+#include "shell-startup-trace.h"
 #include "shell-window-tracker.h"
 #include "shell-wm.h"
 #include "st.h"
@@ -299,9 +300,11 @@ shell_global_init (ShellGlobal *global)
       search_path[0] = g_strdup ("resource:///org/gnome/shell");
     }
 
+  shell_startup_trace_begin ("gjsContext");
   global->js_context = g_object_new (GJS_TYPE_CONTEXT,
                                      "search-path", search_path,
                                      NULL);
+  shell_startup_trace_end ("gjsContext");
 
   g_strfreev (search_path);
 }
@@ -60,9 +60,6 @@ struct _ShellGridDesaturateEffect
   gint factor_uniform;
   gint unshaded_uniform;
 
-  gint tex_width;
-  gint tex_height;
-
   gboolean unshaded_uniform_dirty;
 
   CoglPipeline *pipeline;
@@ -120,7 +117,6 @@ static void update_unshaded_uniform (ShellGridDesaturateEffect *self);
 static gboolean
 shell_grid_desaturate_effect_pre_paint (ClutterEffect *effect)
 {
-  ShellGridDesaturateEffect *self = SHELL_GRID_DESATURATE_EFFECT (effect);
   ClutterEffectClass *parent_class;
 
   if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)))
@@ -139,27 +135,14 @@ shell_grid_desaturate_effect_pre_paint (ClutterEffect *effect)
     }
 
   parent_class = CLUTTER_EFFECT_CLASS (shell_grid_desaturate_effect_parent_class);
-  if (parent_class->pre_paint (effect))
-    {
-      ClutterOffscreenEffect *offscreen_effect =
-        CLUTTER_OFFSCREEN_EFFECT (effect);
-      CoglHandle texture;
-
-      texture = clutter_offscreen_effect_get_texture (offscreen_effect);
-      self->tex_width = cogl_texture_get_width (texture);
-      self->tex_height = cogl_texture_get_height (texture);
-
-      if (self->unshaded_uniform_dirty)
-        update_unshaded_uniform (self);
-
-      cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
-
-      return TRUE;
-    }
-  else
-    return FALSE;
+  return parent_class->pre_paint (effect);
 }
 
+/* While the grid isn't redrawn (e.g. while only the factor or the
+ * unshaded rectangle are animated), ClutterOffscreenEffect skips
+ * pre_paint() and only calls this to paint the texture it already has,
+ * so all the state for painting it has to be set up here.
+ */
 static void
 shell_grid_desaturate_effect_paint_target (ClutterOffscreenEffect *effect)
 {
@@ -168,6 +151,9 @@ shell_grid_desaturate_effect_paint_target (ClutterOffscreenEffect *effect)
   CoglHandle texture;
   guint8 paint_opacity;
 
+  if (self->unshaded_uniform_dirty)
+    update_unshaded_uniform (self);
+
   texture = clutter_offscreen_effect_get_texture (effect);
   cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
 
@@ -0,0 +1,1178 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include "shell-icon-grid-model.h"
+#include <string.h>
+
+#include <json-glib/json-glib.h>
+
+#include "shell-app-system.h"
+
+/**
+ * SECTION:shell-icon-grid-model
+ * @short_description: The layout of the desktop icon grid
+ *
+ * #ShellIconGridModel keeps the folders of the desktop icon grid and the
+ * icons in each of them, as stored in a #GSettings key of type a{sas}.
+ * Every icon is indexed by id, so that finding out whether an icon is on
+ * the desktop, and where, doesn't need to go through all the folders.
+ *
+ * When the setting changes, only the folders whose contents differ are
+ * reported with #ShellIconGridModel::folder-changed. An empty setting
+ * stands for the default layout, which is read from JSON files in a
+ * thread. Until the first layout is in, #ShellIconGridModel:loaded is
+ * %FALSE, the model is empty, and icons repositioned meanwhile are
+ * moved once it is loaded.
+ */
+
+#define DESKTOP_GRID_ID "desktop"
+#define DIRECTORY_EXT ".directory"
+#define LEGACY_APP_PREFIX "eos-app-"
+
+#define DEFAULT_CONFIG_NAME_BASE "icon-grid"
+#define OVERRIDE_CONFIG_NAME_BASE "icon-grid"
+#define PREPEND_CONFIG_NAME_BASE "icon-grid-prepend"
+#define APPEND_CONFIG_NAME_BASE "icon-grid-append"
+
+enum {
+  FOLDER_CHANGED,
+  CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+enum {
+  PROP_0,
+
+  PROP_LOADED,
+
+  PROP_LAST
+};
+
+static GParamSpec *props[PROP_LAST] = { NULL, };
+
+typedef struct {
+  char *id;
+  char *insert_id;
+  char *folder_id;
+} PendingReposition;
+
+typedef struct {
+  char *id;
+  GPtrArray *icons;
+  /* icon id -> index + 1, built the first time it's needed */
+  GHashTable *positions;
+} IconFolder;
+
+struct _ShellIconGridModelPrivate {
+  GSettings *settings;
+  char *key;
+  char *defaults_dir;
+  char *image_defaults_dir;
+
+  /* IconFolder, in the order they are stored in */
+  GPtrArray *folders;
+  GHashTable *folders_by_id;
+  /* icon id -> the IconFolder it is in */
+  GHashTable *icon_folders;
+
+  /* stored icon id -> the id it is shown with */
+  GHashTable *normalized_ids;
+
+  GPtrArray *defaults;
+  GCancellable *defaults_cancellable;
+
+  gboolean loaded;
+  /* PendingReposition, made before the first layout was in */
+  GPtrArray *pending_repositions;
+};
+
+G_DEFINE_TYPE (ShellIconGridModel, shell_icon_grid_model, G_TYPE_OBJECT);
+
+static IconFolder *
+icon_folder_new (const char *id)
+{
+  IconFolder *folder;
+
+  folder = g_slice_new0 (IconFolder);
+  folder->id = g_strdup (id);
+  folder->icons = g_ptr_array_new_with_free_func (g_free);
+
+  return folder;
+}
+
+static void
+icon_folder_free (IconFolder *folder)
+{
+  g_free (folder->id);
+  g_ptr_array_unref (folder->icons);
+  if (folder->positions != NULL)
+    g_hash_table_unref (folder->positions);
+
+  g_slice_free (IconFolder, folder);
+}
+
+static PendingReposition *
+pending_reposition_new (const char *id,
+                        const char *insert_id,
+                        const char *folder_id)
+{
+  PendingReposition *pending = g_slice_new (PendingReposition);
+
+  pending->id = g_strdup (id);
+  pending->insert_id = g_strdup (insert_id);
+  pending->folder_id = g_strdup (folder_id);
+
+  return pending;
+}
+
+static void
+pending_reposition_free (PendingReposition *pending)
+{
+  g_free (pending->id);
+  g_free (pending->insert_id);
+  g_free (pending->folder_id);
+  g_slice_free (PendingReposition, pending);
+}
+
+static void
+icon_folder_invalidate_positions (IconFolder *folder)
+{
+  g_clear_pointer (&folder->positions, g_hash_table_unref);
+}
+
+static int
+icon_folder_get_position (IconFolder *folder,
+                          const char *id)
+{
+  guint i;
+
+  if (folder->positions == NULL)
+    {
+      folder->positions = g_hash_table_new (g_str_hash, g_str_equal);
+
+      /* Go backwards, so that the first copy of a duplicated id wins */
+      for (i = folder->icons->len; i > 0; i--)
+        g_hash_table_insert (folder->positions,
+                             g_ptr_array_index (folder->icons, i - 1),
+                             GUINT_TO_POINTER (i));
+    }
+
+  return GPOINTER_TO_INT (g_hash_table_lookup (folder->positions, id)) - 1;
+}
+
+static gboolean
+icon_folder_equal (IconFolder *a,
+                   IconFolder *b)
+{
+  guint i;
+
+  if (a->icons->len != b->icons->len)
+    return FALSE;
+
+  for (i = 0; i < a->icons->len; i++)
+    if (strcmp (g_ptr_array_index (a->icons, i),
+                g_ptr_array_index (b->icons, i)) != 0)
+      return FALSE;
+
+  return TRUE;
+}
+
+static GPtrArray *
+tree_new (void)
+{
+  return g_ptr_array_new_with_free_func ((GDestroyNotify) icon_folder_free);
+}
+
+static gboolean
+icon_is_folder (const char *id)
+{
+  return g_str_has_suffix (id, DIRECTORY_EXT);
+}
+
+static const char *
+normalize_icon_id (ShellIconGridModel *self,
+                   const char         *id)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  ShellApp *app;
+  char *normalized;
+
+  normalized = g_hash_table_lookup (priv->normalized_ids, id);
+  if (normalized != NULL)
+    return normalized;
+
+  /* Some older versions of eos-app-store incorrectly added eos-app-*.desktop
+   * files to the icon grid layout, instead of the proper unprefixed .desktop
+   * files, which should never leak out of the shell. Some apps also have
+   * their name superseded, for instance gedit -> org.gnome.gedit, and we
+   * want the new name, not the old one.
+   */
+  if (g_str_has_prefix (id, LEGACY_APP_PREFIX))
+    {
+      normalized = g_strdup (id + strlen (LEGACY_APP_PREFIX));
+    }
+  else
+    {
+      app = shell_app_system_lookup_alias (shell_app_system_get_default (), id);
+      normalized = g_strdup (app != NULL ? shell_app_get_id (app) : id);
+    }
+
+  g_hash_table_insert (priv->normalized_ids, g_strdup (id), normalized);
+
+  return normalized;
+}
+
+static GPtrArray *
+tree_new_from_variant (ShellIconGridModel *self,
+                       GVariant           *layout)
+{
+  GPtrArray *tree;
+  GVariantIter iter, *icons_iter;
+  const char *folder_id, *icon_id;
+  IconFolder *folder;
+
+  tree = tree_new ();
+
+  g_variant_iter_init (&iter, layout);
+  while (g_variant_iter_next (&iter, "{&sas}", &folder_id, &icons_iter))
+    {
+      folder = icon_folder_new (folder_id);
+
+      while (g_variant_iter_next (icons_iter, "&s", &icon_id))
+        g_ptr_array_add (folder->icons,
+                         g_strdup (normalize_icon_id (self, icon_id)));
+
+      g_variant_iter_free (icons_iter);
+      g_ptr_array_add (tree, folder);
+    }
+
+  return tree;
+}
+
+/* Copies @defaults, which hold the ids as found in the JSON files */
+static GPtrArray *
+tree_new_from_defaults (ShellIconGridModel *self,
+                        GPtrArray          *defaults)
+{
+  GPtrArray *tree;
+  IconFolder *default_folder, *folder;
+  guint i, j;
+
+  tree = tree_new ();
+
+  for (i = 0; i < defaults->len; i++)
+    {
+      default_folder = g_ptr_array_index (defaults, i);
+      folder = icon_folder_new (default_folder->id);
+
+      for (j = 0; j < default_folder->icons->len; j++)
+        g_ptr_array_add (folder->icons,
+                         g_strdup (normalize_icon_id (self,
+                                                      g_ptr_array_index (default_folder->icons, j))));
+
+      g_ptr_array_add (tree, folder);
+    }
+
+  return tree;
+}
+
+static void
+rebuild_index (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  IconFolder *folder;
+  const char *icon_id;
+  guint i, j;
+
+  g_hash_table_remove_all (priv->folders_by_id);
+  g_hash_table_remove_all (priv->icon_folders);
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      folder = g_ptr_array_index (priv->folders, i);
+
+      if (!g_hash_table_contains (priv->folders_by_id, folder->id))
+        g_hash_table_insert (priv->folders_by_id, folder->id, folder);
+
+      for (j = 0; j < folder->icons->len; j++)
+        {
+          icon_id = g_ptr_array_index (folder->icons, j);
+          if (!g_hash_table_contains (priv->icon_folders, icon_id))
+            g_hash_table_insert (priv->icon_folders, g_strdup (icon_id), folder);
+        }
+    }
+}
+
+/* Points @id to the first folder it is in, as rebuild_index() does,
+ * since it may be in more than one */
+static void
+reindex_icon (ShellIconGridModel *self,
+              const char         *id)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  IconFolder *folder;
+  guint i;
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      folder = g_ptr_array_index (priv->folders, i);
+      if (icon_folder_get_position (folder, id) != -1)
+        {
+          g_hash_table_insert (priv->icon_folders, g_strdup (id), folder);
+          return;
+        }
+    }
+
+  g_hash_table_remove (priv->icon_folders, id);
+}
+
+static void
+emit_changes (ShellIconGridModel *self,
+              GPtrArray          *changed)
+{
+  guint i;
+
+  if (changed->len > 0)
+    {
+      for (i = 0; i < changed->len; i++)
+        g_signal_emit (self, signals[FOLDER_CHANGED], 0,
+                       g_ptr_array_index (changed, i));
+
+      g_signal_emit (self, signals[CHANGED], 0);
+    }
+
+  g_ptr_array_unref (changed);
+}
+
+/* Takes @tree as the new layout, and reports the folders that changed */
+static void
+apply_tree (ShellIconGridModel *self,
+            GPtrArray          *tree)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  GHashTable *new_ids;
+  GPtrArray *changed;
+  IconFolder *folder, *old_folder;
+  GPtrArray *icons;
+  GHashTable *positions;
+  guint i;
+
+  changed = g_ptr_array_new_with_free_func (g_free);
+  new_ids = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (i = 0; i < tree->len; i++)
+    {
+      folder = g_ptr_array_index (tree, i);
+      g_hash_table_add (new_ids, folder->id);
+
+      old_folder = g_hash_table_lookup (priv->folders_by_id, folder->id);
+      if (old_folder != NULL && icon_folder_equal (old_folder, folder))
+        {
+          /* Keep the positions we already know about */
+          icons = folder->icons;
+          positions = folder->positions;
+          folder->icons = old_folder->icons;
+          folder->positions = old_folder->positions;
+          old_folder->icons = icons;
+          old_folder->positions = positions;
+        }
+      else
+        {
+          g_ptr_array_add (changed, g_strdup (folder->id));
+        }
+    }
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      old_folder = g_ptr_array_index (priv->folders, i);
+      if (!g_hash_table_contains (new_ids, old_folder->id))
+        g_ptr_array_add (changed, g_strdup (old_folder->id));
+    }
+
+  g_hash_table_unref (new_ids);
+
+  g_ptr_array_unref (priv->folders);
+  priv->folders = tree;
+  rebuild_index (self);
+
+  emit_changes (self, changed);
+}
+
+/* Called after each layout is applied; the first time, catches up with
+ * the icons repositioned while there was none */
+static void
+set_loaded (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  GPtrArray *pending;
+  PendingReposition *reposition;
+  guint i;
+
+  if (priv->loaded)
+    return;
+
+  priv->loaded = TRUE;
+
+  pending = priv->pending_repositions;
+  priv->pending_repositions = NULL;
+
+  for (i = 0; i < pending->len; i++)
+    {
+      reposition = g_ptr_array_index (pending, i);
+      shell_icon_grid_model_reposition_icon (self, reposition->id,
+                                             reposition->insert_id,
+                                             reposition->folder_id);
+    }
+
+  g_ptr_array_unref (pending);
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_LOADED]);
+}
+
+static void
+write_layout (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  GVariantBuilder builder;
+  IconFolder *folder;
+  guint i, j;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sas}"));
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      folder = g_ptr_array_index (priv->folders, i);
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("{sas}"));
+      g_variant_builder_add (&builder, "s", folder->id);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+      for (j = 0; j < folder->icons->len; j++)
+        g_variant_builder_add (&builder, "s", g_ptr_array_index (folder->icons, j));
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+
+  g_settings_set_value (priv->settings, priv->key,
+                        g_variant_builder_end (&builder));
+}
+
+/* Returns the first file named @base-<language>.json in @dir, for the
+ * languages of the user, as a JSON object */
+static JsonObject *
+load_config (const char   *dir,
+             const char   *base,
+             GCancellable *cancellable)
+{
+  const char * const *languages;
+  JsonParser *parser;
+  JsonNode *root;
+  JsonObject *config = NULL;
+  GError *error = NULL;
+  char *basename, *path, *contents;
+  gsize length;
+  int i;
+
+  languages = g_get_language_names ();
+
+  for (i = 0; languages[i] != NULL; i++)
+    {
+      if (strchr (languages[i], '.') != NULL)
+        continue;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        return NULL;
+
+      basename = g_strdup_printf ("%s-%s.json", base, languages[i]);
+      path = g_build_filename (dir, basename, NULL);
+      g_free (basename);
+
+      if (!g_file_get_contents (path, &contents, &length, NULL))
+        {
+          g_free (path);
+          continue;
+        }
+
+      parser = json_parser_new ();
+      if (!json_parser_load_from_data (parser, contents, length, &error))
+        {
+          g_warning ("Unable to parse %s: %s", path, error->message);
+          g_error_free (error);
+        }
+      else
+        {
+          root = json_parser_get_root (parser);
+          if (root != NULL && JSON_NODE_HOLDS_OBJECT (root))
+            config = json_object_ref (json_node_get_object (root));
+          else
+            g_warning ("Unable to parse %s: not a JSON object", path);
+        }
+
+      g_object_unref (parser);
+      g_free (contents);
+      g_free (path);
+
+      return config;
+    }
+
+  return NULL;
+}
+
+static void
+add_config_icons (IconFolder *folder,
+                  JsonObject *config)
+{
+  JsonNode *node, *element;
+  JsonArray *array;
+  guint i;
+
+  if (config == NULL || !json_object_has_member (config, folder->id))
+    return;
+
+  node = json_object_get_member (config, folder->id);
+  if (!JSON_NODE_HOLDS_ARRAY (node))
+    return;
+
+  array = json_node_get_array (node);
+  for (i = 0; i < json_array_get_length (array); i++)
+    {
+      element = json_array_get_element (array, i);
+      if (JSON_NODE_HOLDS_VALUE (element) &&
+          json_node_get_value_type (element) == G_TYPE_STRING)
+        g_ptr_array_add (folder->icons, g_strdup (json_node_get_string (element)));
+    }
+}
+
+static GPtrArray *
+read_defaults (ShellIconGridModel *self,
+               GCancellable       *cancellable)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  JsonObject *base, *override, *prepend, *append, *layout;
+  GPtrArray *defaults;
+  IconFolder *folder;
+  GList *members, *l;
+
+  base = load_config (priv->defaults_dir, DEFAULT_CONFIG_NAME_BASE, cancellable);
+  override = load_config (priv->image_defaults_dir, OVERRIDE_CONFIG_NAME_BASE, cancellable);
+  prepend = load_config (priv->image_defaults_dir, PREPEND_CONFIG_NAME_BASE, cancellable);
+  append = load_config (priv->image_defaults_dir, APPEND_CONFIG_NAME_BASE, cancellable);
+
+  /* If any image default override matches the user's locale,
+   * give that priority over the default from the base OS */
+  layout = override != NULL ? override : base;
+
+  defaults = tree_new ();
+
+  if (layout != NULL)
+    {
+      members = json_object_get_members (layout);
+      for (l = members; l != NULL; l = l->next)
+        {
+          folder = icon_folder_new (l->data);
+          add_config_icons (folder, prepend);
+          add_config_icons (folder, layout);
+          add_config_icons (folder, append);
+          g_ptr_array_add (defaults, folder);
+        }
+      g_list_free (members);
+    }
+
+  if (defaults->len == 0)
+    {
+      g_warning ("No icon grid defaults found!");
+
+      /* At the minimum, put in something that avoids errors later */
+      g_ptr_array_add (defaults, icon_folder_new (DESKTOP_GRID_ID));
+    }
+
+  g_clear_pointer (&base, json_object_unref);
+  g_clear_pointer (&override, json_object_unref);
+  g_clear_pointer (&prepend, json_object_unref);
+  g_clear_pointer (&append, json_object_unref);
+
+  return defaults;
+}
+
+static void
+load_defaults_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  g_task_return_pointer (task,
+                         read_defaults (SHELL_ICON_GRID_MODEL (source_object),
+                                        cancellable),
+                         (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+load_defaults_cb (GObject      *source,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  ShellIconGridModel *self = SHELL_ICON_GRID_MODEL (source);
+  ShellIconGridModelPrivate *priv = self->priv;
+  GPtrArray *defaults;
+
+  /* Fails only when cancelled, once the layout isn't empty anymore */
+  defaults = g_task_propagate_pointer (G_TASK (res), NULL);
+  if (defaults == NULL)
+    return;
+
+  g_clear_object (&priv->defaults_cancellable);
+  priv->defaults = defaults;
+
+  apply_tree (self, tree_new_from_defaults (self, priv->defaults));
+  set_loaded (self);
+}
+
+static void
+load_defaults (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  GTask *task;
+
+  if (priv->defaults != NULL)
+    {
+      apply_tree (self, tree_new_from_defaults (self, priv->defaults));
+      set_loaded (self);
+      return;
+    }
+
+  if (priv->defaults_cancellable != NULL)
+    return;
+
+  /* The layout we had, if any, stays in place while they are read */
+  priv->defaults_cancellable = g_cancellable_new ();
+
+  task = g_task_new (self, priv->defaults_cancellable, load_defaults_cb, NULL);
+  g_task_run_in_thread (task, load_defaults_thread);
+  g_object_unref (task);
+}
+
+static void
+update_layout (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  GVariant *layout, *desktop;
+
+  layout = g_settings_get_value (priv->settings, priv->key);
+
+  if (g_variant_n_children (layout) == 0)
+    {
+      /* Entirely empty indicates that we need to read in the defaults */
+      g_variant_unref (layout);
+      load_defaults (self);
+      return;
+    }
+
+  if (priv->defaults_cancellable != NULL)
+    {
+      g_cancellable_cancel (priv->defaults_cancellable);
+      g_clear_object (&priv->defaults_cancellable);
+    }
+
+  desktop = g_variant_lookup_value (layout, DESKTOP_GRID_ID, NULL);
+  if (desktop == NULL)
+    {
+      /* Missing toplevel desktop ID indicates we are reading a
+       * corrupted setting. Reset grid to defaults, which will
+       * bring us back here with an empty layout */
+      g_message ("Corrupted %s detected, resetting to defaults", priv->key);
+      g_variant_unref (layout);
+      g_settings_reset (priv->settings, priv->key);
+      return;
+    }
+
+  g_variant_unref (desktop);
+
+  apply_tree (self, tree_new_from_variant (self, layout));
+  g_variant_unref (layout);
+
+  set_loaded (self);
+}
+
+static void
+on_settings_changed (GSettings  *settings,
+                     const char *key,
+                     gpointer    user_data)
+{
+  update_layout (SHELL_ICON_GRID_MODEL (user_data));
+}
+
+static void
+on_installed_changed (ShellAppSystem *app_system,
+                      gpointer        user_data)
+{
+  ShellIconGridModel *self = SHELL_ICON_GRID_MODEL (user_data);
+
+  /* Aliases may resolve to other apps now */
+  g_hash_table_remove_all (self->priv->normalized_ids);
+}
+
+static void
+shell_icon_grid_model_init (ShellIconGridModel *self)
+{
+  ShellIconGridModelPrivate *priv;
+
+  self->priv = priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+                                                   SHELL_TYPE_ICON_GRID_MODEL,
+                                                   ShellIconGridModelPrivate);
+
+  priv->folders = tree_new ();
+  priv->folders_by_id = g_hash_table_new (g_str_hash, g_str_equal);
+  priv->icon_folders = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, NULL);
+  priv->normalized_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, g_free);
+  priv->pending_repositions =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) pending_reposition_free);
+}
+
+static void
+shell_icon_grid_model_dispose (GObject *object)
+{
+  ShellIconGridModel *self = SHELL_ICON_GRID_MODEL (object);
+  ShellIconGridModelPrivate *priv = self->priv;
+
+  if (priv->defaults_cancellable != NULL)
+    {
+      g_cancellable_cancel (priv->defaults_cancellable);
+      g_clear_object (&priv->defaults_cancellable);
+    }
+
+  if (priv->settings != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (priv->settings, on_settings_changed, self);
+      g_signal_handlers_disconnect_by_func (shell_app_system_get_default (),
+                                            on_installed_changed, self);
+      g_clear_object (&priv->settings);
+    }
+
+  G_OBJECT_CLASS (shell_icon_grid_model_parent_class)->dispose (object);
+}
+
+static void
+shell_icon_grid_model_finalize (GObject *object)
+{
+  ShellIconGridModel *self = SHELL_ICON_GRID_MODEL (object);
+  ShellIconGridModelPrivate *priv = self->priv;
+
+  g_hash_table_destroy (priv->folders_by_id);
+  g_hash_table_destroy (priv->icon_folders);
+  g_hash_table_destroy (priv->normalized_ids);
+  g_ptr_array_unref (priv->folders);
+  if (priv->defaults != NULL)
+    g_ptr_array_unref (priv->defaults);
+  if (priv->pending_repositions != NULL)
+    g_ptr_array_unref (priv->pending_repositions);
+
+  g_free (priv->key);
+  g_free (priv->defaults_dir);
+  g_free (priv->image_defaults_dir);
+
+  G_OBJECT_CLASS (shell_icon_grid_model_parent_class)->finalize (object);
+}
+
+static void
+shell_icon_grid_model_get_property (GObject    *object,
+                                    guint       prop_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+  ShellIconGridModel *self = SHELL_ICON_GRID_MODEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_LOADED:
+      g_value_set_boolean (value, self->priv->loaded);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_icon_grid_model_class_init (ShellIconGridModelClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->get_property = shell_icon_grid_model_get_property;
+  gobject_class->dispose = shell_icon_grid_model_dispose;
+  gobject_class->finalize = shell_icon_grid_model_finalize;
+
+  /**
+   * ShellIconGridModel:loaded:
+   *
+   * Whether the layout has been read. Until then, the model has no
+   * folders and no icons.
+   */
+  props[PROP_LOADED] = g_param_spec_boolean ("loaded",
+                                             "Loaded",
+                                             "Whether the layout has been read",
+                                             FALSE,
+                                             G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (gobject_class, PROP_LAST, props);
+
+  /**
+   * ShellIconGridModel::folder-changed:
+   * @model: the #ShellIconGridModel
+   * @folder_id: the id of the folder
+   *
+   * Emitted when the icons in a folder changed, or when the folder
+   * was added or removed.
+   */
+  signals[FOLDER_CHANGED] = g_signal_new ("folder-changed",
+                                          SHELL_TYPE_ICON_GRID_MODEL,
+                                          G_SIGNAL_RUN_LAST,
+                                          0,
+                                          NULL, NULL, NULL,
+                                          G_TYPE_NONE, 1,
+                                          G_TYPE_STRING);
+
+  /**
+   * ShellIconGridModel::changed:
+   * @model: the #ShellIconGridModel
+   *
+   * Emitted once after a change to the layout, following the
+   * #ShellIconGridModel::folder-changed signals for it.
+   */
+  signals[CHANGED] = g_signal_new ("changed",
+                                   SHELL_TYPE_ICON_GRID_MODEL,
+                                   G_SIGNAL_RUN_LAST,
+                                   0,
+                                   NULL, NULL, NULL,
+                                   G_TYPE_NONE, 0);
+
+  g_type_class_add_private (gobject_class, sizeof (ShellIconGridModelPrivate));
+}
+
+/**
+ * shell_icon_grid_model_new:
+ * @settings: the #GSettings the layout is stored in
+ * @key: the key of the layout in @settings, of type a{sas}
+ * @defaults_dir: the directory of the default layouts of the OS
+ * @image_defaults_dir: the directory of the default layouts of the
+ *   image, which override or extend the ones of the OS
+ *
+ * Returns: (transfer full): a new #ShellIconGridModel
+ */
+ShellIconGridModel *
+shell_icon_grid_model_new (GSettings  *settings,
+                           const char *key,
+                           const char *defaults_dir,
+                           const char *image_defaults_dir)
+{
+  ShellIconGridModel *self;
+  ShellIconGridModelPrivate *priv;
+  char *detailed_signal;
+
+  self = g_object_new (SHELL_TYPE_ICON_GRID_MODEL, NULL);
+  priv = self->priv;
+
+  priv->settings = g_object_ref (settings);
+  priv->key = g_strdup (key);
+  priv->defaults_dir = g_strdup (defaults_dir);
+  priv->image_defaults_dir = g_strdup (image_defaults_dir);
+
+  detailed_signal = g_strconcat ("changed::", key, NULL);
+  g_signal_connect (settings, detailed_signal,
+                    G_CALLBACK (on_settings_changed), self);
+  g_free (detailed_signal);
+
+  g_signal_connect (shell_app_system_get_default (), "installed-changed",
+                    G_CALLBACK (on_installed_changed), self);
+
+  update_layout (self);
+
+  return self;
+}
+
+/**
+ * shell_icon_grid_model_get_loaded:
+ * @model: a #ShellIconGridModel
+ *
+ * Returns: the value of #ShellIconGridModel:loaded
+ */
+gboolean
+shell_icon_grid_model_get_loaded (ShellIconGridModel *model)
+{
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), FALSE);
+
+  return model->priv->loaded;
+}
+
+/**
+ * shell_icon_grid_model_has_icon:
+ * @model: a #ShellIconGridModel
+ * @id: the id of an app or a folder
+ *
+ * Returns: %TRUE if @id is in any folder of the layout
+ */
+gboolean
+shell_icon_grid_model_has_icon (ShellIconGridModel *model,
+                                const char         *id)
+{
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), FALSE);
+
+  return id != NULL && g_hash_table_contains (model->priv->icon_folders, id);
+}
+
+/**
+ * shell_icon_grid_model_get_icon_folder:
+ * @model: a #ShellIconGridModel
+ * @id: the id of an app or a folder
+ *
+ * Returns: (allow-none): the id of the folder @id is in, or %NULL
+ */
+const char *
+shell_icon_grid_model_get_icon_folder (ShellIconGridModel *model,
+                                       const char         *id)
+{
+  IconFolder *folder;
+
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), NULL);
+  g_return_val_if_fail (id != NULL, NULL);
+
+  folder = g_hash_table_lookup (model->priv->icon_folders, id);
+
+  return folder != NULL ? folder->id : NULL;
+}
+
+/**
+ * shell_icon_grid_model_get_icon_position:
+ * @model: a #ShellIconGridModel
+ * @id: the id of an app or a folder
+ *
+ * Returns: the position of @id in its folder, or -1
+ */
+int
+shell_icon_grid_model_get_icon_position (ShellIconGridModel *model,
+                                         const char         *id)
+{
+  IconFolder *folder;
+
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), -1);
+  g_return_val_if_fail (id != NULL, -1);
+
+  folder = g_hash_table_lookup (model->priv->icon_folders, id);
+  if (folder == NULL)
+    return -1;
+
+  return icon_folder_get_position (folder, id);
+}
+
+/**
+ * shell_icon_grid_model_get_icons:
+ * @model: a #ShellIconGridModel
+ * @folder_id: the id of a folder
+ *
+ * Returns: (transfer full): the icons in @folder_id, in order
+ */
+char **
+shell_icon_grid_model_get_icons (ShellIconGridModel *model,
+                                 const char         *folder_id)
+{
+  IconFolder *folder;
+  char **icons;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), NULL);
+  g_return_val_if_fail (folder_id != NULL, NULL);
+
+  folder = g_hash_table_lookup (model->priv->folders_by_id, folder_id);
+  if (folder == NULL)
+    return g_new0 (char *, 1);
+
+  icons = g_new (char *, folder->icons->len + 1);
+  for (i = 0; i < folder->icons->len; i++)
+    icons[i] = g_strdup (g_ptr_array_index (folder->icons, i));
+  icons[i] = NULL;
+
+  return icons;
+}
+
+/**
+ * shell_icon_grid_model_list_applications:
+ * @model: a #ShellIconGridModel
+ *
+ * Returns: (transfer full): the ids of all the apps in the layout
+ */
+char **
+shell_icon_grid_model_list_applications (ShellIconGridModel *model)
+{
+  ShellIconGridModelPrivate *priv;
+  GPtrArray *apps;
+  IconFolder *folder;
+  const char *icon_id;
+  guint i, j;
+
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), NULL);
+
+  priv = model->priv;
+  apps = g_ptr_array_new ();
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      folder = g_ptr_array_index (priv->folders, i);
+
+      for (j = 0; j < folder->icons->len; j++)
+        {
+          icon_id = g_ptr_array_index (folder->icons, j);
+          if (!icon_is_folder (icon_id))
+            g_ptr_array_add (apps, g_strdup (icon_id));
+        }
+    }
+
+  g_ptr_array_add (apps, NULL);
+
+  return (char **) g_ptr_array_free (apps, FALSE);
+}
+
+static void
+remove_folder (ShellIconGridModel *self,
+               const char         *folder_id)
+{
+  ShellIconGridModelPrivate *priv = self->priv;
+  IconFolder *folder;
+  GPtrArray *icons;
+  guint i;
+
+  folder = g_hash_table_lookup (priv->folders_by_id, folder_id);
+  if (folder == NULL)
+    return;
+
+  /* The folder frees its icons, which may also be in other folders */
+  icons = g_ptr_array_ref (folder->icons);
+
+  g_hash_table_remove (priv->folders_by_id, folder_id);
+  g_ptr_array_remove (priv->folders, folder);
+
+  for (i = 0; i < priv->folders->len; i++)
+    {
+      folder = g_ptr_array_index (priv->folders, i);
+      if (strcmp (folder->id, folder_id) == 0)
+        {
+          g_hash_table_insert (priv->folders_by_id, folder->id, folder);
+          break;
+        }
+    }
+
+  for (i = 0; i < icons->len; i++)
+    reindex_icon (self, g_ptr_array_index (icons, i));
+
+  g_ptr_array_unref (icons);
+}
+
+/**
+ * shell_icon_grid_model_reposition_icon:
+ * @model: a #ShellIconGridModel
+ * @id: the id of an app or a folder
+ * @insert_id: (allow-none): the icon to put @id before, or %NULL to
+ *   put it at the end
+ * @folder_id: (allow-none): the folder to put @id in, or %NULL to
+ *   remove it from the layout
+ *
+ * Moves @id to a new place in the layout, adding it if it wasn't in
+ * it, and stores the layout.
+ *
+ * @insert_id is an id rather than a position since the layout includes
+ * all the apps the desktop may have, some of which may not be shown.
+ *
+ * Before the layout is loaded, @id is moved once it is.
+ *
+ * Returns: %FALSE if @folder_id isn't in the layout; %TRUE if it is,
+ *   or if the layout isn't loaded yet
+ */
+gboolean
+shell_icon_grid_model_reposition_icon (ShellIconGridModel *model,
+                                       const char         *id,
+                                       const char         *insert_id,
+                                       const char         *folder_id)
+{
+  ShellIconGridModelPrivate *priv;
+  IconFolder *old_folder, *new_folder = NULL, *folder;
+  GPtrArray *changed;
+  int position;
+
+  g_return_val_if_fail (SHELL_IS_ICON_GRID_MODEL (model), FALSE);
+  g_return_val_if_fail (id != NULL, FALSE);
+
+  priv = model->priv;
+
+  if (!priv->loaded)
+    {
+      g_ptr_array_add (priv->pending_repositions,
+                       pending_reposition_new (id, insert_id, folder_id));
+      return TRUE;
+    }
+
+  if (folder_id != NULL)
+    {
+      new_folder = g_hash_table_lookup (priv->folders_by_id, folder_id);
+      if (new_folder == NULL)
+        return FALSE;
+    }
+
+  changed = g_ptr_array_new_with_free_func (g_free);
+
+  old_folder = g_hash_table_lookup (priv->icon_folders, id);
+  if (old_folder != NULL)
+    {
+      position = icon_folder_get_position (old_folder, id);
+      icon_folder_invalidate_positions (old_folder);
+      g_ptr_array_remove_index (old_folder->icons, position);
+
+      g_ptr_array_add (changed, g_strdup (old_folder->id));
+    }
+
+  if (new_folder != NULL)
+    {
+      position = -1;
+      if (insert_id != NULL)
+        position = icon_folder_get_position (new_folder, insert_id);
+
+      /* We were dropped to the left of the trashcan,
+       * or we were asked to append */
+      if (position == -1)
+        position = new_folder->icons->len;
+
+      icon_folder_invalidate_positions (new_folder);
+      g_ptr_array_insert (new_folder->icons, position, g_strdup (id));
+
+      if (new_folder != old_folder)
+        g_ptr_array_add (changed, g_strdup (new_folder->id));
+
+      /* We're adding a folder, which needs a place for its contents */
+      if (icon_is_folder (id) && old_folder == NULL &&
+          !g_hash_table_contains (priv->folders_by_id, id))
+        {
+          folder = icon_folder_new (id);
+          g_ptr_array_add (priv->folders, folder);
+          g_hash_table_insert (priv->folders_by_id, folder->id, folder);
+
+          g_ptr_array_add (changed, g_strdup (id));
+        }
+    }
+  else if (icon_is_folder (id) && old_folder != NULL)
+    {
+      /* We're removing a folder, along with its contents */
+      remove_folder (model, id);
+
+      g_ptr_array_add (changed, g_strdup (id));
+    }
+
+  reindex_icon (model, id);
+
+  /* The notification for our own change finds nothing new */
+  write_layout (model);
+
+  emit_changes (model, changed);
+
+  return TRUE;
+}
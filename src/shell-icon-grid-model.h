@@ -0,0 +1,53 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_ICON_GRID_MODEL_H__
+#define __SHELL_ICON_GRID_MODEL_H__
+
+#include <gio/gio.h>
+
+#define SHELL_TYPE_ICON_GRID_MODEL                 (shell_icon_grid_model_get_type ())
+#define SHELL_ICON_GRID_MODEL(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), SHELL_TYPE_ICON_GRID_MODEL, ShellIconGridModel))
+#define SHELL_ICON_GRID_MODEL_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_ICON_GRID_MODEL, ShellIconGridModelClass))
+#define SHELL_IS_ICON_GRID_MODEL(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SHELL_TYPE_ICON_GRID_MODEL))
+#define SHELL_IS_ICON_GRID_MODEL_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_ICON_GRID_MODEL))
+#define SHELL_ICON_GRID_MODEL_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_ICON_GRID_MODEL, ShellIconGridModelClass))
+
+typedef struct _ShellIconGridModel ShellIconGridModel;
+typedef struct _ShellIconGridModelClass ShellIconGridModelClass;
+typedef struct _ShellIconGridModelPrivate ShellIconGridModelPrivate;
+
+struct _ShellIconGridModel
+{
+  GObject parent;
+
+  ShellIconGridModelPrivate *priv;
+};
+
+struct _ShellIconGridModelClass
+{
+  GObjectClass parent_class;
+};
+
+GType               shell_icon_grid_model_get_type          (void) G_GNUC_CONST;
+ShellIconGridModel *shell_icon_grid_model_new               (GSettings          *settings,
+                                                             const char         *key,
+                                                             const char         *defaults_dir,
+                                                             const char         *image_defaults_dir);
+
+gboolean            shell_icon_grid_model_get_loaded        (ShellIconGridModel *model);
+
+gboolean            shell_icon_grid_model_has_icon          (ShellIconGridModel *model,
+                                                             const char         *id);
+const char         *shell_icon_grid_model_get_icon_folder   (ShellIconGridModel *model,
+                                                             const char         *id);
+int                 shell_icon_grid_model_get_icon_position (ShellIconGridModel *model,
+                                                             const char         *id);
+char              **shell_icon_grid_model_get_icons         (ShellIconGridModel *model,
+                                                             const char         *folder_id);
+char              **shell_icon_grid_model_list_applications (ShellIconGridModel *model);
+
+gboolean            shell_icon_grid_model_reposition_icon   (ShellIconGridModel *model,
+                                                             const char         *id,
+                                                             const char         *insert_id,
+                                                             const char         *folder_id);
+
+#endif /* __SHELL_ICON_GRID_MODEL_H__ */
@@ -0,0 +1,790 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-magnifier-view
+ * @short_description: A magnified view of part of the stage
+ *
+ * #ShellMagnifierView paints a rectangle of its source actor (normally
+ * the group holding the whole UI) scaled to fill its allocation, with
+ * the magnifier's color adjustments applied.
+ *
+ * Rather than painting a scaled clone of the whole source, it paints
+ * the source once into an offscreen buffer the size of the visible
+ * rectangle, and draws that buffer magnified with a single shader that
+ * does the brightness, contrast, lightness inversion and desaturation
+ * together. The buffer is only repainted when something inside the
+ * rectangle was damaged, or the rectangle moved.
+ */
+
+#include "config.h"
+
+#define COGL_ENABLE_EXPERIMENTAL_API
+#define CLUTTER_ENABLE_EXPERIMENTAL_API
+
+#include <math.h>
+
+#include "shell-magnifier-view.h"
+
+#include <cogl/cogl.h>
+
+struct _ShellMagnifierViewPrivate {
+  ClutterActor *source;
+  guint source_redraw_id;
+
+  /* The rectangle of the source that is shown, in stage coordinates */
+  float region_x;
+  float region_y;
+  float region_width;
+  float region_height;
+
+  /* Last known paint box of each actor that queued a redraw in the
+   * source, so that we notice when one moves out of the region */
+  GHashTable *damage_boxes;
+
+  CoglHandle texture;
+  CoglHandle offscreen;
+  int offscreen_x;
+  int offscreen_y;
+
+  CoglPipeline *pipeline;
+  gint invert_uniform;
+  gint desaturation_uniform;
+  gint brightness_multiplier_uniform;
+  gint brightness_offset_uniform;
+  gint contrast_uniform;
+
+  gboolean invert_lightness;
+  gdouble color_saturation;
+  float brightness[3];
+  float contrast[3];
+
+  guint dirty : 1;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_SOURCE,
+  PROP_INVERT_LIGHTNESS,
+  PROP_COLOR_SATURATION
+};
+
+G_DEFINE_TYPE (ShellMagnifierView, shell_magnifier_view, CLUTTER_TYPE_ACTOR);
+
+/* The same adjustments, and in the same order, as the effects the
+ * magnifier used to stack on its clone: #ClutterDesaturateEffect, then
+ * #ClutterBrightnessContrastEffect, then #ShellInvertLightnessEffect,
+ * on premultiplied colors.
+ */
+static const gchar *color_adjust_declarations =
+  "uniform float invert;\n"
+  "uniform float desaturation;\n"
+  "uniform vec3 brightness_multiplier;\n"
+  "uniform vec3 brightness_offset;\n"
+  "uniform vec3 contrast;\n";
+
+static const gchar *color_adjust_source =
+  "cogl_texel = texture2D (cogl_sampler, cogl_tex_coord.st);\n"
+  "vec3 effect = vec3 (cogl_texel);\n"
+  "\n"
+  "vec3 gray = vec3 (dot (vec3 (0.299, 0.587, 0.114), effect));\n"
+  "effect = mix (effect, gray, desaturation);\n"
+  "\n"
+  "effect = effect * brightness_multiplier +\n"
+  "         brightness_offset * cogl_texel.a;\n"
+  "effect = (effect - 0.5 * cogl_texel.a) * contrast +\n"
+  "         0.5 * cogl_texel.a;\n"
+  "\n"
+  "float maxColor = max (effect.r, max (effect.g, effect.b));\n"
+  "float minColor = min (effect.r, min (effect.g, effect.b));\n"
+  "float lightness = (maxColor + minColor) / 2.0;\n"
+  "\n"
+  "float delta = (1.0 - lightness) - lightness;\n"
+  "effect = (effect + delta * invert);\n"
+  "\n"
+  "cogl_texel = vec4 (effect, cogl_texel.a);\n";
+
+static void
+update_uniforms (ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+  float multiplier[3], offset[3], contrast[3];
+  int i;
+
+  for (i = 0; i < 3; i++)
+    {
+      if (priv->brightness[i] > 0.0)
+        {
+          multiplier[i] = 1.0 - priv->brightness[i];
+          offset[i] = priv->brightness[i];
+        }
+      else
+        {
+          multiplier[i] = 1.0 + priv->brightness[i];
+          offset[i] = 0.0;
+        }
+
+      contrast[i] = tan ((priv->contrast[i] + 1) * G_PI_4);
+    }
+
+  if (priv->invert_uniform > -1)
+    cogl_pipeline_set_uniform_1f (priv->pipeline, priv->invert_uniform,
+                                  priv->invert_lightness ? 1.0 : 0.0);
+  if (priv->desaturation_uniform > -1)
+    cogl_pipeline_set_uniform_1f (priv->pipeline, priv->desaturation_uniform,
+                                  1.0 - priv->color_saturation);
+  if (priv->brightness_multiplier_uniform > -1)
+    cogl_pipeline_set_uniform_float (priv->pipeline, priv->brightness_multiplier_uniform,
+                                     3, 1, multiplier);
+  if (priv->brightness_offset_uniform > -1)
+    cogl_pipeline_set_uniform_float (priv->pipeline, priv->brightness_offset_uniform,
+                                     3, 1, offset);
+  if (priv->contrast_uniform > -1)
+    cogl_pipeline_set_uniform_float (priv->pipeline, priv->contrast_uniform,
+                                     3, 1, contrast);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+}
+
+static gboolean
+box_intersects_region (ShellMagnifierView    *self,
+                       const ClutterActorBox *box)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  return (box->x1 < priv->region_x + priv->region_width &&
+          box->x2 > priv->region_x &&
+          box->y1 < priv->region_y + priv->region_height &&
+          box->y2 > priv->region_y);
+}
+
+static void
+get_region_pixels (ShellMagnifierView    *self,
+                   cairo_rectangle_int_t *rect)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  rect->x = floorf (priv->region_x);
+  rect->y = floorf (priv->region_y);
+  rect->width = ceilf (priv->region_x + priv->region_width) - rect->x;
+  rect->height = ceilf (priv->region_y + priv->region_height) - rect->y;
+}
+
+/* Painting the source walks the MetaWindowGroup in it, which culls the
+ * windows outside of the stage's redraw clip even when painting into
+ * our buffer, so a repaint of the buffer is only complete in a stage
+ * redraw that covers the whole region. Along with our own redraw, this
+ * queues one of the region on the stage.
+ */
+static void
+queue_source_repaint (ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+  ClutterActor *stage;
+  cairo_rectangle_int_t rect;
+
+  priv->dirty = TRUE;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (self));
+  if (stage == NULL || priv->region_width <= 0 || priv->region_height <= 0)
+    return;
+
+  get_region_pixels (self, &rect);
+  clutter_actor_queue_redraw_with_clip (stage, &rect);
+}
+
+static gboolean
+region_in_redraw_clip (ShellMagnifierView *self)
+{
+  ClutterActor *stage;
+  cairo_rectangle_int_t clip, rect;
+
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (self));
+  clutter_stage_get_redraw_clip_bounds (CLUTTER_STAGE (stage), &clip);
+  get_region_pixels (self, &rect);
+
+  return (rect.x >= clip.x && rect.y >= clip.y &&
+          rect.x + rect.width <= clip.x + clip.width &&
+          rect.y + rect.height <= clip.y + clip.height);
+}
+
+static void
+on_damaged_actor_finalized (gpointer  data,
+                            GObject  *where_the_object_was)
+{
+  ShellMagnifierView *self = data;
+
+  g_hash_table_remove (self->priv->damage_boxes, where_the_object_was);
+}
+
+static void
+forget_damage_box (gpointer key,
+                   gpointer value,
+                   gpointer data)
+{
+  g_object_weak_unref (key, on_damaged_actor_finalized, data);
+}
+
+static void
+on_source_queue_redraw (ClutterActor       *source,
+                        ClutterActor       *origin,
+                        ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+  ClutterActorBox box, *old_box;
+  gboolean damaged;
+
+  old_box = g_hash_table_lookup (priv->damage_boxes, origin);
+
+  if (!clutter_actor_get_paint_box (origin, &box))
+    {
+      damaged = TRUE;
+
+      if (old_box)
+        {
+          g_object_weak_unref (G_OBJECT (origin), on_damaged_actor_finalized, self);
+          g_hash_table_remove (priv->damage_boxes, origin);
+        }
+    }
+  else
+    {
+      /* Without knowing where the actor was painted before, we have
+       * to assume it was inside the region */
+      damaged = (old_box == NULL ||
+                 box_intersects_region (self, old_box) ||
+                 box_intersects_region (self, &box));
+
+      if (old_box == NULL)
+        {
+          g_object_weak_ref (G_OBJECT (origin), on_damaged_actor_finalized, self);
+          g_hash_table_insert (priv->damage_boxes, origin,
+                               clutter_actor_box_copy (&box));
+        }
+      else
+        *old_box = box;
+    }
+
+  if (damaged)
+    queue_source_repaint (self);
+}
+
+static void
+clear_offscreen (ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  if (priv->offscreen != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->offscreen);
+      priv->offscreen = COGL_INVALID_HANDLE;
+    }
+
+  if (priv->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->texture);
+      priv->texture = COGL_INVALID_HANDLE;
+    }
+}
+
+static gboolean
+ensure_offscreen (ShellMagnifierView *self,
+                  int                 width,
+                  int                 height)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  if (priv->texture != COGL_INVALID_HANDLE &&
+      cogl_texture_get_width (priv->texture) == (guint) width &&
+      cogl_texture_get_height (priv->texture) == (guint) height)
+    return TRUE;
+
+  clear_offscreen (self);
+
+  priv->texture = cogl_texture_new_with_size (width, height,
+                                              COGL_TEXTURE_NO_SLICING,
+                                              COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  if (priv->texture == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  priv->offscreen = cogl_offscreen_new_to_texture (priv->texture);
+  if (priv->offscreen == COGL_INVALID_HANDLE)
+    {
+      clear_offscreen (self);
+      return FALSE;
+    }
+
+  cogl_pipeline_set_layer_texture (priv->pipeline, 0, priv->texture);
+  priv->dirty = TRUE;
+
+  return TRUE;
+}
+
+/* Paints the source into the offscreen buffer with the transformation
+ * it has on the stage, offset so that the region lands on the buffer;
+ * everything outside of it is clipped by the buffer's edges.
+ */
+static void
+paint_source (ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+  ClutterActor *stage;
+  CoglMatrix projection, modelview;
+  CoglColor clear_color;
+  float stage_width, stage_height;
+  float x, y;
+
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (self));
+  clutter_actor_get_size (stage, &stage_width, &stage_height);
+
+  /* We are painted with the stage's projection, and a modelview that
+   * only adds our position to the stage's */
+  cogl_get_projection_matrix (&projection);
+  cogl_get_modelview_matrix (&modelview);
+  clutter_actor_get_transformed_position (CLUTTER_ACTOR (self), &x, &y);
+  cogl_matrix_translate (&modelview, -x, -y, 0);
+
+  cogl_push_framebuffer (priv->offscreen);
+
+  cogl_framebuffer_set_viewport (priv->offscreen,
+                                 -priv->offscreen_x, -priv->offscreen_y,
+                                 stage_width, stage_height);
+  cogl_set_projection_matrix (&projection);
+  cogl_set_modelview_matrix (&modelview);
+
+  cogl_color_init_from_4ub (&clear_color, 0, 0, 0, 0);
+  cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+
+  clutter_actor_paint (priv->source);
+
+  cogl_pop_framebuffer ();
+}
+
+static void
+shell_magnifier_view_paint (ClutterActor *actor)
+{
+  ShellMagnifierView *self = SHELL_MAGNIFIER_VIEW (actor);
+  ShellMagnifierViewPrivate *priv = self->priv;
+  ClutterActorBox box;
+  guint8 paint_opacity;
+  int x1, y1, x2, y2;
+  float tx1, ty1, tx2, ty2;
+
+  if (priv->source == NULL ||
+      priv->region_width <= 0 || priv->region_height <= 0)
+    return;
+
+  /* Align the buffer with the stage's pixels */
+  x1 = floorf (priv->region_x);
+  y1 = floorf (priv->region_y);
+  x2 = ceilf (priv->region_x + priv->region_width);
+  y2 = ceilf (priv->region_y + priv->region_height);
+
+  if (!ensure_offscreen (self, x2 - x1, y2 - y1))
+    return;
+
+  if (x1 != priv->offscreen_x || y1 != priv->offscreen_y)
+    {
+      priv->offscreen_x = x1;
+      priv->offscreen_y = y1;
+      priv->dirty = TRUE;
+    }
+
+  if (priv->dirty)
+    {
+      paint_source (self);
+
+      /* If windows were culled, paint again in the redraw of the region
+       * we queue; meanwhile, what we have is the best we can show */
+      if (region_in_redraw_clip (self))
+        priv->dirty = FALSE;
+      else
+        queue_source_repaint (self);
+    }
+
+  tx1 = (priv->region_x - x1) / (x2 - x1);
+  ty1 = (priv->region_y - y1) / (y2 - y1);
+  tx2 = tx1 + priv->region_width / (x2 - x1);
+  ty2 = ty1 + priv->region_height / (y2 - y1);
+
+  paint_opacity = clutter_actor_get_paint_opacity (actor);
+  cogl_pipeline_set_color4ub (priv->pipeline,
+                              paint_opacity, paint_opacity,
+                              paint_opacity, paint_opacity);
+
+  clutter_actor_get_allocation_box (actor, &box);
+
+  cogl_push_source (priv->pipeline);
+  cogl_rectangle_with_texture_coords (0, 0, box.x2 - box.x1, box.y2 - box.y1,
+                                      tx1, ty1, tx2, ty2);
+  cogl_pop_source ();
+}
+
+static gboolean
+shell_magnifier_view_get_paint_volume (ClutterActor       *actor,
+                                       ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, actor);
+}
+
+static void
+shell_magnifier_view_set_source (ShellMagnifierView *self,
+                                 ClutterActor       *source)
+{
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  if (priv->source == source)
+    return;
+
+  if (priv->source)
+    {
+      g_signal_handler_disconnect (priv->source, priv->source_redraw_id);
+      priv->source_redraw_id = 0;
+
+      g_object_unref (priv->source);
+      priv->source = NULL;
+    }
+
+  if (source)
+    {
+      priv->source = g_object_ref (source);
+      priv->source_redraw_id = g_signal_connect (source, "queue-redraw",
+                                                 G_CALLBACK (on_source_queue_redraw),
+                                                 self);
+    }
+
+  queue_source_repaint (self);
+}
+
+/**
+ * shell_magnifier_view_new:
+ * @source: the actor to magnify
+ *
+ * Return value: (transfer floating): a new #ShellMagnifierView
+ */
+ClutterActor *
+shell_magnifier_view_new (ClutterActor *source)
+{
+  return g_object_new (SHELL_TYPE_MAGNIFIER_VIEW,
+                       "source", source,
+                       NULL);
+}
+
+/**
+ * shell_magnifier_view_set_region:
+ * @view: a #ShellMagnifierView
+ * @x: left edge of the magnified rectangle, in stage coordinates
+ * @y: top edge of the magnified rectangle
+ * @width: width of the magnified rectangle
+ * @height: height of the magnified rectangle
+ *
+ * Sets the rectangle of the source that @view shows, scaled to fill
+ * its allocation.
+ */
+void
+shell_magnifier_view_set_region (ShellMagnifierView *view,
+                                 float               x,
+                                 float               y,
+                                 float               width,
+                                 float               height)
+{
+  ShellMagnifierViewPrivate *priv;
+
+  g_return_if_fail (SHELL_IS_MAGNIFIER_VIEW (view));
+
+  priv = view->priv;
+
+  if (priv->region_x == x && priv->region_y == y &&
+      priv->region_width == width && priv->region_height == height)
+    return;
+
+  priv->region_x = x;
+  priv->region_y = y;
+  priv->region_width = width;
+  priv->region_height = height;
+
+  queue_source_repaint (view);
+}
+
+void
+shell_magnifier_view_set_invert_lightness (ShellMagnifierView *view,
+                                           gboolean            invert)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_VIEW (view));
+
+  invert = invert != FALSE;
+  if (view->priv->invert_lightness == invert)
+    return;
+
+  view->priv->invert_lightness = invert;
+  update_uniforms (view);
+
+  g_object_notify (G_OBJECT (view), "invert-lightness");
+}
+
+gboolean
+shell_magnifier_view_get_invert_lightness (ShellMagnifierView *view)
+{
+  g_return_val_if_fail (SHELL_IS_MAGNIFIER_VIEW (view), FALSE);
+
+  return view->priv->invert_lightness;
+}
+
+void
+shell_magnifier_view_set_color_saturation (ShellMagnifierView *view,
+                                           gdouble             saturation)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_VIEW (view));
+  g_return_if_fail (saturation >= 0.0 && saturation <= 1.0);
+
+  if (fabs (view->priv->color_saturation - saturation) < 0.00001)
+    return;
+
+  view->priv->color_saturation = saturation;
+  update_uniforms (view);
+
+  g_object_notify (G_OBJECT (view), "color-saturation");
+}
+
+gdouble
+shell_magnifier_view_get_color_saturation (ShellMagnifierView *view)
+{
+  g_return_val_if_fail (SHELL_IS_MAGNIFIER_VIEW (view), 1.0);
+
+  return view->priv->color_saturation;
+}
+
+/**
+ * shell_magnifier_view_set_brightness:
+ * @view: a #ShellMagnifierView
+ * @red: red channel brightness change, between -1.0 and 1.0
+ * @green: green channel brightness change, between -1.0 and 1.0
+ * @blue: blue channel brightness change, between -1.0 and 1.0
+ *
+ * Sets the brightness change of each channel, as with
+ * clutter_brightness_contrast_effect_set_brightness_full().
+ */
+void
+shell_magnifier_view_set_brightness (ShellMagnifierView *view,
+                                     float               red,
+                                     float               green,
+                                     float               blue)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_VIEW (view));
+
+  view->priv->brightness[0] = CLAMP (red, -1.0, 1.0);
+  view->priv->brightness[1] = CLAMP (green, -1.0, 1.0);
+  view->priv->brightness[2] = CLAMP (blue, -1.0, 1.0);
+
+  update_uniforms (view);
+}
+
+/**
+ * shell_magnifier_view_set_contrast:
+ * @view: a #ShellMagnifierView
+ * @red: red channel contrast change, between -1.0 and 1.0
+ * @green: green channel contrast change, between -1.0 and 1.0
+ * @blue: blue channel contrast change, between -1.0 and 1.0
+ *
+ * Sets the contrast change of each channel, as with
+ * clutter_brightness_contrast_effect_set_contrast_full().
+ */
+void
+shell_magnifier_view_set_contrast (ShellMagnifierView *view,
+                                   float               red,
+                                   float               green,
+                                   float               blue)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_VIEW (view));
+
+  view->priv->contrast[0] = CLAMP (red, -1.0, 1.0);
+  view->priv->contrast[1] = CLAMP (green, -1.0, 1.0);
+  view->priv->contrast[2] = CLAMP (blue, -1.0, 1.0);
+
+  update_uniforms (view);
+}
+
+static void
+shell_magnifier_view_set_property (GObject      *object,
+                                   guint         prop_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+  ShellMagnifierView *self = SHELL_MAGNIFIER_VIEW (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      shell_magnifier_view_set_source (self, g_value_get_object (value));
+      break;
+
+    case PROP_INVERT_LIGHTNESS:
+      shell_magnifier_view_set_invert_lightness (self, g_value_get_boolean (value));
+      break;
+
+    case PROP_COLOR_SATURATION:
+      shell_magnifier_view_set_color_saturation (self, g_value_get_double (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_magnifier_view_get_property (GObject    *object,
+                                   guint       prop_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+  ShellMagnifierView *self = SHELL_MAGNIFIER_VIEW (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      g_value_set_object (value, self->priv->source);
+      break;
+
+    case PROP_INVERT_LIGHTNESS:
+      g_value_set_boolean (value, self->priv->invert_lightness);
+      break;
+
+    case PROP_COLOR_SATURATION:
+      g_value_set_double (value, self->priv->color_saturation);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_magnifier_view_dispose (GObject *object)
+{
+  ShellMagnifierView *self = SHELL_MAGNIFIER_VIEW (object);
+  ShellMagnifierViewPrivate *priv = self->priv;
+
+  shell_magnifier_view_set_source (self, NULL);
+
+  if (priv->damage_boxes)
+    {
+      g_hash_table_foreach (priv->damage_boxes, forget_damage_box, self);
+      g_hash_table_destroy (priv->damage_boxes);
+      priv->damage_boxes = NULL;
+    }
+
+  clear_offscreen (self);
+
+  if (priv->pipeline != NULL)
+    {
+      cogl_object_unref (priv->pipeline);
+      priv->pipeline = NULL;
+    }
+
+  G_OBJECT_CLASS (shell_magnifier_view_parent_class)->dispose (object);
+}
+
+static void
+shell_magnifier_view_class_init (ShellMagnifierViewClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+  GParamSpec *pspec;
+
+  gobject_class->set_property = shell_magnifier_view_set_property;
+  gobject_class->get_property = shell_magnifier_view_get_property;
+  gobject_class->dispose = shell_magnifier_view_dispose;
+
+  actor_class->paint = shell_magnifier_view_paint;
+  actor_class->get_paint_volume = shell_magnifier_view_get_paint_volume;
+
+  /**
+   * ShellMagnifierView:source:
+   *
+   * The actor that is magnified. It must not contain the view.
+   */
+  pspec = g_param_spec_object ("source",
+                               "Source",
+                               "The actor that is magnified",
+                               CLUTTER_TYPE_ACTOR,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+  g_object_class_install_property (gobject_class, PROP_SOURCE, pspec);
+
+  /**
+   * ShellMagnifierView:invert-lightness:
+   *
+   * Whether the lightness of the magnified view is inverted.
+   */
+  pspec = g_param_spec_boolean ("invert-lightness",
+                                "Invert lightness",
+                                "Whether the lightness is inverted",
+                                FALSE,
+                                G_PARAM_READWRITE);
+  g_object_class_install_property (gobject_class, PROP_INVERT_LIGHTNESS, pspec);
+
+  /**
+   * ShellMagnifierView:color-saturation:
+   *
+   * The color saturation of the magnified view, between 0.0 (gray)
+   * and 1.0 (unchanged).
+   */
+  pspec = g_param_spec_double ("color-saturation",
+                               "Color saturation",
+                               "The color saturation",
+                               0.0, 1.0,
+                               1.0,
+                               G_PARAM_READWRITE);
+  g_object_class_install_property (gobject_class, PROP_COLOR_SATURATION, pspec);
+
+  g_type_class_add_private (gobject_class, sizeof (ShellMagnifierViewPrivate));
+}
+
+static void
+shell_magnifier_view_init (ShellMagnifierView *self)
+{
+  ShellMagnifierViewPrivate *priv;
+  CoglContext *ctx;
+
+  self->priv = priv = G_TYPE_INSTANCE_GET_PRIVATE (self, SHELL_TYPE_MAGNIFIER_VIEW,
+                                                   ShellMagnifierViewPrivate);
+
+  priv->damage_boxes = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify) clutter_actor_box_free);
+  priv->color_saturation = 1.0;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  priv->pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_null_texture (priv->pipeline, 0, COGL_TEXTURE_TYPE_2D);
+
+  if (clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    {
+      CoglSnippet *snippet;
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                                  color_adjust_declarations,
+                                  NULL);
+      cogl_snippet_set_replace (snippet, color_adjust_source);
+      cogl_pipeline_add_layer_snippet (priv->pipeline, 0, snippet);
+      cogl_object_unref (snippet);
+    }
+  else
+    g_warning ("The graphics hardware or the current GL driver does not "
+               "implement support for the GLSL shading language; the "
+               "magnifier's color adjustments will have no effect.");
+
+  priv->invert_uniform =
+    cogl_pipeline_get_uniform_location (priv->pipeline, "invert");
+  priv->desaturation_uniform =
+    cogl_pipeline_get_uniform_location (priv->pipeline, "desaturation");
+  priv->brightness_multiplier_uniform =
+    cogl_pipeline_get_uniform_location (priv->pipeline, "brightness_multiplier");
+  priv->brightness_offset_uniform =
+    cogl_pipeline_get_uniform_location (priv->pipeline, "brightness_offset");
+  priv->contrast_uniform =
+    cogl_pipeline_get_uniform_location (priv->pipeline, "contrast");
+
+  update_uniforms (self);
+}
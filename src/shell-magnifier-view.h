@@ -0,0 +1,62 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_MAGNIFIER_VIEW_H__
+#define __SHELL_MAGNIFIER_VIEW_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_MAGNIFIER_VIEW                 (shell_magnifier_view_get_type ())
+#define SHELL_MAGNIFIER_VIEW(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), SHELL_TYPE_MAGNIFIER_VIEW, ShellMagnifierView))
+#define SHELL_MAGNIFIER_VIEW_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_MAGNIFIER_VIEW, ShellMagnifierViewClass))
+#define SHELL_IS_MAGNIFIER_VIEW(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SHELL_TYPE_MAGNIFIER_VIEW))
+#define SHELL_IS_MAGNIFIER_VIEW_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_MAGNIFIER_VIEW))
+#define SHELL_MAGNIFIER_VIEW_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_MAGNIFIER_VIEW, ShellMagnifierViewClass))
+
+typedef struct _ShellMagnifierView        ShellMagnifierView;
+typedef struct _ShellMagnifierViewClass   ShellMagnifierViewClass;
+
+typedef struct _ShellMagnifierViewPrivate ShellMagnifierViewPrivate;
+
+struct _ShellMagnifierView
+{
+  ClutterActor parent;
+
+  ShellMagnifierViewPrivate *priv;
+};
+
+struct _ShellMagnifierViewClass
+{
+  ClutterActorClass parent_class;
+};
+
+GType shell_magnifier_view_get_type (void) G_GNUC_CONST;
+
+ClutterActor *shell_magnifier_view_new                  (ClutterActor       *source);
+
+void          shell_magnifier_view_set_region           (ShellMagnifierView *view,
+                                                         float               x,
+                                                         float               y,
+                                                         float               width,
+                                                         float               height);
+
+void          shell_magnifier_view_set_invert_lightness (ShellMagnifierView *view,
+                                                         gboolean            invert);
+gboolean      shell_magnifier_view_get_invert_lightness (ShellMagnifierView *view);
+
+void          shell_magnifier_view_set_color_saturation (ShellMagnifierView *view,
+                                                         gdouble             saturation);
+gdouble       shell_magnifier_view_get_color_saturation (ShellMagnifierView *view);
+
+void          shell_magnifier_view_set_brightness       (ShellMagnifierView *view,
+                                                         float               red,
+                                                         float               green,
+                                                         float               blue);
+void          shell_magnifier_view_set_contrast         (ShellMagnifierView *view,
+                                                         float               red,
+                                                         float               green,
+                                                         float               blue);
+
+G_END_DECLS
+
+#endif /* __SHELL_MAGNIFIER_VIEW_H__ */
@@ -9,12 +9,16 @@
 
 #include "config.h"
 
+#include <errno.h>
+
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 
 #define BUS_NAME "org.gnome.Shell.PerfHelper"
 
 static void destroy_windows           (void);
+static void destroy_desktop_files     (void);
 static void finish_wait_windows       (void);
 static void check_finish_wait_windows (void);
 
@@ -30,6 +34,11 @@ static const gchar introspection_xml[] =
 	  "    </method>"
 	  "    <method name='WaitWindows'/>"
 	  "    <method name='DestroyWindows'/>"
+	  "    <method name='CreateDesktopFiles'>"
+	  "      <arg type='i' name='count' direction='in'/>"
+	  "      <arg type='as' name='desktop_ids' direction='out'/>"
+	  "    </method>"
+	  "    <method name='DestroyDesktopFiles'/>"
 	  "  </interface>"
 	"</node>";
 
@@ -46,10 +55,12 @@ typedef struct {
 } WindowInfo;
 
 static int opt_idle_timeout = 30;
+static char *opt_data_dir = NULL;
 
 static GOptionEntry opt_entries[] =
   {
     { "idle-timeout", 'r', 0, G_OPTION_ARG_INT, &opt_idle_timeout, "Exit after N seconds", "N" },
+    { "data-dir", 'd', 0, G_OPTION_ARG_FILENAME, &opt_data_dir, "Data directory to create test .desktop files in", "DIR" },
     { NULL }
   };
 
@@ -62,6 +73,8 @@ static Atom atom_utf8_string;
 static guint timeout_id;
 static GList *our_windows;
 static GList *wait_windows_invocations;
+static GList *our_desktop_files;
+static int n_desktop_files;
 
 static gboolean
 on_timeout (gpointer data)
@@ -69,6 +82,7 @@ on_timeout (gpointer data)
   timeout_id = 0;
 
   destroy_windows ();
+  destroy_desktop_files ();
   gtk_main_quit ();
 
   return FALSE;
@@ -101,6 +115,95 @@ destroy_windows (void)
   check_finish_wait_windows ();
 }
 
+static void
+destroy_desktop_files (void)
+{
+  GList *l;
+
+  for (l = our_desktop_files; l; l = l->next)
+    {
+      g_unlink (l->data);
+      g_free (l->data);
+    }
+
+  g_list_free (our_desktop_files);
+  our_desktop_files = NULL;
+  n_desktop_files = 0;
+}
+
+/* The shell is started with our data directory in XDG_DATA_DIRS, so
+ * the files we write here get picked up through the normal app-info
+ * monitoring and show up in the app system and in search results.
+ * Names and keywords are varied so that searches match a realistic
+ * subset of them rather than all or none.
+ */
+static gboolean
+create_desktop_files (int              count,
+                      GVariantBuilder *desktop_ids,
+                      GError         **error)
+{
+  static const char * const words[] = {
+    "Chess", "Writer", "Paint", "Music", "Video", "Photo", "Calculator",
+    "Terminal", "Browser", "Mail", "Maps", "Notes", "Weather", "Clock"
+  };
+  char *apps_dir;
+  int i;
+
+  if (opt_data_dir == NULL)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           "No --data-dir was given to the perf helper");
+      return FALSE;
+    }
+
+  apps_dir = g_build_filename (opt_data_dir, "applications", NULL);
+  if (g_mkdir_with_parents (apps_dir, 0755) < 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Can't create %s: %s", apps_dir, g_strerror (errno));
+      g_free (apps_dir);
+      return FALSE;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      int n = n_desktop_files;
+      const char *first = words[n % G_N_ELEMENTS (words)];
+      const char *second = words[(n / G_N_ELEMENTS (words)) % G_N_ELEMENTS (words)];
+      char *basename, *path, *contents;
+
+      basename = g_strdup_printf ("eos-shell-perf-helper-%04d.desktop", n);
+      path = g_build_filename (apps_dir, basename, NULL);
+      contents = g_strdup_printf ("[Desktop Entry]\n"
+                                  "Type=Application\n"
+                                  "Name=%s %s %d\n"
+                                  "Comment=Performance test application %d\n"
+                                  "Keywords=%s;%s;perf;\n"
+                                  "Exec=true\n"
+                                  "Icon=application-x-executable\n",
+                                  first, second, n, n, first, second);
+
+      if (!g_file_set_contents (path, contents, -1, error))
+        {
+          g_free (basename);
+          g_free (contents);
+          g_free (path);
+          g_free (apps_dir);
+          return FALSE;
+        }
+
+      g_free (contents);
+      our_desktop_files = g_list_prepend (our_desktop_files, path);
+      n_desktop_files++;
+
+      g_variant_builder_add (desktop_ids, "s", basename);
+      g_free (basename);
+    }
+
+  g_free (apps_dir);
+  return TRUE;
+}
+
 static gboolean
 on_window_map_event (GtkWidget   *window,
                      GdkEventAny *event,
@@ -232,6 +335,7 @@ handle_method_call (GDBusConnection       *connection,
   if (g_strcmp0 (method_name, "Exit") == 0)
     {
       destroy_windows ();
+      destroy_desktop_files ();
 
       g_dbus_method_invocation_return_value (invocation, NULL);
       g_dbus_connection_flush_sync (connection, NULL, NULL);
@@ -258,6 +362,31 @@ handle_method_call (GDBusConnection       *connection,
       destroy_windows ();
       g_dbus_method_invocation_return_value (invocation, NULL);
     }
+  else if (g_strcmp0 (method_name, "CreateDesktopFiles") == 0)
+    {
+      GVariantBuilder desktop_ids;
+      GError *error = NULL;
+      int count;
+
+      g_variant_get (parameters, "(i)", &count);
+      g_variant_builder_init (&desktop_ids, G_VARIANT_TYPE ("as"));
+
+      if (create_desktop_files (count, &desktop_ids, &error))
+        {
+          g_dbus_method_invocation_return_value (invocation,
+                                                 g_variant_new ("(as)", &desktop_ids));
+        }
+      else
+        {
+          g_variant_builder_clear (&desktop_ids);
+          g_dbus_method_invocation_take_error (invocation, error);
+        }
+    }
+  else if (g_strcmp0 (method_name, "DestroyDesktopFiles") == 0)
+    {
+      destroy_desktop_files ();
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
 }
 
 static const GDBusInterfaceVTable interface_vtable =
@@ -296,6 +425,7 @@ on_name_lost  (GDBusConnection *connection,
 	       gpointer         user_data)
 {
   destroy_windows ();
+  destroy_desktop_files ();
   gtk_main_quit ();
 }
 
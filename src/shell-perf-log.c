@@ -589,12 +589,21 @@ shell_perf_log_update_statistic_x (ShellPerfLog *perf_log,
   statistic->initialized = TRUE;
 }
 
+/**
+ * ShellPerfStatisticsCallback:
+ * @perf_log: the #ShellPerfLog collecting statistics
+ * @data: (closure): data passed to shell_perf_log_add_statistics_callback()
+ *
+ * Called by shell_perf_log_collect_statistics() so the statistic values
+ * can be updated before they are recorded.
+ */
+
 /**
  * shell_perf_log_add_statistics_callback:
  * @perf_log: a #ShellPerfLog
- * @callback: function to call before recording statistics
- * @user_data: data to pass to @callback
- * @notify: function to call when @user_data is no longer needed
+ * @callback: (scope notified): function to call before recording statistics
+ * @user_data: (closure): data to pass to @callback
+ * @notify: (destroy user_data): function to call when @user_data is no longer needed
  *
  * Adds a function that will be called before statistics are recorded.
  * The function would typically compute one or more statistics values
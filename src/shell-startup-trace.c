@@ -0,0 +1,300 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "shell-startup-trace.h"
+#include "shell-perf-log.h"
+#include "shell-util.h"
+
+/**
+ * SECTION:shell-startup-trace
+ * @short_description: Timeline of the shell startup
+ *
+ * The startup trace records when the shell reaches each phase of its
+ * startup, from the start of main() to the first frame the user can
+ * interact with, along with the time taken by nested spans of work
+ * such as importing the UI modules.
+ *
+ * Tracing is disabled unless the SHELL_STARTUP_TRACE environment
+ * variable names a file; in that case the performance log is enabled
+ * from the start of main(), every phase and span is also recorded in
+ * it as a startup.* event, and shell_startup_trace_write_report() writes
+ * the timeline together with the performance log to that file. Each
+ * UI module imported by main.js is recorded as a span, which includes
+ * the modules it is the first to import.
+ *
+ * Times in the timeline are read from the monotonic clock and are
+ * given in microseconds since the start of main().
+ */
+
+typedef struct {
+  char   *name;
+  gint64  start;
+  gint64  duration;
+  gint64  children;
+  guint   depth;
+} ShellStartupRecord;
+
+static gint64   start_time = -1;
+static char    *report_path;
+static GArray  *records;
+static GArray  *open_spans;
+static gboolean report_written;
+
+static void
+clear_record (gpointer data)
+{
+  ShellStartupRecord *record = data;
+
+  g_free (record->name);
+}
+
+static ShellStartupRecord *
+add_record (const char *name,
+            gint64      duration)
+{
+  ShellStartupRecord record;
+
+  record.name = g_strdup (name);
+  record.start = g_get_monotonic_time () - start_time;
+  record.duration = duration;
+  record.children = 0;
+  record.depth = open_spans->len;
+
+  g_array_append_val (records, record);
+
+  return &g_array_index (records, ShellStartupRecord, records->len - 1);
+}
+
+/**
+ * shell_startup_trace_init:
+ *
+ * Defines the startup events in the performance log and, if the
+ * SHELL_STARTUP_TRACE environment variable is set, enables tracing and
+ * records the "main" phase. This should be called first thing in main().
+ */
+void
+shell_startup_trace_init (void)
+{
+  ShellPerfLog *perf_log;
+  const char *path;
+
+  if (start_time >= 0)
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  perf_log = shell_perf_log_get_default ();
+  shell_perf_log_define_event (perf_log, "startup.phase",
+                               "Startup reached the named phase",
+                               "s");
+  shell_perf_log_define_event (perf_log, "startup.spanBegin",
+                               "Startup began the named piece of work",
+                               "s");
+  shell_perf_log_define_event (perf_log, "startup.spanEnd",
+                               "Startup finished the named piece of work",
+                               "s");
+
+  path = g_getenv ("SHELL_STARTUP_TRACE");
+  if (path == NULL || *path == '\0')
+    return;
+
+  report_path = g_strdup (path);
+  records = g_array_new (FALSE, FALSE, sizeof (ShellStartupRecord));
+  g_array_set_clear_func (records, clear_record);
+  open_spans = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  shell_perf_log_set_enabled (perf_log, TRUE);
+  shell_startup_trace_mark ("main");
+}
+
+/**
+ * shell_startup_trace_is_enabled:
+ *
+ * Return value: %TRUE if the startup is being traced and the report
+ *   has not been written yet
+ */
+gboolean
+shell_startup_trace_is_enabled (void)
+{
+  return records != NULL && !report_written;
+}
+
+/**
+ * shell_startup_trace_mark:
+ * @phase: name of the phase that was reached
+ *
+ * Records that the startup reached @phase.
+ */
+void
+shell_startup_trace_mark (const char *phase)
+{
+  if (!shell_startup_trace_is_enabled ())
+    return;
+
+  add_record (phase, -1);
+  shell_perf_log_event_s (shell_perf_log_get_default (),
+                          "startup.phase", phase);
+}
+
+/**
+ * shell_startup_trace_begin:
+ * @name: name of the piece of work
+ *
+ * Records the start of a span of work. Spans nest; each one must be
+ * finished with a matching call to shell_startup_trace_end().
+ */
+void
+shell_startup_trace_begin (const char *name)
+{
+  guint index;
+
+  if (!shell_startup_trace_is_enabled ())
+    return;
+
+  add_record (name, 0);
+  index = records->len - 1;
+  g_array_append_val (open_spans, index);
+
+  shell_perf_log_event_s (shell_perf_log_get_default (),
+                          "startup.spanBegin", name);
+}
+
+/**
+ * shell_startup_trace_end:
+ * @name: name of the piece of work
+ *
+ * Records the end of the innermost span, which must have been
+ * started with the same @name.
+ */
+void
+shell_startup_trace_end (const char *name)
+{
+  ShellStartupRecord *record;
+  guint index;
+
+  if (!shell_startup_trace_is_enabled ())
+    return;
+
+  g_return_if_fail (open_spans->len > 0);
+
+  index = g_array_index (open_spans, guint, open_spans->len - 1);
+  record = &g_array_index (records, ShellStartupRecord, index);
+  g_return_if_fail (strcmp (record->name, name) == 0);
+
+  g_array_set_size (open_spans, open_spans->len - 1);
+  record->duration = g_get_monotonic_time () - start_time - record->start;
+
+  if (open_spans->len > 0)
+    {
+      ShellStartupRecord *parent;
+
+      index = g_array_index (open_spans, guint, open_spans->len - 1);
+      parent = &g_array_index (records, ShellStartupRecord, index);
+      parent->children += record->duration;
+    }
+
+  shell_perf_log_event_s (shell_perf_log_get_default (),
+                          "startup.spanEnd", name);
+}
+
+static gboolean
+write_timeline (GOutputStream  *out,
+                GError        **error)
+{
+  guint i;
+
+  if (!shell_write_string_to_stream (out, "[ ", error))
+    return FALSE;
+
+  for (i = 0; i < records->len; i++)
+    {
+      ShellStartupRecord *record = &g_array_index (records, ShellStartupRecord, i);
+      char *escaped = g_strescape (record->name, NULL);
+      char *entry;
+      gboolean success;
+
+      if (record->duration < 0)
+        entry = g_strdup_printf ("{ \"name\": \"%s\", \"start\": %" G_GINT64_FORMAT " }",
+                                 escaped, record->start);
+      else
+        entry = g_strdup_printf ("{ \"name\": \"%s\", \"start\": %" G_GINT64_FORMAT ", "
+                                 "\"duration\": %" G_GINT64_FORMAT ", "
+                                 "\"self\": %" G_GINT64_FORMAT ", \"depth\": %u }",
+                                 escaped, record->start, record->duration,
+                                 record->duration - record->children, record->depth);
+
+      success = shell_write_string_to_stream (out, i == 0 ? "" : ",\n  ", error) &&
+                shell_write_string_to_stream (out, entry, error);
+
+      g_free (entry);
+      g_free (escaped);
+
+      if (!success)
+        return FALSE;
+    }
+
+  return shell_write_string_to_stream (out, " ]", error);
+}
+
+/**
+ * shell_startup_trace_write_report:
+ * @error: location to store a #GError
+ *
+ * Records the "report" phase and writes the startup timeline and the
+ * contents of the performance log, as JSON, to the file named by the
+ * SHELL_STARTUP_TRACE environment variable. Tracing stops afterwards;
+ * unless a performance script is running, the performance log is
+ * disabled again too, so that the shell doesn't keep on growing it.
+ *
+ * Does nothing if tracing is disabled or the report was already written.
+ *
+ * Return value: %TRUE if the report was written or there was nothing to do
+ */
+gboolean
+shell_startup_trace_write_report (GError **error)
+{
+  ShellPerfLog *perf_log = shell_perf_log_get_default ();
+  GFile *file;
+  GFileOutputStream *raw;
+  GOutputStream *out;
+  gboolean success;
+
+  if (!shell_startup_trace_is_enabled ())
+    return TRUE;
+
+  shell_startup_trace_mark ("report");
+  report_written = TRUE;
+
+  if (g_getenv ("SHELL_PERF_MODULE") == NULL)
+    shell_perf_log_set_enabled (perf_log, FALSE);
+
+  file = g_file_new_for_path (report_path);
+  raw = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+  g_object_unref (file);
+
+  if (raw == NULL)
+    return FALSE;
+
+  out = g_buffered_output_stream_new_sized (G_OUTPUT_STREAM (raw), 4096);
+  g_object_unref (raw);
+
+  success = shell_write_string_to_stream (out, "{\n\"timeline\":\n", error) &&
+            write_timeline (out, error) &&
+            shell_write_string_to_stream (out, ",\n\"events\":\n", error) &&
+            shell_perf_log_dump_events (perf_log, out, error) &&
+            shell_write_string_to_stream (out, ",\n\"log\":\n", error) &&
+            shell_perf_log_dump_log (perf_log, out, error) &&
+            shell_write_string_to_stream (out, "\n}\n", error);
+
+  if (success)
+    success = g_output_stream_close (out, NULL, error);
+  else
+    g_output_stream_close (out, NULL, NULL);
+
+  g_object_unref (out);
+
+  return success;
+}
@@ -0,0 +1,20 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_STARTUP_TRACE_H__
+#define __SHELL_STARTUP_TRACE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void     shell_startup_trace_init         (void);
+gboolean shell_startup_trace_is_enabled   (void);
+
+void     shell_startup_trace_mark         (const char  *phase);
+void     shell_startup_trace_begin        (const char  *name);
+void     shell_startup_trace_end          (const char  *name);
+
+gboolean shell_startup_trace_write_report (GError     **error);
+
+G_END_DECLS
+
+#endif /* __SHELL_STARTUP_TRACE_H__ */
@@ -336,3 +336,47 @@ shell_util_set_locale (const gchar *new_locale)
 {
   setlocale (LC_ALL, new_locale);
 }
+
+static void
+add_instance_counts (GVariantBuilder *builder,
+                     GType            type)
+{
+  const char *name = g_type_name (type);
+  GType *children;
+  guint n_children, i;
+
+  if (g_str_has_prefix (name, "St") || g_str_has_prefix (name, "Shell"))
+    {
+      int count = g_type_get_instance_count (type);
+
+      if (count > 0)
+        g_variant_builder_add (builder, "{su}", name, (guint32) count);
+    }
+
+  children = g_type_children (type, &n_children);
+  for (i = 0; i < n_children; i++)
+    add_instance_counts (builder, children[i]);
+  g_free (children);
+}
+
+/**
+ * shell_util_get_instance_counts:
+ *
+ * Gets the number of live instances of each St and Shell class, for
+ * tracking down leaks. GLib only keeps these counts when the shell is
+ * started with GOBJECT_DEBUG=instance-count in the environment;
+ * otherwise, the result is empty.
+ *
+ * Returns: (transfer full): a #GVariant of type a{su}, mapping type
+ *   names to the number of instances of exactly that type
+ */
+GVariant *
+shell_util_get_instance_counts (void)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{su}"));
+  add_instance_counts (&builder, G_TYPE_OBJECT);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
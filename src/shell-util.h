@@ -46,6 +46,8 @@ void    shell_util_cursor_tracker_to_clutter (MetaCursorTracker *tracker,
 
 void    shell_util_set_locale                (const gchar *new_locale);
 
+GVariant *shell_util_get_instance_counts     (void);
+
 G_END_DECLS
 
 #endif /* __SHELL_UTIL_H__ */
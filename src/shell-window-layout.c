@@ -0,0 +1,728 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-window-layout
+ * @short_description: Arranges window thumbnails in the overview
+ *
+ * #ShellWindowLayout computes the slot (position and scale) of each
+ * window clone of an overview workspace. The layout is cached and only
+ * the parts affected by a change are recomputed: moving or resizing a
+ * window only recomputes the slots within the current rows, resizing
+ * the workspace only recomputes the scale, while adding or removing a
+ * window searches for a new row arrangement. The arrangement can also
+ * be dropped explicitly with shell_window_layout_invalidate().
+ *
+ * The layout is computed by trying increasing numbers of rows, filling
+ * each row with windows in order until it is about as wide as the
+ * total width divided by the number of rows, and keeping the last
+ * arrangement that was an improvement, weighing the scale of the
+ * thumbnails against the fraction of the area they cover.
+ *
+ * Each window gets an individual scale in addition to the scale of the
+ * layout, to keep small windows (like a calculator) from becoming too
+ * small to recognize. Thumbnails are never larger than
+ * %WINDOW_CLONE_MAXIMUM_SCALE; a window which would be is shrunk within
+ * its cell, centered horizontally and aligned to the bottom, so that
+ * the other windows of the layout don't shrink with it.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "shell-window-layout.h"
+
+#define WINDOW_CLONE_MAXIMUM_SCALE 0.7
+
+/* When calculating a layout, we calculate the scale of windows and the
+ * percent of the available area the new layout uses. If the values for
+ * the new layout, when weighted with the values as below, are worse
+ * than the previous layout's, we stop looking for a new layout and use
+ * the previous layout. Otherwise, we keep looking for a new layout.
+ */
+#define LAYOUT_SCALE_WEIGHT 1
+#define LAYOUT_SPACE_WEIGHT 0.1
+
+typedef struct _LayoutWindow LayoutWindow;
+typedef struct _LayoutRow LayoutRow;
+typedef struct _LayoutMetrics LayoutMetrics;
+
+struct _LayoutWindow
+{
+  ClutterActor *actor;
+  guint generation;
+
+  /* Position of the real window, used to order each row so that
+   * thumbnails travel as little as possible */
+  double x;
+  double y;
+  double width;
+  double height;
+
+  double window_scale;
+  double scaled_width;
+  double scaled_height;
+
+  double slot_x;
+  double slot_y;
+  double slot_scale;
+};
+
+struct _LayoutRow
+{
+  guint first_window;
+  guint n_windows;
+
+  /* Unscaled size of the windows in the row, without spacing */
+  double full_width;
+  double full_height;
+
+  /* Scaled size and position of the row, relative to the area;
+   * the width includes the spacing between windows */
+  double x;
+  double y;
+  double width;
+  double height;
+};
+
+struct _LayoutMetrics
+{
+  guint n_rows;
+  guint n_columns;
+  guint max_columns;
+
+  double grid_width;
+  double grid_height;
+
+  double scale;
+  double space;
+};
+
+struct _ShellWindowLayout
+{
+  GObject parent;
+
+  /* LayoutWindow, in the order they are laid out */
+  GPtrArray *windows;
+  GHashTable *windows_by_actor;
+  guint generation;
+
+  /* LayoutWindow, ordered within each row */
+  GPtrArray *placed;
+
+  GArray *rows;
+  GArray *candidate_rows;
+  LayoutMetrics metrics;
+
+  double area_x;
+  double area_y;
+  double area_width;
+  double area_height;
+
+  /* Spacing of the current arrangement, and the one to use for
+   * the next arrangement */
+  double row_spacing;
+  double column_spacing;
+  double pending_row_spacing;
+  double pending_column_spacing;
+
+  double monitor_height;
+
+  guint layout_dirty : 1;
+  guint scale_dirty : 1;
+  guint slots_dirty : 1;
+};
+
+struct _ShellWindowLayoutClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (ShellWindowLayout, shell_window_layout, G_TYPE_OBJECT);
+
+static void
+layout_window_free (LayoutWindow *window)
+{
+  g_object_unref (window->actor);
+  g_slice_free (LayoutWindow, window);
+}
+
+static void
+layout_window_update_scale (ShellWindowLayout *layout,
+                            LayoutWindow      *window)
+{
+  double ratio;
+
+  /* Since we align windows next to each other, the height of the
+   * thumbnails is much more important to preserve than the width of
+   * them, so two windows with equal height, but maybe differing
+   * widths line up.
+   *
+   * Bump up the size of small windows a bit, mapping the height
+   * ratio from [0, 1] to a scale of [1.5, 1].
+   */
+  ratio = layout->monitor_height > 0 ? window->height / layout->monitor_height : 0;
+
+  window->window_scale = 1.5 + (1 - 1.5) * ratio;
+  window->scaled_width = window->width * window->window_scale;
+  window->scaled_height = window->height * window->window_scale;
+}
+
+static void
+shell_window_layout_finalize (GObject *object)
+{
+  ShellWindowLayout *layout = SHELL_WINDOW_LAYOUT (object);
+
+  g_ptr_array_free (layout->placed, TRUE);
+  g_ptr_array_free (layout->windows, TRUE);
+  g_hash_table_destroy (layout->windows_by_actor);
+
+  g_array_free (layout->rows, TRUE);
+  g_array_free (layout->candidate_rows, TRUE);
+
+  G_OBJECT_CLASS (shell_window_layout_parent_class)->finalize (object);
+}
+
+static void
+shell_window_layout_class_init (ShellWindowLayoutClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = shell_window_layout_finalize;
+}
+
+static void
+shell_window_layout_init (ShellWindowLayout *layout)
+{
+  layout->windows = g_ptr_array_new ();
+  layout->windows_by_actor = g_hash_table_new_full (NULL, NULL, NULL,
+                                                    (GDestroyNotify) layout_window_free);
+  layout->placed = g_ptr_array_new ();
+
+  layout->rows = g_array_new (FALSE, TRUE, sizeof (LayoutRow));
+  layout->candidate_rows = g_array_new (FALSE, TRUE, sizeof (LayoutRow));
+
+  layout->layout_dirty = TRUE;
+}
+
+/**
+ * shell_window_layout_new:
+ *
+ * Return value: (transfer full): a new, empty #ShellWindowLayout
+ */
+ShellWindowLayout *
+shell_window_layout_new (void)
+{
+  return g_object_new (SHELL_TYPE_WINDOW_LAYOUT, NULL);
+}
+
+/**
+ * shell_window_layout_set_area:
+ * @layout: a #ShellWindowLayout
+ * @x: left edge of the area to lay windows out in
+ * @y: top edge of the area
+ * @width: width of the area
+ * @height: height of the area
+ *
+ * Sets the area the thumbnails must fit in. Changing it keeps the
+ * current arrangement of windows in rows, and only rescales it.
+ */
+void
+shell_window_layout_set_area (ShellWindowLayout *layout,
+                              double             x,
+                              double             y,
+                              double             width,
+                              double             height)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  if (layout->area_x == x && layout->area_y == y &&
+      layout->area_width == width && layout->area_height == height)
+    return;
+
+  layout->area_x = x;
+  layout->area_y = y;
+  layout->area_width = width;
+  layout->area_height = height;
+
+  layout->scale_dirty = TRUE;
+}
+
+/**
+ * shell_window_layout_set_spacing:
+ * @layout: a #ShellWindowLayout
+ * @row_spacing: vertical space between rows of thumbnails
+ * @column_spacing: horizontal space between thumbnails in a row
+ *
+ * Sets the spacing between thumbnails, which isn't scaled with them.
+ * Like the arrangement in rows, the spacing is only updated when the
+ * windows change or the layout is invalidated.
+ */
+void
+shell_window_layout_set_spacing (ShellWindowLayout *layout,
+                                 double             row_spacing,
+                                 double             column_spacing)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  layout->pending_row_spacing = row_spacing;
+  layout->pending_column_spacing = column_spacing;
+}
+
+/**
+ * shell_window_layout_set_monitor_height:
+ * @layout: a #ShellWindowLayout
+ * @height: height of the monitor the windows are on
+ *
+ * Sets the height windows are compared to when deciding how much
+ * to enlarge small windows.
+ */
+void
+shell_window_layout_set_monitor_height (ShellWindowLayout *layout,
+                                        double             height)
+{
+  guint i;
+
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  if (layout->monitor_height == height)
+    return;
+
+  layout->monitor_height = height;
+
+  for (i = 0; i < layout->windows->len; i++)
+    layout_window_update_scale (layout, g_ptr_array_index (layout->windows, i));
+
+  layout->slots_dirty = TRUE;
+}
+
+/**
+ * shell_window_layout_set_windows:
+ * @layout: a #ShellWindowLayout
+ * @windows: (element-type Clutter.Actor): the window clones to lay out
+ *
+ * Sets the windows to lay out, in order. Windows that were already
+ * part of the layout keep their geometry; new ones must be given one
+ * with shell_window_layout_update_window(). If the set of windows
+ * didn't change, the layout is kept, even if they were reordered.
+ */
+void
+shell_window_layout_set_windows (ShellWindowLayout *layout,
+                                 GList             *windows)
+{
+  GPtrArray *old_windows;
+  gboolean changed = FALSE;
+  GList *l;
+  guint i;
+
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  old_windows = layout->windows;
+  layout->windows = g_ptr_array_sized_new (g_list_length (windows));
+  layout->generation++;
+
+  for (l = windows; l; l = l->next)
+    {
+      ClutterActor *actor = l->data;
+      LayoutWindow *window;
+
+      window = g_hash_table_lookup (layout->windows_by_actor, actor);
+      if (window == NULL)
+        {
+          window = g_slice_new0 (LayoutWindow);
+          window->actor = g_object_ref (actor);
+          g_hash_table_insert (layout->windows_by_actor, actor, window);
+
+          changed = TRUE;
+        }
+
+      window->generation = layout->generation;
+      g_ptr_array_add (layout->windows, window);
+    }
+
+  for (i = 0; i < old_windows->len; i++)
+    {
+      LayoutWindow *window = g_ptr_array_index (old_windows, i);
+
+      if (window->generation != layout->generation)
+        {
+          g_hash_table_remove (layout->windows_by_actor, window->actor);
+          changed = TRUE;
+        }
+    }
+
+  g_ptr_array_free (old_windows, TRUE);
+
+  if (changed)
+    layout->layout_dirty = TRUE;
+}
+
+/**
+ * shell_window_layout_update_window:
+ * @layout: a #ShellWindowLayout
+ * @window: a window clone previously passed to shell_window_layout_set_windows()
+ * @x: horizontal position of the real window
+ * @y: vertical position of the real window
+ * @width: unscaled width of the clone
+ * @height: unscaled height of the clone
+ *
+ * Updates the geometry of @window. The thumbnail is resized within
+ * its current row; the rows are only rearranged for the new size the
+ * next time the windows change or the layout is invalidated.
+ */
+void
+shell_window_layout_update_window (ShellWindowLayout *layout,
+                                   ClutterActor      *window,
+                                   double             x,
+                                   double             y,
+                                   double             width,
+                                   double             height)
+{
+  LayoutWindow *layout_window;
+
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  layout_window = g_hash_table_lookup (layout->windows_by_actor, window);
+  g_return_if_fail (layout_window != NULL);
+
+  if (layout_window->width != width || layout_window->height != height)
+    {
+      layout_window->width = width;
+      layout_window->height = height;
+      layout_window_update_scale (layout, layout_window);
+
+      layout->slots_dirty = TRUE;
+    }
+
+  if (layout_window->x != x || layout_window->y != y)
+    {
+      layout_window->x = x;
+      layout_window->y = y;
+
+      layout->slots_dirty = TRUE;
+    }
+}
+
+/**
+ * shell_window_layout_invalidate:
+ * @layout: a #ShellWindowLayout
+ *
+ * Forces the arrangement of windows in rows to be recomputed, even
+ * if no window was added or removed, for example when the overview is
+ * shown again or a window was resized.
+ */
+void
+shell_window_layout_invalidate (ShellWindowLayout *layout)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  layout->layout_dirty = TRUE;
+}
+
+static gboolean
+keep_same_row (LayoutRow *row,
+               double     width,
+               double     ideal_row_width)
+{
+  double old_ratio, new_ratio;
+
+  if (row->full_width + width <= ideal_row_width)
+    return TRUE;
+
+  old_ratio = row->full_width / ideal_row_width;
+  new_ratio = (row->full_width + width) / ideal_row_width;
+
+  return fabs (1 - new_ratio) < fabs (1 - old_ratio);
+}
+
+static void
+compute_rows (ShellWindowLayout *layout,
+              guint              n_rows,
+              double             total_width,
+              GArray            *rows,
+              LayoutMetrics     *metrics)
+{
+  double ideal_row_width = total_width / n_rows;
+  LayoutRow *max_row = NULL;
+  guint window_idx = 0;
+  guint i;
+
+  g_array_set_size (rows, n_rows);
+  memset (rows->data, 0, n_rows * sizeof (LayoutRow));
+
+  metrics->grid_height = 0;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      LayoutRow *row = &g_array_index (rows, LayoutRow, i);
+
+      row->first_window = window_idx;
+
+      for (; window_idx < layout->windows->len; window_idx++)
+        {
+          LayoutWindow *window = g_ptr_array_index (layout->windows, window_idx);
+
+          row->full_height = MAX (row->full_height, window->scaled_height);
+
+          /* either new width is < idealWidth or new width is nearer
+           * from idealWidth then oldWidth */
+          if (keep_same_row (row, window->scaled_width, ideal_row_width) ||
+              i == n_rows - 1)
+            {
+              row->n_windows++;
+              row->full_width += window->scaled_width;
+            }
+          else
+            break;
+        }
+
+      if (max_row == NULL || row->full_width > max_row->full_width)
+        max_row = row;
+      metrics->grid_height += row->full_height;
+    }
+
+  metrics->n_rows = n_rows;
+  metrics->max_columns = max_row->n_windows;
+  metrics->grid_width = max_row->full_width;
+}
+
+/* Computes the overall scale of the layout, and the fraction of the
+ * area it covers.
+ */
+static void
+compute_scale_and_space (ShellWindowLayout *layout,
+                         LayoutMetrics     *metrics)
+{
+  double hspacing, vspacing;
+  double horizontal_scale, vertical_scale;
+  double scaled_width, scaled_height;
+  double scale;
+
+  hspacing = ((int) metrics->max_columns - 1) * layout->column_spacing;
+  vspacing = ((int) metrics->n_rows - 1) * layout->row_spacing;
+
+  horizontal_scale = (layout->area_width - hspacing) / metrics->grid_width;
+  vertical_scale = (layout->area_height - vspacing) / metrics->grid_height;
+
+  scale = MIN (horizontal_scale, vertical_scale);
+  scale = MIN (scale, WINDOW_CLONE_MAXIMUM_SCALE);
+
+  scaled_width = metrics->grid_width * scale + hspacing;
+  scaled_height = metrics->grid_height * scale + vspacing;
+
+  metrics->scale = scale;
+  metrics->space = (scaled_width * scaled_height) / (layout->area_width * layout->area_height);
+}
+
+static gboolean
+is_better_layout (LayoutMetrics *old_metrics,
+                  LayoutMetrics *new_metrics)
+{
+  double space_power = (new_metrics->space - old_metrics->space) * LAYOUT_SPACE_WEIGHT;
+  double scale_power = (new_metrics->scale - old_metrics->scale) * LAYOUT_SCALE_WEIGHT;
+
+  if (new_metrics->scale > old_metrics->scale && new_metrics->space > old_metrics->space)
+    /* Win win -- better scale and better space */
+    return TRUE;
+  else if (new_metrics->scale > old_metrics->scale && new_metrics->space <= old_metrics->space)
+    /* Keep new layout only if scale gain outweights aspect space loss */
+    return scale_power > space_power;
+  else if (new_metrics->scale <= old_metrics->scale && new_metrics->space > old_metrics->space)
+    /* Keep new layout only if aspect space gain outweights scale loss */
+    return space_power > scale_power;
+  else
+    /* Lose -- worse scale and space */
+    return FALSE;
+}
+
+static void
+compute_layout (ShellWindowLayout *layout)
+{
+  LayoutMetrics best, candidate;
+  gboolean have_best = FALSE;
+  double total_width = 0;
+  guint n_windows = layout->windows->len;
+  guint n_rows, i;
+
+  g_ptr_array_set_size (layout->placed, 0);
+  g_array_set_size (layout->rows, 0);
+  memset (&layout->metrics, 0, sizeof (LayoutMetrics));
+
+  layout->row_spacing = layout->pending_row_spacing;
+  layout->column_spacing = layout->pending_column_spacing;
+
+  if (n_windows == 0)
+    return;
+
+  for (i = 0; i < n_windows; i++)
+    {
+      LayoutWindow *window = g_ptr_array_index (layout->windows, i);
+
+      total_width += window->scaled_width;
+      g_ptr_array_add (layout->placed, window);
+    }
+
+  for (n_rows = 1; ; n_rows++)
+    {
+      GArray *tmp;
+
+      candidate.n_columns = (n_windows + n_rows - 1) / n_rows;
+
+      /* If adding a new row does not change column count just stop
+       * (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
+       * 3 columns as well => just use 3 rows then)
+       */
+      if (have_best && candidate.n_columns == best.n_columns)
+        break;
+
+      compute_rows (layout, n_rows, total_width, layout->candidate_rows, &candidate);
+      compute_scale_and_space (layout, &candidate);
+
+      if (have_best && !is_better_layout (&best, &candidate))
+        break;
+
+      best = candidate;
+      have_best = TRUE;
+
+      tmp = layout->rows;
+      layout->rows = layout->candidate_rows;
+      layout->candidate_rows = tmp;
+    }
+
+  layout->metrics = best;
+}
+
+static double
+get_distance (LayoutRow    *row,
+              LayoutWindow *window)
+{
+  double dist_x = window->x - row->x;
+  double dist_y = window->y - row->y;
+
+  return sqrt (dist_x * dist_x + dist_y * dist_y);
+}
+
+static gint
+compare_distance (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  LayoutRow *row = user_data;
+  double dist_a = get_distance (row, *(LayoutWindow **) a);
+  double dist_b = get_distance (row, *(LayoutWindow **) b);
+
+  return (dist_a > dist_b) - (dist_a < dist_b);
+}
+
+static void
+compute_slots (ShellWindowLayout *layout)
+{
+  double scale = layout->metrics.scale;
+  double y = 0, height, base_y;
+  guint i, j;
+
+  for (i = 0; i < layout->rows->len; i++)
+    {
+      LayoutRow *row = &g_array_index (layout->rows, LayoutRow, i);
+
+      row->width = row->full_width * scale + ((int) row->n_windows - 1) * layout->column_spacing;
+      row->height = row->full_height * scale;
+
+      row->x = layout->area_x + (layout->area_width - row->width) / 2;
+      row->y = layout->area_y + y;
+      y += row->height + layout->row_spacing;
+
+      /* The sort is stable, so windows keep their order across
+       * relayouts unless they actually moved */
+      g_qsort_with_data (&g_ptr_array_index (layout->placed, row->first_window),
+                         row->n_windows, sizeof (gpointer),
+                         compare_distance, row);
+    }
+
+  height = y - layout->row_spacing;
+  base_y = (layout->area_height - height) / 2;
+
+  for (i = 0; i < layout->rows->len; i++)
+    {
+      LayoutRow *row = &g_array_index (layout->rows, LayoutRow, i);
+      double x = row->x;
+
+      row->y += base_y;
+
+      for (j = 0; j < row->n_windows; j++)
+        {
+          LayoutWindow *window = g_ptr_array_index (layout->placed, row->first_window + j);
+          double s = scale * window->window_scale;
+          double cell_width = window->width * s;
+          double cell_height = window->height * s;
+
+          s = MIN (s, WINDOW_CLONE_MAXIMUM_SCALE);
+
+          window->slot_x = x + (cell_width - window->width * s) / 2;
+          window->slot_y = row->y + row->height - cell_height;
+          window->slot_scale = s;
+
+          x += cell_width + layout->column_spacing;
+        }
+    }
+}
+
+static void
+ensure_slots (ShellWindowLayout *layout)
+{
+  if (layout->layout_dirty)
+    {
+      compute_layout (layout);
+      layout->slots_dirty = TRUE;
+    }
+  else if (layout->scale_dirty && layout->rows->len > 0)
+    {
+      compute_scale_and_space (layout, &layout->metrics);
+      layout->slots_dirty = TRUE;
+    }
+
+  if (layout->slots_dirty)
+    compute_slots (layout);
+
+  layout->layout_dirty = FALSE;
+  layout->scale_dirty = FALSE;
+  layout->slots_dirty = FALSE;
+}
+
+/**
+ * shell_window_layout_get_slot:
+ * @layout: a #ShellWindowLayout
+ * @window: a window clone previously passed to shell_window_layout_set_windows()
+ * @x: (out): location to store the horizontal position of the thumbnail
+ * @y: (out): location to store the vertical position of the thumbnail
+ * @scale: (out): location to store the scale of the thumbnail
+ *
+ * Gets the slot of @window, recomputing whatever part of the layout
+ * is out of date.
+ *
+ * Return value: %TRUE if @window is part of the layout
+ */
+gboolean
+shell_window_layout_get_slot (ShellWindowLayout *layout,
+                              ClutterActor      *window,
+                              double            *x,
+                              double            *y,
+                              double            *scale)
+{
+  LayoutWindow *layout_window;
+
+  g_return_val_if_fail (SHELL_IS_WINDOW_LAYOUT (layout), FALSE);
+
+  layout_window = g_hash_table_lookup (layout->windows_by_actor, window);
+  if (layout_window == NULL)
+    return FALSE;
+
+  ensure_slots (layout);
+
+  *x = layout_window->slot_x;
+  *y = layout_window->slot_y;
+  *scale = layout_window->slot_scale;
+
+  return TRUE;
+}
@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_WINDOW_LAYOUT_H__
+#define __SHELL_WINDOW_LAYOUT_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ShellWindowLayout ShellWindowLayout;
+typedef struct _ShellWindowLayoutClass ShellWindowLayoutClass;
+
+#define SHELL_TYPE_WINDOW_LAYOUT              (shell_window_layout_get_type ())
+#define SHELL_WINDOW_LAYOUT(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayout))
+#define SHELL_WINDOW_LAYOUT_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayoutClass))
+#define SHELL_IS_WINDOW_LAYOUT(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_WINDOW_LAYOUT))
+#define SHELL_IS_WINDOW_LAYOUT_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_WINDOW_LAYOUT))
+#define SHELL_WINDOW_LAYOUT_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayoutClass))
+
+GType shell_window_layout_get_type (void) G_GNUC_CONST;
+
+ShellWindowLayout *shell_window_layout_new (void);
+
+void shell_window_layout_set_area           (ShellWindowLayout *layout,
+                                             double             x,
+                                             double             y,
+                                             double             width,
+                                             double             height);
+void shell_window_layout_set_spacing        (ShellWindowLayout *layout,
+                                             double             row_spacing,
+                                             double             column_spacing);
+void shell_window_layout_set_monitor_height (ShellWindowLayout *layout,
+                                             double             height);
+
+void shell_window_layout_set_windows        (ShellWindowLayout *layout,
+                                             GList             *windows);
+void shell_window_layout_update_window      (ShellWindowLayout *layout,
+                                             ClutterActor      *window,
+                                             double             x,
+                                             double             y,
+                                             double             width,
+                                             double             height);
+
+void     shell_window_layout_invalidate     (ShellWindowLayout *layout);
+gboolean shell_window_layout_get_slot       (ShellWindowLayout *layout,
+                                             ClutterActor      *window,
+                                             double            *x,
+                                             double            *y,
+                                             double            *scale);
+
+G_END_DECLS
+
+#endif /* __SHELL_WINDOW_LAYOUT_H__ */
@@ -0,0 +1,554 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-window-thumbnail
+ * @short_description: A downscaled, live copy of a window
+ *
+ * #ShellWindowThumbnail shows the contents of a window texture, like a
+ * #ClutterClone of it. When it is painted at less than half the size
+ * of the window, it instead paints a downscaled copy of the texture,
+ * made by halving it repeatedly until it is less than twice the
+ * painted size. This avoids both the aliasing and the memory bandwidth
+ * of sampling a full size window texture for a tiny thumbnail.
+ *
+ * The downscaled copy is only updated when the window is damaged, and
+ * then at most once every %UPDATE_INTERVAL milliseconds.
+ *
+ * The downscaled copy is made from the window texture alone, without
+ * the mask #MetaShapedTexture paints it through, so windows that may
+ * have a mask (those with a frame, or shaped without client side
+ * decorations) are always shown through the clone.
+ */
+
+#include "config.h"
+
+#define COGL_ENABLE_EXPERIMENTAL_API
+
+#include "shell-window-thumbnail.h"
+
+#include <cogl/cogl.h>
+#include <meta/meta-shaped-texture.h>
+#include <meta/meta-window-actor.h>
+#include <meta/window.h>
+
+/* Minimum time between two updates of the downscaled copy, in ms */
+#define UPDATE_INTERVAL 50
+
+#define MAX_LEVELS 6
+
+typedef struct {
+  CoglHandle texture;
+  CoglHandle offscreen;
+} ThumbnailLevel;
+
+struct _ShellWindowThumbnailPrivate {
+  ClutterActor *source;
+  ClutterActor *clone;
+
+  guint source_redraw_id;
+
+  /* levels[i] is the source texture halved i + 1 times */
+  ThumbnailLevel levels[MAX_LEVELS];
+  guint n_valid_levels;
+
+  /* Referenced, so that a new texture can't be mistaken for the one
+   * the levels were made from */
+  CoglHandle source_texture;
+  CoglHandle downscale_material;
+  CoglHandle paint_material;
+
+  gint64 last_update;
+  guint update_id;
+
+  guint dirty : 1;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_SOURCE
+};
+
+G_DEFINE_TYPE (ShellWindowThumbnail, shell_window_thumbnail, CLUTTER_TYPE_ACTOR);
+
+static void
+clear_levels (ShellWindowThumbnail *self)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  int i;
+
+  for (i = 0; i < MAX_LEVELS; i++)
+    {
+      if (priv->levels[i].offscreen != COGL_INVALID_HANDLE)
+        cogl_handle_unref (priv->levels[i].offscreen);
+      if (priv->levels[i].texture != COGL_INVALID_HANDLE)
+        cogl_handle_unref (priv->levels[i].texture);
+
+      priv->levels[i].offscreen = COGL_INVALID_HANDLE;
+      priv->levels[i].texture = COGL_INVALID_HANDLE;
+    }
+
+  if (priv->source_texture != COGL_INVALID_HANDLE)
+    cogl_handle_unref (priv->source_texture);
+
+  priv->n_valid_levels = 0;
+  priv->source_texture = COGL_INVALID_HANDLE;
+}
+
+/* Returns whether the source may be painted through a mask, which
+ * cuts out the rounded corners of frames and the shape of shaped
+ * windows. Client side decorated windows are drawn with an alpha
+ * channel instead, and have neither.
+ */
+static gboolean
+source_may_have_mask (ShellWindowThumbnail *self)
+{
+  ClutterActor *actor;
+  MetaWindow *window;
+
+  for (actor = self->priv->source; actor; actor = clutter_actor_get_parent (actor))
+    if (META_IS_WINDOW_ACTOR (actor))
+      break;
+
+  if (actor == NULL)
+    return TRUE;
+
+  window = meta_window_actor_get_meta_window (META_WINDOW_ACTOR (actor));
+
+  return window == NULL ||
+         meta_window_get_frame (window) != NULL ||
+         !meta_window_is_client_decorated (window);
+}
+
+static CoglHandle
+get_level_texture (ShellWindowThumbnail *self,
+                   int                   level)
+{
+  if (level == 0)
+    return self->priv->source_texture;
+  else
+    return self->priv->levels[level - 1].texture;
+}
+
+/* Returns how many times the source texture can be halved while still
+ * being at least as large as the thumbnail is on screen.
+ */
+static int
+choose_level (ShellWindowThumbnail *self,
+              CoglHandle            texture)
+{
+  float width, height;
+  guint texture_width, texture_height;
+  int level = 0;
+
+  clutter_actor_get_transformed_size (CLUTTER_ACTOR (self), &width, &height);
+
+  texture_width = cogl_texture_get_width (texture);
+  texture_height = cogl_texture_get_height (texture);
+
+  while (level < MAX_LEVELS &&
+         (texture_width >> (level + 1)) >= width &&
+         (texture_height >> (level + 1)) >= height)
+    level++;
+
+  return level;
+}
+
+static gboolean
+render_level (ShellWindowThumbnail *self,
+              int                   level)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  ThumbnailLevel *thumbnail_level = &priv->levels[level - 1];
+  CoglColor clear_color = { 0, 0, 0, 0 };
+  guint width, height;
+
+  width = MAX (1, cogl_texture_get_width (priv->source_texture) >> level);
+  height = MAX (1, cogl_texture_get_height (priv->source_texture) >> level);
+
+  if (thumbnail_level->texture == COGL_INVALID_HANDLE)
+    {
+      thumbnail_level->texture = cogl_texture_new_with_size (width, height,
+                                                             COGL_TEXTURE_NO_SLICING,
+                                                             COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (thumbnail_level->texture == COGL_INVALID_HANDLE)
+        return FALSE;
+
+      thumbnail_level->offscreen = cogl_offscreen_new_to_texture (thumbnail_level->texture);
+      if (thumbnail_level->offscreen == COGL_INVALID_HANDLE)
+        {
+          cogl_handle_unref (thumbnail_level->texture);
+          thumbnail_level->texture = COGL_INVALID_HANDLE;
+          return FALSE;
+        }
+    }
+
+  if (priv->downscale_material == COGL_INVALID_HANDLE)
+    {
+      priv->downscale_material = cogl_material_new ();
+      cogl_material_set_layer_filters (priv->downscale_material, 0,
+                                       COGL_MATERIAL_FILTER_LINEAR,
+                                       COGL_MATERIAL_FILTER_LINEAR);
+      cogl_material_set_layer_wrap_mode (priv->downscale_material, 0,
+                                         COGL_MATERIAL_WRAP_MODE_CLAMP_TO_EDGE);
+    }
+
+  /* Halving with linear filtering averages each 2x2 block of texels
+   * of the previous level */
+  cogl_material_set_layer (priv->downscale_material, 0,
+                           get_level_texture (self, level - 1));
+
+  cogl_push_framebuffer (thumbnail_level->offscreen);
+  cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+  cogl_ortho (0, width, height, 0, -1, 1);
+  cogl_set_source (priv->downscale_material);
+  cogl_rectangle (0, 0, width, height);
+  cogl_pop_framebuffer ();
+
+  return TRUE;
+}
+
+static gboolean
+on_update_timeout (gpointer data)
+{
+  ShellWindowThumbnail *self = data;
+
+  self->priv->update_id = 0;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  return FALSE;
+}
+
+static gboolean
+update_levels (ShellWindowThumbnail *self,
+               int                   level)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  gint64 now;
+
+  if (priv->dirty)
+    {
+      now = g_get_monotonic_time ();
+
+      if (priv->n_valid_levels == 0 ||
+          now - priv->last_update >= UPDATE_INTERVAL * 1000)
+        {
+          priv->n_valid_levels = 0;
+          priv->last_update = now;
+          priv->dirty = FALSE;
+        }
+      else if (priv->update_id == 0)
+        {
+          guint remaining = UPDATE_INTERVAL - (now - priv->last_update) / 1000;
+
+          priv->update_id = g_timeout_add (remaining, on_update_timeout, self);
+        }
+    }
+
+  for (; priv->n_valid_levels < (guint) level; priv->n_valid_levels++)
+    if (!render_level (self, priv->n_valid_levels + 1))
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+shell_window_thumbnail_paint (ClutterActor *actor)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  ClutterActorBox box;
+  CoglHandle texture = COGL_INVALID_HANDLE;
+  guint8 paint_opacity;
+  int level = 0;
+
+  if (priv->source && META_IS_SHAPED_TEXTURE (priv->source) &&
+      !source_may_have_mask (self))
+    texture = meta_shaped_texture_get_texture (META_SHAPED_TEXTURE (priv->source));
+
+  if (texture != priv->source_texture)
+    {
+      clear_levels (self);
+      if (texture != COGL_INVALID_HANDLE)
+        priv->source_texture = cogl_handle_ref (texture);
+    }
+
+  if (texture != COGL_INVALID_HANDLE)
+    level = choose_level (self, texture);
+
+  /* Close to full size, the window texture itself is the best we can do */
+  if (level == 0 || !update_levels (self, level))
+    {
+      if (priv->clone)
+        clutter_actor_paint (priv->clone);
+      return;
+    }
+
+  if (priv->paint_material == COGL_INVALID_HANDLE)
+    {
+      priv->paint_material = cogl_material_new ();
+      cogl_material_set_layer_filters (priv->paint_material, 0,
+                                       COGL_MATERIAL_FILTER_LINEAR,
+                                       COGL_MATERIAL_FILTER_LINEAR);
+      cogl_material_set_layer_wrap_mode (priv->paint_material, 0,
+                                         COGL_MATERIAL_WRAP_MODE_CLAMP_TO_EDGE);
+    }
+
+  cogl_material_set_layer (priv->paint_material, 0,
+                           get_level_texture (self, level));
+
+  paint_opacity = clutter_actor_get_paint_opacity (actor);
+  cogl_material_set_color4ub (priv->paint_material,
+                              paint_opacity, paint_opacity,
+                              paint_opacity, paint_opacity);
+
+  clutter_actor_get_allocation_box (actor, &box);
+
+  cogl_set_source (priv->paint_material);
+  cogl_rectangle (0, 0, box.x2 - box.x1, box.y2 - box.y1);
+}
+
+static gboolean
+shell_window_thumbnail_get_paint_volume (ClutterActor       *actor,
+                                         ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, actor);
+}
+
+static void
+shell_window_thumbnail_get_preferred_width (ClutterActor *actor,
+                                            gfloat        for_height,
+                                            gfloat       *min_width_p,
+                                            gfloat       *natural_width_p)
+{
+  ShellWindowThumbnailPrivate *priv = SHELL_WINDOW_THUMBNAIL (actor)->priv;
+
+  clutter_actor_get_preferred_width (priv->clone, for_height,
+                                     min_width_p, natural_width_p);
+}
+
+static void
+shell_window_thumbnail_get_preferred_height (ClutterActor *actor,
+                                             gfloat        for_width,
+                                             gfloat       *min_height_p,
+                                             gfloat       *natural_height_p)
+{
+  ShellWindowThumbnailPrivate *priv = SHELL_WINDOW_THUMBNAIL (actor)->priv;
+
+  clutter_actor_get_preferred_height (priv->clone, for_width,
+                                      min_height_p, natural_height_p);
+}
+
+static void
+shell_window_thumbnail_allocate (ClutterActor           *actor,
+                                 const ClutterActorBox  *box,
+                                 ClutterAllocationFlags  flags)
+{
+  ShellWindowThumbnailPrivate *priv = SHELL_WINDOW_THUMBNAIL (actor)->priv;
+  ClutterActorBox child_box;
+
+  clutter_actor_set_allocation (actor, box, flags);
+
+  if (priv->clone)
+    {
+      child_box.x1 = child_box.y1 = 0;
+      child_box.x2 = box->x2 - box->x1;
+      child_box.y2 = box->y2 - box->y1;
+
+      clutter_actor_allocate (priv->clone, &child_box, flags);
+    }
+}
+
+static void
+on_source_queue_redraw (ClutterActor         *source,
+                        ClutterActor         *origin,
+                        ShellWindowThumbnail *self)
+{
+  /* The window was damaged; our clone of it makes sure we get
+   * repainted, which is when the downscaled copy is updated */
+  self->priv->dirty = TRUE;
+}
+
+ClutterActor *
+shell_window_thumbnail_get_source (ShellWindowThumbnail *thumbnail)
+{
+  g_return_val_if_fail (SHELL_IS_WINDOW_THUMBNAIL (thumbnail), NULL);
+
+  return thumbnail->priv->source;
+}
+
+void
+shell_window_thumbnail_set_source (ShellWindowThumbnail *thumbnail,
+                                   ClutterActor         *source)
+{
+  ShellWindowThumbnailPrivate *priv;
+
+  g_return_if_fail (SHELL_IS_WINDOW_THUMBNAIL (thumbnail));
+  g_return_if_fail (source == NULL || CLUTTER_IS_ACTOR (source));
+
+  priv = thumbnail->priv;
+
+  if (priv->source == source)
+    return;
+
+  if (priv->source)
+    {
+      g_signal_handler_disconnect (priv->source, priv->source_redraw_id);
+      priv->source_redraw_id = 0;
+
+      g_object_unref (priv->source);
+      priv->source = NULL;
+    }
+
+  if (source)
+    {
+      priv->source = g_object_ref (source);
+      priv->source_redraw_id = g_signal_connect (source, "queue-redraw",
+                                                 G_CALLBACK (on_source_queue_redraw),
+                                                 thumbnail);
+    }
+
+  /* Besides painting the window close to full size, the clone keeps
+   * redraws of the window propagating to us even while the window
+   * itself is hidden, for example on another workspace */
+  clutter_clone_set_source (CLUTTER_CLONE (priv->clone), source);
+
+  clear_levels (thumbnail);
+  priv->dirty = TRUE;
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (thumbnail));
+  g_object_notify (G_OBJECT (thumbnail), "source");
+}
+
+/**
+ * shell_window_thumbnail_new:
+ * @source: the window texture to show
+ *
+ * Return value: (transfer floating): a new #ShellWindowThumbnail
+ */
+ClutterActor *
+shell_window_thumbnail_new (ClutterActor *source)
+{
+  return g_object_new (SHELL_TYPE_WINDOW_THUMBNAIL,
+                       "source", source,
+                       NULL);
+}
+
+static void
+shell_window_thumbnail_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      shell_window_thumbnail_set_source (self, g_value_get_object (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_window_thumbnail_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      g_value_set_object (value, self->priv->source);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_window_thumbnail_dispose (GObject *object)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+  ShellWindowThumbnailPrivate *priv = self->priv;
+
+  if (priv->update_id != 0)
+    {
+      g_source_remove (priv->update_id);
+      priv->update_id = 0;
+    }
+
+  if (priv->clone)
+    shell_window_thumbnail_set_source (self, NULL);
+
+  clear_levels (self);
+
+  if (priv->downscale_material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->downscale_material);
+      priv->downscale_material = COGL_INVALID_HANDLE;
+    }
+
+  if (priv->paint_material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->paint_material);
+      priv->paint_material = COGL_INVALID_HANDLE;
+    }
+
+  G_OBJECT_CLASS (shell_window_thumbnail_parent_class)->dispose (object);
+
+  /* Chaining up destroys our children, the clone included */
+  priv->clone = NULL;
+}
+
+static void
+shell_window_thumbnail_class_init (ShellWindowThumbnailClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+  GParamSpec *pspec;
+
+  gobject_class->set_property = shell_window_thumbnail_set_property;
+  gobject_class->get_property = shell_window_thumbnail_get_property;
+  gobject_class->dispose = shell_window_thumbnail_dispose;
+
+  actor_class->paint = shell_window_thumbnail_paint;
+  actor_class->get_paint_volume = shell_window_thumbnail_get_paint_volume;
+  actor_class->get_preferred_width = shell_window_thumbnail_get_preferred_width;
+  actor_class->get_preferred_height = shell_window_thumbnail_get_preferred_height;
+  actor_class->allocate = shell_window_thumbnail_allocate;
+
+  /**
+   * ShellWindowThumbnail:source:
+   *
+   * The window texture (as returned by meta_window_actor_get_texture())
+   * to show. Other actors are shown like a #ClutterClone would.
+   */
+  pspec = g_param_spec_object ("source",
+                               "Source",
+                               "The window texture to show",
+                               CLUTTER_TYPE_ACTOR,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  g_object_class_install_property (gobject_class, PROP_SOURCE, pspec);
+
+  g_type_class_add_private (gobject_class, sizeof (ShellWindowThumbnailPrivate));
+}
+
+static void
+shell_window_thumbnail_init (ShellWindowThumbnail *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, SHELL_TYPE_WINDOW_THUMBNAIL,
+                                            ShellWindowThumbnailPrivate);
+
+  self->priv->clone = clutter_clone_new (NULL);
+  clutter_actor_add_child (CLUTTER_ACTOR (self), self->priv->clone);
+}
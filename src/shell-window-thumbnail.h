@@ -0,0 +1,43 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_WINDOW_THUMBNAIL_H__
+#define __SHELL_WINDOW_THUMBNAIL_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_WINDOW_THUMBNAIL                 (shell_window_thumbnail_get_type ())
+#define SHELL_WINDOW_THUMBNAIL(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), SHELL_TYPE_WINDOW_THUMBNAIL, ShellWindowThumbnail))
+#define SHELL_WINDOW_THUMBNAIL_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_WINDOW_THUMBNAIL, ShellWindowThumbnailClass))
+#define SHELL_IS_WINDOW_THUMBNAIL(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SHELL_TYPE_WINDOW_THUMBNAIL))
+#define SHELL_IS_WINDOW_THUMBNAIL_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_WINDOW_THUMBNAIL))
+#define SHELL_WINDOW_THUMBNAIL_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_WINDOW_THUMBNAIL, ShellWindowThumbnailClass))
+
+typedef struct _ShellWindowThumbnail        ShellWindowThumbnail;
+typedef struct _ShellWindowThumbnailClass   ShellWindowThumbnailClass;
+
+typedef struct _ShellWindowThumbnailPrivate ShellWindowThumbnailPrivate;
+
+struct _ShellWindowThumbnail
+{
+  ClutterActor parent;
+
+  ShellWindowThumbnailPrivate *priv;
+};
+
+struct _ShellWindowThumbnailClass
+{
+  ClutterActorClass parent_class;
+};
+
+GType shell_window_thumbnail_get_type (void) G_GNUC_CONST;
+
+ClutterActor *shell_window_thumbnail_new        (ClutterActor         *source);
+
+ClutterActor *shell_window_thumbnail_get_source (ShellWindowThumbnail *thumbnail);
+void          shell_window_thumbnail_set_source (ShellWindowThumbnail *thumbnail,
+                                                 ClutterActor         *source);
+
+G_END_DECLS
+
+#endif /* __SHELL_WINDOW_THUMBNAIL_H__ */
@@ -445,6 +445,8 @@ _st_create_shadow_material (StShadow   *shadow_spec,
 
   g_free (pixels_out);
 
+  _st_texture_track_memory (texture, ST_TEXTURE_MEMORY_SHADOW);
+
   if (G_UNLIKELY (shadow_material_template == COGL_INVALID_HANDLE))
     {
       shadow_material_template = cogl_material_new ();
@@ -700,3 +702,84 @@ _st_paint_shadow_with_opacity (StShadow        *shadow_spec,
                                       shadow_box.x2, shadow_box.y2,
                                       0, 0, 1, 1);
 }
+
+typedef struct {
+  StTextureMemoryCategory category;
+  gsize size;
+} TrackedTexture;
+
+static CoglUserDataKey tracked_texture_key;
+static guint tracked_textures[ST_TEXTURE_MEMORY_N_CATEGORIES];
+static gsize tracked_bytes[ST_TEXTURE_MEMORY_N_CATEGORIES];
+
+static void
+tracked_texture_destroyed (void *user_data)
+{
+  TrackedTexture *tracked = user_data;
+
+  tracked_textures[tracked->category]--;
+  tracked_bytes[tracked->category] -= tracked->size;
+
+  g_slice_free (TrackedTexture, tracked);
+}
+
+/**
+ * _st_texture_get_memory_size:
+ * @texture: a #CoglTexture
+ *
+ * Estimates the amount of video memory used by @texture, assuming it
+ * is stored unpadded and without mipmaps.
+ *
+ * Return value: the size of @texture, in bytes
+ */
+gsize
+_st_texture_get_memory_size (CoglHandle texture)
+{
+  gsize bpp;
+
+  if (cogl_texture_get_format (texture) == COGL_PIXEL_FORMAT_A_8)
+    bpp = 1;
+  else
+    bpp = 4;
+
+  return (gsize) cogl_texture_get_width (texture) *
+         cogl_texture_get_height (texture) * bpp;
+}
+
+/**
+ * _st_texture_track_memory:
+ * @texture: a newly created #CoglTexture
+ * @category: what @texture is used for
+ *
+ * Adds @texture to the memory accounting for @category until it is freed.
+ */
+void
+_st_texture_track_memory (CoglHandle              texture,
+                          StTextureMemoryCategory category)
+{
+  TrackedTexture *tracked;
+
+  if (texture == COGL_INVALID_HANDLE)
+    return;
+
+  tracked = g_slice_new (TrackedTexture);
+  tracked->category = category;
+  tracked->size = _st_texture_get_memory_size (texture);
+
+  tracked_textures[category]++;
+  tracked_bytes[category] += tracked->size;
+
+  cogl_object_set_user_data (texture, &tracked_texture_key,
+                             tracked, tracked_texture_destroyed);
+}
+
+void
+_st_texture_get_tracked_memory (StTextureMemoryCategory  category,
+                                guint                   *n_textures,
+                                gsize                   *n_bytes)
+{
+  if (n_textures)
+    *n_textures = tracked_textures[category];
+  if (n_bytes)
+    *n_bytes = tracked_bytes[category];
+}
@@ -79,4 +79,20 @@ void _st_paint_shadow_with_opacity (StShadow        *shadow_spec,
                                     ClutterActorBox *box,
                                     guint8           paint_opacity);
 
+/* Memory accounting for textures St renders itself; see
+ * st_theme_node_get_texture_memory_usage() */
+typedef enum {
+  ST_TEXTURE_MEMORY_PRERENDERED,
+  ST_TEXTURE_MEMORY_SHADOW,
+
+  ST_TEXTURE_MEMORY_N_CATEGORIES
+} StTextureMemoryCategory;
+
+gsize _st_texture_get_memory_size (CoglHandle texture);
+void  _st_texture_track_memory    (CoglHandle              texture,
+                                   StTextureMemoryCategory category);
+void  _st_texture_get_tracked_memory (StTextureMemoryCategory  category,
+                                      guint                   *n_textures,
+                                      gsize                   *n_bytes);
+
 #endif /* __ST_PRIVATE_H__ */
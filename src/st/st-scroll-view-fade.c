@@ -23,6 +23,8 @@
 #define ST_IS_SCROLL_VIEW_FADE_CLASS(klass)     (G_TYPE_CHECK_CLASS_TYPE ((klass), ST_TYPE_SCROLL_VIEW_FADE))
 #define ST_SCROLL_VIEW_FADE_GET_CLASS(obj)      (G_TYPE_INSTANCE_GET_CLASS ((obj), ST_TYPE_SCROLL_VIEW_FADE, StScrollViewFadeClass))
 
+#define COGL_ENABLE_EXPERIMENTAL_API
+
 #include "st-scroll-view-fade.h"
 #include "st-scroll-view.h"
 #include "st-widget.h"
@@ -65,6 +67,9 @@ struct _StScrollViewFade
 
   float vfade_offset;
   float hfade_offset;
+
+  /* For fading by drawing over the edges, see st_scroll_view_fade_paint() */
+  CoglPipeline *overlay_pipeline;
 };
 
 struct _StScrollViewFadeClass
@@ -83,19 +88,26 @@ enum {
   PROP_HFADE_OFFSET
 };
 
+/* Whether the effect should fade the actor at all, by either method */
 static gboolean
-st_scroll_view_fade_pre_paint (ClutterEffect *effect)
+should_fade (StScrollViewFade *self)
 {
-  StScrollViewFade *self = ST_SCROLL_VIEW_FADE (effect);
-  ClutterEffectClass *parent_class;
-
   if (self->shader == COGL_INVALID_HANDLE)
     return FALSE;
 
-  if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)))
+  if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (self)))
     return FALSE;
 
-  if (self->actor == NULL)
+  return self->actor != NULL;
+}
+
+static gboolean
+st_scroll_view_fade_pre_paint (ClutterEffect *effect)
+{
+  StScrollViewFade *self = ST_SCROLL_VIEW_FADE (effect);
+  ClutterEffectClass *parent_class;
+
+  if (!should_fade (self))
     return FALSE;
 
   if (self->program == COGL_INVALID_HANDLE)
@@ -146,6 +158,47 @@ st_scroll_view_fade_create_texture (ClutterOffscreenEffect *effect,
                                      COGL_PIXEL_FORMAT_RGBA_8888_PRE);
 }
 
+/* Returns the area to fade, in the coordinates of the actor's allocation */
+static void
+get_fade_area (StScrollViewFade *self,
+               ClutterActorBox  *fade_box)
+{
+  ClutterActor *vscroll = st_scroll_view_get_vscroll_bar (ST_SCROLL_VIEW (self->actor));
+  ClutterActor *hscroll = st_scroll_view_get_hscroll_bar (ST_SCROLL_VIEW (self->actor));
+  gboolean h_scroll_visible, v_scroll_visible;
+  ClutterActorBox allocation;
+
+  clutter_actor_get_allocation_box (self->actor, &allocation);
+  st_theme_node_get_content_box (st_widget_get_theme_node (ST_WIDGET (self->actor)),
+                                (const ClutterActorBox *)&allocation, fade_box);
+
+  g_object_get (ST_SCROLL_VIEW (self->actor),
+                "hscrollbar-visible", &h_scroll_visible,
+                "vscrollbar-visible", &v_scroll_visible,
+                NULL);
+
+  if (v_scroll_visible)
+    {
+      if (clutter_actor_get_text_direction (self->actor) == CLUTTER_TEXT_DIRECTION_RTL)
+          fade_box->x1 += clutter_actor_get_width (vscroll);
+
+      fade_box->x2 -= clutter_actor_get_width (vscroll);
+    }
+
+  if (h_scroll_visible)
+      fade_box->y2 -= clutter_actor_get_height (hscroll);
+}
+
+/* Returns how far the adjustment is scrolled, from 0.0 to 1.0 */
+static gdouble
+get_scroll_ratio (StAdjustment *adjustment)
+{
+  gdouble value, lower, upper, page_size;
+
+  st_adjustment_get_values (adjustment, &value, &lower, &upper, NULL, NULL, &page_size);
+  return (value - lower) / (upper - page_size - lower);
+}
+
 static void
 st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
 {
@@ -153,12 +206,7 @@ st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
   ClutterOffscreenEffectClass *parent;
   CoglHandle material;
 
-  gdouble value, lower, upper, page_size;
-  ClutterActor *vscroll = st_scroll_view_get_vscroll_bar (ST_SCROLL_VIEW (self->actor));
-  ClutterActor *hscroll = st_scroll_view_get_hscroll_bar (ST_SCROLL_VIEW (self->actor));
-  gboolean h_scroll_visible, v_scroll_visible;
-
-  ClutterActorBox allocation, content_box, paint_box;
+  ClutterActorBox content_box, paint_box;
 
   /*
    * Used to pass the fade area to the shader
@@ -178,9 +226,7 @@ st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
   clutter_actor_get_paint_box (self->actor, &paint_box);
   clutter_actor_get_abs_allocation_vertices (self->actor, verts);
 
-  clutter_actor_get_allocation_box (self->actor, &allocation);
-  st_theme_node_get_content_box (st_widget_get_theme_node (ST_WIDGET (self->actor)),
-                                (const ClutterActorBox *)&allocation, &content_box);
+  get_fade_area (self, &content_box);
 
   /*
    * The FBO is based on the paint_volume's size which can be larger then the actual
@@ -191,35 +237,13 @@ st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
   fade_area[1][0] = content_box.x2 + (verts[3].x - paint_box.x2);
   fade_area[1][1] = content_box.y2 + (verts[3].y - paint_box.y2);
 
-  g_object_get (ST_SCROLL_VIEW (self->actor),
-                "hscrollbar-visible", &h_scroll_visible,
-                "vscrollbar-visible", &v_scroll_visible,
-                NULL);
-
-  if (v_scroll_visible)
-    {
-      if (clutter_actor_get_text_direction (self->actor) == CLUTTER_TEXT_DIRECTION_RTL)
-          fade_area[0][0] += clutter_actor_get_width (vscroll);
-
-      fade_area[1][0] -= clutter_actor_get_width (vscroll);
-    }
-
-  if (h_scroll_visible)
-      fade_area[1][1] -= clutter_actor_get_height (hscroll);
-
   if (self->vvalue_uniform > -1)
-    {
-      st_adjustment_get_values (self->vadjustment, &value, &lower, &upper, NULL, NULL, &page_size);
-      value = (value - lower) / (upper - page_size - lower);
-      cogl_program_set_uniform_1f (self->program, self->vvalue_uniform, value);
-    }
+    cogl_program_set_uniform_1f (self->program, self->vvalue_uniform,
+                                 get_scroll_ratio (self->vadjustment));
 
   if (self->hvalue_uniform > -1)
-    {
-      st_adjustment_get_values (self->hadjustment, &value, &lower, &upper, NULL, NULL, &page_size);
-      value = (value - lower) / (upper - page_size - lower);
-      cogl_program_set_uniform_1f (self->program, self->hvalue_uniform, value);
-    }
+    cogl_program_set_uniform_1f (self->program, self->hvalue_uniform,
+                                 get_scroll_ratio (self->hadjustment));
 
   if (self->vfade_offset_uniform > -1)
     cogl_program_set_uniform_1f (self->program, self->vfade_offset_uniform, self->vfade_offset);
@@ -242,6 +266,224 @@ out:
   parent->paint_target (effect);
 }
 
+/* Whether @node paints nothing but a plain opaque @color as its background */
+static gboolean
+node_has_plain_background (StThemeNode        *node,
+                           const ClutterColor *color)
+{
+  StGradientType gradient;
+  ClutterColor start, end, background;
+
+  st_theme_node_get_background_gradient (node, &gradient, &start, &end);
+  if (gradient != ST_GRADIENT_NONE)
+    return FALSE;
+
+  if (st_theme_node_get_background_image (node) != NULL)
+    return FALSE;
+
+  st_theme_node_get_background_color (node, &background);
+  return background.alpha == 0xff && clutter_color_equal (&background, color);
+}
+
+/* Whether what shows through where the actor fades out is known to be
+ * plain @color: the parent paints it as its background under all of the
+ * actor, and none of the siblings painted before the actor overlap it.
+ */
+static gboolean
+backdrop_is_color (StScrollViewFade   *self,
+                   const ClutterColor *color)
+{
+  ClutterActor *parent = clutter_actor_get_parent (self->actor);
+  ClutterActor *sibling;
+  ClutterActorBox box, parent_box, sibling_box;
+  StThemeNode *parent_node;
+  int corner;
+
+  if (parent == NULL || !ST_IS_WIDGET (parent))
+    return FALSE;
+
+  parent_node = st_widget_get_theme_node (ST_WIDGET (parent));
+  if (!node_has_plain_background (parent_node, color))
+    return FALSE;
+
+  /* Rounded corners leave part of the parent unpainted */
+  for (corner = ST_CORNER_TOPLEFT; corner <= ST_CORNER_BOTTOMLEFT; corner++)
+    if (st_theme_node_get_border_radius (parent_node, corner) > 0)
+      return FALSE;
+
+  clutter_actor_get_allocation_box (self->actor, &box);
+  clutter_actor_get_allocation_box (parent, &parent_box);
+  if (box.x1 < 0 || box.y1 < 0 ||
+      box.x2 > parent_box.x2 - parent_box.x1 ||
+      box.y2 > parent_box.y2 - parent_box.y1)
+    return FALSE;
+
+  for (sibling = clutter_actor_get_first_child (parent);
+       sibling != NULL && sibling != self->actor;
+       sibling = clutter_actor_get_next_sibling (sibling))
+    {
+      if (!CLUTTER_ACTOR_IS_VISIBLE (sibling))
+        continue;
+
+      clutter_actor_get_allocation_box (sibling, &sibling_box);
+      if (sibling_box.x1 < box.x2 && sibling_box.x2 > box.x1 &&
+          sibling_box.y1 < box.y2 && sibling_box.y2 > box.y1)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Fading the content towards transparency gives the same result as
+ * blending a gradient of the backdrop's color over it, which doesn't
+ * need an offscreen buffer, as long as the actor paints that same color
+ * as its own opaque background, the backdrop is known to be exactly that
+ * color, and the actor is painted fully opaque. Anything else goes
+ * through the shader.
+ */
+static gboolean
+can_paint_overlay (StScrollViewFade *self,
+                   ClutterColor     *color)
+{
+  StThemeNode *node = st_widget_get_theme_node (ST_WIDGET (self->actor));
+
+  if (clutter_actor_get_paint_opacity (self->actor) != 0xff)
+    return FALSE;
+
+  st_theme_node_get_background_color (node, color);
+  if (!node_has_plain_background (node, color))
+    return FALSE;
+
+  return backdrop_is_color (self, color);
+}
+
+static void
+add_overlay_quad (CoglVertexP2C4 *v,
+                  float           x1,
+                  float           y1,
+                  float           x2,
+                  float           y2,
+                  guint8          alpha1,
+                  guint8          alpha2,
+                  gboolean        vertical,
+                  ClutterColor   *color)
+{
+  /* alpha1 is the alpha at (x1, y1), alpha2 at the opposite edge */
+  float xs[4] = { x1, x2, x2, x1 };
+  float ys[4] = { y1, y1, y2, y2 };
+  guint8 alphas[4];
+  int order[6] = { 0, 1, 2, 0, 2, 3 };
+  int i;
+
+  alphas[0] = alpha1;
+  alphas[1] = vertical ? alpha1 : alpha2;
+  alphas[2] = alpha2;
+  alphas[3] = vertical ? alpha2 : alpha1;
+
+  for (i = 0; i < 6; i++)
+    {
+      int k = order[i];
+      guint8 alpha = alphas[k];
+
+      /* premultiplied */
+      v[i].x = xs[k];
+      v[i].y = ys[k];
+      v[i].r = color->red * alpha / 255;
+      v[i].g = color->green * alpha / 255;
+      v[i].b = color->blue * alpha / 255;
+      v[i].a = alpha;
+    }
+}
+
+static void
+paint_overlay (StScrollViewFade *self,
+               ClutterColor     *color)
+{
+  CoglContext *ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglVertexP2C4 verts[4 * 6];
+  CoglPrimitive *primitive;
+  ClutterActorBox box;
+  guint8 opacity;
+  int n_verts = 0;
+
+  /* Already relative to the actor, as we paint */
+  get_fade_area (self, &box);
+
+  opacity = clutter_actor_get_paint_opacity (self->actor);
+
+  if (self->vfade_offset > 0)
+    {
+      if (get_scroll_ratio (self->vadjustment) > 0.0)
+        {
+          add_overlay_quad (verts + n_verts, box.x1, box.y1, box.x2, box.y1 + self->vfade_offset,
+                            opacity, 0, TRUE, color);
+          n_verts += 6;
+        }
+      if (get_scroll_ratio (self->vadjustment) < 1.0)
+        {
+          add_overlay_quad (verts + n_verts, box.x1, box.y2, box.x2, box.y2 - self->vfade_offset,
+                            opacity, 0, TRUE, color);
+          n_verts += 6;
+        }
+    }
+
+  if (self->hfade_offset > 0)
+    {
+      if (get_scroll_ratio (self->hadjustment) > 0.0)
+        {
+          add_overlay_quad (verts + n_verts, box.x1, box.y1, box.x1 + self->hfade_offset, box.y2,
+                            opacity, 0, FALSE, color);
+          n_verts += 6;
+        }
+      if (get_scroll_ratio (self->hadjustment) < 1.0)
+        {
+          add_overlay_quad (verts + n_verts, box.x2, box.y1, box.x2 - self->hfade_offset, box.y2,
+                            opacity, 0, FALSE, color);
+          n_verts += 6;
+        }
+    }
+
+  if (n_verts == 0)
+    return;
+
+  if (self->overlay_pipeline == NULL)
+    self->overlay_pipeline = cogl_pipeline_new (ctx);
+
+  primitive = cogl_primitive_new_p2c4 (ctx, COGL_VERTICES_MODE_TRIANGLES, n_verts, verts);
+  cogl_framebuffer_draw_primitive (cogl_get_draw_framebuffer (),
+                                   self->overlay_pipeline,
+                                   primitive);
+  cogl_object_unref (primitive);
+}
+
+static void
+st_scroll_view_fade_paint (ClutterEffect           *effect,
+                           ClutterEffectPaintFlags  flags)
+{
+  StScrollViewFade *self = ST_SCROLL_VIEW_FADE (effect);
+  ClutterColor color;
+
+  if (!should_fade (self))
+    {
+      if (self->actor != NULL)
+        clutter_actor_continue_paint (self->actor);
+      return;
+    }
+
+  if (can_paint_overlay (self, &color))
+    {
+      clutter_actor_continue_paint (self->actor);
+      paint_overlay (self, &color);
+      return;
+    }
+
+  /* This redirects the actor offscreen only when it has been redrawn
+   * since the last time; otherwise its last contents are reused, and
+   * only paint_target() runs.
+   */
+  CLUTTER_EFFECT_CLASS (st_scroll_view_fade_parent_class)->paint (effect, flags);
+}
+
 static void
 on_adjustment_changed (StAdjustment *adjustment,
                        ClutterEffect *effect)
@@ -333,6 +575,12 @@ st_scroll_view_fade_dispose (GObject *gobject)
       self->shader = COGL_INVALID_HANDLE;
     }
 
+  if (self->overlay_pipeline != NULL)
+    {
+      cogl_object_unref (self->overlay_pipeline);
+      self->overlay_pipeline = NULL;
+    }
+
   if (self->vadjustment)
     {
       g_signal_handlers_disconnect_by_func (self->vadjustment,
@@ -449,6 +697,7 @@ st_scroll_view_fade_class_init (StScrollViewFadeClass *klass)
   meta_class->set_actor = st_scroll_view_fade_set_actor;
 
   effect_class->pre_paint = st_scroll_view_fade_pre_paint;
+  effect_class->paint = st_scroll_view_fade_paint;
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->create_texture = st_scroll_view_fade_create_texture;
@@ -30,6 +30,10 @@
 #define CACHE_PREFIX_ICON "icon:"
 #define CACHE_PREFIX_FILE "file:"
 #define CACHE_PREFIX_FILE_FOR_CAIRO "file-for-cairo:"
+#define CACHE_PREFIX_IMAGE_DATA "image-data:"
+
+/* Number of decoded notification images to keep around */
+#define IMAGE_DATA_CACHE_SIZE 32
 
 #define IMAGE_MISSING_ICON_NAME "image-missing"
 
@@ -45,6 +49,13 @@ struct _StTextureCachePrivate
 
   /* File monitors to evict cache data on changes */
   GHashTable *file_monitors; /* char * -> GFileMonitor * */
+
+  /* Scaled images loaded from raw image data, keyed by content; these
+   * are filled in from a worker thread, so they are protected by a lock.
+   */
+  GMutex      image_data_lock;
+  GHashTable *image_data_cache; /* char * -> GdkPixbuf * */
+  GQueue     *image_data_keys; /* char *, oldest first */
 };
 
 static void st_texture_cache_dispose (GObject *object);
@@ -152,6 +163,10 @@ st_texture_cache_init (StTextureCache *self)
   self->priv->file_monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
                                                      g_object_unref, g_object_unref);
 
+  g_mutex_init (&self->priv->image_data_lock);
+  self->priv->image_data_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                        g_free, g_object_unref);
+  self->priv->image_data_keys = g_queue_new ();
 }
 
 static void
@@ -171,12 +186,25 @@ st_texture_cache_dispose (GObject *object)
   g_clear_pointer (&self->priv->outstanding_requests, g_hash_table_destroy);
   g_clear_pointer (&self->priv->file_monitors, g_hash_table_destroy);
 
+  g_mutex_lock (&self->priv->image_data_lock);
+  g_clear_pointer (&self->priv->image_data_cache, g_hash_table_destroy);
+  if (self->priv->image_data_keys)
+    {
+      g_queue_free_full (self->priv->image_data_keys, g_free);
+      self->priv->image_data_keys = NULL;
+    }
+  g_mutex_unlock (&self->priv->image_data_lock);
+
   G_OBJECT_CLASS (st_texture_cache_parent_class)->dispose (object);
 }
 
 static void
 st_texture_cache_finalize (GObject *object)
 {
+  StTextureCache *self = (StTextureCache*)object;
+
+  g_mutex_clear (&self->priv->image_data_lock);
+
   G_OBJECT_CLASS (st_texture_cache_parent_class)->finalize (object);
 }
 
@@ -1219,6 +1247,226 @@ st_texture_cache_load_sliced_image_async (StTextureCache      *cache,
   g_object_unref (result);
 }
 
+typedef struct {
+  GVariant  *image_data;
+  gint       size;
+  GdkPixbuf *pixbuf;
+} AsyncImageDataLoad;
+
+static void
+on_image_data_load_destroy (gpointer data)
+{
+  AsyncImageDataLoad *d = data;
+
+  g_clear_object (&d->pixbuf);
+  g_variant_unref (d->image_data);
+  g_free (d);
+}
+
+static void
+free_image_data_bytes (guchar   *pixels,
+                       gpointer  data)
+{
+  g_bytes_unref (data);
+}
+
+/* Wraps the pixels of a (iiibiiay) notification image in a pixbuf,
+ * without copying them out of the variant.
+ */
+static GdkPixbuf *
+pixbuf_from_image_data (GVariant  *image_data,
+                        GError   **error)
+{
+  gint width, height, rowstride, bits_per_sample, n_channels;
+  gboolean has_alpha;
+  GVariant *pixels;
+  GBytes *bytes;
+
+  g_variant_get (image_data, "(iiibii@ay)",
+                 &width, &height, &rowstride, &has_alpha,
+                 &bits_per_sample, &n_channels, &pixels);
+  bytes = g_variant_get_data_as_bytes (pixels);
+  g_variant_unref (pixels);
+
+  if (width <= 0 || height <= 0 || bits_per_sample != 8 ||
+      n_channels != (has_alpha ? 4 : 3) || rowstride < width * n_channels ||
+      g_bytes_get_size (bytes) < (gsize) rowstride * (height - 1) + width * n_channels)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Invalid image data (%dx%d, rowstride %d, %d channels)",
+                   width, height, rowstride, n_channels);
+      g_bytes_unref (bytes);
+      return NULL;
+    }
+
+  return gdk_pixbuf_new_from_data (g_bytes_get_data (bytes, NULL),
+                                   GDK_COLORSPACE_RGB, has_alpha, bits_per_sample,
+                                   width, height, rowstride,
+                                   free_image_data_bytes, bytes);
+}
+
+static GdkPixbuf *
+scale_pixbuf_to_size (GdkPixbuf *pixbuf,
+                      gint       size)
+{
+  gint width, height;
+  gdouble scale;
+
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+
+  if (size <= 0 || (width <= size && height <= size))
+    return g_object_ref (pixbuf);
+
+  scale = (gdouble) size / MAX (width, height);
+  return gdk_pixbuf_scale_simple (pixbuf,
+                                  MAX (1, (gint) (width * scale + 0.5)),
+                                  MAX (1, (gint) (height * scale + 0.5)),
+                                  GDK_INTERP_BILINEAR);
+}
+
+static void
+load_image_data_thread (GSimpleAsyncResult *result,
+                        GObject            *object,
+                        GCancellable       *cancellable)
+{
+  StTextureCachePrivate *priv = ST_TEXTURE_CACHE (object)->priv;
+  AsyncImageDataLoad *data;
+  GdkPixbuf *pixbuf, *scaled;
+  GError *error = NULL;
+  char *checksum, *key;
+
+  data = g_object_get_data (G_OBJECT (result), "load_image_data");
+  g_assert (data);
+
+  /* Applications tend to send the same image (an avatar, an album
+   * cover) over and over again, so we key on the content rather than
+   * on anything the sender tells us.
+   */
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+                                          g_variant_get_data (data->image_data),
+                                          g_variant_get_size (data->image_data));
+  key = g_strdup_printf (CACHE_PREFIX_IMAGE_DATA "%s:%d", checksum, data->size);
+  g_free (checksum);
+
+  g_mutex_lock (&priv->image_data_lock);
+  if (priv->image_data_cache)
+    {
+      scaled = g_hash_table_lookup (priv->image_data_cache, key);
+      if (scaled)
+        data->pixbuf = g_object_ref (scaled);
+    }
+  g_mutex_unlock (&priv->image_data_lock);
+
+  if (data->pixbuf)
+    {
+      g_free (key);
+      return;
+    }
+
+  pixbuf = pixbuf_from_image_data (data->image_data, &error);
+  if (pixbuf == NULL)
+    {
+      g_simple_async_result_take_error (result, error);
+      g_free (key);
+      return;
+    }
+
+  data->pixbuf = scale_pixbuf_to_size (pixbuf, data->size);
+  g_object_unref (pixbuf);
+
+  g_mutex_lock (&priv->image_data_lock);
+  if (priv->image_data_cache &&
+      !g_hash_table_contains (priv->image_data_cache, key))
+    {
+      g_hash_table_insert (priv->image_data_cache,
+                           g_strdup (key), g_object_ref (data->pixbuf));
+      g_queue_push_tail (priv->image_data_keys, key);
+      key = NULL;
+
+      while (g_queue_get_length (priv->image_data_keys) > IMAGE_DATA_CACHE_SIZE)
+        {
+          char *oldest = g_queue_pop_head (priv->image_data_keys);
+          g_hash_table_remove (priv->image_data_cache, oldest);
+          g_free (oldest);
+        }
+    }
+  g_mutex_unlock (&priv->image_data_lock);
+
+  g_free (key);
+}
+
+/**
+ * st_texture_cache_load_image_data_async:
+ * @cache: A #StTextureCache
+ * @image_data: A #GVariant of type (iiibiiay), as in the 'image-data'
+ *   hint of the notification specification
+ * @size: Size in pixels the image should fit in, or 0 to keep the original size
+ * @callback: (scope async): Function called when the image is loaded
+ * @user_data: (closure): Data to pass to the load callback
+ *
+ * Decodes raw image data in a thread, scaling it down to @size. The
+ * pixels are read straight from @image_data, and the scaled result is
+ * cached by content so that repeated images are only decoded once.
+ */
+void
+st_texture_cache_load_image_data_async (StTextureCache      *cache,
+                                        GVariant            *image_data,
+                                        gint                 size,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+  AsyncImageDataLoad *data;
+  GSimpleAsyncResult *result;
+
+  result = g_simple_async_result_new (G_OBJECT (cache), callback, user_data,
+                                      st_texture_cache_load_image_data_async);
+
+  if (!g_variant_is_of_type (image_data, G_VARIANT_TYPE ("(iiibiiay)")))
+    {
+      g_simple_async_result_set_error (result, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                                       "Image data has type '%s', expected '(iiibiiay)'",
+                                       g_variant_get_type_string (image_data));
+      g_simple_async_result_complete_in_idle (result);
+      g_object_unref (result);
+      return;
+    }
+
+  data = g_new0 (AsyncImageDataLoad, 1);
+  data->image_data = g_variant_ref_sink (image_data);
+  data->size = size;
+
+  g_object_set_data_full (G_OBJECT (result), "load_image_data", data, on_image_data_load_destroy);
+  g_simple_async_result_run_in_thread (result, load_image_data_thread, G_PRIORITY_DEFAULT, NULL);
+
+  g_object_unref (result);
+}
+
+/**
+ * st_texture_cache_load_image_data_finish:
+ * @cache: A #StTextureCache
+ * @result: A #GAsyncResult
+ * @error: A #GError, or %NULL
+ *
+ * Returns: (transfer full): a #GIcon for the loaded image, or %NULL on error
+ */
+GIcon *
+st_texture_cache_load_image_data_finish (StTextureCache *cache,
+                                         GAsyncResult   *result,
+                                         GError        **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+  AsyncImageDataLoad *data;
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  data = g_object_get_data (G_OBJECT (result), "load_image_data");
+  g_assert (data);
+
+  return G_ICON (g_object_ref (data->pixbuf));
+}
+
 /**
  * st_texture_cache_load_file_async:
  * @cache: The texture cache instance
@@ -1434,3 +1682,52 @@ st_texture_cache_get_default (void)
     instance = g_object_new (ST_TYPE_TEXTURE_CACHE, NULL);
   return instance;
 }
+
+/**
+ * st_texture_cache_get_memory_usage:
+ * @cache: A #StTextureCache
+ * @n_entries: (out) (allow-none): number of textures, surfaces and images held in the cache
+ * @n_bytes: (out) (allow-none): estimated memory used by the cached images
+ *
+ * Reports the size of the cache of textures that are kept around for
+ * reuse, keyed by icon, file or custom key, and of the images decoded
+ * by st_texture_cache_load_image_data_async().
+ */
+void
+st_texture_cache_get_memory_usage (StTextureCache *cache,
+                                   guint          *n_entries,
+                                   gsize          *n_bytes)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gsize bytes = 0;
+  guint n_images;
+
+  g_hash_table_iter_init (&iter, cache->priv->keyed_cache);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (g_str_has_prefix (key, CACHE_PREFIX_FILE_FOR_CAIRO))
+        {
+          cairo_surface_t *surface = value;
+
+          bytes += cairo_image_surface_get_stride (surface) *
+                   cairo_image_surface_get_height (surface);
+        }
+      else
+        {
+          bytes += _st_texture_get_memory_size (value);
+        }
+    }
+
+  g_mutex_lock (&cache->priv->image_data_lock);
+  n_images = g_hash_table_size (cache->priv->image_data_cache);
+  g_hash_table_iter_init (&iter, cache->priv->image_data_cache);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    bytes += gdk_pixbuf_get_rowstride (value) * gdk_pixbuf_get_height (value);
+  g_mutex_unlock (&cache->priv->image_data_lock);
+
+  if (n_entries)
+    *n_entries = g_hash_table_size (cache->priv->keyed_cache) + n_images;
+  if (n_bytes)
+    *n_bytes = bytes;
+}
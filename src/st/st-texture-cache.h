@@ -78,6 +78,16 @@ GList * st_texture_cache_load_sliced_image_finish (StTextureCache *cache,
                                                    GAsyncResult   *result,
                                                    GError        **error);
 
+void st_texture_cache_load_image_data_async (StTextureCache      *cache,
+                                             GVariant            *image_data,
+                                             gint                 size,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+
+GIcon * st_texture_cache_load_image_data_finish (StTextureCache *cache,
+                                                 GAsyncResult   *result,
+                                                 GError        **error);
+
 ClutterActor *st_texture_cache_bind_cairo_surface_property (StTextureCache    *cache,
                                                             GObject           *object,
                                                             const char        *property_name);
@@ -126,4 +136,8 @@ CoglHandle st_texture_cache_load (StTextureCache       *cache,
                                   void                 *data,
                                   GError              **error);
 
+void st_texture_cache_get_memory_usage (StTextureCache *cache,
+                                        guint          *n_entries,
+                                        gsize          *n_bytes);
+
 #endif /* __ST_TEXTURE_CACHE_H__ */
@@ -0,0 +1,870 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-theme-cache.c: On-disk cache of compiled stylesheets
+ *
+ * Copyright © 2014 Endless Mobile, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Parsing the shell stylesheet with libcroco is a noticeable part of
+ * startup, since it tokenizes the whole CSS text and builds the
+ * statement tree through the SAC callbacks. Once a stylesheet has been
+ * parsed, its tree is written to a compiled file in the user cache
+ * directory: selectors split into simple selectors with their
+ * combinators and additional selectors, and declarations with their
+ * terms already parsed into numbers, colors, identifiers and functions.
+ * The next time the stylesheet is loaded, the compiled file is mapped
+ * and the tree is rebuilt from it directly.
+ *
+ * A compiled file is keyed by the URI of the stylesheet and records a
+ * checksum of the CSS text it was compiled from; it is only used if
+ * the text is unchanged and it was written by the same format version.
+ * Only stylesheets made of plain rulesets are compiled; those with
+ * at-rules, attribute selectors or other constructs the theme code
+ * doesn't match against are always parsed.
+ */
+
+#include <string.h>
+
+#include "st-theme-private.h"
+
+/* Bump whenever the layout below changes */
+#define CACHE_FORMAT_VERSION 1
+
+#define CACHE_MAGIC "StCSS\0\0"
+#define CACHE_MAGIC_LENGTH 8
+#define CACHE_BYTE_ORDER 0x01020304
+
+/* Function terms can nest; this only guards against corrupt files */
+#define MAX_TERM_DEPTH 8
+
+/* Marks an absent (NULL) string */
+#define NO_STRING G_MAXUINT32
+
+/* Layout of a compiled stylesheet, all integers being 32-bit in host
+ * byte order and strings being a length followed by the bytes and a
+ * terminating nul:
+ *
+ *   header:       magic, version, byte order mark, checksum string
+ *   stylesheet:   count, ruleset*
+ *   ruleset:      count, selector*, count, declaration*
+ *   selector:     count, simple selector*
+ *   simple sel:   type mask, case sensitivity, combinator, name,
+ *                 count, additional selector*
+ *   additional:   type, then class or id name, or pseudo-class type,
+ *                 name and argument
+ *   declaration:  property, importance, count, term*
+ *   term:         type, unary operator, operator, then a number type
+ *                 and value, a string, a function name and count,
+ *                 term*, or the components and flags of a color
+ */
+
+typedef struct {
+  const char *data;
+  gsize length;
+  gsize pos;
+  gboolean failed;
+} CacheReader;
+
+static gchar *
+get_cache_path (GFile *file)
+{
+  gchar *uri, *name, *path;
+
+  uri = g_file_get_uri (file);
+  name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+  g_free (uri);
+
+  path = g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "stylesheets", name,
+                           NULL);
+  g_free (name);
+
+  return path;
+}
+
+/* Writing */
+
+static void
+write_uint (GByteArray *out,
+            guint32     value)
+{
+  g_byte_array_append (out, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_double (GByteArray *out,
+              gdouble     value)
+{
+  g_byte_array_append (out, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_string (GByteArray *out,
+              const char *str)
+{
+  gsize length;
+
+  if (str == NULL)
+    {
+      write_uint (out, NO_STRING);
+      return;
+    }
+
+  length = strlen (str);
+  write_uint (out, length);
+  g_byte_array_append (out, (const guint8 *) str, length + 1);
+}
+
+static void
+write_cr_string (GByteArray *out,
+                 CRString   *str)
+{
+  write_string (out, str && str->stryng ? str->stryng->str : NULL);
+}
+
+static gboolean
+write_terms (GByteArray *out,
+             CRTerm     *terms,
+             int         depth)
+{
+  CRTerm *term;
+  guint n_terms = 0;
+
+  if (depth > MAX_TERM_DEPTH)
+    return FALSE;
+
+  for (term = terms; term; term = term->next)
+    n_terms++;
+
+  write_uint (out, n_terms);
+
+  for (term = terms; term; term = term->next)
+    {
+      write_uint (out, term->type);
+      write_uint (out, term->unary_op);
+      write_uint (out, term->the_operator);
+
+      switch (term->type)
+        {
+        case TERM_NUMBER:
+          if (term->content.num == NULL)
+            return FALSE;
+          write_uint (out, term->content.num->type);
+          write_double (out, term->content.num->val);
+          break;
+
+        case TERM_FUNCTION:
+          write_cr_string (out, term->content.str);
+          if (!write_terms (out, term->ext_content.func_param, depth + 1))
+            return FALSE;
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          write_cr_string (out, term->content.str);
+          break;
+
+        case TERM_RGB:
+          if (term->content.rgb == NULL)
+            return FALSE;
+          write_uint (out, term->content.rgb->red);
+          write_uint (out, term->content.rgb->green);
+          write_uint (out, term->content.rgb->blue);
+          write_uint (out, term->content.rgb->is_percentage);
+          write_uint (out, term->content.rgb->inherit);
+          write_uint (out, term->content.rgb->is_transparent);
+          break;
+
+        default:
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_declarations (GByteArray    *out,
+                    CRDeclaration *decls)
+{
+  CRDeclaration *decl;
+  guint n_decls = 0;
+
+  for (decl = decls; decl; decl = decl->next)
+    n_decls++;
+
+  write_uint (out, n_decls);
+
+  for (decl = decls; decl; decl = decl->next)
+    {
+      if (decl->property == NULL || decl->property->stryng == NULL)
+        return FALSE;
+
+      write_cr_string (out, decl->property);
+      write_uint (out, decl->important);
+
+      if (!write_terms (out, decl->value, 0))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_additional_selectors (GByteArray      *out,
+                            CRAdditionalSel *add_sels)
+{
+  CRAdditionalSel *add_sel;
+  guint n_add_sels = 0;
+
+  for (add_sel = add_sels; add_sel; add_sel = add_sel->next)
+    n_add_sels++;
+
+  write_uint (out, n_add_sels);
+
+  for (add_sel = add_sels; add_sel; add_sel = add_sel->next)
+    {
+      write_uint (out, add_sel->type);
+
+      switch (add_sel->type)
+        {
+        case CLASS_ADD_SELECTOR:
+          write_cr_string (out, add_sel->content.class_name);
+          break;
+
+        case ID_ADD_SELECTOR:
+          write_cr_string (out, add_sel->content.id_name);
+          break;
+
+        case PSEUDO_CLASS_ADD_SELECTOR:
+          if (add_sel->content.pseudo == NULL)
+            return FALSE;
+          write_uint (out, add_sel->content.pseudo->type);
+          write_cr_string (out, add_sel->content.pseudo->name);
+          write_cr_string (out, add_sel->content.pseudo->extra);
+          break;
+
+        default:
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_selectors (GByteArray *out,
+                 CRSelector *selectors)
+{
+  CRSelector *selector;
+  CRSimpleSel *simple_sel;
+  guint n_selectors = 0, n_simple_sels;
+
+  for (selector = selectors; selector; selector = selector->next)
+    n_selectors++;
+
+  write_uint (out, n_selectors);
+
+  for (selector = selectors; selector; selector = selector->next)
+    {
+      if (selector->simple_sel == NULL)
+        return FALSE;
+
+      n_simple_sels = 0;
+      for (simple_sel = selector->simple_sel; simple_sel; simple_sel = simple_sel->next)
+        n_simple_sels++;
+
+      write_uint (out, n_simple_sels);
+
+      for (simple_sel = selector->simple_sel; simple_sel; simple_sel = simple_sel->next)
+        {
+          write_uint (out, simple_sel->type_mask);
+          write_uint (out, simple_sel->is_case_sentive);
+          write_uint (out, simple_sel->combinator);
+          write_cr_string (out, simple_sel->name);
+
+          if (!write_additional_selectors (out, simple_sel->add_sel))
+            return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static GByteArray *
+compile_stylesheet (CRStyleSheet *stylesheet,
+                    const char   *checksum)
+{
+  GByteArray *out;
+  CRStatement *stmt;
+  guint n_statements = 0;
+
+  for (stmt = stylesheet->statements; stmt; stmt = stmt->next)
+    {
+      if (stmt->type != RULESET_STMT || stmt->kind.ruleset == NULL ||
+          stmt->kind.ruleset->parent_media_rule != NULL)
+        return NULL;
+
+      n_statements++;
+    }
+
+  out = g_byte_array_new ();
+
+  g_byte_array_append (out, (const guint8 *) CACHE_MAGIC, CACHE_MAGIC_LENGTH);
+  write_uint (out, CACHE_FORMAT_VERSION);
+  write_uint (out, CACHE_BYTE_ORDER);
+  write_string (out, checksum);
+
+  write_uint (out, n_statements);
+
+  for (stmt = stylesheet->statements; stmt; stmt = stmt->next)
+    {
+      if (!write_selectors (out, stmt->kind.ruleset->sel_list) ||
+          !write_declarations (out, stmt->kind.ruleset->decl_list))
+        {
+          g_byte_array_free (out, TRUE);
+          return NULL;
+        }
+    }
+
+  return out;
+}
+
+/* Reading */
+
+static gboolean
+read_bytes (CacheReader *reader,
+            gpointer     dest,
+            gsize        size)
+{
+  if (reader->failed || reader->length - reader->pos < size)
+    {
+      reader->failed = TRUE;
+      return FALSE;
+    }
+
+  memcpy (dest, reader->data + reader->pos, size);
+  reader->pos += size;
+
+  return TRUE;
+}
+
+static guint32
+read_uint (CacheReader *reader)
+{
+  guint32 value = 0;
+
+  read_bytes (reader, &value, sizeof (value));
+
+  return value;
+}
+
+static gdouble
+read_double (CacheReader *reader)
+{
+  gdouble value = 0;
+
+  read_bytes (reader, &value, sizeof (value));
+
+  return value;
+}
+
+/* Reads an element count; each element takes at least one byte, so
+ * a count larger than what is left can only come from a corrupt file.
+ */
+static guint32
+read_count (CacheReader *reader)
+{
+  guint32 count = read_uint (reader);
+
+  if (count > reader->length - reader->pos)
+    {
+      reader->failed = TRUE;
+      return 0;
+    }
+
+  return count;
+}
+
+/* Returns a string pointing into the mapped file, or %NULL if the
+ * string is absent or the file is corrupt.
+ */
+static const char *
+read_string (CacheReader *reader)
+{
+  const char *str;
+  guint32 length;
+
+  length = read_uint (reader);
+  if (reader->failed || length == NO_STRING)
+    return NULL;
+
+  if (reader->length - reader->pos <= length ||
+      reader->data[reader->pos + length] != '\0')
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  str = reader->data + reader->pos;
+  reader->pos += length + 1;
+
+  return str;
+}
+
+static CRString *
+read_cr_string (CacheReader *reader)
+{
+  const char *str = read_string (reader);
+
+  return str ? cr_string_new_from_string (str) : NULL;
+}
+
+static CRTerm *
+read_terms (CacheReader *reader,
+            int          depth)
+{
+  CRTerm *terms = NULL, *tail = NULL;
+  guint32 n_terms, i;
+
+  if (depth > MAX_TERM_DEPTH)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  n_terms = read_count (reader);
+
+  for (i = 0; i < n_terms && !reader->failed; i++)
+    {
+      CRTerm *term = cr_term_new ();
+      CRString *str;
+      CRTerm *params;
+      CRRgb *rgb;
+      guint32 num_type, red, green, blue;
+      gdouble val;
+
+      term->type = read_uint (reader);
+      term->unary_op = read_uint (reader);
+      term->the_operator = read_uint (reader);
+
+      switch (term->type)
+        {
+        case TERM_NUMBER:
+          num_type = read_uint (reader);
+          val = read_double (reader);
+          term->content.num = cr_num_new_with_val (val, num_type);
+          break;
+
+        case TERM_FUNCTION:
+          str = read_cr_string (reader);
+          params = read_terms (reader, depth + 1);
+          term->content.str = str;
+          term->ext_content.func_param = params;
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          term->content.str = read_cr_string (reader);
+          break;
+
+        case TERM_RGB:
+          red = read_uint (reader);
+          green = read_uint (reader);
+          blue = read_uint (reader);
+          rgb = cr_rgb_new_with_vals ((gint32) red, (gint32) green, (gint32) blue,
+                                      read_uint (reader));
+          rgb->inherit = read_uint (reader);
+          rgb->is_transparent = read_uint (reader);
+          term->content.rgb = rgb;
+          break;
+
+        default:
+          /* Leave nothing for cr_term_destroy() to interpret */
+          term->type = TERM_NO_TYPE;
+          reader->failed = TRUE;
+          break;
+        }
+
+      if (tail)
+        {
+          tail->next = term;
+          term->prev = tail;
+        }
+      else
+        terms = term;
+      tail = term;
+    }
+
+  if (reader->failed && terms)
+    {
+      cr_term_destroy (terms);
+      terms = NULL;
+    }
+
+  return terms;
+}
+
+static CRDeclaration *
+read_declarations (CacheReader *reader)
+{
+  CRDeclaration *decls = NULL, *tail = NULL;
+  guint32 n_decls, i;
+
+  n_decls = read_count (reader);
+
+  for (i = 0; i < n_decls && !reader->failed; i++)
+    {
+      CRDeclaration *decl;
+      CRString *property;
+      CRTerm *value;
+      gboolean important;
+
+      property = read_cr_string (reader);
+      important = read_uint (reader);
+      value = read_terms (reader, 0);
+
+      if (property == NULL)
+        {
+          reader->failed = TRUE;
+          if (value)
+            cr_term_destroy (value);
+          break;
+        }
+
+      decl = cr_declaration_new (NULL, property, value);
+      decl->important = important;
+
+      if (tail)
+        {
+          tail->next = decl;
+          decl->prev = tail;
+        }
+      else
+        decls = decl;
+      tail = decl;
+    }
+
+  if (reader->failed && decls)
+    {
+      cr_declaration_destroy (decls);
+      decls = NULL;
+    }
+
+  return decls;
+}
+
+static CRAdditionalSel *
+read_additional_selectors (CacheReader *reader)
+{
+  CRAdditionalSel *add_sels = NULL, *tail = NULL;
+  guint32 n_add_sels, i;
+
+  n_add_sels = read_count (reader);
+
+  for (i = 0; i < n_add_sels && !reader->failed; i++)
+    {
+      CRAdditionalSel *add_sel;
+      CRPseudo *pseudo;
+      guint32 type;
+
+      type = read_uint (reader);
+
+      switch (type)
+        {
+        case CLASS_ADD_SELECTOR:
+          add_sel = cr_additional_sel_new_with_type (type);
+          cr_additional_sel_set_class_name (add_sel, read_cr_string (reader));
+          break;
+
+        case ID_ADD_SELECTOR:
+          add_sel = cr_additional_sel_new_with_type (type);
+          cr_additional_sel_set_id_name (add_sel, read_cr_string (reader));
+          break;
+
+        case PSEUDO_CLASS_ADD_SELECTOR:
+          add_sel = cr_additional_sel_new_with_type (type);
+          pseudo = cr_pseudo_new ();
+          pseudo->type = read_uint (reader);
+          pseudo->name = read_cr_string (reader);
+          pseudo->extra = read_cr_string (reader);
+          cr_additional_sel_set_pseudo (add_sel, pseudo);
+          break;
+
+        default:
+          reader->failed = TRUE;
+          add_sel = NULL;
+          break;
+        }
+
+      if (add_sel == NULL)
+        break;
+
+      if (tail)
+        {
+          tail->next = add_sel;
+          add_sel->prev = tail;
+        }
+      else
+        add_sels = add_sel;
+      tail = add_sel;
+    }
+
+  if (reader->failed && add_sels)
+    {
+      cr_additional_sel_destroy (add_sels);
+      add_sels = NULL;
+    }
+
+  return add_sels;
+}
+
+static CRSimpleSel *
+read_simple_selectors (CacheReader *reader)
+{
+  CRSimpleSel *simple_sels = NULL, *tail = NULL;
+  guint32 n_simple_sels, i;
+
+  n_simple_sels = read_count (reader);
+
+  for (i = 0; i < n_simple_sels && !reader->failed; i++)
+    {
+      CRSimpleSel *simple_sel = cr_simple_sel_new ();
+
+      simple_sel->type_mask = read_uint (reader);
+      simple_sel->is_case_sentive = read_uint (reader);
+      simple_sel->combinator = read_uint (reader);
+      simple_sel->name = read_cr_string (reader);
+      simple_sel->add_sel = read_additional_selectors (reader);
+
+      if (tail)
+        {
+          tail->next = simple_sel;
+          simple_sel->prev = tail;
+        }
+      else
+        simple_sels = simple_sel;
+      tail = simple_sel;
+    }
+
+  if (reader->failed && simple_sels)
+    {
+      cr_simple_sel_destroy (simple_sels);
+      simple_sels = NULL;
+    }
+
+  return simple_sels;
+}
+
+static CRSelector *
+read_selectors (CacheReader *reader)
+{
+  CRSelector *selectors = NULL, *tail = NULL;
+  guint32 n_selectors, i;
+
+  n_selectors = read_count (reader);
+
+  for (i = 0; i < n_selectors && !reader->failed; i++)
+    {
+      CRSimpleSel *simple_sels;
+      CRSelector *selector;
+
+      simple_sels = read_simple_selectors (reader);
+      if (simple_sels == NULL)
+        {
+          reader->failed = TRUE;
+          break;
+        }
+
+      selector = cr_selector_new (simple_sels);
+
+      if (tail)
+        {
+          tail->next = selector;
+          selector->prev = tail;
+        }
+      else
+        selectors = selector;
+      tail = selector;
+    }
+
+  if (reader->failed && selectors)
+    {
+      cr_selector_destroy (selectors);
+      selectors = NULL;
+    }
+
+  return selectors;
+}
+
+static CRStyleSheet *
+load_compiled_stylesheet (CacheReader *reader,
+                          const char  *checksum)
+{
+  CRStyleSheet *stylesheet;
+  CRStatement *tail = NULL;
+  const char *compiled_checksum;
+  char magic[CACHE_MAGIC_LENGTH];
+  guint32 n_statements, i;
+
+  if (!read_bytes (reader, magic, CACHE_MAGIC_LENGTH) ||
+      memcmp (magic, CACHE_MAGIC, CACHE_MAGIC_LENGTH) != 0 ||
+      read_uint (reader) != CACHE_FORMAT_VERSION ||
+      read_uint (reader) != CACHE_BYTE_ORDER)
+    return NULL;
+
+  compiled_checksum = read_string (reader);
+  if (compiled_checksum == NULL || strcmp (compiled_checksum, checksum) != 0)
+    return NULL;
+
+  stylesheet = cr_stylesheet_new (NULL);
+
+  n_statements = read_count (reader);
+
+  for (i = 0; i < n_statements && !reader->failed; i++)
+    {
+      CRSelector *selectors;
+      CRDeclaration *decls, *decl;
+      CRStatement *stmt;
+
+      selectors = read_selectors (reader);
+      decls = read_declarations (reader);
+
+      if (reader->failed)
+        {
+          if (selectors)
+            cr_selector_destroy (selectors);
+          if (decls)
+            cr_declaration_destroy (decls);
+          break;
+        }
+
+      stmt = cr_statement_new_ruleset (stylesheet, selectors, decls, NULL);
+
+      for (decl = decls; decl; decl = decl->next)
+        decl->parent_statement = stmt;
+
+      if (tail)
+        {
+          tail->next = stmt;
+          stmt->prev = tail;
+        }
+      else
+        stylesheet->statements = stmt;
+      tail = stmt;
+    }
+
+  if (reader->failed || reader->pos != reader->length)
+    {
+      cr_stylesheet_destroy (stylesheet);
+      return NULL;
+    }
+
+  return stylesheet;
+}
+
+/**
+ * _st_theme_cache_load:
+ * @file: the stylesheet file
+ * @contents: the CSS text of @file
+ * @length: the length of @contents
+ *
+ * Loads the compiled form of @file from the cache.
+ *
+ * Return value: the stylesheet, or %NULL if it isn't cached or the
+ *   cached copy was compiled from a different text
+ */
+CRStyleSheet *
+_st_theme_cache_load (GFile      *file,
+                      const char *contents,
+                      gsize       length)
+{
+  CRStyleSheet *stylesheet;
+  GMappedFile *mapped;
+  CacheReader reader = { NULL, };
+  gchar *path, *checksum;
+
+  path = get_cache_path (file);
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+
+  if (mapped == NULL)
+    return NULL;
+
+  reader.data = g_mapped_file_get_contents (mapped);
+  reader.length = g_mapped_file_get_length (mapped);
+
+  if (reader.data == NULL)
+    {
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+                                          (const guchar *) contents, length);
+  stylesheet = load_compiled_stylesheet (&reader, checksum);
+  g_free (checksum);
+
+  g_mapped_file_unref (mapped);
+
+  return stylesheet;
+}
+
+/**
+ * _st_theme_cache_save:
+ * @file: the stylesheet file
+ * @contents: the CSS text of @file
+ * @length: the length of @contents
+ * @stylesheet: the stylesheet parsed from @contents
+ *
+ * Writes the compiled form of @stylesheet to the cache, if it only
+ * contains constructs the compiled format can represent.
+ */
+void
+_st_theme_cache_save (GFile        *file,
+                      const char   *contents,
+                      gsize         length,
+                      CRStyleSheet *stylesheet)
+{
+  GByteArray *compiled;
+  GError *error = NULL;
+  gchar *path, *dir, *checksum;
+
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+                                          (const guchar *) contents, length);
+  compiled = compile_stylesheet (stylesheet, checksum);
+  g_free (checksum);
+
+  if (compiled == NULL)
+    return;
+
+  path = get_cache_path (file);
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0700);
+
+  if (!g_file_set_contents (path, (const gchar *) compiled->data, compiled->len, &error))
+    {
+      g_warning ("Unable to save the compiled stylesheet: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+  g_byte_array_free (compiled, TRUE);
+}
@@ -24,6 +24,7 @@
 #include "st-texture-cache.h"
 #include "st-theme.h"
 #include "st-theme-context.h"
+#include "st-theme-node-private.h"
 
 struct _StThemeContext {
   GObject parent;
@@ -333,3 +334,38 @@ st_theme_context_intern_node (StThemeContext *context,
   g_hash_table_add (context->nodes, g_object_ref (node));
   return node;
 }
+
+/**
+ * st_theme_context_get_memory_usage:
+ * @context: a #StThemeContext
+ * @n_nodes: (out) (allow-none): number of interned theme nodes
+ * @n_bytes: (out) (allow-none): estimated memory used by the interned nodes
+ *
+ * Reports the size of the table of theme nodes that @context shares
+ * between widgets with the same style. The byte count includes the nodes
+ * themselves and their computed property arrays, but not the
+ * stylesheet declarations they point to.
+ */
+void
+st_theme_context_get_memory_usage (StThemeContext *context,
+                                   guint          *n_nodes,
+                                   gsize          *n_bytes)
+{
+  GHashTableIter iter;
+  gpointer key;
+  gsize bytes = 0;
+
+  g_hash_table_iter_init (&iter, context->nodes);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      StThemeNode *node = key;
+
+      bytes += sizeof (StThemeNode);
+      bytes += node->n_properties * sizeof (CRDeclaration *);
+    }
+
+  if (n_nodes)
+    *n_nodes = g_hash_table_size (context->nodes);
+  if (n_bytes)
+    *n_bytes = bytes;
+}
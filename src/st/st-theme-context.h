@@ -65,6 +65,10 @@ StThemeNode *               st_theme_context_get_root_node  (StThemeContext
 StThemeNode *               st_theme_context_intern_node    (StThemeContext             *context,
                                                              StThemeNode                *node);
 
+void                        st_theme_context_get_memory_usage (StThemeContext           *context,
+                                                               guint                    *n_nodes,
+                                                               gsize                    *n_bytes);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_CONTEXT_H__ */
@@ -1265,6 +1265,8 @@ st_theme_node_prerender_background (StThemeNode *node,
   cairo_surface_destroy (surface);
   g_free (data);
 
+  _st_texture_track_memory (texture, ST_TEXTURE_MEMORY_PRERENDERED);
+
   return texture;
 }
 
@@ -2373,25 +2375,12 @@ st_theme_node_needs_new_box_shadow_for_size (StThemeNodePaintState *state,
   return FALSE;
 }
 
-void
-st_theme_node_paint (StThemeNode           *node,
-                     StThemeNodePaintState *state,
-                     const ClutterActorBox *box,
-                     guint8                 paint_opacity)
+static void
+st_theme_node_prepare_paint_state (StThemeNode           *node,
+                                   StThemeNodePaintState *state,
+                                   float                  width,
+                                   float                  height)
 {
-  float width, height;
-  ClutterActorBox allocation;
-
-  /* Some things take an ActorBox, some things just width/height */
-  width = box->x2 - box->x1;
-  height = box->y2 - box->y1;
-  allocation.x1 = allocation.y1 = 0;
-  allocation.x2 = width;
-  allocation.y2 = height;
-
-  if (width <= 0 || height <= 0)
-    return;
-
   /* Check whether we need to recreate the textures of the paint
    * state, either because :
    *  1) the theme node associated to the paint state has changed
@@ -2414,6 +2403,65 @@ st_theme_node_paint (StThemeNode           *node,
     }
   else if (state->alloc_width != width || state->alloc_height != height)
     st_theme_node_update_resources (state, node, width, height);
+}
+
+/* Makes sure @state holds the resources to paint @node at the size of
+ * @box and, if painting it draws nothing but the prerendered background
+ * (no box shadow, border image or outline), returns that texture along
+ * with the area it covers, relative to the origin of @box. Transitions
+ * use this to cross-fade two backgrounds without offscreen rendering.
+ */
+CoglHandle
+_st_theme_node_paint_state_get_prerendered (StThemeNode           *node,
+                                            StThemeNodePaintState *state,
+                                            const ClutterActorBox *box,
+                                            ClutterActorBox       *paint_box)
+{
+  float width, height;
+  ClutterActorBox allocation;
+
+  width = box->x2 - box->x1;
+  height = box->y2 - box->y1;
+  allocation.x1 = allocation.y1 = 0;
+  allocation.x2 = width;
+  allocation.y2 = height;
+
+  if (width <= 0 || height <= 0)
+    return COGL_INVALID_HANDLE;
+
+  st_theme_node_prepare_paint_state (node, state, width, height);
+
+  if (state->prerendered_texture == COGL_INVALID_HANDLE ||
+      state->box_shadow_material != COGL_INVALID_HANDLE ||
+      st_theme_node_load_border_image (node) ||
+      st_theme_node_get_outline_width (node) != 0)
+    return COGL_INVALID_HANDLE;
+
+  st_theme_node_get_background_paint_box (node, &allocation, paint_box);
+
+  return state->prerendered_texture;
+}
+
+void
+st_theme_node_paint (StThemeNode           *node,
+                     StThemeNodePaintState *state,
+                     const ClutterActorBox *box,
+                     guint8                 paint_opacity)
+{
+  float width, height;
+  ClutterActorBox allocation;
+
+  /* Some things take an ActorBox, some things just width/height */
+  width = box->x2 - box->x1;
+  height = box->y2 - box->y1;
+  allocation.x1 = allocation.y1 = 0;
+  allocation.x2 = width;
+  allocation.y2 = height;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  st_theme_node_prepare_paint_state (node, state, width, height);
 
   /* Rough notes about the relationship of borders and backgrounds in CSS3;
    * see http://www.w3.org/TR/css3-background/ for more accurate details.
@@ -2579,6 +2627,29 @@ st_theme_node_paint_state_free (StThemeNodePaintState *state)
   st_theme_node_paint_state_node_free_internal (state, TRUE);
 }
 
+/**
+ * st_theme_node_get_texture_memory_usage:
+ * @n_prerendered: (out) (allow-none): number of live prerendered backgrounds
+ * @prerendered_bytes: (out) (allow-none): estimated size of the prerendered backgrounds
+ * @n_shadows: (out) (allow-none): number of live blurred shadow textures
+ * @shadow_bytes: (out) (allow-none): estimated size of the shadow textures
+ *
+ * Reports the textures that St has rendered itself for painting theme
+ * nodes and shadows and that haven't been freed yet, for finding leaks
+ * and sizing caches.
+ */
+void
+st_theme_node_get_texture_memory_usage (guint *n_prerendered,
+                                        gsize *prerendered_bytes,
+                                        guint *n_shadows,
+                                        gsize *shadow_bytes)
+{
+  _st_texture_get_tracked_memory (ST_TEXTURE_MEMORY_PRERENDERED,
+                                  n_prerendered, prerendered_bytes);
+  _st_texture_get_tracked_memory (ST_TEXTURE_MEMORY_SHADOW,
+                                  n_shadows, shadow_bytes);
+}
+
 void
 st_theme_node_paint_state_init (StThemeNodePaintState *state)
 {
@@ -84,6 +84,17 @@ struct _StThemeNode {
   CRDeclaration **properties;
   int n_properties;
 
+  /* The property name id of each declaration, and the index of the
+   * previous declaration of the same property (or -1); property_table
+   * is an open-addressed hash from id to the last such declaration. */
+  GQuark *property_ids;
+  int *property_prev;
+  int *property_table;
+  guint property_table_mask;
+
+  /* Results of the generic lookups, including inherited values */
+  GHashTable *resolved_values;
+
   /* We hold onto these separately so we can destroy them on finalize */
   CRDeclaration *inline_properties;
 
@@ -122,6 +133,11 @@ struct _StThemeNodeClass {
 void _st_theme_node_ensure_background (StThemeNode *node);
 void _st_theme_node_ensure_geometry (StThemeNode *node);
 
+CoglHandle _st_theme_node_paint_state_get_prerendered (StThemeNode           *node,
+                                                       StThemeNodePaintState *state,
+                                                       const ClutterActorBox *box,
+                                                       ClutterActorBox       *paint_box);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_NODE_PRIVATE_H__ */
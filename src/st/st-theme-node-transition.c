@@ -19,7 +19,10 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define COGL_ENABLE_EXPERIMENTAL_API
+
 #include "st-theme-node-transition.h"
+#include "st-theme-node-private.h"
 
 enum {
   COMPLETED,
@@ -27,6 +30,24 @@ enum {
   LAST_SIGNAL
 };
 
+/* Offscreen buffers are shared between all transitions; their sizes are
+ * rounded up to a multiple of FRAMEBUFFER_BUCKET_SIZE so that widgets of
+ * similar sizes (buttons, menu items, app icons) reuse the same ones.
+ */
+#define FRAMEBUFFER_BUCKET_SIZE 32
+#define MAX_POOLED_FRAMEBUFFERS 16
+
+typedef struct {
+  CoglHandle texture;
+  CoglHandle offscreen;
+
+  guint width;
+  guint height;
+} StTransitionFramebuffer;
+
+static GSList *framebuffer_pool = NULL;
+static guint framebuffer_pool_length = 0;
+
 #define ST_THEME_NODE_TRANSITION_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), ST_TYPE_THEME_NODE_TRANSITION, StThemeNodeTransitionPrivate))
 
 struct _StThemeNodeTransitionPrivate {
@@ -36,11 +57,8 @@ struct _StThemeNodeTransitionPrivate {
   StThemeNodePaintState old_paint_state;
   StThemeNodePaintState new_paint_state;
 
-  CoglHandle old_texture;
-  CoglHandle new_texture;
-
-  CoglHandle old_offscreen;
-  CoglHandle new_offscreen;
+  StTransitionFramebuffer *old_framebuffer;
+  StTransitionFramebuffer *new_framebuffer;
 
   CoglHandle material;
 
@@ -51,6 +69,7 @@ struct _StThemeNodeTransitionPrivate {
 
   ClutterActorBox last_allocation;
   ClutterActorBox offscreen_box;
+  float tex_coords[8];
 
   gboolean needs_setup;
 };
@@ -189,6 +208,7 @@ st_theme_node_transition_update (StThemeNodeTransition *transition,
           priv->new_theme_node = g_object_ref (new_node);
 
           st_theme_node_paint_state_invalidate (&priv->new_paint_state);
+          priv->needs_setup = TRUE;
         }
     }
 }
@@ -230,89 +250,240 @@ st_theme_node_transition_get_paint_box (StThemeNodeTransition *transition,
   paint_box->y2 = MAX (old_node_box.y2, new_node_box.y2);
 }
 
-static gboolean
-setup_framebuffers (StThemeNodeTransition *transition,
-                    const ClutterActorBox *allocation)
+static void
+framebuffer_free (StTransitionFramebuffer *framebuffer)
+{
+  cogl_handle_unref (framebuffer->offscreen);
+  cogl_handle_unref (framebuffer->texture);
+
+  g_slice_free (StTransitionFramebuffer, framebuffer);
+}
+
+static StTransitionFramebuffer *
+framebuffer_acquire (guint width,
+                     guint height)
+{
+  StTransitionFramebuffer *framebuffer;
+  CoglHandle texture, offscreen;
+  GSList *l;
+
+  width = (width + FRAMEBUFFER_BUCKET_SIZE - 1) / FRAMEBUFFER_BUCKET_SIZE * FRAMEBUFFER_BUCKET_SIZE;
+  height = (height + FRAMEBUFFER_BUCKET_SIZE - 1) / FRAMEBUFFER_BUCKET_SIZE * FRAMEBUFFER_BUCKET_SIZE;
+
+  for (l = framebuffer_pool; l; l = l->next)
+    {
+      framebuffer = l->data;
+
+      if (framebuffer->width == width && framebuffer->height == height)
+        {
+          framebuffer_pool = g_slist_delete_link (framebuffer_pool, l);
+          framebuffer_pool_length--;
+          return framebuffer;
+        }
+    }
+
+  texture = cogl_texture_new_with_size (width, height,
+                                        COGL_TEXTURE_NO_SLICING,
+                                        COGL_PIXEL_FORMAT_ANY);
+  if (texture == COGL_INVALID_HANDLE)
+    return NULL;
+
+  offscreen = cogl_offscreen_new_to_texture (texture);
+  if (offscreen == COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (texture);
+      return NULL;
+    }
+
+  framebuffer = g_slice_new (StTransitionFramebuffer);
+  framebuffer->texture = texture;
+  framebuffer->offscreen = offscreen;
+  framebuffer->width = width;
+  framebuffer->height = height;
+
+  return framebuffer;
+}
+
+static void
+framebuffer_release (StTransitionFramebuffer *framebuffer)
+{
+  /* Most recently released buffers go first, so the ones we drop
+   * when the pool is full are those that have been idle longest */
+  framebuffer_pool = g_slist_prepend (framebuffer_pool, framebuffer);
+  framebuffer_pool_length++;
+
+  if (framebuffer_pool_length > MAX_POOLED_FRAMEBUFFERS)
+    {
+      GSList *last = g_slist_last (framebuffer_pool);
+
+      framebuffer_free (last->data);
+      framebuffer_pool = g_slist_delete_link (framebuffer_pool, last);
+      framebuffer_pool_length--;
+    }
+}
+
+static void
+release_framebuffers (StThemeNodeTransition *transition)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+
+  if (priv->old_framebuffer)
+    {
+      framebuffer_release (priv->old_framebuffer);
+      priv->old_framebuffer = NULL;
+    }
+
+  if (priv->new_framebuffer)
+    {
+      framebuffer_release (priv->new_framebuffer);
+      priv->new_framebuffer = NULL;
+    }
+}
+
+static void
+ensure_material (StThemeNodeTransition *transition)
 {
   StThemeNodeTransitionPrivate *priv = transition->priv;
-  CoglColor clear_color = { 0, 0, 0, 0 };
-  guint width, height;
 
   /* template material to avoid unnecessary shader compilation */
   static CoglHandle material_template = COGL_INVALID_HANDLE;
 
-  width  = priv->offscreen_box.x2 - priv->offscreen_box.x1;
-  height = priv->offscreen_box.y2 - priv->offscreen_box.y1;
+  if (priv->material != NULL)
+    return;
 
-  g_return_val_if_fail (width  > 0, FALSE);
-  g_return_val_if_fail (height > 0, FALSE);
+  if (G_UNLIKELY (material_template == COGL_INVALID_HANDLE))
+    {
+      material_template = cogl_material_new ();
+
+      cogl_material_set_layer_combine (material_template, 0,
+                                       "RGBA = REPLACE (TEXTURE)",
+                                       NULL);
+      cogl_material_set_layer_combine (material_template, 1,
+                                       "RGBA = INTERPOLATE (PREVIOUS, "
+                                                           "TEXTURE, "
+                                                           "CONSTANT[A])",
+                                       NULL);
+      cogl_material_set_layer_combine (material_template, 2,
+                                       "RGBA = MODULATE (PREVIOUS, "
+                                                        "PRIMARY)",
+                                       NULL);
+    }
+  priv->material = cogl_material_copy (material_template);
+}
 
-  if (priv->old_texture)
-    cogl_handle_unref (priv->old_texture);
-  priv->old_texture = cogl_texture_new_with_size (width, height,
-                                                  COGL_TEXTURE_NO_SLICING,
-                                                  COGL_PIXEL_FORMAT_ANY);
+static void
+set_tex_coords (StThemeNodeTransition *transition,
+                float                  s,
+                float                  t)
+{
+  float *tex_coords = transition->priv->tex_coords;
 
-  if (priv->new_texture)
-    cogl_handle_unref (priv->new_texture);
-  priv->new_texture = cogl_texture_new_with_size (width, height,
-                                                  COGL_TEXTURE_NO_SLICING,
-                                                  COGL_PIXEL_FORMAT_ANY);
+  tex_coords[0] = tex_coords[4] = 0.0;
+  tex_coords[1] = tex_coords[5] = 0.0;
+  tex_coords[2] = tex_coords[6] = s;
+  tex_coords[3] = tex_coords[7] = t;
+}
 
-  g_return_val_if_fail (priv->old_texture != COGL_INVALID_HANDLE, FALSE);
-  g_return_val_if_fail (priv->new_texture != COGL_INVALID_HANDLE, FALSE);
+/* If both nodes paint nothing but a prerendered background of the same
+ * size, cross-fading the two textures directly gives the same result as
+ * going through offscreen buffers, at a fraction of the cost.
+ */
+static gboolean
+setup_direct (StThemeNodeTransition *transition,
+              const ClutterActorBox *allocation)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+  CoglHandle old_texture, new_texture;
+  ClutterActorBox old_box, new_box;
 
-  if (priv->old_offscreen)
-    cogl_handle_unref (priv->old_offscreen);
-  priv->old_offscreen = cogl_offscreen_new_to_texture (priv->old_texture);
+  old_texture = _st_theme_node_paint_state_get_prerendered (priv->old_theme_node,
+                                                            &priv->old_paint_state,
+                                                            allocation,
+                                                            &old_box);
+  if (old_texture == COGL_INVALID_HANDLE)
+    return FALSE;
 
-  if (priv->new_offscreen)
-    cogl_handle_unref (priv->new_offscreen);
-  priv->new_offscreen = cogl_offscreen_new_to_texture (priv->new_texture);
+  new_texture = _st_theme_node_paint_state_get_prerendered (priv->new_theme_node,
+                                                            &priv->new_paint_state,
+                                                            allocation,
+                                                            &new_box);
+  if (new_texture == COGL_INVALID_HANDLE)
+    return FALSE;
 
-  g_return_val_if_fail (priv->old_offscreen != COGL_INVALID_HANDLE, FALSE);
-  g_return_val_if_fail (priv->new_offscreen != COGL_INVALID_HANDLE, FALSE);
+  if (!clutter_actor_box_equal (&old_box, &new_box))
+    return FALSE;
 
-  if (priv->material == NULL)
-    {
-      if (G_UNLIKELY (material_template == COGL_INVALID_HANDLE))
-        {
-          material_template = cogl_material_new ();
-
-          cogl_material_set_layer_combine (material_template, 0,
-                                           "RGBA = REPLACE (TEXTURE)",
-                                           NULL);
-          cogl_material_set_layer_combine (material_template, 1,
-                                           "RGBA = INTERPOLATE (PREVIOUS, "
-                                                               "TEXTURE, "
-                                                               "CONSTANT[A])",
-                                           NULL);
-          cogl_material_set_layer_combine (material_template, 2,
-                                           "RGBA = MODULATE (PREVIOUS, "
-                                                            "PRIMARY)",
-                                           NULL);
-        }
-      priv->material = cogl_material_copy (material_template);
-    }
+  release_framebuffers (transition);
+  ensure_material (transition);
 
-  cogl_material_set_layer (priv->material, 0, priv->new_texture);
-  cogl_material_set_layer (priv->material, 1, priv->old_texture);
+  cogl_material_set_layer (priv->material, 0, new_texture);
+  cogl_material_set_layer (priv->material, 1, old_texture);
 
-  cogl_push_framebuffer (priv->old_offscreen);
-  cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
-  cogl_ortho (priv->offscreen_box.x1, priv->offscreen_box.x2,
-              priv->offscreen_box.y2, priv->offscreen_box.y1,
-              0.0, 1.0);
-  st_theme_node_paint (priv->old_theme_node, &priv->old_paint_state, allocation, 255);
-  cogl_pop_framebuffer ();
+  priv->offscreen_box = new_box;
+  set_tex_coords (transition, 1.0, 1.0);
+
+  return TRUE;
+}
 
-  cogl_push_framebuffer (priv->new_offscreen);
+static void
+paint_offscreen (StThemeNodeTransition   *transition,
+                 StTransitionFramebuffer *framebuffer,
+                 StThemeNode             *node,
+                 StThemeNodePaintState   *state,
+                 const ClutterActorBox   *allocation)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+  CoglColor clear_color = { 0, 0, 0, 0 };
+
+  /* Pooled buffers may be larger than needed; only render to the
+   * top-left corner, which is what we sample from when painting */
+  cogl_framebuffer_set_viewport (framebuffer->offscreen, 0, 0,
+                                 priv->offscreen_box.x2 - priv->offscreen_box.x1,
+                                 priv->offscreen_box.y2 - priv->offscreen_box.y1);
+
+  cogl_push_framebuffer (framebuffer->offscreen);
   cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
   cogl_ortho (priv->offscreen_box.x1, priv->offscreen_box.x2,
               priv->offscreen_box.y2, priv->offscreen_box.y1,
               0.0, 1.0);
-  st_theme_node_paint (priv->new_theme_node, &priv->new_paint_state, allocation, 255);
+  st_theme_node_paint (node, state, allocation, 255);
   cogl_pop_framebuffer ();
+}
+
+static gboolean
+setup_framebuffers (StThemeNodeTransition *transition,
+                    const ClutterActorBox *allocation)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+  guint width, height;
+
+  width  = priv->offscreen_box.x2 - priv->offscreen_box.x1;
+  height = priv->offscreen_box.y2 - priv->offscreen_box.y1;
+
+  g_return_val_if_fail (width  > 0, FALSE);
+  g_return_val_if_fail (height > 0, FALSE);
+
+  release_framebuffers (transition);
+
+  priv->old_framebuffer = framebuffer_acquire (width, height);
+  priv->new_framebuffer = framebuffer_acquire (width, height);
+
+  g_return_val_if_fail (priv->old_framebuffer != NULL, FALSE);
+  g_return_val_if_fail (priv->new_framebuffer != NULL, FALSE);
+
+  ensure_material (transition);
+
+  cogl_material_set_layer (priv->material, 0, priv->new_framebuffer->texture);
+  cogl_material_set_layer (priv->material, 1, priv->old_framebuffer->texture);
+
+  set_tex_coords (transition,
+                  (float) width / priv->new_framebuffer->width,
+                  (float) height / priv->new_framebuffer->height);
+
+  paint_offscreen (transition, priv->old_framebuffer,
+                   priv->old_theme_node, &priv->old_paint_state, allocation);
+  paint_offscreen (transition, priv->new_framebuffer,
+                   priv->new_theme_node, &priv->new_paint_state, allocation);
 
   return TRUE;
 }
@@ -325,10 +496,6 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
   StThemeNodeTransitionPrivate *priv = transition->priv;
 
   CoglColor constant;
-  float tex_coords[] = {
-    0.0, 0.0, 1.0, 1.0,
-    0.0, 0.0, 1.0, 1.0,
-  };
 
   g_return_if_fail (ST_IS_THEME_NODE (priv->old_theme_node));
   g_return_if_fail (ST_IS_THEME_NODE (priv->new_theme_node));
@@ -341,7 +508,8 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
       priv->last_allocation = *allocation;
 
       calculate_offscreen_box (transition, allocation);
-      priv->needs_setup = !setup_framebuffers (transition, allocation);
+      priv->needs_setup = !setup_direct (transition, allocation) &&
+                          !setup_framebuffers (transition, allocation);
 
       if (priv->needs_setup) /* setting up framebuffers failed */
         return;
@@ -360,7 +528,7 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
                                            priv->offscreen_box.y1,
                                            priv->offscreen_box.x2,
                                            priv->offscreen_box.y2,
-                                           tex_coords, 8);
+                                           priv->tex_coords, 8);
 }
 
 static void
@@ -380,29 +548,7 @@ st_theme_node_transition_dispose (GObject *object)
       priv->new_theme_node = NULL;
     }
 
-  if (priv->old_texture)
-    {
-      cogl_handle_unref (priv->old_texture);
-      priv->old_texture = NULL;
-    }
-
-  if (priv->new_texture)
-    {
-      cogl_handle_unref (priv->new_texture);
-      priv->new_texture = NULL;
-    }
-
-  if (priv->old_offscreen)
-    {
-      cogl_handle_unref (priv->old_offscreen);
-      priv->old_offscreen = NULL;
-    }
-
-  if (priv->new_offscreen)
-    {
-      cogl_handle_unref (priv->new_offscreen);
-      priv->new_offscreen = NULL;
-    }
+  release_framebuffers (ST_THEME_NODE_TRANSITION (object));
 
   if (priv->material)
     {
@@ -440,11 +586,8 @@ st_theme_node_transition_init (StThemeNodeTransition *transition)
   transition->priv->old_theme_node = NULL;
   transition->priv->new_theme_node = NULL;
 
-  transition->priv->old_texture = NULL;
-  transition->priv->new_texture = NULL;
-
-  transition->priv->old_offscreen = NULL;
-  transition->priv->new_offscreen = NULL;
+  transition->priv->old_framebuffer = NULL;
+  transition->priv->new_framebuffer = NULL;
 
   st_theme_node_paint_state_init (&transition->priv->old_paint_state);
   st_theme_node_paint_state_init (&transition->priv->new_paint_state);
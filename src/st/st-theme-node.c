@@ -73,6 +73,32 @@ on_custom_stylesheets_changed (StTheme *theme,
 {
   StThemeNode *node = data;
   node->properties_computed = FALSE;
+
+  if (node->resolved_values)
+    g_hash_table_remove_all (node->resolved_values);
+}
+
+static void
+clear_properties (StThemeNode *node)
+{
+  g_free (node->properties);
+  node->properties = NULL;
+  node->n_properties = 0;
+
+  g_free (node->property_ids);
+  node->property_ids = NULL;
+  g_free (node->property_prev);
+  node->property_prev = NULL;
+  g_free (node->property_table);
+  node->property_table = NULL;
+  node->property_table_mask = 0;
+
+  if (node->inline_properties)
+    {
+      /* This destroys the list, not just the head of the list */
+      cr_declaration_destroy (node->inline_properties);
+      node->inline_properties = NULL;
+    }
 }
 
 
@@ -120,18 +146,10 @@ st_theme_node_finalize (GObject *object)
   g_strfreev (node->pseudo_classes);
   g_free (node->inline_style);
 
-  if (node->properties)
-    {
-      g_free (node->properties);
-      node->properties = NULL;
-      node->n_properties = 0;
-    }
+  clear_properties (node);
 
-  if (node->inline_properties)
-    {
-      /* This destroys the list, not just the head of the list */
-      cr_declaration_destroy (node->inline_properties);
-    }
+  if (node->resolved_values)
+    g_hash_table_destroy (node->resolved_values);
 
   if (node->font_desc)
     {
@@ -461,6 +479,47 @@ st_theme_node_hash (StThemeNode *node)
   return hash;
 }
 
+/* Builds the table used to find the declarations of a property
+ * without comparing its name against all of them.
+ */
+static void
+build_property_table (StThemeNode *node)
+{
+  guint size, slot;
+  int i;
+
+  for (size = 8; size < 2 * (guint) node->n_properties; size *= 2)
+    ;
+
+  node->property_ids = g_new (GQuark, node->n_properties);
+  node->property_prev = g_new (int, node->n_properties);
+  node->property_table = g_new (int, size);
+  node->property_table_mask = size - 1;
+
+  for (slot = 0; slot < size; slot++)
+    node->property_table[slot] = -1;
+
+  for (i = 0; i < node->n_properties; i++)
+    {
+      CRDeclaration *decl = node->properties[i];
+      GQuark id = 0;
+
+      if (node->theme)
+        id = _st_theme_get_property_id (node->theme, decl);
+      if (id == 0)
+        id = g_quark_from_string (decl->property->stryng->str);
+
+      slot = id & node->property_table_mask;
+      while (node->property_table[slot] >= 0 &&
+             node->property_ids[node->property_table[slot]] != id)
+        slot = (slot + 1) & node->property_table_mask;
+
+      node->property_ids[i] = id;
+      node->property_prev[i] = node->property_table[slot];
+      node->property_table[slot] = i;
+    }
+}
+
 static void
 ensure_properties (StThemeNode *node)
 {
@@ -470,6 +529,8 @@ ensure_properties (StThemeNode *node)
 
       node->properties_computed = TRUE;
 
+      clear_properties (node);
+
       if (node->theme)
         properties = _st_theme_get_matched_properties (node->theme, node);
 
@@ -489,10 +550,91 @@ ensure_properties (StThemeNode *node)
         {
           node->n_properties = properties->len;
           node->properties = (CRDeclaration **)g_ptr_array_free (properties, FALSE);
+          build_property_table (node);
         }
     }
 }
 
+/* Returns the index of the last declaration of the property @id,
+ * or -1; the earlier ones are chained through property_prev. */
+static int
+find_property (StThemeNode *node,
+               GQuark       id)
+{
+  guint slot;
+
+  if (node->property_table == NULL)
+    return -1;
+
+  for (slot = id & node->property_table_mask;
+       node->property_table[slot] >= 0;
+       slot = (slot + 1) & node->property_table_mask)
+    {
+      if (node->property_ids[node->property_table[slot]] == id)
+        return node->property_table[slot];
+    }
+
+  return -1;
+}
+
+#define FOREACH_DECLARATION(node, id, i) \
+  for ((i) = find_property ((node), (id)); (i) >= 0; (i) = (node)->property_prev[(i)])
+
+typedef enum {
+  RESOLVED_COLOR,
+  RESOLVED_DOUBLE,
+  RESOLVED_TIME,
+  RESOLVED_LENGTH
+} ResolvedKind;
+
+typedef struct {
+  gboolean found;
+  union {
+    ClutterColor color;
+    double number;
+  } v;
+} ResolvedValue;
+
+static gboolean resolve_value (StThemeNode   *node,
+                               GQuark         id,
+                               ResolvedKind   kind,
+                               gboolean       inherit,
+                               ResolvedValue *value);
+
+/* Theme nodes are immutable, so the result of a generic lookup,
+ * including one that went up the parent chain, stays valid until the
+ * stylesheets change.
+ */
+static gboolean
+lookup_resolved (StThemeNode   *node,
+                 GQuark         id,
+                 ResolvedKind   kind,
+                 gboolean       inherit,
+                 ResolvedValue *value)
+{
+  ResolvedValue *resolved;
+  gpointer key;
+
+  ensure_properties (node);
+
+  key = GUINT_TO_POINTER ((id << 3) | (kind << 1) | (inherit != FALSE));
+
+  if (node->resolved_values == NULL)
+    node->resolved_values = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  resolved = g_hash_table_lookup (node->resolved_values, key);
+  if (resolved == NULL)
+    {
+      resolved = g_new0 (ResolvedValue, 1);
+      resolved->found = resolve_value (node, id, kind, inherit, resolved);
+      g_hash_table_insert (node->resolved_values, key, resolved);
+    }
+
+  *value = *resolved;
+
+  return value->found;
+}
+
 typedef enum {
   VALUE_FOUND,
   VALUE_NOT_FOUND,
@@ -685,34 +827,48 @@ st_theme_node_lookup_color (StThemeNode  *node,
                             gboolean      inherit,
                             ClutterColor *color)
 {
+  ResolvedValue value;
 
-  int i;
+  if (!lookup_resolved (node, g_quark_from_string (property_name),
+                        RESOLVED_COLOR, inherit, &value))
+    return FALSE;
 
-  ensure_properties (node);
+  *color = value.v.color;
+  return TRUE;
+}
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+static gboolean
+resolve_color (StThemeNode  *node,
+               GQuark        id,
+               gboolean      inherit,
+               ClutterColor *color)
+{
+  ResolvedValue value;
+  gboolean use_parent = inherit;
+  int i;
+
+  FOREACH_DECLARATION (node, id, i)
     {
       CRDeclaration *decl = node->properties[i];
+      GetFromTermResult result = get_color_from_term (node, decl->value, color);
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (result == VALUE_FOUND)
         {
-          GetFromTermResult result = get_color_from_term (node, decl->value, color);
-          if (result == VALUE_FOUND)
-            {
-              return TRUE;
-            }
-          else if (result == VALUE_INHERIT)
-            {
-              if (node->parent_node)
-                return st_theme_node_lookup_color (node->parent_node, property_name, inherit, color);
-              else
-                break;
-            }
+          return TRUE;
+        }
+      else if (result == VALUE_INHERIT)
+        {
+          use_parent = TRUE;
+          break;
         }
     }
 
-  if (inherit && node->parent_node)
-    return st_theme_node_lookup_color (node->parent_node, property_name, inherit, color);
+  if (use_parent && node->parent_node &&
+      lookup_resolved (node->parent_node, id, RESOLVED_COLOR, inherit, &value))
+    {
+      *color = value.v.color;
+      return TRUE;
+    }
 
   return FALSE;
 }
@@ -775,32 +931,45 @@ st_theme_node_lookup_double (StThemeNode *node,
                              gboolean     inherit,
                              double      *value)
 {
-  gboolean result = FALSE;
-  int i;
+  ResolvedValue resolved;
 
-  ensure_properties (node);
+  if (!lookup_resolved (node, g_quark_from_string (property_name),
+                        RESOLVED_DOUBLE, inherit, &resolved))
+    return FALSE;
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  *value = resolved.v.number;
+  return TRUE;
+}
+
+static gboolean
+resolve_double (StThemeNode *node,
+                GQuark       id,
+                gboolean     inherit,
+                double      *value)
+{
+  ResolvedValue resolved;
+  int i;
+
+  FOREACH_DECLARATION (node, id, i)
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          CRTerm *term = decl->value;
-
-          if (term->type != TERM_NUMBER || term->content.num->type != NUM_GENERIC)
-            continue;
+      if (term->type != TERM_NUMBER || term->content.num->type != NUM_GENERIC)
+        continue;
 
-          *value = term->content.num->val;
-          result = TRUE;
-          break;
-        }
+      *value = term->content.num->val;
+      return TRUE;
     }
 
-  if (!result && inherit && node->parent_node)
-    result = st_theme_node_lookup_double (node->parent_node, property_name, inherit, value);
+  if (inherit && node->parent_node &&
+      lookup_resolved (node->parent_node, id, RESOLVED_DOUBLE, inherit, &resolved))
+    {
+      *value = resolved.v.number;
+      return TRUE;
+    }
 
-  return result;
+  return FALSE;
 }
 
 /**
@@ -828,45 +997,54 @@ st_theme_node_lookup_time (StThemeNode *node,
                            gboolean     inherit,
                            double      *value)
 {
-  gboolean result = FALSE;
-  int i;
+  ResolvedValue resolved;
 
-  ensure_properties (node);
+  if (!lookup_resolved (node, g_quark_from_string (property_name),
+                        RESOLVED_TIME, inherit, &resolved))
+    return FALSE;
 
-  for (i = node->n_properties - 1; i >= 0; i--)
-    {
-      CRDeclaration *decl = node->properties[i];
+  *value = resolved.v.number;
+  return TRUE;
+}
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          CRTerm *term = decl->value;
+static gboolean
+resolve_time (StThemeNode *node,
+              GQuark       id,
+              gboolean     inherit,
+              double      *value)
+{
+  ResolvedValue resolved;
+  int i;
 
-          if (term->type != TERM_NUMBER)
-            continue;
+  FOREACH_DECLARATION (node, id, i)
+    {
+      CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
 
-          switch (term->content.num->type)
-            {
-            case NUM_TIME_S:
-              *value = 1000 * term->content.num->val;
-              result = TRUE;
-              break;
-            case NUM_TIME_MS:
-              *value = term->content.num->val;
-              result = TRUE;
-              break;
-            default:
-              ;
-            }
+      if (term->type != TERM_NUMBER)
+        continue;
 
-          if (result)
-            break;
+      switch (term->content.num->type)
+        {
+        case NUM_TIME_S:
+          *value = 1000 * term->content.num->val;
+          return TRUE;
+        case NUM_TIME_MS:
+          *value = term->content.num->val;
+          return TRUE;
+        default:
+          ;
         }
     }
 
-  if (!result && inherit && node->parent_node)
-    result = st_theme_node_lookup_time (node->parent_node, property_name, inherit, value);
+  if (inherit && node->parent_node &&
+      lookup_resolved (node->parent_node, id, RESOLVED_TIME, inherit, &resolved))
+    {
+      *value = resolved.v.number;
+      return TRUE;
+    }
 
-  return result;
+  return FALSE;
 }
 
 /**
@@ -1075,25 +1253,18 @@ get_length_from_term_int (StThemeNode *node,
 
 static GetFromTermResult
 get_length_internal (StThemeNode *node,
-                     const char  *property_name,
-                     const char  *suffixed,
+                     GQuark       id,
                      gdouble     *length)
 {
   int i;
 
-  ensure_properties (node);
-
-  for (i = node->n_properties - 1; i >= 0; i--)
+  FOREACH_DECLARATION (node, id, i)
     {
       CRDeclaration *decl = node->properties[i];
+      GetFromTermResult result = get_length_from_term (node, decl->value, FALSE, length);
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0 ||
-          (suffixed != NULL && strcmp (decl->property->stryng->str, suffixed) == 0))
-        {
-          GetFromTermResult result = get_length_from_term (node, decl->value, FALSE, length);
-          if (result != VALUE_NOT_FOUND)
-            return result;
-        }
+      if (result != VALUE_NOT_FOUND)
+        return result;
     }
 
   return VALUE_NOT_FOUND;
@@ -1129,17 +1300,61 @@ st_theme_node_lookup_length (StThemeNode *node,
                              gboolean     inherit,
                              gdouble     *length)
 {
-  GetFromTermResult result = get_length_internal (node, property_name, NULL, length);
+  ResolvedValue resolved;
+
+  if (!lookup_resolved (node, g_quark_from_string (property_name),
+                        RESOLVED_LENGTH, inherit, &resolved))
+    return FALSE;
+
+  *length = resolved.v.number;
+  return TRUE;
+}
+
+static gboolean
+resolve_length (StThemeNode *node,
+                GQuark       id,
+                gboolean     inherit,
+                gdouble     *length)
+{
+  ResolvedValue resolved;
+  GetFromTermResult result = get_length_internal (node, id, length);
+
   if (result == VALUE_FOUND)
     return TRUE;
   else if (result == VALUE_INHERIT)
     inherit = TRUE;
 
   if (inherit && node->parent_node &&
-      st_theme_node_lookup_length (node->parent_node, property_name, inherit, length))
-    return TRUE;
-  else
-    return FALSE;
+      lookup_resolved (node->parent_node, id, RESOLVED_LENGTH, inherit, &resolved))
+    {
+      *length = resolved.v.number;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+resolve_value (StThemeNode   *node,
+               GQuark         id,
+               ResolvedKind   kind,
+               gboolean       inherit,
+               ResolvedValue *value)
+{
+  switch (kind)
+    {
+    case RESOLVED_COLOR:
+      return resolve_color (node, id, inherit, &value->v.color);
+    case RESOLVED_DOUBLE:
+      return resolve_double (node, id, inherit, &value->v.number);
+    case RESOLVED_TIME:
+      return resolve_time (node, id, inherit, &value->v.number);
+    case RESOLVED_LENGTH:
+      return resolve_length (node, id, inherit, &value->v.number);
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
 }
 
 /**
@@ -2056,18 +2271,15 @@ st_theme_node_get_foreground_color (StThemeNode  *node,
 
       ensure_properties (node);
 
-      for (i = node->n_properties - 1; i >= 0; i--)
+      FOREACH_DECLARATION (node, g_quark_from_static_string ("color"), i)
         {
           CRDeclaration *decl = node->properties[i];
+          GetFromTermResult result = get_color_from_term (node, decl->value, &node->foreground_color);
 
-          if (strcmp (decl->property->stryng->str, "color") == 0)
-            {
-              GetFromTermResult result = get_color_from_term (node, decl->value, &node->foreground_color);
-              if (result == VALUE_FOUND)
-                goto out;
-              else if (result == VALUE_INHERIT)
-                break;
-            }
+          if (result == VALUE_FOUND)
+            goto out;
+          else if (result == VALUE_INHERIT)
+            break;
         }
 
       if (node->parent_node)
@@ -3065,42 +3277,38 @@ st_theme_node_lookup_shadow (StThemeNode  *node,
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  FOREACH_DECLARATION (node, g_quark_from_string (property_name), i)
     {
       CRDeclaration *decl = node->properties[i];
+      GetFromTermResult result = parse_shadow_property (node,
+                                                        decl,
+                                                        &color,
+                                                        &xoffset,
+                                                        &yoffset,
+                                                        &blur,
+                                                        &spread,
+                                                        &inset,
+                                                        &is_none);
+      if (result == VALUE_FOUND)
+        {
+          if (is_none)
+            return FALSE;
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          GetFromTermResult result = parse_shadow_property (node,
-                                                            decl,
-                                                            &color,
-                                                            &xoffset,
-                                                            &yoffset,
-                                                            &blur,
-                                                            &spread,
-                                                            &inset,
-                                                            &is_none);
-          if (result == VALUE_FOUND)
-            {
-              if (is_none)
-                return FALSE;
-
-              *shadow = st_shadow_new (&color,
-                                       xoffset, yoffset,
-                                       blur, spread,
-                                       inset);
-              return TRUE;
-            }
-          else if (result == VALUE_INHERIT)
-            {
-              if (node->parent_node)
-                return st_theme_node_lookup_shadow (node->parent_node,
-                                                    property_name,
-                                                    inherit,
-                                                    shadow);
-              else
-                break;
-            }
+          *shadow = st_shadow_new (&color,
+                                   xoffset, yoffset,
+                                   blur, spread,
+                                   inset);
+          return TRUE;
+        }
+      else if (result == VALUE_INHERIT)
+        {
+          if (node->parent_node)
+            return st_theme_node_lookup_shadow (node->parent_node,
+                                                property_name,
+                                                inherit,
+                                                shadow);
+          else
+            break;
         }
     }
 
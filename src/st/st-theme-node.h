@@ -278,6 +278,11 @@ void st_theme_node_paint_state_invalidate (StThemeNodePaintState *state);
 void st_theme_node_paint_state_set_node (StThemeNodePaintState *state,
                                          StThemeNode           *node);
 
+void st_theme_node_get_texture_memory_usage (guint *n_prerendered,
+                                             gsize *prerendered_bytes,
+                                             guint *n_shadows,
+                                             gsize *shadow_bytes);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_NODE_H__ */
@@ -36,6 +36,18 @@ GFile *_st_theme_resolve_url (StTheme      *theme,
 
 CRDeclaration *_st_theme_parse_declaration_list (const char *str);
 
+GQuark _st_theme_get_property_id (StTheme       *theme,
+                                  CRDeclaration *decl);
+
+/* Compiled stylesheets, see st-theme-cache.c */
+CRStyleSheet *_st_theme_cache_load (GFile        *file,
+                                    const char   *contents,
+                                    gsize         length);
+void          _st_theme_cache_save (GFile        *file,
+                                    const char   *contents,
+                                    gsize         length,
+                                    CRStyleSheet *stylesheet);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_PRIVATE_H__ */
@@ -71,6 +71,9 @@ struct _StTheme
   GHashTable *stylesheets_by_file;
   GHashTable *files_by_stylesheet;
 
+  /* CRDeclaration => GQuark of its property name */
+  GHashTable *property_ids;
+
   CRCascade *cascade;
 };
 
@@ -95,6 +98,25 @@ enum
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
+/* The role a stylesheet is loaded in; a parsed stylesheet is only
+ * shared between themes that use it in the same role, since the role
+ * determines its origin in the cascade.
+ */
+typedef enum {
+  STYLESHEET_APPLICATION,
+  STYLESHEET_THEME,
+  STYLESHEET_DEFAULT,
+  STYLESHEET_CUSTOM
+} StylesheetRole;
+
+typedef struct {
+  CRStyleSheet *stylesheet;
+  char *etag;
+} StylesheetCacheEntry;
+
+/* "role:uri" => StylesheetCacheEntry */
+static GHashTable *stylesheet_cache = NULL;
+
 G_DEFINE_TYPE (StTheme, st_theme, G_TYPE_OBJECT)
 
 /* Quick strcmp.  Test only for == 0 or != 0, not < 0 or > 0.  */
@@ -120,6 +142,7 @@ st_theme_init (StTheme *theme)
   theme->stylesheets_by_file = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
                                                       (GDestroyNotify)g_object_unref, (GDestroyNotify)cr_stylesheet_unref);
   theme->files_by_stylesheet = g_hash_table_new (g_direct_hash, g_direct_equal);
+  theme->property_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 static void
@@ -198,27 +221,151 @@ parse_stylesheet (GFile   *file,
   if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
     return NULL;
 
-  status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
-                                          length,
-                                          CR_UTF_8,
-                                          &stylesheet);
-  g_free (contents);
-
-  if (status != CR_OK)
+  /* Rebuilding the tree from the compiled form is much cheaper than
+   * parsing the CSS again */
+  stylesheet = _st_theme_cache_load (file, contents, length);
+  if (stylesheet == NULL)
     {
-      char *uri = g_file_get_uri (file);
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-                   "Error parsing stylesheet '%s'; errcode:%d", uri, status);
-      g_free (uri);
-      return NULL;
+      status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
+                                              length,
+                                              CR_UTF_8,
+                                              &stylesheet);
+      if (status != CR_OK)
+        {
+          char *uri = g_file_get_uri (file);
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "Error parsing stylesheet '%s'; errcode:%d", uri, status);
+          g_free (uri);
+          g_free (contents);
+          return NULL;
+        }
+
+      _st_theme_cache_save (file, contents, length, stylesheet);
     }
 
+  g_free (contents);
+
   /* Extension stylesheet */
   stylesheet->app_data = GUINT_TO_POINTER (FALSE);
 
   return stylesheet;
 }
 
+static void
+stylesheet_cache_entry_free (StylesheetCacheEntry *entry)
+{
+  cr_stylesheet_unref (entry->stylesheet);
+  g_free (entry->etag);
+  g_slice_free (StylesheetCacheEntry, entry);
+}
+
+static char *
+get_file_etag (GFile *file)
+{
+  GFileInfo *info;
+  char *etag = NULL;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_ETAG_VALUE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info)
+    {
+      etag = g_strdup (g_file_info_get_etag (info));
+      g_object_unref (info);
+    }
+
+  return etag;
+}
+
+static gboolean
+stylesheet_has_imports (CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    if (cur_stmt->type == AT_IMPORT_RULE_STMT)
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Like parse_stylesheet(), but reuses the stylesheet parsed for an
+ * earlier theme if the file hasn't changed since, so that reloading
+ * the theme doesn't parse all of the CSS again. Stylesheets with
+ * @import rules aren't shared, because the imported stylesheets are
+ * resolved and owned by the theme that first matches against them.
+ */
+static CRStyleSheet *
+get_stylesheet (GFile          *file,
+                StylesheetRole  role,
+                GError        **error)
+{
+  StylesheetCacheEntry *entry;
+  CRStyleSheet *stylesheet;
+  char *uri, *key, *etag;
+
+  if (file == NULL)
+    return NULL;
+
+  if (stylesheet_cache == NULL)
+    stylesheet_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) stylesheet_cache_entry_free);
+
+  uri = g_file_get_uri (file);
+  key = g_strdup_printf ("%d:%s", role, uri);
+  g_free (uri);
+
+  etag = get_file_etag (file);
+
+  entry = g_hash_table_lookup (stylesheet_cache, key);
+  if (entry != NULL && g_strcmp0 (entry->etag, etag) == 0)
+    {
+      g_free (key);
+      g_free (etag);
+      return entry->stylesheet;
+    }
+
+  stylesheet = parse_stylesheet (file, error);
+  if (stylesheet == NULL || stylesheet_has_imports (stylesheet))
+    {
+      g_hash_table_remove (stylesheet_cache, key);
+      g_free (key);
+      g_free (etag);
+      return stylesheet;
+    }
+
+  if (role == STYLESHEET_CUSTOM)
+    stylesheet->app_data = GUINT_TO_POINTER (TRUE);
+
+  entry = g_slice_new (StylesheetCacheEntry);
+  entry->stylesheet = stylesheet;
+  entry->etag = etag;
+  cr_stylesheet_ref (stylesheet);
+
+  g_hash_table_replace (stylesheet_cache, key, entry);
+
+  return stylesheet;
+}
+
+static gboolean
+stylesheet_cache_entry_unused (gpointer key,
+                               gpointer value,
+                               gpointer data)
+{
+  StylesheetCacheEntry *entry = value;
+
+  return entry->stylesheet->ref_count <= 1;
+}
+
+/* Drops the stylesheets that no theme uses anymore */
+static void
+prune_stylesheet_cache (void)
+{
+  if (stylesheet_cache == NULL)
+    return;
+
+  g_hash_table_foreach_remove (stylesheet_cache, stylesheet_cache_entry_unused, NULL);
+}
+
 CRDeclaration *
 _st_theme_parse_declaration_list (const char *str)
 {
@@ -228,12 +375,13 @@ _st_theme_parse_declaration_list (const char *str)
 
 /* Just g_warning for now until we have something nicer to do */
 static CRStyleSheet *
-parse_stylesheet_nofail (GFile *file)
+get_stylesheet_nofail (GFile          *file,
+                       StylesheetRole  role)
 {
   GError *error = NULL;
   CRStyleSheet *result;
 
-  result = parse_stylesheet (file, &error);
+  result = get_stylesheet (file, role, &error);
   if (error)
     {
       g_warning ("%s", error->message);
@@ -242,6 +390,62 @@ parse_stylesheet_nofail (GFile *file)
   return result;
 }
 
+static void
+update_declaration_ids (StTheme       *theme,
+                        CRDeclaration *decl_list,
+                        gboolean       add)
+{
+  CRDeclaration *cur_decl;
+
+  for (cur_decl = decl_list; cur_decl; cur_decl = cur_decl->next)
+    {
+      if (!add)
+        g_hash_table_remove (theme->property_ids, cur_decl);
+      else if (cur_decl->property && cur_decl->property->stryng)
+        g_hash_table_insert (theme->property_ids, cur_decl,
+                             GUINT_TO_POINTER (g_quark_from_string (cur_decl->property->stryng->str)));
+    }
+}
+
+/* Interns the property names of all the declarations in @stylesheet
+ * (or forgets them, if @add is %FALSE) so that theme nodes don't have
+ * to hash the names each time they match the declarations.
+ */
+static void
+update_property_ids (StTheme      *theme,
+                     CRStyleSheet *stylesheet,
+                     gboolean      add)
+{
+  CRStatement *cur_stmt, *cur_ruleset;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      switch (cur_stmt->type)
+        {
+        case RULESET_STMT:
+          if (cur_stmt->kind.ruleset)
+            update_declaration_ids (theme, cur_stmt->kind.ruleset->decl_list, add);
+          break;
+
+        case AT_MEDIA_RULE_STMT:
+          if (cur_stmt->kind.media_rule)
+            {
+              for (cur_ruleset = cur_stmt->kind.media_rule->rulesets;
+                   cur_ruleset;
+                   cur_ruleset = cur_ruleset->next)
+                {
+                  if (cur_ruleset->type == RULESET_STMT && cur_ruleset->kind.ruleset)
+                    update_declaration_ids (theme, cur_ruleset->kind.ruleset->decl_list, add);
+                }
+            }
+          break;
+
+        default:
+          break;
+        }
+    }
+}
+
 static void
 insert_stylesheet (StTheme      *theme,
                    GFile        *file,
@@ -255,6 +459,8 @@ insert_stylesheet (StTheme      *theme,
 
   g_hash_table_insert (theme->stylesheets_by_file, file, stylesheet);
   g_hash_table_insert (theme->files_by_stylesheet, stylesheet, file);
+
+  update_property_ids (theme, stylesheet, TRUE);
 }
 
 gboolean
@@ -264,7 +470,7 @@ st_theme_load_stylesheet (StTheme    *theme,
 {
   CRStyleSheet *stylesheet;
 
-  stylesheet = parse_stylesheet (file, error);
+  stylesheet = get_stylesheet (file, STYLESHEET_CUSTOM, error);
   if (!stylesheet)
     return FALSE;
 
@@ -292,9 +498,11 @@ st_theme_unload_stylesheet (StTheme    *theme,
     return;
 
   theme->custom_stylesheets = g_slist_remove (theme->custom_stylesheets, stylesheet);
+  update_property_ids (theme, stylesheet, FALSE);
   g_hash_table_remove (theme->stylesheets_by_file, file);
   g_hash_table_remove (theme->files_by_stylesheet, stylesheet);
   cr_stylesheet_unref (stylesheet);
+  prune_stylesheet_cache ();
   g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
 }
 
@@ -338,9 +546,12 @@ st_theme_constructor (GType                  type,
                                                                       construct_properties);
   theme = ST_THEME (object);
 
-  application_stylesheet = parse_stylesheet_nofail (theme->application_stylesheet);
-  theme_stylesheet = parse_stylesheet_nofail (theme->theme_stylesheet);
-  default_stylesheet = parse_stylesheet_nofail (theme->default_stylesheet);
+  application_stylesheet = get_stylesheet_nofail (theme->application_stylesheet,
+                                                  STYLESHEET_APPLICATION);
+  theme_stylesheet = get_stylesheet_nofail (theme->theme_stylesheet,
+                                            STYLESHEET_THEME);
+  default_stylesheet = get_stylesheet_nofail (theme->default_stylesheet,
+                                              STYLESHEET_DEFAULT);
 
   theme->cascade = cr_cascade_new (application_stylesheet,
                                    theme_stylesheet,
@@ -367,6 +578,7 @@ st_theme_finalize (GObject * object)
 
   g_hash_table_destroy (theme->stylesheets_by_file);
   g_hash_table_destroy (theme->files_by_stylesheet);
+  g_hash_table_destroy (theme->property_ids);
 
   g_clear_object (&theme->application_stylesheet);
   g_clear_object (&theme->theme_stylesheet);
@@ -378,6 +590,8 @@ st_theme_finalize (GObject * object)
       theme->cascade = NULL;
     }
 
+  prune_stylesheet_cache ();
+
   G_OBJECT_CLASS (st_theme_parent_class)->finalize (object);
 }
 
@@ -1035,6 +1249,22 @@ _st_theme_get_matched_properties (StTheme        *theme,
   return props;
 }
 
+/**
+ * _st_theme_get_property_id:
+ * @theme: a #StTheme
+ * @decl: a declaration matched by _st_theme_get_matched_properties()
+ *
+ * Return value: the #GQuark for the property name of @decl, interned
+ *   when its stylesheet was loaded, or 0 if @decl doesn't come from
+ *   one of the stylesheets of @theme.
+ */
+GQuark
+_st_theme_get_property_id (StTheme       *theme,
+                           CRDeclaration *decl)
+{
+  return GPOINTER_TO_UINT (g_hash_table_lookup (theme->property_ids, decl));
+}
+
 /* Resolve an url from an url() reference in a stylesheet into a GFile,
  * if possible. The resolution here is distinctly lame and
  * will fail on many examples.
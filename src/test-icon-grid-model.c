@@ -0,0 +1,291 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "shell-icon-grid-model.h"
+
+#define SCHEMA_ID "org.gnome.shell"
+#define LAYOUT_KEY "icon-grid-layout"
+
+static const char default_config[] =
+  "{ \"desktop\": [ \"a.desktop\", \"b.desktop\", \"f.directory\" ],"
+  "  \"f.directory\": [ \"c.desktop\" ] }";
+
+typedef struct {
+  char *defaults_dir;
+  GSettings *settings;
+  ShellIconGridModel *model;
+  GPtrArray *changed_folders;
+} Fixture;
+
+static void
+on_folder_changed (ShellIconGridModel *model,
+                   const char         *folder_id,
+                   Fixture            *fixture)
+{
+  g_ptr_array_add (fixture->changed_folders, g_strdup (folder_id));
+}
+
+static gboolean
+folder_changed (Fixture    *fixture,
+                const char *folder_id)
+{
+  guint i;
+
+  for (i = 0; i < fixture->changed_folders->len; i++)
+    if (strcmp (g_ptr_array_index (fixture->changed_folders, i), folder_id) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+assert_icons (Fixture    *fixture,
+              const char *folder_id,
+              const char *expected)
+{
+  char **icons;
+  char *joined;
+
+  icons = shell_icon_grid_model_get_icons (fixture->model, folder_id);
+  joined = g_strjoinv (" ", icons);
+  g_assert_cmpstr (joined, ==, expected);
+
+  g_free (joined);
+  g_strfreev (icons);
+}
+
+static void
+set_layout (Fixture    *fixture,
+            const char *layout)
+{
+  g_settings_set_value (fixture->settings, LAYOUT_KEY,
+                        g_variant_new_parsed (layout));
+}
+
+static void
+wait_loaded (Fixture *fixture)
+{
+  while (!shell_icon_grid_model_get_loaded (fixture->model))
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+fixture_setup_loading (Fixture       *fixture,
+                       gconstpointer  data)
+{
+  char *path;
+
+  fixture->defaults_dir = g_dir_make_tmp ("test-icon-grid-model-XXXXXX", NULL);
+  g_assert (fixture->defaults_dir != NULL);
+
+  path = g_build_filename (fixture->defaults_dir, "icon-grid-C.json", NULL);
+  g_assert (g_file_set_contents (path, default_config, -1, NULL));
+  g_free (path);
+
+  fixture->settings = g_settings_new (SCHEMA_ID);
+  g_settings_reset (fixture->settings, LAYOUT_KEY);
+
+  fixture->model = shell_icon_grid_model_new (fixture->settings, LAYOUT_KEY,
+                                              fixture->defaults_dir,
+                                              fixture->defaults_dir);
+
+  fixture->changed_folders = g_ptr_array_new_with_free_func (g_free);
+  g_signal_connect (fixture->model, "folder-changed",
+                    G_CALLBACK (on_folder_changed), fixture);
+}
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+  fixture_setup_loading (fixture, data);
+  wait_loaded (fixture);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+  char *path;
+
+  g_ptr_array_unref (fixture->changed_folders);
+  g_object_unref (fixture->model);
+  g_object_unref (fixture->settings);
+
+  path = g_build_filename (fixture->defaults_dir, "icon-grid-C.json", NULL);
+  g_unlink (path);
+  g_free (path);
+
+  g_rmdir (fixture->defaults_dir);
+  g_free (fixture->defaults_dir);
+}
+
+static void
+test_defaults (Fixture       *fixture,
+               gconstpointer  data)
+{
+  g_assert (shell_icon_grid_model_has_icon (fixture->model, "a.desktop"));
+  g_assert_cmpstr (shell_icon_grid_model_get_icon_folder (fixture->model, "c.desktop"),
+                   ==, "f.directory");
+  g_assert_cmpint (shell_icon_grid_model_get_icon_position (fixture->model, "b.desktop"),
+                   ==, 1);
+  assert_icons (fixture, "desktop", "a.desktop b.desktop f.directory");
+
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "d.desktop",
+                                                   NULL, "desktop"));
+  assert_icons (fixture, "desktop", "a.desktop b.desktop f.directory d.desktop");
+}
+
+static void
+test_loading (Fixture       *fixture,
+              gconstpointer  data)
+{
+  GVariant *layout;
+
+  /* The defaults are read in a thread */
+  g_assert (!shell_icon_grid_model_get_loaded (fixture->model));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "a.desktop"));
+
+  /* Icons added meanwhile are added once they are in */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "d.desktop",
+                                                   NULL, "desktop"));
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "e.desktop",
+                                                   "c.desktop", "f.directory"));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "d.desktop"));
+
+  wait_loaded (fixture);
+
+  assert_icons (fixture, "desktop", "a.desktop b.desktop f.directory d.desktop");
+  assert_icons (fixture, "f.directory", "e.desktop c.desktop");
+
+  layout = g_settings_get_value (fixture->settings, LAYOUT_KEY);
+  g_assert_cmpuint (g_variant_n_children (layout), ==, 2);
+  g_variant_unref (layout);
+}
+
+static void
+test_diff (Fixture       *fixture,
+           gconstpointer  data)
+{
+  set_layout (fixture, "{ 'desktop': ['a.desktop', 'b.desktop', 'f.directory'],"
+                       "  'f.directory': ['c.desktop', 'd.desktop'] }");
+
+  /* Only the folder whose icons changed is reported */
+  g_assert (!folder_changed (fixture, "desktop"));
+  g_assert (folder_changed (fixture, "f.directory"));
+  assert_icons (fixture, "f.directory", "c.desktop d.desktop");
+
+  g_ptr_array_set_size (fixture->changed_folders, 0);
+  set_layout (fixture, "{ 'desktop': ['b.desktop', 'a.desktop'] }");
+
+  g_assert (folder_changed (fixture, "desktop"));
+  g_assert (folder_changed (fixture, "f.directory"));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "c.desktop"));
+  g_assert_cmpint (shell_icon_grid_model_get_icon_position (fixture->model, "a.desktop"),
+                   ==, 1);
+}
+
+static void
+test_reposition (Fixture       *fixture,
+                 gconstpointer  data)
+{
+  GVariant *layout;
+
+  /* Into a folder, before another icon */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "a.desktop",
+                                                   "c.desktop", "f.directory"));
+  assert_icons (fixture, "desktop", "b.desktop f.directory");
+  assert_icons (fixture, "f.directory", "a.desktop c.desktop");
+  g_assert_cmpstr (shell_icon_grid_model_get_icon_folder (fixture->model, "a.desktop"),
+                   ==, "f.directory");
+  g_assert (folder_changed (fixture, "desktop"));
+  g_assert (folder_changed (fixture, "f.directory"));
+
+  /* The layout is stored */
+  layout = g_settings_get_value (fixture->settings, LAYOUT_KEY);
+  g_assert_cmpuint (g_variant_n_children (layout), ==, 2);
+  g_variant_unref (layout);
+
+  /* Out of the layout */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "b.desktop",
+                                                   NULL, NULL));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "b.desktop"));
+  assert_icons (fixture, "desktop", "f.directory");
+
+  /* Removing a folder removes its contents */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "f.directory",
+                                                   NULL, NULL));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "c.desktop"));
+  assert_icons (fixture, "desktop", "");
+
+  /* Adding one gives it a place for its contents */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "g.directory",
+                                                   NULL, "desktop"));
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "c.desktop",
+                                                   NULL, "g.directory"));
+  assert_icons (fixture, "g.directory", "c.desktop");
+
+  g_assert (!shell_icon_grid_model_reposition_icon (fixture->model, "c.desktop",
+                                                    NULL, "missing.directory"));
+}
+
+static void
+test_duplicates (Fixture       *fixture,
+                 gconstpointer  data)
+{
+  set_layout (fixture, "{ 'desktop': ['a.desktop', 'f.directory', 'a.desktop'],"
+                       "  'f.directory': ['a.desktop', 'c.desktop'],"
+                       "  'g.directory': ['c.desktop'] }");
+
+  /* The first copy wins */
+  g_assert_cmpstr (shell_icon_grid_model_get_icon_folder (fixture->model, "a.desktop"),
+                   ==, "desktop");
+  g_assert_cmpint (shell_icon_grid_model_get_icon_position (fixture->model, "a.desktop"),
+                   ==, 0);
+
+  /* Removing one copy leaves the others in place */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "a.desktop",
+                                                   NULL, NULL));
+  g_assert (shell_icon_grid_model_has_icon (fixture->model, "a.desktop"));
+  g_assert_cmpint (shell_icon_grid_model_get_icon_position (fixture->model, "a.desktop"),
+                   ==, 1);
+
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "a.desktop",
+                                                   NULL, NULL));
+  g_assert_cmpstr (shell_icon_grid_model_get_icon_folder (fixture->model, "a.desktop"),
+                   ==, "f.directory");
+
+  /* So does removing a folder with a copy in it */
+  g_assert (shell_icon_grid_model_reposition_icon (fixture->model, "f.directory",
+                                                   NULL, NULL));
+  g_assert (!shell_icon_grid_model_has_icon (fixture->model, "a.desktop"));
+  g_assert_cmpstr (shell_icon_grid_model_get_icon_folder (fixture->model, "c.desktop"),
+                   ==, "g.directory");
+}
+
+int
+main (int argc, char **argv)
+{
+  g_setenv ("GSETTINGS_SCHEMA_DIR", TEST_SCHEMA_DIR, TRUE);
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  g_setenv ("LANGUAGE", "C", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/icon-grid-model/defaults", Fixture, NULL,
+              fixture_setup, test_defaults, fixture_teardown);
+  g_test_add ("/icon-grid-model/loading", Fixture, NULL,
+              fixture_setup_loading, test_loading, fixture_teardown);
+  g_test_add ("/icon-grid-model/diff", Fixture, NULL,
+              fixture_setup, test_diff, fixture_teardown);
+  g_test_add ("/icon-grid-model/reposition", Fixture, NULL,
+              fixture_setup, test_reposition, fixture_teardown);
+  g_test_add ("/icon-grid-model/duplicates", Fixture, NULL,
+              fixture_setup, test_duplicates, fixture_teardown);
+
+  return g_test_run ();
+}
@@ -19,7 +19,13 @@
  * Authors: Sam Spilsbury <sam@endlessm.com>
  */
 
+#define COGL_ENABLE_EXPERIMENTAL_API
+#define CLUTTER_ENABLE_EXPERIMENTAL_API
+
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <vector>
 #include <boost/noncopyable.hpp>
 
 #include <glib-object.h>
@@ -38,17 +44,30 @@ typedef struct _EndlessShellFXWobblyPrivate
 
     wobbly::Model  *model;
     wobbly::Anchor *anchor;
-    gint64         last_msecs;
-    guint          timeout_id;
+    float          model_width;
+    float          model_height;
+
+    /* How far the model is from the undeformed actor, as of the
+     * last step, in pixels */
+    float          displacement;
     guint          width_changed_signal;
     guint          height_changed_signal;
 
+    /* The deformed grid we paint the offscreen texture with */
+    CoglPrimitive       *mesh;
+    CoglAttributeBuffer *mesh_buffer;
+    CoglVertexP2T2      *mesh_vertices;
+    guint               mesh_tiles_x;
+    guint               mesh_tiles_y;
+
     /* We'll be touching this seldomly, so put
      * it down here for now */
     wobbly::Model::Settings model_settings;
 
-    /* Single bit at the end of the struct */
+    /* Bits at the end of the struct */
     bool          ungrab_pending : 1;
+    bool          animating : 1;
+    bool          mesh_dirty : 1;
 } EndlessShellFXWobblyPrivate;
 
 enum
@@ -59,6 +78,7 @@ enum
     PROP_FRICTION,
     PROP_SLOWDOWN_FACTOR,
     PROP_OBJECT_MOVEMENT_RANGE,
+    PROP_SETTLED,
 
     PROP_LAST
 };
@@ -164,99 +184,649 @@ endless_shell_fx_wobbly_pre_paint (ClutterEffect *effect)
 }
 
 static void
-endless_shell_fx_wobbly_deform_vertex (ClutterDeformEffect *effect,
-                                       gfloat              ,
-                                       gfloat              ,
-                                       CoglTextureVertex   *vertex)
+remove_anchor_if_pending (EndlessShellFXWobblyPrivate *priv)
+{
+    if (priv->ungrab_pending)
+    {
+        delete priv->anchor;
+        priv->anchor = nullptr;
+        priv->ungrab_pending = false;
+    }
+}
+
+/* Below this displacement the deformation isn't visible, so we paint
+ * the actor directly instead of redirecting it offscreen */
+static const float idle_displacement = 0.5f;
+
+/* Largest distance between the model's surface and where the actor
+ * is painted without the effect, sampled on a coarse grid */
+static float
+endless_shell_fx_wobbly_get_displacement (EndlessShellFXWobblyPrivate *priv)
+{
+    static const guint probe_tiles = 4;
+    float max_distance_sq = 0.0f;
+
+    for (guint i = 0; i <= probe_tiles; ++i)
+    {
+        float const t = static_cast <float> (i) / probe_tiles;
+
+        for (guint j = 0; j <= probe_tiles; ++j)
+        {
+            float const s = static_cast <float> (j) / probe_tiles;
+            wobbly::Point const deformed =
+                priv->model->DeformTexcoords (wobbly::Point (t, s));
+            float const dx = bg::get <0> (deformed) - s * priv->model_width;
+            float const dy = bg::get <1> (deformed) - t * priv->model_height;
+
+            max_distance_sq = std::max (max_distance_sq, dx * dx + dy * dy);
+        }
+    }
+
+    return std::sqrt (max_distance_sq);
+}
+
+/* Advances the model by msecs_delta, returning false once it has
+ * settled and the effect no longer needs to be stepped */
+static bool
+endless_shell_fx_wobbly_step (EndlessShellFXWobbly *wobbly_effect,
+                              guint                msecs_delta)
 {
-    EndlessShellFXWobbly *wobbly_effect =
-        ENDLESS_SHELL_FX_WOBBLY (effect);
     EndlessShellFXWobblyPrivate *priv =
         reinterpret_cast <EndlessShellFXWobblyPrivate *> (endless_shell_fx_wobbly_get_instance_private (wobbly_effect));
 
-    wobbly::Point deformed =
-        priv->model->DeformTexcoords (wobbly::Point (vertex->ty,
-                                                     vertex->tx));
-    vertex->x = bg::get <0> (deformed);
-    vertex->y = bg::get <1> (deformed);
+    g_assert (priv->model);
+
+    if (priv->model->Step (msecs_delta / priv->slowdown_factor))
+    {
+        priv->displacement = endless_shell_fx_wobbly_get_displacement (priv);
+
+        /* Keep stepping the model while it is nearly flat, but don't pay
+         * for the offscreen redirect when nobody could tell */
+        if (priv->displacement < idle_displacement)
+        {
+            if (clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (wobbly_effect)))
+            {
+                clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (wobbly_effect),
+                                                FALSE);
+                clutter_actor_queue_redraw (clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (wobbly_effect)));
+            }
+            return true;
+        }
+
+        priv->mesh_dirty = true;
+        clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (wobbly_effect),
+                                        TRUE);
+        clutter_deform_effect_invalidate (CLUTTER_DEFORM_EFFECT (wobbly_effect));
+        return true;
+    }
+
+    remove_anchor_if_pending (priv);
+
+    /* Also disable the effect */
+    clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (wobbly_effect),
+                                    FALSE);
+
+    priv->animating = false;
+    return false;
+}
+
+namespace
+{
+    /* Clutter doesn't have timeline-less animations, so all animating
+     * models are stepped from a single timeline that never completes.
+     * Being driven by the master clock, every model advances once per
+     * frame, rather than on independent timers beating against the
+     * frame rate.
+     *
+     * The timeline's delta is only the time between the master clock's
+     * wakeups, which jitters with the work done in each frame. Once the
+     * stage reports when frames actually reach the screen, the models are
+     * stepped to the time the frame being drawn will be presented at,
+     * predicted from the last presentation and the refresh rate */
+    class ModelScheduler :
+        boost::noncopyable
+    {
+        public:
+
+            static ModelScheduler & Get ()
+            {
+                static ModelScheduler scheduler;
+                return scheduler;
+            }
+
+            void Add (EndlessShellFXWobbly *effect)
+            {
+                if (std::find (effects.begin (), effects.end (), effect) == effects.end ())
+                    effects.push_back (effect);
+
+                if (!stage)
+                    WatchStage (clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect)));
+
+                if (!clutter_timeline_is_playing (timeline))
+                {
+                    clutter_timeline_rewind (timeline);
+                    clutter_timeline_start (timeline);
+                }
+            }
+
+            void Remove (EndlessShellFXWobbly *effect)
+            {
+                effects.erase (std::remove (effects.begin (), effects.end (), effect),
+                               effects.end ());
+
+                if (effects.empty ())
+                    Stop ();
+            }
+
+        private:
+
+            ModelScheduler () :
+                timeline (clutter_timeline_new (1000)),
+                stage (nullptr),
+                last_presentation_time (0),
+                refresh_interval (0),
+                stepped_to (0)
+            {
+                clutter_timeline_set_repeat_count (timeline, -1);
+                g_signal_connect (timeline, "new-frame",
+                                  G_CALLBACK (ModelScheduler::NewFrame), this);
+            }
+
+            void WatchStage (ClutterActor *actor)
+            {
+                ClutterActor *actor_stage = actor ? clutter_actor_get_stage (actor) : nullptr;
+
+                if (!actor_stage)
+                    return;
+
+                stage = CLUTTER_STAGE (actor_stage);
+                g_object_add_weak_pointer (G_OBJECT (stage),
+                                           reinterpret_cast <gpointer *> (&stage));
+                g_signal_connect (stage, "presented",
+                                  G_CALLBACK (ModelScheduler::Presented), this);
+            }
+
+            void Stop ()
+            {
+                clutter_timeline_stop (timeline);
+                stepped_to = 0;
+            }
+
+            static void Presented (ClutterStage     *stage,
+                                   ClutterFrameEvent event,
+                                   ClutterFrameInfo *info,
+                                   gpointer         user_data)
+            {
+                ModelScheduler *scheduler = static_cast <ModelScheduler *> (user_data);
+
+                if (event != CLUTTER_FRAME_EVENT_COMPLETE ||
+                    info->presentation_time == 0 ||
+                    info->refresh_rate <= 0.0f)
+                    return;
+
+                scheduler->last_presentation_time = info->presentation_time;
+                scheduler->refresh_interval =
+                    static_cast <gint64> (G_USEC_PER_SEC / info->refresh_rate);
+            }
+
+            /* Milliseconds to step the models by for the frame being
+             * drawn, keeping the remainder for the next frame */
+            guint FrameDelta (guint timeline_delta)
+            {
+                if (last_presentation_time == 0)
+                    return timeline_delta;
+
+                /* Presentation times are on the monotonic clock */
+                gint64 const now = g_get_monotonic_time ();
+                gint64 target = last_presentation_time + refresh_interval;
+
+                if (target < now)
+                    target += ((now - target) / refresh_interval + 1) * refresh_interval;
+
+                if (stepped_to == 0)
+                {
+                    stepped_to = target;
+                    return timeline_delta;
+                }
+
+                if (target <= stepped_to)
+                    return 0;
+
+                guint const msecs_delta = (target - stepped_to) / 1000;
+                stepped_to += msecs_delta * 1000;
+                return msecs_delta;
+            }
+
+            static void NewFrame (ClutterTimeline *timeline,
+                                  gint            ,
+                                  gpointer        user_data)
+            {
+                ModelScheduler *scheduler = static_cast <ModelScheduler *> (user_data);
+                guint msecs_delta =
+                    scheduler->FrameDelta (clutter_timeline_get_delta (timeline));
+
+                /* If there was no time movement, then we can't really step or remove
+                 * models in a way that makes sense, so don't do it */
+                if (!msecs_delta)
+                    return;
+
+                std::vector <EndlessShellFXWobbly *> &effects (scheduler->effects);
+                std::vector <EndlessShellFXWobbly *> settled;
+                effects.erase (std::remove_if (effects.begin (),
+                                               effects.end (),
+                                               [msecs_delta, &settled] (EndlessShellFXWobbly *effect) {
+                                                   if (endless_shell_fx_wobbly_step (effect,
+                                                                                     msecs_delta))
+                                                       return false;
+
+                                                   settled.push_back (effect);
+                                                   return true;
+                                               }),
+                               effects.end ());
+
+                if (effects.empty ())
+                    scheduler->Stop ();
+
+                /* Only notify once we're done with the list, handlers
+                 * may well start the effect again */
+                for (EndlessShellFXWobbly *effect : settled)
+                    g_object_notify_by_pspec (G_OBJECT (effect),
+                                              object_properties[PROP_SETTLED]);
+            }
+
+            ClutterTimeline                      *timeline;
+            std::vector <EndlessShellFXWobbly *> effects;
+
+            ClutterStage                         *stage;
+            gint64                               last_presentation_time;
+            gint64                               refresh_interval;
+
+            /* Presentation time the models have been stepped to */
+            gint64                               stepped_to;
+    };
 }
 
 static void
-remove_anchor_if_pending (EndlessShellFXWobblyPrivate *priv)
+endless_shell_fx_wobbly_ensure_timeline (EndlessShellFXWobbly *wobbly_effect)
 {
-    if (priv->ungrab_pending)
+    EndlessShellFXWobblyPrivate *priv =
+        reinterpret_cast <EndlessShellFXWobblyPrivate *> (endless_shell_fx_wobbly_get_instance_private (wobbly_effect));
+
+    if (!priv->animating)
     {
-        delete priv->anchor;
-        priv->anchor = nullptr;
-        priv->ungrab_pending = false;
+        ModelScheduler::Get ().Add (wobbly_effect);
+        priv->animating = true;
+        g_object_notify_by_pspec (G_OBJECT (wobbly_effect),
+                                  object_properties[PROP_SETTLED]);
     }
 }
 
-/* It turns out that clutter doesn't contain any mechanism whatsoever
- * to do timeline-less animations. We're just using a timeout here
- * to keep performing animations on the actor */
-static gboolean
-endless_shell_fx_wobbly_new_frame (gpointer user_data)
+static void
+endless_shell_fx_wobbly_stop_timeline (EndlessShellFXWobbly *wobbly_effect)
 {
-    EndlessShellFXWobbly *wobbly_effect = ENDLESS_SHELL_FX_WOBBLY (user_data);
     EndlessShellFXWobblyPrivate *priv =
         reinterpret_cast <EndlessShellFXWobblyPrivate *> (endless_shell_fx_wobbly_get_instance_private (wobbly_effect));
-    gint64 msecs = g_get_monotonic_time ();
 
-    static const unsigned int ms_to_us = 1000;
+    if (priv->animating)
+    {
+        ModelScheduler::Get ().Remove (wobbly_effect);
+        priv->animating = false;
+        g_object_notify_by_pspec (G_OBJECT (wobbly_effect),
+                                  object_properties[PROP_SETTLED]);
+    }
+}
 
-    g_assert (priv->model);
+static void
+endless_shell_fx_wobbly_free_mesh (EndlessShellFXWobblyPrivate *priv)
+{
+    if (priv->mesh)
+    {
+        cogl_object_unref (priv->mesh);
+        priv->mesh = nullptr;
+    }
+
+    if (priv->mesh_buffer)
+    {
+        cogl_object_unref (priv->mesh_buffer);
+        priv->mesh_buffer = nullptr;
+    }
+
+    g_free (priv->mesh_vertices);
+    priv->mesh_vertices = nullptr;
+}
+
+/* The grid shares its vertices between neighbouring tiles, so it can
+ * only be as fine as 16 bit indices allow */
+static const guint max_mesh_tiles = 254;
+
+static void
+endless_shell_fx_wobbly_ensure_mesh (EndlessShellFXWobblyPrivate *priv,
+                                     guint                       tiles_x,
+                                     guint                       tiles_y)
+{
+    tiles_x = CLAMP (tiles_x, 1, max_mesh_tiles);
+    tiles_y = CLAMP (tiles_y, 1, max_mesh_tiles);
+
+    if (priv->mesh &&
+        priv->mesh_tiles_x == tiles_x &&
+        priv->mesh_tiles_y == tiles_y)
+        return;
+
+    endless_shell_fx_wobbly_free_mesh (priv);
 
-    /* Wraparound, priv->last_msecs -= G_MAXINT64.
-     * We make priv->last_msecs negative so that subtracting it
-     * from msecs results in the correct delta */
-    if (G_UNLIKELY (priv->last_msecs > msecs))
-        priv->last_msecs -= G_MAXINT64;
+    CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+    guint const stride = tiles_x + 1;
+    guint const n_vertices = stride * (tiles_y + 1);
+    guint const n_indices = tiles_x * tiles_y * 6;
 
-    gint64 msecs_delta = (msecs - priv->last_msecs ) / ms_to_us;
-    priv->last_msecs = msecs;
+    std::vector <guint16> indices;
+    indices.reserve (n_indices);
 
-    /* If there was no time movement, then we can't really step or remove
-     * models in a way that makes sense, so don't do it */
-    if (msecs_delta)
+    for (guint i = 0; i < tiles_y; ++i)
     {
-        if (priv->model->Step (msecs_delta / priv->slowdown_factor))
+        for (guint j = 0; j < tiles_x; ++j)
         {
-            clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (wobbly_effect),
-                                            TRUE);
-            clutter_deform_effect_invalidate (CLUTTER_DEFORM_EFFECT (wobbly_effect));
+            guint16 const top_left = i * stride + j;
+            guint16 const top_right = top_left + 1;
+            guint16 const bottom_left = top_left + stride;
+            guint16 const bottom_right = bottom_left + 1;
+
+            indices.insert (indices.end (), {
+                top_left, top_right, bottom_left,
+                bottom_left, top_right, bottom_right
+            });
         }
-        else
+    }
+
+    priv->mesh_vertices = g_new0 (CoglVertexP2T2, n_vertices);
+    priv->mesh_buffer = cogl_attribute_buffer_new (ctx,
+                                                   n_vertices * sizeof (CoglVertexP2T2),
+                                                   priv->mesh_vertices);
+
+    CoglAttribute *attributes[] =
+    {
+        cogl_attribute_new (priv->mesh_buffer,
+                            "cogl_position_in",
+                            sizeof (CoglVertexP2T2),
+                            G_STRUCT_OFFSET (CoglVertexP2T2, x),
+                            2,
+                            COGL_ATTRIBUTE_TYPE_FLOAT),
+        cogl_attribute_new (priv->mesh_buffer,
+                            "cogl_tex_coord0_in",
+                            sizeof (CoglVertexP2T2),
+                            G_STRUCT_OFFSET (CoglVertexP2T2, s),
+                            2,
+                            COGL_ATTRIBUTE_TYPE_FLOAT)
+    };
+
+    CoglIndices *mesh_indices = cogl_indices_new (ctx,
+                                                  COGL_INDICES_TYPE_UNSIGNED_SHORT,
+                                                  indices.data (),
+                                                  n_indices);
+
+    priv->mesh = cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLES,
+                                                     n_vertices,
+                                                     attributes,
+                                                     G_N_ELEMENTS (attributes));
+    cogl_primitive_set_indices (priv->mesh, mesh_indices, n_indices);
+
+    cogl_object_unref (mesh_indices);
+    for (CoglAttribute *attribute : attributes)
+        cogl_object_unref (attribute);
+
+    priv->mesh_tiles_x = tiles_x;
+    priv->mesh_tiles_y = tiles_y;
+    priv->mesh_dirty = true;
+}
+
+/* The error of approximating a curve bulging by some displacement with
+ * n straight segments shrinks with n², so this picks the coarsest grid
+ * that keeps the error under max_mesh_error. Only powers of two are
+ * used, so that the mesh isn't rebuilt on every frame as the model
+ * slows down */
+static const float max_mesh_error = 0.25f;
+static const guint min_mesh_tiles = 4;
+
+static guint
+endless_shell_fx_wobbly_tiles_for_displacement (float displacement,
+                                                guint max_tiles)
+{
+    guint tiles = min_mesh_tiles;
+
+    while (tiles < max_tiles && displacement / (tiles * tiles) > max_mesh_error)
+        tiles *= 2;
+
+    return std::min (tiles, max_tiles);
+}
+
+namespace
+{
+    typedef std::array <float, 4> CubicBasis;
+
+    /* Cubic Bernstein polynomials at u */
+    inline CubicBasis
+    bernstein_basis (float u)
+    {
+        float const v = 1.0f - u;
+
+        return CubicBasis {{ v * v * v,
+                             3.0f * u * v * v,
+                             3.0f * u * u * v,
+                             u * u * u }};
+    }
+
+    /* Inverse of the matrix of the cubic Bernstein polynomials sampled at
+     * 0, 1/3, 2/3 and 1, which recovers the control points of a cubic
+     * from its values at those points */
+    float const bernstein_inverse[4][4] =
+    {
+        {  1.0f,         0.0f,        0.0f,        0.0f         },
+        { -5.0f / 6.0f,  3.0f,       -3.0f / 2.0f, 1.0f / 3.0f  },
+        {  1.0f / 3.0f, -3.0f / 2.0f, 3.0f,       -5.0f / 6.0f  },
+        {  0.0f,         0.0f,        0.0f,        1.0f         }
+    };
+
+    /* The model's surface is a bicubic Bézier patch over its 4x4 grid of
+     * springs. Recovering its control points takes 16 calls to the model,
+     * after which any number of points can be evaluated with plain
+     * arithmetic over flat arrays */
+    class BezierPatch
+    {
+        public:
+
+            explicit BezierPatch (wobbly::Model &model)
+            {
+                float samples[2][4][4];
+
+                for (guint a = 0; a < 4; ++a)
+                    for (guint b = 0; b < 4; ++b)
+                    {
+                        wobbly::Point const p =
+                            model.DeformTexcoords (wobbly::Point (a / 3.0f, b / 3.0f));
+                        samples[0][a][b] = bg::get <0> (p);
+                        samples[1][a][b] = bg::get <1> (p);
+                    }
+
+                /* control = B⁻¹ · samples · B⁻ᵀ, for each coordinate */
+                for (guint c = 0; c < 2; ++c)
+                {
+                    float half[4][4];
+
+                    for (guint a = 0; a < 4; ++a)
+                        for (guint b = 0; b < 4; ++b)
+                        {
+                            half[a][b] = 0.0f;
+                            for (guint k = 0; k < 4; ++k)
+                                half[a][b] += bernstein_inverse[a][k] * samples[c][k][b];
+                        }
+
+                    for (guint a = 0; a < 4; ++a)
+                        for (guint b = 0; b < 4; ++b)
+                        {
+                            control[c][a][b] = 0.0f;
+                            for (guint k = 0; k < 4; ++k)
+                                control[c][a][b] += half[a][k] * bernstein_inverse[b][k];
+                        }
+                }
+            }
+
+            wobbly::Point Evaluate (float u, float v) const
+            {
+                CubicBasis const bu = bernstein_basis (u);
+                CubicBasis const bv = bernstein_basis (v);
+                float p[2] = { 0.0f, 0.0f };
+
+                for (guint c = 0; c < 2; ++c)
+                    for (guint a = 0; a < 4; ++a)
+                        for (guint b = 0; b < 4; ++b)
+                            p[c] += bu[a] * control[c][a][b] * bv[b];
+
+                return wobbly::Point (p[0], p[1]);
+            }
+
+            /* The four points that the curve along the second parameter
+             * blends between at u, as separate x and y arrays */
+            void Row (float u, float x[4], float y[4]) const
+            {
+                CubicBasis const bu = bernstein_basis (u);
+
+                for (guint b = 0; b < 4; ++b)
+                {
+                    x[b] = bu[0] * control[0][0][b] + bu[1] * control[0][1][b] +
+                           bu[2] * control[0][2][b] + bu[3] * control[0][3][b];
+                    y[b] = bu[0] * control[1][0][b] + bu[1] * control[1][1][b] +
+                           bu[2] * control[1][2][b] + bu[3] * control[1][3][b];
+                }
+            }
+
+        private:
+
+            float control[2][4][4];
+    };
+
+    /* Tolerance, in pixels, for the fitted patch to count as matching
+     * the model */
+    float const patch_tolerance = 0.01f;
+}
+
+/* Evaluates the model over the whole grid straight into the vertex
+ * buffer, instead of once per vertex through
+ * ClutterDeformEffect::deform_vertex. The model's control points are
+ * recovered once per change, the basis along the columns is shared by
+ * every row, and each row is a branch-free loop over flat arrays that
+ * the compiler can vectorize. Should the model ever stop being a
+ * bicubic patch, which is checked against a point that wasn't used for
+ * the fit, every vertex is evaluated through the model instead. */
+static void
+endless_shell_fx_wobbly_deform_mesh (EndlessShellFXWobblyPrivate *priv)
+{
+    guint const tiles_x = priv->mesh_tiles_x;
+    guint const tiles_y = priv->mesh_tiles_y;
+    float const tile_s = 1.0f / tiles_x;
+    float const tile_t = 1.0f / tiles_y;
+    CoglVertexP2T2 *vertex = priv->mesh_vertices;
+
+    BezierPatch const patch (*priv->model);
+    wobbly::Point const probe = priv->model->DeformTexcoords (wobbly::Point (0.5f, 0.5f));
+    wobbly::Point const fitted = patch.Evaluate (0.5f, 0.5f);
+
+    if (std::fabs (bg::get <0> (probe) - bg::get <0> (fitted)) < patch_tolerance &&
+        std::fabs (bg::get <1> (probe) - bg::get <1> (fitted)) < patch_tolerance)
+    {
+        std::vector <CubicBasis> column_basis (tiles_x + 1);
+
+        for (guint j = 0; j <= tiles_x; ++j)
+            column_basis[j] = bernstein_basis (j * tile_s);
+
+        for (guint i = 0; i <= tiles_y; ++i)
         {
-            remove_anchor_if_pending (priv);
+            float const t = i * tile_t;
+            float row_x[4], row_y[4];
+
+            patch.Row (t, row_x, row_y);
 
-            /* Also disable the effect */
-            clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (wobbly_effect),
-                                            FALSE);
+            for (guint j = 0; j <= tiles_x; ++j, ++vertex)
+            {
+                CubicBasis const &b = column_basis[j];
+
+                vertex->x = b[0] * row_x[0] + b[1] * row_x[1] + b[2] * row_x[2] + b[3] * row_x[3];
+                vertex->y = b[0] * row_y[0] + b[1] * row_y[1] + b[2] * row_y[2] + b[3] * row_y[3];
+                vertex->s = j * tile_s;
+                vertex->t = t;
+            }
+        }
+    }
+    else
+    {
+        for (guint i = 0; i <= tiles_y; ++i)
+        {
+            float const t = i * tile_t;
 
-            /* Finally, return false so that we don't keep animating */
-            priv->timeout_id = 0;
-            return FALSE;
+            for (guint j = 0; j <= tiles_x; ++j, ++vertex)
+            {
+                float const s = j * tile_s;
+                wobbly::Point const deformed =
+                    priv->model->DeformTexcoords (wobbly::Point (t, s));
+
+                vertex->x = bg::get <0> (deformed);
+                vertex->y = bg::get <1> (deformed);
+                vertex->s = s;
+                vertex->t = t;
+            }
         }
     }
 
-    /* We always want to return true even if there was no time delta */
-    return TRUE;
+    cogl_buffer_set_data (COGL_BUFFER (priv->mesh_buffer),
+                          0,
+                          priv->mesh_vertices,
+                          (vertex - priv->mesh_vertices) * sizeof (CoglVertexP2T2));
+
+    priv->mesh_dirty = false;
 }
 
 static void
-endless_shell_fx_wobbly_ensure_timeline (EndlessShellFXWobbly *wobbly_effect)
+endless_shell_fx_wobbly_paint_target (ClutterOffscreenEffect *effect)
 {
+    EndlessShellFXWobbly *wobbly_effect =
+        ENDLESS_SHELL_FX_WOBBLY (effect);
     EndlessShellFXWobblyPrivate *priv =
         reinterpret_cast <EndlessShellFXWobblyPrivate *> (endless_shell_fx_wobbly_get_instance_private (wobbly_effect));
 
-    if (!priv->timeout_id)
+    if (!priv->model)
     {
-        static const unsigned int frame_length_ms = 16; // 60 / 1000;
-
-        priv->last_msecs = g_get_monotonic_time ();
-        priv->timeout_id = g_timeout_add (frame_length_ms, endless_shell_fx_wobbly_new_frame, wobbly_effect);
+        CLUTTER_OFFSCREEN_EFFECT_CLASS (endless_shell_fx_wobbly_parent_class)->paint_target (effect);
+        return;
     }
+
+    /* ClutterDeformEffect:n-tiles is the finest the grid gets */
+    guint max_tiles_x, max_tiles_y;
+    clutter_deform_effect_get_n_tiles (CLUTTER_DEFORM_EFFECT (effect),
+                                       &max_tiles_x,
+                                       &max_tiles_y);
+
+    guint tiles =
+        endless_shell_fx_wobbly_tiles_for_displacement (priv->displacement,
+                                                        std::max (max_tiles_x, max_tiles_y));
+    endless_shell_fx_wobbly_ensure_mesh (priv,
+                                         std::min (tiles, max_tiles_x),
+                                         std::min (tiles, max_tiles_y));
+
+    if (priv->mesh_dirty)
+        endless_shell_fx_wobbly_deform_mesh (priv);
+
+    ClutterActor *actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+    CoglPipeline *pipeline = COGL_PIPELINE (clutter_offscreen_effect_get_target (effect));
+    guint8 paint_opacity = clutter_actor_get_paint_opacity (actor);
+
+    cogl_pipeline_set_color4ub (pipeline,
+                                paint_opacity,
+                                paint_opacity,
+                                paint_opacity,
+                                paint_opacity);
+    cogl_framebuffer_draw_primitive (cogl_get_draw_framebuffer (),
+                                     pipeline,
+                                     priv->mesh);
 }
 
 void
@@ -275,6 +845,8 @@ endless_shell_fx_wobbly_grab (EndlessShellFXWobbly *effect,
 
     if (priv->model)
     {
+        priv->mesh_dirty = true;
+
         /* Make sure to move the model to the actor's current position first
          * as it may have changed in the meantime */
         priv->model->MoveModelTo (wobbly::Point (0, 0));
@@ -300,7 +872,7 @@ endless_shell_fx_wobbly_ungrab (EndlessShellFXWobbly *effect)
     /* Don't immediately ungrab. We can be a little bit more
      * clever here and make the ungrab pending on the completion
      * of the animation */
-    if (priv->timeout_id)
+    if (priv->animating)
         priv->ungrab_pending = true;
     else
     {
@@ -323,6 +895,7 @@ endless_shell_fx_wobbly_move_by (EndlessShellFXWobbly *effect,
 
         endless_shell_fx_wobbly_ensure_timeline (effect);
         priv->anchor->MoveBy (delta);
+        priv->mesh_dirty = true;
 
         wobbly::Vector reverse_delta (delta);
         bg::multiply_value (reverse_delta, -1);
@@ -386,7 +959,10 @@ endless_shell_fx_wobbly_size_changed (GObject    *object,
         remove_anchor_if_pending (priv);
 
         priv->model->ResizeModel (actor_width, actor_height);
+        priv->model_width = actor_width;
+        priv->model_height = actor_height;
         priv->model->MoveModelTo (wobbly::Point (0, 0));
+        priv->mesh_dirty = true;
 
     }
 }
@@ -419,11 +995,8 @@ endless_shell_fx_wobbly_set_actor (ClutterActorMeta *actor_meta,
         priv->model = nullptr;
     }
 
-    if (priv->timeout_id)
-    {
-        g_source_remove (priv->timeout_id);
-        priv->timeout_id = 0;
-    }
+    endless_shell_fx_wobbly_stop_timeline (wobbly_effect);
+    priv->mesh_dirty = true;
 
     if (prev_actor)
     {
@@ -446,6 +1019,9 @@ endless_shell_fx_wobbly_set_actor (ClutterActorMeta *actor_meta,
                                          actor_width,
                                          actor_height,
                                          priv->model_settings);
+        priv->model_width = actor_width;
+        priv->model_height = actor_height;
+        priv->displacement = 0.0f;
 
         priv->width_changed_signal =
             g_signal_connect_object (actor,
@@ -497,6 +1073,28 @@ endless_shell_fx_wobbly_set_property (GObject      *object,
     }
 }
 
+static void
+endless_shell_fx_wobbly_get_property (GObject    *object,
+                                      guint      prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+    EndlessShellFXWobbly *wobbly_effect =
+        reinterpret_cast <EndlessShellFXWobbly *> (object);
+    EndlessShellFXWobblyPrivate *priv =
+        reinterpret_cast <EndlessShellFXWobblyPrivate *> (endless_shell_fx_wobbly_get_instance_private (wobbly_effect));
+
+    switch (prop_id)
+    {
+        case PROP_SETTLED:
+            g_value_set_boolean (value, !priv->animating);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+}
+
 static void
 endless_shell_fx_wobbly_finalize (GObject *object)
 {
@@ -508,11 +1106,11 @@ endless_shell_fx_wobbly_finalize (GObject *object)
     if (priv->model)
         delete priv->model;
 
-    if (priv->timeout_id)
-    {
-        g_source_remove (priv->timeout_id);
-        priv->timeout_id = 0;
-    }
+    /* Too late to notify anyone that we settled */
+    if (priv->animating)
+        ModelScheduler::Get ().Remove (wobbly_effect);
+
+    endless_shell_fx_wobbly_free_mesh (priv);
 
     G_OBJECT_CLASS (endless_shell_fx_wobbly_parent_class)->finalize (object);
 }
@@ -535,15 +1133,16 @@ endless_shell_fx_wobbly_class_init (EndlessShellFXWobblyClass *klass)
         CLUTTER_ACTOR_META_CLASS (klass);
     ClutterEffectClass *effect_class =
         CLUTTER_EFFECT_CLASS (klass);
-    ClutterDeformEffectClass *deform_class =
-        CLUTTER_DEFORM_EFFECT_CLASS (klass);
+    ClutterOffscreenEffectClass *offscreen_class =
+        CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
 
     object_class->set_property = endless_shell_fx_wobbly_set_property;
+    object_class->get_property = endless_shell_fx_wobbly_get_property;
     object_class->finalize = endless_shell_fx_wobbly_finalize;
     meta_class->set_actor = endless_shell_fx_wobbly_set_actor;
     effect_class->pre_paint = endless_shell_fx_wobbly_pre_paint;
     effect_class->get_paint_volume = endless_shell_fx_wobbly_get_paint_volume;
-    deform_class->deform_vertex = endless_shell_fx_wobbly_deform_vertex;
+    offscreen_class->paint_target = endless_shell_fx_wobbly_paint_target;
 
     object_properties[PROP_SPRING_K] =
         g_param_spec_double ("spring-k",
@@ -573,6 +1172,15 @@ endless_shell_fx_wobbly_class_init (EndlessShellFXWobblyClass *klass)
                              10.0f, 500.0f, 100.0f,
                              G_PARAM_WRITABLE);
 
+    /* The effect may already be disabled while the model is still
+     * coming to rest, so this is what to watch to know it stopped */
+    object_properties[PROP_SETTLED] =
+        g_param_spec_boolean ("settled",
+                              "Settled",
+                              "Whether the model has come to rest",
+                              TRUE,
+                              G_PARAM_READABLE);
+
     g_object_class_install_properties (object_class, PROP_LAST, object_properties);
 }
 
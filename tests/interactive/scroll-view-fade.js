@@ -0,0 +1,52 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Clutter = imports.gi.Clutter;
+const St = imports.gi.St;
+
+const UI = imports.testcommon.ui;
+
+// The fade of a scroll view over a plain background is painted as an
+// overlay, without an offscreen; one over a gradient still goes through
+// the shader. Both scroll views sit away from their parent's origin, and
+// their fades should look the same and cover the edges of the content,
+// not a box shifted by the scroll view's position.
+
+function addScrollView(parent, style) {
+    let v = new St.ScrollView({ style: style + '-st-vfade-offset: 40px;' +
+                                              'padding: 5px;' });
+    parent.add(v, { expand: true });
+
+    let b = new St.BoxLayout({ vertical: true });
+    v.add_actor(b);
+
+    for (let i = 0; i < 60; i++)
+        b.add(new St.Label({ text: 'Line ' + (i + 1) + ' of the scroll view ' +
+                                   'with a fade at both ends' }));
+}
+
+function test() {
+    let stage = new Clutter.Stage();
+    UI.init(stage);
+
+    let hbox = new St.BoxLayout({ width: stage.width,
+                                  height: stage.height,
+                                  style: 'padding: 10px; spacing: 10px;' });
+    stage.add_actor(hbox);
+
+    let plain = new St.BoxLayout({ vertical: true,
+                                   style: 'padding: 60px 30px; background: #dddddd;' });
+    hbox.add(plain, { expand: true });
+    plain.add(new St.Label({ text: 'Overlay' }));
+    addScrollView(plain, 'background: #dddddd;');
+
+    let gradient = new St.BoxLayout({ vertical: true,
+                                      style: 'padding: 60px 30px; background: #dddddd;' });
+    hbox.add(gradient, { expand: true });
+    gradient.add(new St.Label({ text: 'Shader' }));
+    addScrollView(gradient, 'background-gradient-direction: vertical;' +
+                            'background-gradient-start: #dddddd;' +
+                            'background-gradient-end: #d0d0d0;');
+
+    UI.main(stage);
+}
+test();
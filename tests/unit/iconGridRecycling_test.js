@@ -0,0 +1,105 @@
+/* -*- mode: js2; js2-basic-offset: 4; indent-tabs-mode: nil -*- */
+const Clutter = imports.gi.Clutter;
+const GLib = imports.gi.GLib;
+
+function resetEnvironment() {
+    let settings = jasmine.createSpyObj('settings', [
+        'connect',
+        'get_boolean',
+        'get_value',
+        'reset',
+    ]);
+    settings.get_value.and.returnValue(new GLib.Variant('a{sv}',
+        [new GLib.Variant('{sv}', ['desktop', new GLib.Variant('as', [])])]));
+    settings.get_boolean.and.returnValue(true);
+
+    window.global = {
+        settings: settings,
+    };
+    window._ = (str) => str;
+    window.C_ = (ctx, str) => str;
+}
+resetEnvironment();  // Needed for following import
+
+const IconGrid = imports.ui.iconGrid;
+const Main = imports.ui.main;
+const Tweener = imports.ui.tweener;
+
+describe('Virtualized icon grid', function() {
+    let grid, updated;
+
+    beforeEach(function() {
+        resetEnvironment();
+        Main.layoutManager = jasmine.createSpyObj('layoutManager', ['connect']);
+
+        updated = [];
+        grid = new IconGrid.IconGrid({
+            virtualized: true,
+            createItem: function(index) {
+                return new Clutter.Actor();
+            },
+            updateItem: function(actor, index) {
+                updated.push([actor, index]);
+                return index >= 0;
+            }
+        });
+    });
+
+    afterEach(function() {
+        grid.actor.destroy();
+    });
+
+    it('hands recycled actors back to be shown again', function() {
+        let actor = new Clutter.Actor();
+        grid._recycledItems.push(actor);
+
+        expect(grid._takeRecycledItem(3)).toBe(actor);
+        expect(updated).toEqual([[actor, 3]]);
+        expect(grid._recycledItems.length).toEqual(0);
+    });
+
+    it('resets what animations left on recycled actors', function() {
+        let actor = new Clutter.Actor({ translation_x: 12,
+                                        translation_y: -4,
+                                        scale_x: 0,
+                                        scale_y: 0,
+                                        opacity: 0 });
+        grid._recycledItems.push(actor);
+        spyOn(Tweener, 'removeTweens');
+
+        grid._takeRecycledItem(0);
+
+        expect(Tweener.removeTweens).toHaveBeenCalledWith(actor);
+        expect(actor.translation_x).toEqual(0);
+        expect(actor.translation_y).toEqual(0);
+        expect(actor.scale_x).toEqual(1);
+        expect(actor.scale_y).toEqual(1);
+        expect(actor.opacity).toEqual(255);
+    });
+
+    it('resets actors before they are rebound', function() {
+        let actor = new Clutter.Actor({ opacity: 0 });
+        grid._recycledItems.push(actor);
+
+        let opacity = -1;
+        grid._updateItem = function(actor, index) {
+            opacity = actor.opacity;
+            return true;
+        };
+
+        grid._takeRecycledItem(0);
+        expect(opacity).toEqual(255);
+    });
+
+    it('destroys actors that can not be rebound', function() {
+        let destroyed = false;
+        let actor = new Clutter.Actor();
+        actor.connect('destroy', function() {
+            destroyed = true;
+        });
+        grid._recycledItems.push(actor);
+
+        expect(grid._takeRecycledItem(-1)).toBe(null);
+        expect(destroyed).toBe(true);
+    });
+});
@@ -0,0 +1,81 @@
+/* -*- mode: js2; js2-basic-offset: 4; indent-tabs-mode: nil -*- */
+const Util = imports.misc.util;
+const CoreEnvironment = imports.misc.coreEnvironment;
+
+function drain(queue) {
+    let items = [];
+    while (queue.length > 0)
+        items.push(queue.shift());
+    return items;
+}
+
+describe('Priority Queue Utility', function() {
+    beforeEach(function() {
+        CoreEnvironment.coreInit();
+    });
+    it('returns integers in order', function() {
+        let queue = new Util.PriorityQueue(function(one, two) {
+                                               return one - two;
+                                           });
+        [5, 3, 9, 1, 7, 2, 8].forEach(function(i) { queue.push(i); });
+        expect(queue.peek()).toEqual(1);
+        expect(drain(queue)).toEqual([1, 2, 3, 5, 7, 8, 9]);
+        expect(queue.shift()).toBe(null);
+    });
+    it('returns items that compare equal in the order they were pushed', function() {
+        let queue = new Util.PriorityQueue(function(one, two) {
+                                               return two.a - one.a;
+                                           });
+        let obj1 = { a: 1 };
+        let obj2 = { a: 2 };
+        let obj3 = { a: 1 };
+        let obj4 = { a: 2 };
+        let obj5 = { a: 1 };
+        [obj1, obj2, obj3, obj4, obj5].forEach(function(obj) { queue.push(obj); });
+        expect(drain(queue)).toEqual([obj2, obj4, obj1, obj3, obj5]);
+    });
+    it('keeps its order when items are removed', function() {
+        let queue = new Util.PriorityQueue(function(one, two) {
+                                               return one - two;
+                                           });
+        [4, 8, 1, 6, 3, 7].forEach(function(i) { queue.push(i); });
+        expect(queue.remove(1)).toBe(true);
+        expect(queue.remove(5)).toBe(false);
+        expect(queue.contains(1)).toBe(false);
+        expect(queue.contains(6)).toBe(true);
+        queue.removeAll(function(i) { return i % 2 == 1; });
+        expect(drain(queue)).toEqual([4, 6, 8]);
+    });
+    it('only queues an item once', function() {
+        let queue = new Util.PriorityQueue(function(one, two) {
+                                               return one.a - two.a;
+                                           });
+        let obj = { a: 1 };
+        queue.push(obj);
+        queue.push(obj);
+        expect(queue.length).toEqual(1);
+        expect(queue.remove(obj)).toBe(true);
+        expect(queue.contains(obj)).toBe(false);
+    });
+    it('finds items by their key', function() {
+        let queue = new Util.PriorityQueue(function(one, two) {
+                                               return one.a - two.a;
+                                           }, function(obj) {
+                                               return obj.key;
+                                           });
+        let obj1 = { a: 3, key: 'x' };
+        let obj2 = { a: 1, key: 'y' };
+        let obj3 = { a: 2, key: 'x' };
+        [obj1, obj2, obj3].forEach(function(obj) { queue.push(obj); });
+        let isFirst = function(obj) { return obj.a < 3; };
+        expect(queue.findByKey('x', isFirst)).toBe(obj3);
+        expect(queue.findByKey('z', isFirst)).toBe(null);
+        queue.remove(obj3);
+        expect(queue.findByKey('x', isFirst)).toBe(null);
+        expect(queue.shift()).toBe(obj2);
+        expect(queue.findByKey('y', isFirst)).toBe(null);
+        queue.removeAll(function(obj) { return obj.a == 3; });
+        expect(queue.findByKey('x', function() { return true; })).toBe(null);
+        expect(queue.length).toEqual(0);
+    });
+});